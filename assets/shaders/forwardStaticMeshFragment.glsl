@@ -25,47 +25,58 @@ uniform bool u_hasSpecular = false;
 uniform bool u_hasNormal = false;
 uniform bool u_hasHeight = false;
 
+// Same layout as engine::ClusteredPointLight
 struct PointLight {
-    vec3 posInViewSpace;
-    vec3 color;
-    float intensity;
-    float attenuation;
+    vec4 positionAndRadius; // In view space
+    vec4 colorAndIntensity;
+    vec4 attenuation;
 };
 
 #ifdef USE_SHADOW_MAPPING
-
-#define MAX_SHADOW_MAP_LEVELS 5
 #define SHADOW_CALCULATIONS_BIAS 0.00025
+#endif // USE_SHADOW_MAPPING
 
+// MAX_SHADOW_MAP_LEVELS and MAX_DIRECTIONAL_LIGHTS are defined by the ShaderLibrary. The shadow
+// fields are in every variant so the Lights block has the same layout in all of them
 struct ShadowMapLevel {
     mat4 cameraSpaceToLightSpace;
     float cutoffDistance;
 };
 
-#endif // USE_SHADOW_MAPPING
-
 struct DirectionalLight {
     vec3 directionInViewSpace;
     vec3 color;
     float intensity;
-#ifdef USE_SHADOW_MAPPING
     ShadowMapLevel shadowMapLevels[MAX_SHADOW_MAP_LEVELS];
     int numOfShadowMapLevels;
-#endif // USE_SHADOW_MAPPING
 };
 
+// The view frustum is split in clusters and each one has the range of u_lightClusterIndices with
+// the point lights that reach it
+layout (std430, binding = 0) readonly buffer PointLights {
+    PointLight u_pointLights[];
+};
+layout (std430, binding = 1) readonly buffer LightClusters {
+    uvec2 u_lightClusters[]; // offset, count
+};
+layout (std430, binding = 2) readonly buffer LightClusterIndices {
+    uint u_lightClusterIndices[];
+};
 
-#define MAX_LIGHTS 10
-#define MAX_DIRECTIONAL_LIGHTS 10
-
-uniform PointLight u_pointLights[MAX_LIGHTS];
-uniform int u_numOfPointLights;
+// Same layout as engine::ForwardMeshLightsBlock, each renderer that draws with the program binds
+// its own buffer
+layout (std140, binding = 1) uniform Lights {
+    DirectionalLight u_directionalLights[MAX_DIRECTIONAL_LIGHTS];
+    uvec3 u_clusterGridSize; // Zero when there are no light clusters (no point lights)
+    int u_numOfDirectionalLights;
+    float u_clusterDepthScale;
+    float u_clusterDepthBias;
+};
 
-uniform DirectionalLight u_directionalLights[MAX_DIRECTIONAL_LIGHTS];
 #ifdef USE_SHADOW_MAPPING
-uniform sampler2D u_directionalLightsShadowMapAtlas[MAX_DIRECTIONAL_LIGHTS];
+// In the texture units [0, MAX_DIRECTIONAL_LIGHTS), the one of each light in its index
+layout (binding = 0) uniform sampler2D u_directionalLightsShadowMapAtlas[MAX_DIRECTIONAL_LIGHTS];
 #endif // USE_SHADOW_MAPPING
-uniform int u_numOfDirectionalLights;
 
 #ifdef USE_SHADOW_MAPPING
 float shadowCalculation(uint lightIndex, vec4 fragPosLightSpace, uint level, float bias)
@@ -202,18 +213,43 @@ vec3 directionalLightCalculations(uint lightIndex, vec3 color, vec3 normal, vec3
 vec3 pointLightCalculations(uint lightIndex, vec3 color, vec3 normal, vec3 spec)
 {
     PointLight light = u_pointLights[lightIndex];
-    vec3 lightDir = normalize(o_position - light.posInViewSpace);
+    vec3 lightPosition = light.positionAndRadius.xyz;
+    vec3 lightColor = light.colorAndIntensity.rgb;
+    float intensity = light.colorAndIntensity.a;
+
+    vec3 lightDir = normalize(o_position - lightPosition);
     float diffuse = max(dot(normal, -lightDir), 0.0);
 
     vec3 viewDir = normalize(o_position);
     vec3 reflectDirection = reflect(lightDir, normal);
     vec3 specular = pow(max(dot(-viewDir, reflectDirection), 0.0), 16) * spec;
 
-    float distance = length(light.posInViewSpace - o_position);
-    float attenuation = 1.0 / (1.0 + light.attenuation*distance*distance);
+    float distance = length(lightPosition - o_position);
+    float attenuation = 1.0 / (1.0 + light.attenuation.x*distance*distance);
+
+    // Fade to zero at the radius used to assign the light to clusters so there are no seams
+    // between the clusters that have the light and the ones that dont
+    float falloff = clamp(1.0 - pow(distance / light.positionAndRadius.w, 4.0), 0.0, 1.0);
+    attenuation *= falloff * falloff;
 
-    return diffuse * color * light.intensity * light.color * attenuation
-        + specular * light.color * light.intensity * attenuation;
+    return diffuse * color * intensity * lightColor * attenuation
+        + specular * lightColor * intensity * attenuation;
+}
+
+uvec2 getLightCluster()
+{
+    // Same calculation as LightClusters::getClusterIndex
+    vec4 clipPosition = u_projectionMatrix * vec4(o_position, 1.0);
+    vec2 tile = (clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(u_clusterGridSize.xy);
+    float slice = floor(log(-o_position.z) * u_clusterDepthScale + u_clusterDepthBias);
+    uvec3 cluster = uvec3(clamp(
+        ivec3(floor(tile), slice),
+        ivec3(0),
+        ivec3(u_clusterGridSize) - 1));
+    return u_lightClusters[
+        cluster.x
+        + cluster.y * u_clusterGridSize.x
+        + cluster.z * u_clusterGridSize.x * u_clusterGridSize.y];
 }
 
 void main()
@@ -269,9 +305,13 @@ void main()
         final += directionalLightCalculations(i, color, normal, spec);
     }
 
-    for (int i = 0; i < u_numOfPointLights; i++)
+    if (u_clusterGridSize.x > 0)
     {
-        final += pointLightCalculations(i, color, normal, spec);
+        uvec2 cluster = getLightCluster();
+        for (uint i = 0; i < cluster.y; i++)
+        {
+            final += pointLightCalculations(u_lightClusterIndices[cluster.x + i], color, normal, spec);
+        }
     }
 
     outColor = vec4(final + ambient, 1.0);
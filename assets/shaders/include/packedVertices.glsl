@@ -0,0 +1,21 @@
+// Decoding of the attributes of Mesh::VertexFormat::packed
+
+// AABB of the mesh to dequantize the positions
+uniform vec3 u_positionOffset;
+uniform vec3 u_positionScale;
+
+vec3 dequantizePosition(vec3 position)
+{
+    return u_positionOffset + position * u_positionScale;
+}
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0.0)
+    {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
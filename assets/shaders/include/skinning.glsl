@@ -0,0 +1,26 @@
+// Bone matrices of the animated meshes and the blending of the influences of a vertex
+
+const int MAX_BONE_INFLUENCE = 4;
+#ifdef USE_PACKED_VERTICES
+const uint INVALID_BONE_ID = 0xFF;
+#else
+const uint INVALID_BONE_ID = 0xFFFFFFFF;
+#endif
+
+// Poses of every animated mesh of the frame, this one starts at u_firstBoneMatrix
+layout (std430, binding = 3) readonly buffer BoneMatrices {
+    mat4 u_boneMatrices[];
+};
+uniform uint u_firstBoneMatrix;
+
+mat4 getBoneTransform(uvec4 boneIds, vec4 boneWeights)
+{
+    mat4 boneTransform = mat4(0.0);
+    for (uint i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        if (boneIds[i] == INVALID_BONE_ID)
+            continue;
+        boneTransform += u_boneMatrices[u_firstBoneMatrix + boneIds[i]] * boneWeights[i];
+    }
+    return boneTransform;
+}
@@ -0,0 +1,65 @@
+#version 450 core
+
+// The same values as QuadMode in Renderer2D.cpp
+#define MODE_TEXTURE 0
+#define MODE_COVERAGE_TEXT 1
+#define MODE_DISTANCE_FIELD_TEXT 2
+
+layout (location = 0) in vec2 o_uv;
+layout (location = 1) in vec4 o_color;
+layout (location = 2) flat in uint o_textureIndex;
+layout (location = 3) flat in uint o_mode;
+
+out vec4 outColor;
+
+// The textures of the batch, bound to the first texture units
+layout (binding = 0) uniform sampler2D u_textures[MAX_TEXTURES_IN_BATCH];
+
+#if MAX_TEXTURES_IN_BATCH != 16
+#error "sampleTexture() has a case for each of the textures of a batch"
+#endif
+
+// Sampler arrays can only be indexed with dynamically uniform values, and the index changes
+// between the quads of a batch, so every sampler is read with a constant index. The
+// derivatives are passed because the neighbour pixels can take other cases
+vec4 sampleTexture(uint index, vec2 uv, vec2 dx, vec2 dy)
+{
+    switch (index)
+    {
+        case 0: return textureGrad(u_textures[0], uv, dx, dy);
+        case 1: return textureGrad(u_textures[1], uv, dx, dy);
+        case 2: return textureGrad(u_textures[2], uv, dx, dy);
+        case 3: return textureGrad(u_textures[3], uv, dx, dy);
+        case 4: return textureGrad(u_textures[4], uv, dx, dy);
+        case 5: return textureGrad(u_textures[5], uv, dx, dy);
+        case 6: return textureGrad(u_textures[6], uv, dx, dy);
+        case 7: return textureGrad(u_textures[7], uv, dx, dy);
+        case 8: return textureGrad(u_textures[8], uv, dx, dy);
+        case 9: return textureGrad(u_textures[9], uv, dx, dy);
+        case 10: return textureGrad(u_textures[10], uv, dx, dy);
+        case 11: return textureGrad(u_textures[11], uv, dx, dy);
+        case 12: return textureGrad(u_textures[12], uv, dx, dy);
+        case 13: return textureGrad(u_textures[13], uv, dx, dy);
+        case 14: return textureGrad(u_textures[14], uv, dx, dy);
+        case 15: return textureGrad(u_textures[15], uv, dx, dy);
+    }
+    return vec4(0.0);
+}
+
+void main()
+{
+    vec4 texel = sampleTexture(o_textureIndex, o_uv, dFdx(o_uv), dFdy(o_uv));
+
+    // The font atlases have a single channel so they are read from red. The distance field
+    // stores 0.5 on the edges of the glyphs and more inside them, the edge is smoothed over
+    // about a pixel of the screen at any scale. The derivative is taken outside the branches
+    float distance = texel.r;
+    float edgeWidth = max(fwidth(distance) * 0.5, 1e-4);
+
+    if (o_mode == MODE_COVERAGE_TEXT)
+        outColor = vec4(o_color.rgb, o_color.a * texel.r);
+    else if (o_mode == MODE_DISTANCE_FIELD_TEXT)
+        outColor = vec4(o_color.rgb, o_color.a * smoothstep(0.5 - edgeWidth, 0.5 + edgeWidth, distance));
+    else
+        outColor = texel * o_color;
+}
@@ -0,0 +1,23 @@
+#version 450 core
+
+layout (location = 0) in vec3 a_position;
+layout (location = 1) in vec2 a_uv;
+layout (location = 2) in vec4 a_color;
+layout (location = 3) in uint a_textureIndex;
+layout (location = 4) in uint a_mode;
+
+layout (location = 0) out vec2 o_uv;
+layout (location = 1) out vec4 o_color;
+layout (location = 2) flat out uint o_textureIndex;
+layout (location = 3) flat out uint o_mode;
+
+uniform mat4 u_viewProjection;
+
+void main()
+{
+    o_uv = a_uv;
+    o_color = a_color;
+    o_textureIndex = a_textureIndex;
+    o_mode = a_mode;
+    gl_Position = u_viewProjection * vec4(a_position, 1.0);
+}
@@ -1,33 +1,61 @@
 #version 450 core
 
+#ifdef USE_SINGLE_PASS_CASCADES
+// Any of them lets the vertex shader write gl_ViewportIndex
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+#endif
+
+#ifdef USE_PACKED_VERTICES
+layout (location = 0) in vec4 a_position; // unorm16 relative to the AABB
+#else
 layout (location = 0) in vec3 a_position;
+#endif
 #ifdef USE_SKINNING
 layout (location = 4) in uvec4 a_boneIds;
 layout (location = 5) in vec4 a_boneWeights;
 #endif
 
 #ifdef USE_SKINNING
-const int MAX_BONES = 100;
-const int MAX_BONE_INFLUENCE = 4;
-const uint INVALID_BONE_ID = 0xFFFFFFFF;
-uniform mat4 u_finalBonesMatrices[MAX_BONES];
+#include "include/skinning.glsl"
 #endif
 
+#ifdef USE_SINGLE_PASS_CASCADES
+// MAX_SHADOW_MAP_LEVELS is defined by the ShaderLibrary
+layout (std140, binding = 0) uniform ShadowMapLevels {
+    mat4 u_levelProjectionViews[MAX_SHADOW_MAP_LEVELS];
+};
+uniform mat4 u_modelMatrix;
+// Level each instance is drawn to, 4 bits per instance
+uniform uint u_instanceLevels;
+#else
 uniform mat4 u_lightSpaceModelMatrix;
+#endif
+
+#ifdef USE_PACKED_VERTICES
+#include "include/packedVertices.glsl"
+#endif
 
 void main()
 {
+#ifdef USE_PACKED_VERTICES
+    vec3 inPosition = dequantizePosition(a_position.xyz);
+#else
+    vec3 inPosition = a_position;
+#endif
+
 #ifdef USE_SKINNING
-    mat4 boneTransform = mat4(0.0);
-    for (uint i = 0; i < MAX_BONE_INFLUENCE; i++)
-    {
-        if (a_boneIds[i] == INVALID_BONE_ID)
-            continue;
-        boneTransform += u_finalBonesMatrices[a_boneIds[i]] * a_boneWeights[i];
-    }
-    vec4 position = boneTransform * vec4(a_position, 1.0);
+    mat4 boneTransform = getBoneTransform(a_boneIds, a_boneWeights);
+    vec4 position = boneTransform * vec4(inPosition, 1.0);
 #else
-    vec4 position = vec4(a_position, 1.0);
+    vec4 position = vec4(inPosition, 1.0);
 #endif
+#ifdef USE_SINGLE_PASS_CASCADES
+    // Every level has its own viewport in the atlas
+    uint level = (u_instanceLevels >> (4 * gl_InstanceID)) & 0xFu;
+    gl_ViewportIndex = int(level);
+    gl_Position = u_levelProjectionViews[level] * u_modelMatrix * position;
+#else
     gl_Position = u_lightSpaceModelMatrix * position;
+#endif
 }
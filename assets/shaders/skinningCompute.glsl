@@ -0,0 +1,89 @@
+#version 450 core
+
+// Skins the vertices of an animated mesh and writes them with the layout of the full
+// StaticMesh vertices so the result can be drawn as a static mesh in every pass
+
+layout (local_size_x = 64) in;
+
+#ifdef USE_PACKED_VERTICES
+const uint SOURCE_VERTEX_SIZE = 7; // In uints, AnimatedMesh::PackedVertex
+#else
+const uint SOURCE_VERTEX_SIZE = 19; // In uints, AnimatedMesh::Vertex
+#endif
+const uint SKINNED_VERTEX_SIZE = 11; // In floats, StaticMesh::Vertex
+
+#include "include/skinning.glsl"
+
+layout (std430, binding = 4) readonly buffer SourceVertices {
+    uint u_sourceVertices[];
+};
+layout (std430, binding = 5) writeonly buffer SkinnedVertices {
+    float u_skinnedVertices[];
+};
+
+uniform uint u_vertexCount;
+
+#ifdef USE_PACKED_VERTICES
+#include "include/packedVertices.glsl"
+#else
+vec3 readVec3(uint offset)
+{
+    return uintBitsToFloat(uvec3(
+        u_sourceVertices[offset],
+        u_sourceVertices[offset + 1],
+        u_sourceVertices[offset + 2]));
+}
+#endif
+
+void main()
+{
+    uint vertex = gl_GlobalInvocationID.x;
+    if (vertex >= u_vertexCount)
+        return;
+
+    uint source = vertex * SOURCE_VERTEX_SIZE;
+#ifdef USE_PACKED_VERTICES
+    vec3 position = dequantizePosition(vec3(
+        unpackUnorm2x16(u_sourceVertices[source]),
+        unpackUnorm2x16(u_sourceVertices[source + 1]).x));
+    vec3 normal = decodeOctahedral(unpackSnorm2x16(u_sourceVertices[source + 2]));
+    vec3 tangent = decodeOctahedral(unpackSnorm2x16(u_sourceVertices[source + 3]));
+    vec2 uvCoords = unpackHalf2x16(u_sourceVertices[source + 4]);
+    uint packedBoneIds = u_sourceVertices[source + 5];
+    uvec4 boneIds = uvec4(
+        packedBoneIds & 0xFFu,
+        (packedBoneIds >> 8) & 0xFFu,
+        (packedBoneIds >> 16) & 0xFFu,
+        packedBoneIds >> 24);
+    vec4 boneWeights = unpackUnorm4x8(u_sourceVertices[source + 6]);
+#else
+    vec3 position = readVec3(source);
+    vec3 normal = readVec3(source + 3);
+    vec3 tangent = readVec3(source + 6);
+    vec2 uvCoords = uintBitsToFloat(uvec2(u_sourceVertices[source + 9], u_sourceVertices[source + 10]));
+    uvec4 boneIds = uvec4(
+        u_sourceVertices[source + 11],
+        u_sourceVertices[source + 12],
+        u_sourceVertices[source + 13],
+        u_sourceVertices[source + 14]);
+    vec4 boneWeights = uintBitsToFloat(uvec4(
+        u_sourceVertices[source + 15],
+        u_sourceVertices[source + 16],
+        u_sourceVertices[source + 17],
+        u_sourceVertices[source + 18]));
+#endif
+
+    mat4 boneTransform = getBoneTransform(boneIds, boneWeights);
+    vec3 skinnedPosition = vec3(boneTransform * vec4(position, 1.0));
+    vec3 skinnedNormal = normalize(vec3(boneTransform * vec4(normal, 0.0)));
+    vec3 skinnedTangent = normalize(vec3(boneTransform * vec4(tangent, 0.0)));
+
+    uint destination = vertex * SKINNED_VERTEX_SIZE;
+    float values[SKINNED_VERTEX_SIZE] = float[](
+        skinnedPosition.x, skinnedPosition.y, skinnedPosition.z,
+        skinnedNormal.x, skinnedNormal.y, skinnedNormal.z,
+        skinnedTangent.x, skinnedTangent.y, skinnedTangent.z,
+        uvCoords.x, uvCoords.y);
+    for (uint i = 0; i < SKINNED_VERTEX_SIZE; i++)
+        u_skinnedVertices[destination + i] = values[i];
+}
@@ -1,23 +1,88 @@
 #include "engine/assets/AnimatedMesh.hpp"
 
+#include "engine/assets/VertexPacking.hpp"
+
+#include <vector>
+
 AnimatedMesh::AnimatedMesh(std::span<const Vertex> vertices, 
      std::span<const uint32_t> indices, 
-     Skeleton &&skeleton)
-    : m_skeleton(std::move(skeleton))
+     std::span<const Lod> lods,
+     const AxisAlignedBoundingBox &aabb,
+     Skeleton &&skeleton,
+     VertexFormat vertexFormat)
+    : m_aabb(aabb),
+      m_vertexFormat(vertexFormat),
+      m_vertexCount(vertices.size()),
+      m_lods(lods.begin(), lods.end()),
+      m_skeleton(std::move(skeleton))
 {
+    if (m_lods.empty())
+        m_lods.push_back({.firstIndex = 0, .indexCount = uint32_t(indices.size()), .error = 0.0f});
+
+    // Bone ids have to fit in 8 bits with one value reserved for unused influences
+    if (m_vertexFormat == VertexFormat::packed && m_skeleton.bones.size() > INVALID_PACKED_BONE_ID)
+    {
+        WARN("Skeleton has {} bones, too many for packed vertices. Using full vertices",
+            m_skeleton.bones.size());
+        m_vertexFormat = VertexFormat::full;
+    }
+
     m_vertex_array = std::make_shared<VertexArray>();
 
-    m_vertex_buffer = std::make_shared<VertexBuffer>(
-        vertices.data(),
-        vertices.size() * sizeof(vertices[0]));
-    m_vertex_buffer->setLayout({
-        {ShaderDataType::float3, "a_position"},
-        {ShaderDataType::float3, "a_normal"},
-        {ShaderDataType::float3, "a_tangent"},
-        {ShaderDataType::float2, "a_uvCoords"},
-        {ShaderDataType::uint4,  "a_boneIds"},
-        {ShaderDataType::float4, "a_boneWeights"}
-    });
+    switch (m_vertexFormat) {
+    case VertexFormat::full:
+        m_vertex_buffer = std::make_shared<VertexBuffer>(
+            vertices.data(),
+            vertices.size() * sizeof(vertices[0]));
+        m_vertex_buffer->setLayout({
+            {ShaderDataType::float3, "a_position"},
+            {ShaderDataType::float3, "a_normal"},
+            {ShaderDataType::float3, "a_tangent"},
+            {ShaderDataType::float2, "a_uvCoords"},
+            {ShaderDataType::uint4,  "a_boneIds"},
+            {ShaderDataType::float4, "a_boneWeights"}
+        });
+        break;
+    case VertexFormat::packed:
+        {
+            std::vector<PackedVertex> packedVertices(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                glm::u8vec4 boneIDs;
+                for (glm::length_t j = 0; j < 4; j++)
+                {
+                    boneIDs[j] = vertices[i].boneIDs[j] < m_skeleton.bones.size()
+                        ? static_cast<uint8_t>(vertices[i].boneIDs[j])
+                        : INVALID_PACKED_BONE_ID;
+                }
+
+                packedVertices[i] = {
+                    .position = engine::packing::packPositionUnorm16(vertices[i].position, m_aabb),
+                    .normal = engine::packing::packOctahedralSnorm16(vertices[i].normal),
+                    .tangent = engine::packing::packOctahedralSnorm16(vertices[i].tangent),
+                    .texture = engine::packing::packHalf2(vertices[i].texture),
+                    .boneIDs = boneIDs,
+                    .boneWeights = engine::packing::packWeightsUnorm8(vertices[i].boneWeights),
+                };
+            }
+
+            m_vertex_buffer = std::make_shared<VertexBuffer>(
+                packedVertices.data(),
+                packedVertices.size() * sizeof(packedVertices[0]));
+            m_vertex_buffer->setLayout({
+                {ShaderDataType::ushort4, "a_position", true},
+                {ShaderDataType::short2,  "a_normal", true},
+                {ShaderDataType::short2,  "a_tangent", true},
+                {ShaderDataType::half2,   "a_uvCoords"},
+                {ShaderDataType::ubyte4,  "a_boneIds"},
+                {ShaderDataType::ubyte4,  "a_boneWeights", true}
+            });
+            break;
+        }
+    default:
+        ASSERT_MSG(false, "Invalid vertex format!");
+        break;
+    }
 
     m_vertex_array->addVertexBuffer(m_vertex_buffer);
 
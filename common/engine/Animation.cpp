@@ -1,5 +1,6 @@
 #include "engine/assets/Animation.hpp"
 
+#include "engine/FrameArena.hpp"
 #include "utils/Assert.hpp"
 
 #include <glm/common.hpp>
@@ -9,10 +10,22 @@
 #include <glm/matrix.hpp>
 #include <limits>
 
-std::vector<glm::mat4> Animation::getTransformations(float time, const Skeleton &skeleton) const
+size_t Animation::getMemorySize() const
 {
-    std::vector<glm::mat4> result(m_boneKeyframes.size(), glm::mat4(1.0f));
-    std::vector<glm::mat4> boneTransforms(m_boneKeyframes.size());
+    size_t size = m_boneKeyframes.size() * sizeof(BoneKeyFrames);
+    for (const BoneKeyFrames &boneKeyframes : m_boneKeyframes)
+    {
+        size += boneKeyframes.positions.size() * sizeof(PositionKeyFrame)
+            + boneKeyframes.rotations.size() * sizeof(RotationKeyFrame)
+            + boneKeyframes.scalings.size() * sizeof(ScaleKeyFrame);
+    }
+    return size;
+}
+
+void Animation::getTransformations(float time, const Skeleton &skeleton, std::span<glm::mat4> out) const
+{
+    ASSERT(out.size() >= m_boneKeyframes.size());
+    std::pmr::vector<glm::mat4> boneTransforms(m_boneKeyframes.size(), &engine::FrameArena::get());
 
     for (BoneID boneId = 0; boneId < m_boneKeyframes.size(); boneId++)
     {
@@ -31,10 +44,8 @@ std::vector<glm::mat4> Animation::getTransformations(float time, const Skeleton
             ? animation
             : boneTransforms[bone.parentID] * animation;
 
-        result[boneId] = boneTransforms[boneId] * bone.offsetMatrix;
+        out[boneId] = boneTransforms[boneId] * bone.offsetMatrix;
     }
-
-    return result;
 }
 
 glm::vec3 Animation::getPosition(BoneID bone, float time) const
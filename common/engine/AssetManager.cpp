@@ -6,6 +6,7 @@
 #include "engine/assets/Material.hpp"
 #include "engine/assets/Animation.hpp"
 #include "engine/assets/Font.hpp"
+#include "utils/MemoryTracker.hpp"
 
 const StaticMesh *AssetManager::get(StaticMeshId id) const
 {
@@ -183,8 +184,38 @@ bool AssetManager::move(FontId from, FontId to)
 }
 
 
+// Puts the indices of every level of detail after the ones of the full mesh in combinedIndices
+// so they all share the same index buffer
+std::vector<Mesh::Lod> combineLodIndices(
+    const std::vector<uint32_t> &indices,
+    const std::vector<paca::fileformats::MeshLod> &lods,
+    std::vector<uint32_t> &combinedIndices)
+{
+    size_t indexCount = indices.size();
+    for (const paca::fileformats::MeshLod &lod : lods)
+        indexCount += lod.indices.size();
+    combinedIndices.reserve(indexCount);
+    combinedIndices.assign(indices.begin(), indices.end());
+
+    std::vector<Mesh::Lod> result;
+    result.push_back({.firstIndex = 0, .indexCount = uint32_t(indices.size()), .error = 0.0f});
+    for (const paca::fileformats::MeshLod &lod : lods)
+    {
+        result.push_back({
+            .firstIndex = uint32_t(combinedIndices.size()),
+            .indexCount = uint32_t(lod.indices.size()),
+            .error = lod.error,
+        });
+        combinedIndices.insert(combinedIndices.end(), lod.indices.begin(), lod.indices.end());
+    }
+    return result;
+}
+
 void AssetManager::add(paca::fileformats::StaticMesh &staticMesh)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
+    std::vector<uint32_t> indices;
+    const std::vector<Mesh::Lod> lods = combineLodIndices(staticMesh.indices, staticMesh.lods, indices);
     const auto it = m_staticMeshes.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(StaticMeshId(staticMesh.id)),
@@ -194,17 +225,19 @@ void AssetManager::add(paca::fileformats::StaticMesh &staticMesh)
                 reinterpret_cast<StaticMesh::Vertex*>(staticMesh.vertices.data()),
                 staticMesh.vertices.size()
             },
-            std::span
-            {
-                staticMesh.indices
-            },
-            AxisAlignedBoundingBox{staticMesh.aabb.min, staticMesh.aabb.max}));
+            std::span{indices},
+            std::span{lods},
+            AxisAlignedBoundingBox{staticMesh.aabb.min, staticMesh.aabb.max},
+            m_meshVertexFormat));
 
     ASSERT_MSG(it.second, "Error static mesh id {} is already on assets", staticMesh.id);
 }
 
 void AssetManager::add(paca::fileformats::AnimatedMesh &animatedMesh)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
+    std::vector<uint32_t> indices;
+    const std::vector<Mesh::Lod> lods = combineLodIndices(animatedMesh.indices, animatedMesh.lods, indices);
     const auto it = m_animatedMeshes.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(AnimatedMeshId(animatedMesh.id)),
@@ -214,17 +247,18 @@ void AssetManager::add(paca::fileformats::AnimatedMesh &animatedMesh)
                 reinterpret_cast<AnimatedMesh::Vertex*>(animatedMesh.vertices.data()),
                 animatedMesh.vertices.size()
             },
-            std::span
-            {
-                animatedMesh.indices
-            },
-            std::move(animatedMesh.skeleton)));
+            std::span{indices},
+            std::span{lods},
+            AxisAlignedBoundingBox{animatedMesh.aabb.min, animatedMesh.aabb.max},
+            std::move(animatedMesh.skeleton),
+            m_meshVertexFormat));
 
     ASSERT_MSG(it.second, "Error animated mesh id {} is already on assets", animatedMesh.id);
 }
 
 void AssetManager::add(paca::fileformats::Texture &texture)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     Texture::Format format;
     switch (texture.channels)
     {
@@ -256,6 +290,7 @@ void AssetManager::add(paca::fileformats::Texture &texture)
 
 void AssetManager::add(paca::fileformats::CubeMap &cubeMap)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     Texture::Format format;
     switch (cubeMap.channels)
     {
@@ -303,6 +338,7 @@ MaterialTextureType::Type pacaTextureTypeToMaterialTextureType(paca::fileformats
 
 void AssetManager::add(paca::fileformats::Material &material)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     MaterialSpecification materialSpec;
     for (uint32_t i = paca::fileformats::TextureType::none; i < paca::fileformats::TextureType::last; i++)
     {
@@ -323,6 +359,7 @@ void AssetManager::add(paca::fileformats::Material &material)
 
 void AssetManager::add(paca::fileformats::Animation &animation)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     const auto it = m_animations.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(AnimationId(animation.id)),
@@ -335,14 +372,32 @@ void AssetManager::add(paca::fileformats::Animation &animation)
 
 void AssetManager::add(paca::fileformats::Font &font)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     const auto it = m_fonts.emplace(
         std::piecewise_construct,
         std::forward_as_tuple(FontId(font.id)),
         std::forward_as_tuple(
             TextureId(font.atlasTextureId),
             font.fontHeight,
+            font.distanceFieldSpread,
             font.glyphs));
 
     ASSERT_MSG(it.second, "Error font id {} is already on assets", font.id);
 }
 
+
+AssetManager::MemoryUsage AssetManager::getMemoryUsage() const
+{
+    MemoryUsage usage;
+    for (const auto &[id, staticMesh] : m_staticMeshes)
+        usage.staticMeshes += staticMesh.getMemorySize();
+    for (const auto &[id, animatedMesh] : m_animatedMeshes)
+        usage.animatedMeshes += animatedMesh.getMemorySize();
+    for (const auto &[id, texture] : m_textures)
+        usage.textures += texture.getMemorySize();
+    for (const auto &[id, cubemap] : m_cubemaps)
+        usage.cubemaps += cubemap.getMemorySize();
+    for (const auto &[id, animation] : m_animations)
+        usage.animations += animation.getMemorySize();
+    return usage;
+}
@@ -39,12 +39,19 @@ DirectionalLightShadowMap::DirectionalLightShadowMap(
         .depthTextureAttachment = std::move(depthTexture),
         .colorTextureAttachments = {},
     });
+
+    staticCasterAtlas.init(Texture::Specification{
+        .width = width,
+        .height = height,
+        .format = Texture::Format::depth24,
+    });
 }
 
 DirectionalLightShadowMap::DirectionalLightShadowMap(DirectionalLightShadowMap &&source)
     : shadowMapSize(source.shadowMapSize),
       levelCount(source.levelCount),
-      shadowMapAtlasFramebuffer(std::move(source.shadowMapAtlasFramebuffer))
+      shadowMapAtlasFramebuffer(std::move(source.shadowMapAtlasFramebuffer)),
+      staticCasterAtlas(std::move(source.staticCasterAtlas))
 {
     for(int i = 0; i < levelCount; i++)
     {
@@ -57,6 +64,7 @@ DirectionalLightShadowMap &DirectionalLightShadowMap::operator=(DirectionalLight
     shadowMapSize = source.shadowMapSize;
     levelCount = source.levelCount;
     shadowMapAtlasFramebuffer = std::move(source.shadowMapAtlasFramebuffer);
+    staticCasterAtlas = std::move(source.staticCasterAtlas);
     for(int i = 0; i < levelCount; i++)
     {
         levels[i] = source.levels[i];
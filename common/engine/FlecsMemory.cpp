@@ -0,0 +1,51 @@
+#include "engine/FlecsMemory.hpp"
+
+#include <utils/MemoryTracker.hpp>
+
+#include <flecs.h>
+
+#include <cstring>
+
+namespace engine {
+
+namespace {
+
+void *flecsMalloc(ecs_size_t size)
+{
+    MemoryTagScope memoryTag(MemoryTag::ecs);
+    return MemoryTracker::allocate(size);
+}
+
+void *flecsCalloc(ecs_size_t size)
+{
+    void *pointer = flecsMalloc(size);
+    if (pointer)
+        std::memset(pointer, 0, size);
+    return pointer;
+}
+
+void *flecsRealloc(void *pointer, ecs_size_t size)
+{
+    MemoryTagScope memoryTag(MemoryTag::ecs);
+    return MemoryTracker::reallocate(pointer, size);
+}
+
+void flecsFree(void *pointer)
+{
+    MemoryTracker::free(pointer);
+}
+
+} // namespace
+
+void trackFlecsMemory()
+{
+    ecs_os_set_api_defaults();
+    ecs_os_api_t api = ecs_os_get_api();
+    api.malloc_ = flecsMalloc;
+    api.calloc_ = flecsCalloc;
+    api.realloc_ = flecsRealloc;
+    api.free_ = flecsFree;
+    ecs_os_set_api(&api);
+}
+
+} // namespace engine
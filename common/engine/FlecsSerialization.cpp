@@ -2,12 +2,15 @@
 
 #include "engine/Components.hpp"
 
+#include <string>
+#include <vector>
+
 namespace engine::serializers {
 
 void FlecsSerializer::operator()(flecs::world &world)
 {
     m_serializer.getYamlEmitter() << YAML::BeginMap;
-    m_serializer.getYamlEmitter() << YAML::Key << "sceneEntities";
+    m_serializer.getYamlEmitter() << YAML::Key << "entities";
     m_serializer.getYamlEmitter() << YAML::Value << YAML::BeginSeq;
     world.each([this](
         flecs::entity e,
@@ -25,6 +28,9 @@ void FlecsSerializer::operator()(flecs::world &world)
         m_serializer.getYamlEmitter() << YAML::BeginMap;
         m_serializer.getYamlEmitter() << YAML::Key << "id" << YAML::Value << e.id();
         m_serializer.getYamlEmitter() << YAML::Key << "name" << YAML::Value << e.name();
+        // The full path because children of different parents can have the same name
+        if (const flecs::entity parent = e.parent(); parent.is_valid())
+            m_serializer.getYamlEmitter() << YAML::Key << "parent" << YAML::Value << parent.path();
 
         m_serializer.getYamlEmitter() << YAML::Key << "components";
         m_serializer.getYamlEmitter() << YAML::Value << YAML::BeginSeq;
@@ -36,7 +42,7 @@ void FlecsSerializer::operator()(flecs::world &world)
         if (c6) m_serializer(c6->getClassName(), *c6);
         if (c7) m_serializer(c7->getClassName(), *c7);
         if (c8) m_serializer(c8->getClassName(), *c8);
-        if (c8) m_serializer(c8->getClassName(), *c9);
+        if (c9) m_serializer(c9->getClassName(), *c9);
         m_serializer.getYamlEmitter() << YAML::EndSeq;
         m_serializer.getYamlEmitter() << YAML::EndMap;
     });
@@ -63,7 +69,8 @@ void FlecsUnserializer::operator()(flecs::world &world)
 
     world.component<engine::tags::SceneEntityTag>("SceneEntityTag");
 
-    world.component<engine::components::Transform>("Transform");
+    world.component<engine::components::Transform>("Transform")
+        .add(flecs::With, world.component<engine::components::WorldTransform>("WorldTransform"));
     world.component<engine::components::Material>("Material");
     world.component<engine::components::StaticMesh>("StaticMesh");
     world.component<engine::components::AnimatedMesh>("AnimatedMesh");
@@ -74,14 +81,26 @@ void FlecsUnserializer::operator()(flecs::world &world)
     world.component<engine::components::Skybox>("Skybox");
     world.component<engine::components::Camera>("Camera");
 
+    // The names of children are scoped to their parent, so they are named after they are moved
+    // into it. Their parents can come after them in the file
+    struct ChildEntity {
+        flecs::entity entity;
+        std::string name;
+        std::string parentPath;
+    };
+    std::vector<ChildEntity> children;
+
     YAML::Node rootNode = m_unserializer.getYamlNode();
     YAML::Node sceneEntities = rootNode["entities"];
     for (size_t i = 0; i < sceneEntities.size(); i++)
     {
         YAML::Node entityNode = sceneEntities[i];
-        flecs::entity e = world.entity()
-            .set_name(entityNode["name"].as<std::string>("UNNAMED").c_str())
-            .add<engine::tags::SceneEntityTag>();
+        flecs::entity e = world.entity().add<engine::tags::SceneEntityTag>();
+        const std::string name = entityNode["name"].as<std::string>("UNNAMED");
+        if (entityNode["parent"])
+            children.emplace_back(e, name, entityNode["parent"].as<std::string>());
+        else
+            e.set_name(name.c_str());
 
         YAML::Node entityComponents = entityNode["components"];
         for (size_t i = 0; i < entityComponents.size(); i++)
@@ -111,6 +130,26 @@ void FlecsUnserializer::operator()(flecs::world &world)
         }
     }
 
+    // Each pass names the children of the entities named in the previous one
+    while (!children.empty())
+    {
+        const size_t remaining = children.size();
+        std::erase_if(children, [&world](const ChildEntity &child) {
+            const flecs::entity parent = world.lookup(child.parentPath.c_str());
+            if (!parent.is_valid())
+                return false;
+            child.entity.child_of(parent).set_name(child.name.c_str());
+            return true;
+        });
+        if (children.size() == remaining)
+            break;
+    }
+    for (const ChildEntity &child : children)
+    {
+        ERROR("Parent {} of entity {} does not exist", child.parentPath, child.name);
+        child.entity.set_name(child.name.c_str());
+    }
+
     YAML::Node entityComponents = rootNode["sceneComponents"];
     for (size_t i = 0; i < entityComponents.size(); i++)
     {
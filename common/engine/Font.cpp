@@ -1,22 +1,29 @@
 #include "engine/assets/Font.hpp"
-#include <utility>
 
 Font::Font(
     TextureId fontAtlasTextureId,
     unsigned int fontHeight,
+    unsigned int distanceFieldSpread,
     const std::vector<paca::fileformats::GlyphData> &glyphsData)
     : m_atlas(fontAtlasTextureId),
-      m_fontHeight(fontHeight)
+      m_fontHeight(fontHeight),
+      m_distanceFieldSpread(distanceFieldSpread)
 {
+    m_directGlyphIndices.fill(NO_GLYPH);
+    m_glyphs.reserve(glyphsData.size());
     for (const paca::fileformats::GlyphData &glyph : glyphsData)
     {
-        m_glyphsData.emplace(std::make_pair(
-            glyph.characterCode,
-            GlyphData(
-                glyph.textureCoords,
-                glyph.size,
-                glyph.advance,
-                glyph.offset)));
+        const uint32_t index = m_glyphs.size();
+        if (glyph.characterCode < DIRECT_GLYPH_COUNT)
+            m_directGlyphIndices[glyph.characterCode] = index;
+        else
+            m_otherGlyphIndices.emplace(glyph.characterCode, index);
+
+        m_glyphs.push_back({
+            .textureCoords = glyph.textureCoords,
+            .size = glyph.size,
+            .advance = glyph.advance,
+            .offset = glyph.offset,
+        });
     }
 }
-
@@ -1,22 +1,53 @@
 #include "engine/ForwardRenderer.hpp"
 
 #include "engine/Components.hpp"
+#include "engine/FrameArena.hpp"
+#include "engine/Frustum.hpp"
+#include "engine/Profiler.hpp"
+#include "engine/ShaderLibrary.hpp"
 #include "engine/assets/Material.hpp"
 
 #include <glm/fwd.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <memory>
 #include <opengl/gl.hpp>
+#include <utils/MemoryTracker.hpp>
 
 #include <flecs.h>
 
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <utility>
 
 namespace engine {
 
 constexpr size_t MAX_VERTICES_IN_LINES_BATCH = 2048;
+static_assert(MAX_VERTICES_IN_LINES_BATCH % 2 == 0, "Lines batches are split between lines");
+
+// Of each of the frames in flight
+constexpr uint32_t STREAM_BUFFER_REGION_SIZE = 4 << 20;
+
+// Maximum error of the mesh LOD used in pixels (or shadow map texels)
+constexpr float MAX_LOD_ERROR_IN_PIXELS = 1.0f;
+
+// Static meshes are occluders if the diagonal of their AABB divided by their distance to the
+// camera is bigger than this
+constexpr float MIN_OCCLUDER_SCREEN_SIZE = 0.5f;
+
+// Storage buffer binding points, they have to match the ones in the shaders
+constexpr uint32_t POINT_LIGHTS_BINDING = 0;
+constexpr uint32_t LIGHT_CLUSTERS_BINDING = 1;
+constexpr uint32_t LIGHT_CLUSTER_INDICES_BINDING = 2;
+constexpr uint32_t BONE_MATRICES_BINDING = 3;
+
+// Uniform block binding points
+constexpr uint32_t SHADOW_MAP_LEVELS_BINDING = 0;
+
+// The single pass shadow map shader gets the level of each instance in 4 bits of an uint
+static_assert(engine::components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS <= 8);
 
 ForwardRenderer::ForwardRenderer()
 {}
@@ -31,29 +62,27 @@ ForwardRenderer::~ForwardRenderer()
 
 void ForwardRenderer::init(Flags flags)
 {
+    MemoryTagScope memoryTag(MemoryTag::render);
     m_flags = flags;
-    std::list<ShaderCompileTimeParameter> meshShaderParams;
-
+    ShaderFeatures meshFeatures = ShaderFeatures::none;
     if (std::to_underlying(m_flags & Flags::enableShadowMapping))
-    {
-        meshShaderParams.emplace_back("USE_SHADOW_MAPPING");
-    }
+        meshFeatures = meshFeatures | ShaderFeatures::shadowMapping;
     if (std::to_underlying(m_flags & Flags::enableParallaxMapping))
+        meshFeatures = meshFeatures | ShaderFeatures::parallaxMapping;
+
+    for (Mesh::VertexFormat format : {Mesh::VertexFormat::full, Mesh::VertexFormat::packed})
     {
-        meshShaderParams.emplace_back("USE_PARALLAX_MAPPING");
+        ShaderFeatures features = meshFeatures;
+        if (format == Mesh::VertexFormat::packed)
+            features = features | ShaderFeatures::packedVertices;
+
+        m_staticMeshShaders[std::to_underlying(format)]
+            = ShaderLibrary::get(ShaderLibrary::Program::forwardMesh, features);
+        m_animatedMeshShaders[std::to_underlying(format)] = ShaderLibrary::get(
+            ShaderLibrary::Program::forwardMesh,
+            features | ShaderFeatures::skinning);
     }
 
-    m_staticMeshShader = std::make_shared<Shader>(
-        "assets/shaders/forwardStaticMeshVertex.glsl",
-        "assets/shaders/forwardStaticMeshFragment.glsl",
-        meshShaderParams);
-
-    meshShaderParams.emplace_back("USE_SKINNING");
-    m_animatedMeshShader = std::make_shared<Shader>(
-        "assets/shaders/forwardStaticMeshVertex.glsl",
-        "assets/shaders/forwardStaticMeshFragment.glsl",
-        meshShaderParams);
-
     if (std::to_underlying(m_flags & Flags::enableShadowMapping))
     {
         //m_shadowMapSize = m_parameters.shadowMapSize;
@@ -76,18 +105,43 @@ void ForwardRenderer::init(Flags flags)
         //shadowDepthMapBufferParams.textureAttachmentFormats = { Texture::Format::depth24 };
         //m_shadowMapAtlasFramebuffer = std::make_shared<FrameBuffer>(shadowDepthMapBufferParams);
         //m_shadowMapAtlasFramebuffer->getDepthAttachment()->setBorderColor({1.0f, 1.0f, 1.0f, 1.0f});
-        m_staticShadowMapShader = std::make_shared<Shader>(
-            "assets/shaders/shadowMapVertex.glsl",
-            "assets/shaders/shadowMapFragment.glsl");
-
-        std::list<ShaderCompileTimeParameter> animatedMeshShadowMapShaderParameters {{"USE_SKINNING"}};
-        m_animatedShadowMapShader = std::make_shared<Shader>(
-            "assets/shaders/shadowMapVertex.glsl",
-            "assets/shaders/shadowMapFragment.glsl",
-            animatedMeshShadowMapShaderParameters);
+        for (Mesh::VertexFormat format : {Mesh::VertexFormat::full, Mesh::VertexFormat::packed})
+        {
+            const ShaderFeatures features = format == Mesh::VertexFormat::packed
+                ? ShaderFeatures::packedVertices
+                : ShaderFeatures::none;
+
+            m_staticShadowMapShaders[std::to_underlying(format)]
+                = ShaderLibrary::get(ShaderLibrary::Program::shadowMap, features);
+            m_animatedShadowMapShaders[std::to_underlying(format)] = ShaderLibrary::get(
+                ShaderLibrary::Program::shadowMap,
+                features | ShaderFeatures::skinning);
+
+            // Static casters are cached and redrawn by parts so only the dynamic ones (animated,
+            // pre-skinned or not), that are drawn every frame to every level, use the single pass
+            // path
+            if (GL::supportsViewportIndexInVertexShader())
+            {
+                m_staticSinglePassShadowMapShaders[std::to_underlying(format)] = ShaderLibrary::get(
+                    ShaderLibrary::Program::shadowMap,
+                    features | ShaderFeatures::singlePassCascades);
+                m_animatedSinglePassShadowMapShaders[std::to_underlying(format)] = ShaderLibrary::get(
+                    ShaderLibrary::Program::shadowMap,
+                    features | ShaderFeatures::skinning | ShaderFeatures::singlePassCascades);
+            }
+        }
     }
 
-    m_skyboxShader = std::make_shared<Shader>("assets/shaders/skyboxVertex.glsl", "assets/shaders/skyboxFragment.glsl");
+    m_skyboxShader = ShaderLibrary::get(ShaderLibrary::Program::skybox);
+
+    m_pointLightsBuffer = std::make_shared<StorageBuffer>(sizeof(ClusteredPointLight));
+    m_lightClusterIndicesBuffer = std::make_shared<StorageBuffer>(sizeof(uint32_t));
+    m_boneMatricesBuffer = std::make_shared<StorageBuffer>(sizeof(glm::mat4));
+    m_lightsBuffer = std::make_shared<UniformBuffer>(sizeof(ForwardMeshLightsBlock));
+    if (std::to_underlying(m_flags & Flags::enablePreSkinning))
+        m_skinningCache = std::make_shared<SkinningCache>();
+    if (std::to_underlying(m_flags & Flags::enableOcclusionCulling))
+        m_occlusionCuller = std::make_shared<OcclusionCuller>();
 
     m_cubeVertexArray = std::make_shared<VertexArray>();
     float cubeVertices[] = {
@@ -141,9 +195,7 @@ void ForwardRenderer::init(Flags flags)
         );
     m_cubeVertexArray->setIndexBuffer(cubeIndexBuffer);
 
-    m_cubeLinesShader = std::make_shared<Shader>(
-        "assets/shaders/renderCubeLinesVertex.glsl",
-        "assets/shaders/renderCubeLinesFragment.glsl");
+    m_cubeLinesShader = ShaderLibrary::get(ShaderLibrary::Program::cubeLines);
     m_cubeVertexArrayForLines = std::make_shared<VertexArray>();
     float cubeVerticesForLines[] = {
         0.0f, 0.0f, 0.0f,
@@ -181,11 +233,15 @@ void ForwardRenderer::init(Flags flags)
         );
     m_cubeVertexArrayForLines->setIndexBuffer(cubeIndexBufferForLines);
 
-    m_linesBatchVertexArray = std::make_shared<VertexArray>();
+    createStreamBuffer(STREAM_BUFFER_REGION_SIZE);
+}
 
-    m_linesBatchVertexBuffer = std::make_shared<VertexBuffer>(MAX_VERTICES_IN_LINES_BATCH);
-    m_linesBatchVertexBuffer->setLayout({ {ShaderDataType::float3, "a_position"} });
-    m_linesBatchVertexArray->addVertexBuffer(m_linesBatchVertexBuffer);
+void ForwardRenderer::createStreamBuffer(uint32_t regionSize)
+{
+    m_streamBuffer = std::make_shared<StreamBuffer>(regionSize);
+
+    m_linesBatchVertexArray = std::make_shared<VertexArray>();
+    m_linesBatchVertexArray->addVertexBuffer(*m_streamBuffer, { {ShaderDataType::float3, "a_position"} });
 
     std::array<uint32_t, MAX_VERTICES_IN_LINES_BATCH> indices;
     for (uint32_t i = 0; i < indices.size(); i++)
@@ -196,6 +252,30 @@ void ForwardRenderer::init(Flags flags)
     m_linesBatchVertexArray->setIndexBuffer(linesBatchIndexBufer);
 }
 
+void ForwardRenderer::pushStorageData(
+    uint32_t bindingPoint,
+    const void *data,
+    uint32_t size,
+    StorageBuffer &fallbackBuffer)
+{
+    // Empty ranges can't be bound, the shaders don't read past the counts they get
+    const uint32_t rangeSize = std::max<uint32_t>(size, sizeof(glm::vec4));
+    const uint32_t alignment = StreamBuffer::getStorageAlignment();
+    if (m_streamBuffer->fits(rangeSize, alignment))
+    {
+        const StreamBuffer::Allocation allocation = m_streamBuffer->allocate(rangeSize, alignment);
+        if (size > 0)
+            std::memcpy(allocation.data, data, size);
+        m_streamBuffer->bindStorageRange(bindingPoint, allocation);
+        return;
+    }
+
+    m_streamBufferOverflow += rangeSize + alignment;
+    if (size > 0)
+        fallbackBuffer.setData(data, size);
+    fallbackBuffer.bind(bindingPoint);
+}
+
 std::array<glm::vec3, 8> getFrustumCorners(const glm::mat4 &projectionViewMatrix)
 {
     const glm::mat4 inverseProjectionView = glm::inverse(projectionViewMatrix);
@@ -228,7 +308,7 @@ void ForwardRenderer::updateShadowMapLevels(
     if (!std::to_underlying(m_flags & Flags::enableShadowMapping))
         return;
 
-    world.each([&camera, &cameraTransform](
+    world.each([this, &camera](
         const components::DirectionalLight &light,
         const components::Transform &transform,
         components::DirectionalLightShadowMap &shadowMapComponent)
@@ -237,10 +317,6 @@ void ForwardRenderer::updateShadowMapLevels(
         bool projectionChanged = previousProjectionMatrix != camera.getProjection();
         previousProjectionMatrix = camera.getProjection();
 
-        // Clear the shadowMap atlas
-        shadowMapComponent.shadowMapAtlasFramebuffer.bind();
-        GL::clear();
-
         for (unsigned int i = 0; i < shadowMapComponent.levelCount; i++)
         {
             components::DirectionalLightShadowMap::ShadowMapLevel &shadowMap
@@ -260,7 +336,7 @@ void ForwardRenderer::updateShadowMapLevels(
             std::array<glm::vec3, 8> corners
                 = getFrustumCorners(
                     shadowMap.frustumProjectionMatrix
-                    * cameraTransform.getView());
+                    * m_viewMatrix);
             ASSERT_MSG(corners.size() == 8, "There is {} corners instead of 8", corners.size());
 
             // calculate max diagonal of frustum if the projection changed
@@ -283,21 +359,75 @@ void ForwardRenderer::updateShadowMapLevels(
             const float pixelSize = shadowMap.maxDiagonal / shadowMapComponent.shadowMapSize;
 
             // Align coordinate axis to lightView so when the position of the shadowMap is rounded
-            // It is rounded aligned with the pixels
+            // It is rounded aligned with the pixels. The depth is rounded to the side of the level
+            // (much less than its depth range) so the depth values only change when it moves a
+            // lot in the light's direction, this lets the static casters be reused between frames
+            float &side = shadowMap.maxDiagonal;
             center = lightRotMatrix * center;
-            center.x = std::round(center.x / pixelSize) * pixelSize;
-            center.y = std::round(center.y / pixelSize) * pixelSize;
-            center = glm::inverse(lightRotMatrix) * center;
-            //center.z = std::round(center.z / pixelSize) * pixelSize;
+            shadowMap.lightDirection = lightDirection;
+            shadowMap.centerInTexels = glm::ivec2(
+                std::round(center.x / pixelSize),
+                std::round(center.y / pixelSize));
+            shadowMap.centerDepth = std::round(center.z / side) * side;
+            center = glm::vec3(glm::vec2(shadowMap.centerInTexels) * pixelSize, shadowMap.centerDepth);
 
-            float &side = shadowMap.maxDiagonal;
             float depthOfShadowMap = 5.0f; // Tune this parameter
             shadowMap.projectionView = glm::ortho(-side/2, side/2, -side/2, side/2, -side*depthOfShadowMap, side*depthOfShadowMap)
-                    * glm::lookAt(center - lightDirection, center, glm::vec3(0.0f, 1.0f, 0.0f));
+                    * glm::translate(glm::mat4(1.0f), -center)
+                    * glm::mat4(lightRotMatrix);
         }
     });
 }
 
+void ForwardRenderer::updateLightClusters(
+    const engine::components::Transform &cameraTransform,
+    const engine::components::Camera &camera,
+    const flecs::world &world)
+{
+    m_lightClusters.setProjection(camera.fov, camera.aspect, camera.near, camera.far);
+
+    m_pointLights.clear();
+    world.each([this, &camera](
+        const components::PointLight &light,
+        const components::WorldTransform &worldTransform)
+    {
+        const float radius = LightClusters::getPointLightRadius(
+            light.color,
+            light.intensity,
+            light.attenuation,
+            camera.far);
+        if (radius == 0.0f)
+            return;
+
+        const glm::vec3 positionInViewSpace = m_viewMatrix * worldTransform.matrix[3];
+        m_pointLights.push_back({
+            .positionAndRadius = glm::vec4(positionInViewSpace, radius),
+            .colorAndIntensity = glm::vec4(light.color, light.intensity),
+            .attenuation = glm::vec4(light.attenuation, 0.0f, 0.0f, 0.0f),
+        });
+    });
+
+    m_lightClusters.assignLights(m_pointLights, m_threadPool);
+
+    // Empty buffers cant be bound so there is always at least one element
+    const std::span<const LightClusters::Cluster> clusters = m_lightClusters.getClusters();
+    const std::span<const uint32_t> lightIndices = m_lightClusters.getLightIndices();
+    pushStorageData(
+        POINT_LIGHTS_BINDING,
+        m_pointLights.data(),
+        m_pointLights.size() * sizeof(m_pointLights[0]),
+        *m_pointLightsBuffer);
+    const StreamBuffer::Allocation clustersAllocation = m_streamBuffer->push(
+        clusters.data(), clusters.size_bytes(), StreamBuffer::getStorageAlignment());
+    ASSERT(clustersAllocation.data);
+    m_streamBuffer->bindStorageRange(LIGHT_CLUSTERS_BINDING, clustersAllocation);
+    pushStorageData(
+        LIGHT_CLUSTER_INDICES_BINDING,
+        lightIndices.data(),
+        lightIndices.size_bytes(),
+        *m_lightClusterIndicesBuffer);
+}
+
 void ForwardRenderer::renderWorld(
     float deltaTime, // in miliseconds
     const engine::components::Transform &cameraTransform,
@@ -306,8 +436,13 @@ void ForwardRenderer::renderWorld(
     const AssetManager &assetManager,
     const FrameBuffer &renderTarget)
 {
+    PROFILE_SCOPE("ForwardRenderer::renderWorld");
+    MemoryTagScope memoryTag(MemoryTag::render);
+    Profiler::collectGpuZones();
+
     if (deltaTime > 0.0f)
     {
+        PROFILE_SCOPE("Animations");
         world.each([deltaTime, &assetManager](
             engine::components::AnimationPlayer &animationComponent)
         {
@@ -324,88 +459,186 @@ void ForwardRenderer::renderWorld(
         });
     }
 
+    {
+        PROFILE_SCOPE("World transforms");
+        m_worldTransforms.update(world, m_threadPool);
+    }
+    m_viewMatrix = cameraTransform.getView();
+
+    {
+        PROFILE_SCOPE("Frustum culling");
+        updateSpatialIndex(world, assetManager);
+        m_visibleEntities.clear();
+        m_spatialIndex.queryFrustum(
+            Frustum(camera.getProjection() * m_viewMatrix),
+            m_visibleEntities);
+        m_stats.meshes = m_spatialIndex.size();
+        m_stats.inFrustum = m_visibleEntities.size();
+        m_stats.occluded = 0;
+    }
+
+    updateBonePalettes(world, assetManager);
     updateShadowMapLevels(cameraTransform, camera, world);
     // Draw for shadow map
     if (std::to_underlying(m_flags & Flags::enableShadowMapping))
     {
-        world.each([&assetManager, this, &world](
-            const components::StaticMesh &meshComponent,
-            const components::Transform &transform)
-        {
-            drawMeshInShadowMaps(meshComponent, transform.getTransform(), assetManager, world);
-        });
-        world.each([&assetManager, this, &world](
-            const components::AnimatedMesh &meshComponent,
-            const components::AnimationPlayer *animationComponent,
-            const components::Transform &transform)
-        {
-            drawMeshInShadowMaps(meshComponent, animationComponent, transform.getTransform(), assetManager, world);
-        });
+        PROFILE_SCOPE("Shadow maps");
+        PROFILE_GPU_SCOPE("Shadow maps");
+        drawShadowMaps(world, assetManager);
     }
 
-    int nextFreeTextureSlotStaticMeshShader = 0;
-    int nextFreeTextureSlotAnimatedMeshShader = 0;
-    m_staticMeshShader->bind();
-    setLightUniforms(*m_staticMeshShader, world, cameraTransform, nextFreeTextureSlotStaticMeshShader);
-    m_animatedMeshShader->bind();
-    setLightUniforms(*m_animatedMeshShader, world, cameraTransform, nextFreeTextureSlotAnimatedMeshShader);
+    {
+        PROFILE_SCOPE("Light clusters");
+        updateLightClusters(cameraTransform, camera, world);
+    }
+    {
+        PROFILE_SCOPE("Occlusion culling");
+        updateOcclusionCulling(cameraTransform, camera, world, assetManager);
+    }
 
-    world.each([&assetManager, this, &camera, &cameraTransform, &renderTarget, nextFreeTextureSlotStaticMeshShader](
-        const components::StaticMesh &meshComponent,
-        const components::Transform &transform,
-        const components::Material *materialComponent)
+    drawOpaqueMeshes(cameraTransform, camera, world, assetManager, renderTarget);
+
+    {
+        PROFILE_SCOPE("Debug");
+        PROFILE_GPU_SCOPE("Debug");
+        drawDebug(cameraTransform, camera, world, assetManager, renderTarget);
+    }
+
+    if (world.has<components::Skybox>())
     {
+        PROFILE_SCOPE("Skybox");
+        PROFILE_GPU_SCOPE("Skybox");
+        const Cubemap *cubemap = assetManager.get(world.ensure<components::Skybox>().id);
+        if (cubemap) drawSkybox(cameraTransform, camera, *cubemap, renderTarget);
+    }
+
+    // The data written this frame can't be overwritten until the gpu draws it
+    m_streamBuffer->nextFrame();
+
+    // The regions are only written after the gpu finished with them, so the bigger buffer can
+    // replace the old one at the end of the frame
+    if (m_streamBufferOverflow > 0)
+    {
+        const uint32_t regionSize
+            = std::bit_ceil(m_streamBuffer->getRegionSize() + m_streamBufferOverflow);
+        INFO("The stream buffer regions grow to {} bytes", regionSize);
+        createStreamBuffer(regionSize);
+        m_streamBufferOverflow = 0;
+    }
+}
+
+void ForwardRenderer::drawOpaqueMeshes(
+    const engine::components::Transform &cameraTransform,
+    const engine::components::Camera &camera,
+    const flecs::world &world,
+    const AssetManager &assetManager,
+    const FrameBuffer &renderTarget)
+{
+    PROFILE_SCOPE("Opaque");
+    PROFILE_GPU_SCOPE("Opaque");
+
+    updateLightsBlock(world);
+    // The shadow map atlases are in the first texture units
+    const int firstMaterialTextureSlot = components::MAX_DIRECTIONAL_LIGHTS;
+
+    // Static meshes first and then animated ones so the shaders change less
+    for (uint64_t entityId : m_visibleEntities)
+    {
+        const flecs::entity entity = world.entity(entityId);
+        const components::StaticMesh *meshComponent = entity.get<components::StaticMesh>();
+        if (!meshComponent)
+            continue;
+
+        if (isOccluded(entityId))
+        {
+            m_stats.occluded++;
+            continue;
+        }
+        const glm::mat4 &modelMatrix = entity.get<components::WorldTransform>()->matrix;
+
         drawMesh(
             cameraTransform,
             camera,
-            meshComponent,
-            materialComponent,
-            transform.getTransform(),
+            *meshComponent,
+            entity.get<components::Material>(),
+            modelMatrix,
             assetManager,
             renderTarget,
-            nextFreeTextureSlotStaticMeshShader);
-        drawAABB(
-            cameraTransform,
-            camera,
-            meshComponent,
-            transform.getTransform(),
-            assetManager,
-            renderTarget);
-    });
-    world.each([&assetManager, this, &camera, &cameraTransform, &renderTarget, nextFreeTextureSlotAnimatedMeshShader](
-        const components::AnimatedMesh &meshComponent,
-        const components::AnimationPlayer *animationComponent,
-        const components::Transform &transform,
-        const components::Material *materialComponent)
+            firstMaterialTextureSlot);
+    }
+    for (uint64_t entityId : m_visibleEntities)
     {
+        const flecs::entity entity = world.entity(entityId);
+        const components::AnimatedMesh *meshComponent = entity.get<components::AnimatedMesh>();
+        if (!meshComponent)
+            continue;
+
+        const auto firstBoneMatrix = m_firstBoneMatrixOfEntity.find(entityId);
+        if (firstBoneMatrix == m_firstBoneMatrixOfEntity.end())
+            continue;
+        if (isOccluded(entityId))
+        {
+            m_stats.occluded++;
+            continue;
+        }
+        const glm::mat4 &modelMatrix = entity.get<components::WorldTransform>()->matrix;
+
         drawMesh(
             cameraTransform,
             camera,
-            meshComponent,
-            materialComponent,
-            animationComponent,
-            transform.getTransform(),
+            *meshComponent,
+            entity.get<components::Material>(),
+            firstBoneMatrix->second,
+            m_skinningCache ? m_skinningCache->getVertexArray(entityId) : nullptr,
+            modelMatrix,
             assetManager,
             renderTarget,
-            nextFreeTextureSlotAnimatedMeshShader);
-        drawSkeleton(
-            cameraTransform,
-            camera,
-            meshComponent,
-            animationComponent,
-            transform.getTransform(),
-            assetManager,
-            renderTarget);
-        //drawAABB(cameraTransform, camera, mesh->getAABB(), transform.getTransform(), renderTarget);
-    });
-    if (world.has<components::Skybox>())
+            firstMaterialTextureSlot);
+    }
+}
+
+void ForwardRenderer::drawDebug(
+    const engine::components::Transform &cameraTransform,
+    const engine::components::Camera &camera,
+    const flecs::world &world,
+    const AssetManager &assetManager,
+    const FrameBuffer &renderTarget)
+{
+    for (uint64_t entityId : m_visibleEntities)
     {
-        const Cubemap *cubemap = assetManager.get(world.ensure<components::Skybox>().id);
-        if (cubemap) drawSkybox(cameraTransform, camera, *cubemap, renderTarget);
+        if (isOccluded(entityId))
+            continue;
+        const flecs::entity entity = world.entity(entityId);
+        const glm::mat4 &modelMatrix = entity.get<components::WorldTransform>()->matrix;
+
+        if (const components::StaticMesh *meshComponent = entity.get<components::StaticMesh>())
+        {
+            drawAABB(
+                cameraTransform,
+                camera,
+                *meshComponent,
+                modelMatrix,
+                assetManager,
+                renderTarget);
+        }
+        else if (const components::AnimatedMesh *meshComponent = entity.get<components::AnimatedMesh>())
+        {
+            const auto firstBoneMatrix = m_firstBoneMatrixOfEntity.find(entityId);
+            if (firstBoneMatrix == m_firstBoneMatrixOfEntity.end())
+                continue;
+            drawSkeleton(
+                cameraTransform,
+                camera,
+                *meshComponent,
+                firstBoneMatrix->second,
+                modelMatrix,
+                assetManager,
+                renderTarget);
+        }
     }
 }
 
-std::string textureTypeToUniformName(MaterialTextureType::Type type)
+const char *textureTypeToUniformName(MaterialTextureType::Type type)
 {
     switch (type) {
         case MaterialTextureType::diffuse: return "u_diffuseMap";
@@ -418,7 +651,7 @@ std::string textureTypeToUniformName(MaterialTextureType::Type type)
     ASSERT_MSG(false, "Invalid Material Texture Type!");
 }
 
-std::string textureTypeToHasTextureUniformName(MaterialTextureType::Type type)
+const char *textureTypeToHasTextureUniformName(MaterialTextureType::Type type)
 {
     switch (type) {
         case MaterialTextureType::diffuse: return "u_hasDiffuse";
@@ -431,103 +664,631 @@ std::string textureTypeToHasTextureUniformName(MaterialTextureType::Type type)
     ASSERT_MSG(false, "Invalid Material Texture Type!");
 }
 
-void ForwardRenderer::drawMeshInShadowMaps(
-    const engine::components::StaticMesh &meshComponent,
+// Uniforms needed to decode the vertex attributes of the mesh
+void setVertexFormatUniforms(Shader &shader, const Mesh &mesh)
+{
+    if (mesh.getVertexFormat() == Mesh::VertexFormat::packed)
+    {
+        const AxisAlignedBoundingBox &aabb = mesh.getAABB();
+        shader.setUniform(aabb.min, "u_positionOffset");
+        shader.setUniform(aabb.max - aabb.min, "u_positionScale");
+    }
+}
+
+// Length of the diagonal of the mesh's AABB in world space
+float getMeshWorldSize(const Mesh &mesh, const glm::mat4 &modelMatrix)
+{
+    const float maxScale = std::sqrt(std::max({
+        glm::dot(glm::vec3(modelMatrix[0]), glm::vec3(modelMatrix[0])),
+        glm::dot(glm::vec3(modelMatrix[1]), glm::vec3(modelMatrix[1])),
+        glm::dot(glm::vec3(modelMatrix[2]), glm::vec3(modelMatrix[2])),
+    }));
+    const AxisAlignedBoundingBox &aabb = mesh.getAABB();
+    return glm::length(aabb.max - aabb.min) * maxScale;
+}
+
+// LOD from the size of a pixel at the distance of the mesh from the camera
+const Mesh::Lod &selectLod(
+    const Mesh &mesh,
+    const glm::mat4 &viewModelMatrix,
+    const engine::components::Camera &camera,
+    uint32_t viewportHeight)
+{
+    const AxisAlignedBoundingBox &aabb = mesh.getAABB();
+    const float worldSize = getMeshWorldSize(mesh, viewModelMatrix);
+    const glm::vec3 center = viewModelMatrix * glm::vec4((aabb.min + aabb.max) * 0.5f, 1.0f);
+    const float distance = std::max(glm::length(center) - worldSize * 0.5f, camera.near);
+    const float pixelSize
+        = 2.0f * distance * std::tan(glm::radians(camera.fov) * 0.5f) / viewportHeight;
+    return mesh.getLods()[mesh.selectLod(MAX_LOD_ERROR_IN_PIXELS * pixelSize / worldSize)];
+}
+
+// Shadow maps are orthographic so the texel size is the same at any distance
+const Mesh::Lod &selectLod(
+    const Mesh &mesh,
     const glm::mat4 &modelMatrix,
+    const engine::components::DirectionalLightShadowMap::ShadowMapLevel &shadowMapLevel,
+    uint32_t shadowMapSize)
+{
+    const float texelSize = shadowMapLevel.maxDiagonal / shadowMapSize;
+    const float worldSize = getMeshWorldSize(mesh, modelMatrix);
+    return mesh.getLods()[mesh.selectLod(MAX_LOD_ERROR_IN_PIXELS * texelSize / worldSize)];
+}
+
+// Moves the entities of the tables where the mesh or the WorldTransform was written since the
+// last run of the query. The ones whose mesh asset isn't loaded are left out of the index and
+// added to entitiesWithoutMeshAsset
+template<typename MeshComponent>
+void setChangedSpatialIndexBoxes(
+    flecs::query<const MeshComponent, const components::WorldTransform> &query,
     const AssetManager &assetManager,
-    const flecs::world &world) const
+    SpatialIndex &spatialIndex,
+    std::unordered_set<uint64_t> &entitiesWithoutMeshAsset)
 {
-    const StaticMesh *mesh = assetManager.get(meshComponent.id);
-    if (!mesh) {
-        WARN("Static mesh with id: {} does not exist", std::to_underlying(meshComponent.id));
+    if (!query.changed())
         return;
-    }
-
-    GL::setDepthTest(true);
 
-    m_staticShadowMapShader->bind();
-    world.each([this, &modelMatrix, &mesh](
-        const components::DirectionalLight &light,
-        const components::Transform &transform,
-        components::DirectionalLightShadowMap &shadowMapComponent)
-    {
-        shadowMapComponent.shadowMapAtlasFramebuffer.bind();
-        for (unsigned int i = 0; i < shadowMapComponent.levelCount; i++)
+    query.run([&assetManager, &spatialIndex, &entitiesWithoutMeshAsset](flecs::iter &it) {
+        while (it.next())
         {
-            GL::viewport(
-                0,
-                i*shadowMapComponent.shadowMapSize,
-                shadowMapComponent.shadowMapSize,
-                shadowMapComponent.shadowMapSize);
-            m_staticShadowMapShader->setUniform(
-                shadowMapComponent.levels[i].projectionView * modelMatrix,
-                "u_lightSpaceModelMatrix");
-            GL::drawIndexed(mesh->getVertexArray());
+            if (!it.changed())
+            {
+                it.skip();
+                continue;
+            }
+
+            flecs::field<const MeshComponent> meshComponents = it.field<const MeshComponent>(0);
+            flecs::field<const components::WorldTransform> worldTransforms
+                = it.field<const components::WorldTransform>(1);
+            for (size_t i : it)
+            {
+                const uint64_t id = it.entity(i).id();
+                if (const auto *mesh = assetManager.get(meshComponents[i].id))
+                {
+                    spatialIndex.set(id, mesh->getAABB().transformed(worldTransforms[i].matrix));
+                }
+                else
+                {
+                    spatialIndex.remove(id);
+                    entitiesWithoutMeshAsset.insert(id);
+                }
+            }
         }
     });
 }
 
-void ForwardRenderer::drawMeshInShadowMaps(
-    const engine::components::AnimatedMesh &meshComponent,
-    const engine::components::AnimationPlayer *animationComponent,
-    const glm::mat4 &modelMatrix,
-    const AssetManager &assetManager,
-    const flecs::world &world) const
+void ForwardRenderer::updateSpatialIndex(
+    const flecs::world &world,
+    const AssetManager &assetManager)
 {
-    const AnimatedMesh *mesh = assetManager.get(meshComponent.id);
-    if (!mesh) {
-        WARN("Animated mesh with id: {} does not exist", std::to_underlying(meshComponent.id));
-        return;
+    if (world.c_ptr() != m_spatialIndexWorld)
+    {
+        m_spatialIndexWorld = world.c_ptr();
+        m_spatialIndex.clear();
+        m_entitiesWithoutMeshAsset.clear();
+        m_staticMeshesQuery = world.query_builder<
+                const components::StaticMesh,
+                const components::WorldTransform>()
+            .cached()
+            .detect_changes()
+            .build();
+        m_animatedMeshesQuery = world.query_builder<
+                const components::AnimatedMesh,
+                const components::WorldTransform>()
+            .cached()
+            .detect_changes()
+            .build();
+
+        // The observers live as long as the world, so they only hold a weak_ptr to the list
+        m_entitiesRemovedFromSpatialIndex = std::make_shared<std::vector<uint64_t>>();
+        const auto addRemovedEntity
+            = [removedEntities = std::weak_ptr(m_entitiesRemovedFromSpatialIndex)](flecs::entity entity) {
+                if (const auto list = removedEntities.lock())
+                    list->push_back(entity.id());
+            };
+        world.observer().with<components::StaticMesh>().event(flecs::OnRemove).each(addRemovedEntity);
+        world.observer().with<components::AnimatedMesh>().event(flecs::OnRemove).each(addRemovedEntity);
+        world.observer().with<components::WorldTransform>().event(flecs::OnRemove).each(addRemovedEntity);
     }
-    const Animation *animation = animationComponent ? assetManager.get(animationComponent->id) : nullptr;
-    if (!animation) {
-        WARN("Animation with id: {} does not exist", std::to_underlying(animationComponent->id));
+
+    // Before the changed tables, an entity can lose its mesh and get another one in a frame
+    for (uint64_t id : *m_entitiesRemovedFromSpatialIndex)
+    {
+        m_spatialIndex.remove(id);
+        m_entitiesWithoutMeshAsset.erase(id);
+    }
+    m_entitiesRemovedFromSpatialIndex->clear();
+
+    // Only the boxes of the tables that changed are moved, the rest stay where they were
+    setChangedSpatialIndexBoxes(
+        m_staticMeshesQuery,
+        assetManager,
+        m_spatialIndex,
+        m_entitiesWithoutMeshAsset);
+    setChangedSpatialIndexBoxes(
+        m_animatedMeshesQuery,
+        assetManager,
+        m_spatialIndex,
+        m_entitiesWithoutMeshAsset);
+
+    // Their tables may not change again, so they are checked every update until the asset loads
+    std::erase_if(m_entitiesWithoutMeshAsset, [this, &world, &assetManager](uint64_t id) {
+        const flecs::entity entity = world.entity(id);
+        if (!entity.is_alive())
+            return true;
+        const components::WorldTransform *worldTransform = entity.get<components::WorldTransform>();
+        if (!worldTransform)
+            return true;
+
+        const Mesh *mesh = nullptr;
+        if (const components::StaticMesh *meshComponent = entity.get<components::StaticMesh>())
+            mesh = assetManager.get(meshComponent->id);
+        else if (const components::AnimatedMesh *meshComponent = entity.get<components::AnimatedMesh>())
+            mesh = assetManager.get(meshComponent->id);
+        else
+            return true;
+        if (!mesh)
+            return false;
+
+        m_spatialIndex.set(id, mesh->getAABB().transformed(worldTransform->matrix));
+        return true;
+    });
+}
+
+void ForwardRenderer::updateOcclusionCulling(
+    const engine::components::Transform &cameraTransform,
+    const engine::components::Camera &camera,
+    const flecs::world &world,
+    const AssetManager &assetManager)
+{
+    if (!m_occlusionCuller)
         return;
+
+    m_occlusionCuller->beginFrame(camera.getProjection() * m_viewMatrix);
+
+    for (uint64_t entityId : m_visibleEntities)
+    {
+        const flecs::entity entity = world.entity(entityId);
+        const components::StaticMesh *meshComponent = entity.get<components::StaticMesh>();
+        if (!meshComponent)
+            continue;
+        const StaticMesh *mesh = assetManager.get(meshComponent->id);
+        if (!mesh || !mesh->getOccluder())
+            continue;
+
+        const glm::mat4 &modelMatrix = entity.get<components::WorldTransform>()->matrix;
+        const AxisAlignedBoundingBox &aabb = mesh->getAABB();
+        const glm::vec3 center = m_viewMatrix * modelMatrix * glm::vec4((aabb.min + aabb.max) * 0.5f, 1.0f);
+        const float worldSize = getMeshWorldSize(*mesh, modelMatrix);
+        if (worldSize < MIN_OCCLUDER_SCREEN_SIZE * glm::length(center))
+            continue;
+
+        const StaticMesh::Occluder &occluder = *mesh->getOccluder();
+        m_occlusionCuller->addOccluder(occluder.positions, occluder.indices, modelMatrix);
     }
 
-    GL::setDepthTest(true);
+    m_occlusionCuller->rasterizeOccluders(m_threadPool);
+}
 
-    m_animatedShadowMapShader->bind();
+bool ForwardRenderer::isOccluded(uint64_t entityId)
+{
+    return m_occlusionCuller && !m_occlusionCuller->isVisible(m_spatialIndex.getAABB(entityId));
+}
+
+void ForwardRenderer::updateBonePalettes(
+    const flecs::world &world,
+    const AssetManager &assetManager)
+{
+    PROFILE_SCOPE("Bone palettes");
+    m_boneMatrices.clear();
+    m_firstBoneMatrixOfEntity.clear();
 
-    if (animationComponent && animation)
+    world.each([this, &assetManager](
+        flecs::entity entity,
+        const components::AnimatedMesh &meshComponent,
+        const components::AnimationPlayer *animationComponent)
     {
-        std::vector<glm::mat4> matrices
-            = animation->getTransformations(
-                animationComponent->progress,
-                mesh->getSkeleton());
+        const AnimatedMesh *mesh = assetManager.get(meshComponent.id);
+        if (!mesh) {
+            WARN("Animated mesh with id: {} does not exist", std::to_underlying(meshComponent.id));
+            return;
+        }
+        const Animation *animation = animationComponent ? assetManager.get(animationComponent->id) : nullptr;
+        if (animationComponent && !animation) {
+            WARN("Animation with id: {} does not exist", std::to_underlying(animationComponent->id));
+        }
 
-        for (BoneID boneId = 0; boneId < matrices.size(); boneId++)
+        // The pose is calculated once and used in every pass
+        const uint32_t firstBoneMatrix = m_boneMatrices.size();
+        m_firstBoneMatrixOfEntity[entity.id()] = firstBoneMatrix;
+        m_boneMatrices.resize(
+            firstBoneMatrix + mesh->getSkeleton().bones.size(),
+            glm::mat4(1.0f));
+        if (animation)
         {
-            m_animatedShadowMapShader->setUniform(matrices[boneId], "u_finalBonesMatrices[{}]", boneId);
+            animation->getTransformations(
+                animationComponent->progress,
+                mesh->getSkeleton(),
+                std::span(m_boneMatrices).subspan(firstBoneMatrix));
         }
-    }
-    else
+    });
+
+    // One memcpy to the region of the frame in the persistently mapped buffer
+    pushStorageData(
+        BONE_MATRICES_BINDING,
+        m_boneMatrices.data(),
+        m_boneMatrices.size() * sizeof(glm::mat4),
+        *m_boneMatricesBuffer);
+
+    if (m_skinningCache)
     {
-        for (BoneID boneId = 0; boneId < mesh->getSkeleton().bones.size(); boneId++)
+        m_skinningCache->beginFrame();
+        world.each([this, &assetManager](
+            flecs::entity entity,
+            const components::AnimatedMesh &meshComponent)
         {
-            m_animatedShadowMapShader->setUniform(glm::mat4(1.0f), "u_finalBonesMatrices[{}]", boneId);
+            const auto firstBoneMatrix = m_firstBoneMatrixOfEntity.find(entity.id());
+            if (firstBoneMatrix == m_firstBoneMatrixOfEntity.end())
+                return;
+            m_skinningCache->skin(entity.id(), *assetManager.get(meshComponent.id), firstBoneMatrix->second);
+        });
+        m_skinningCache->endFrame();
+    }
+}
+
+// FNV-1a, continues from the hash of the previous data
+uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Bounds of the receivers of a shadow map level in its clip space: the visible meshes inside the
+// slice of the camera frustum that the level covers. Empty (min > max) if there are none
+AxisAlignedBoundingBox getShadowReceiverBounds(
+    const components::DirectionalLightShadowMap::ShadowMapLevel &level,
+    const glm::mat4 &viewMatrix,
+    const AxisAlignedBoundingBox &visibleBounds)
+{
+    const AxisAlignedBoundingBox empty{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+    if (glm::any(glm::greaterThan(visibleBounds.min, visibleBounds.max)))
+        return empty;
+
+    AxisAlignedBoundingBox receivers = visibleBounds.transformed(level.projectionView);
+    glm::vec3 sliceMin(INFINITY), sliceMax(-INFINITY);
+    for (const glm::vec3 &corner : getFrustumCorners(level.frustumProjectionMatrix * viewMatrix))
+    {
+        const glm::vec3 levelCorner = level.projectionView * glm::vec4(corner, 1.0f);
+        sliceMin = glm::min(sliceMin, levelCorner);
+        sliceMax = glm::max(sliceMax, levelCorner);
+    }
+    receivers.min = glm::max(receivers.min, sliceMin);
+    receivers.max = glm::min(receivers.max, sliceMax);
+    if (glm::any(glm::greaterThan(receivers.min, receivers.max)))
+        return empty;
+    return receivers;
+}
+
+// The shadow of a caster goes from it away from the light, towards the far plane of the level,
+// so it only has to be drawn if that volume reaches the receivers. Both in the level's clip space
+bool shadowReachesReceivers(
+    const AxisAlignedBoundingBox &caster,
+    const AxisAlignedBoundingBox &receivers)
+{
+    return caster.max.x >= receivers.min.x && caster.min.x <= receivers.max.x
+        && caster.max.y >= receivers.min.y && caster.min.y <= receivers.max.y
+        && caster.min.z <= receivers.max.z;
+}
+
+void ForwardRenderer::collectShadowCasters(
+    const flecs::world &world,
+    const AssetManager &assetManager)
+{
+    m_shadowCasters.clear();
+    m_staticShadowCastersHash = 14695981039346656037ull;
+
+    world.each([this, &assetManager](
+        const components::StaticMesh &meshComponent,
+        const components::WorldTransform &worldTransform)
+    {
+        const StaticMesh *mesh = assetManager.get(meshComponent.id);
+        if (!mesh) {
+            WARN("Static mesh with id: {} does not exist", std::to_underlying(meshComponent.id));
+            return;
         }
+
+        const glm::mat4 &modelMatrix = worldTransform.matrix;
+        m_staticShadowCastersHash = hashBytes(m_staticShadowCastersHash, &mesh, sizeof(mesh));
+        m_staticShadowCastersHash = hashBytes(m_staticShadowCastersHash, &modelMatrix, sizeof(modelMatrix));
+        m_shadowCasters.push_back({
+            .mesh = mesh,
+            .animatedMesh = nullptr,
+            .modelMatrix = modelMatrix,
+            .worldAABB = mesh->getAABB().transformed(modelMatrix),
+            .firstBoneMatrix = 0,
+            .preSkinnedVertexArray = nullptr,
+        });
+    });
+
+    world.each([this, &assetManager](
+        flecs::entity entity,
+        const components::AnimatedMesh &meshComponent,
+        const components::WorldTransform &worldTransform)
+    {
+        const auto firstBoneMatrix = m_firstBoneMatrixOfEntity.find(entity.id());
+        if (firstBoneMatrix == m_firstBoneMatrixOfEntity.end())
+            return;
+
+        const AnimatedMesh *mesh = assetManager.get(meshComponent.id);
+        const glm::mat4 &modelMatrix = worldTransform.matrix;
+        m_shadowCasters.push_back({
+            .mesh = mesh,
+            .animatedMesh = mesh,
+            .modelMatrix = modelMatrix,
+            .worldAABB = mesh->getAABB().transformed(modelMatrix),
+            .firstBoneMatrix = firstBoneMatrix->second,
+            .preSkinnedVertexArray = m_skinningCache
+                ? m_skinningCache->getVertexArray(entity.id())
+                : nullptr,
+        });
+    });
+}
+
+void ForwardRenderer::drawShadowMaps(
+    const flecs::world &world,
+    const AssetManager &assetManager)
+{
+    collectShadowCasters(world, assetManager);
+
+    // Everything that can receive a shadow in this frame
+    AxisAlignedBoundingBox visibleBounds{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+    for (uint64_t entityId : m_visibleEntities)
+    {
+        const AxisAlignedBoundingBox &aabb = m_spatialIndex.getAABB(entityId);
+        visibleBounds.min = glm::min(visibleBounds.min, aabb.min);
+        visibleBounds.max = glm::max(visibleBounds.max, aabb.max);
     }
 
-    world.each([this, &modelMatrix, &mesh](
+    GL::setDepthTest(true);
+    // Casters between the light and the near plane of a level still have to cast shadows, so
+    // they are not culled by the near plane and their depth gets clamped to it
+    GL::setDepthClamp(true);
+
+    world.each([this, &visibleBounds](
         const components::DirectionalLight &light,
         const components::Transform &transform,
         components::DirectionalLightShadowMap &shadowMapComponent)
     {
+        const uint32_t size = shadowMapComponent.shadowMapSize;
+        const Texture &atlas = shadowMapComponent.shadowMapAtlasFramebuffer.getDepthAttachment();
+        const Texture &staticCasterAtlas = shadowMapComponent.staticCasterAtlas;
+
+        ReceiverBoundsPerLevel receiverBounds;
+        for (unsigned int i = 0; i < shadowMapComponent.levelCount; i++)
+        {
+            receiverBounds[i] = getShadowReceiverBounds(
+                shadowMapComponent.levels[i],
+                m_viewMatrix,
+                visibleBounds);
+        }
+
         shadowMapComponent.shadowMapAtlasFramebuffer.bind();
         for (unsigned int i = 0; i < shadowMapComponent.levelCount; i++)
         {
-            GL::viewport(
-                0,
-                i*shadowMapComponent.shadowMapSize,
-                shadowMapComponent.shadowMapSize,
-                shadowMapComponent.shadowMapSize);
-            m_animatedShadowMapShader->setUniform(
-                shadowMapComponent.levels[i].projectionView * modelMatrix,
-                "u_lightSpaceModelMatrix");
-            GL::drawIndexed(mesh->getVertexArray());
+            components::DirectionalLightShadowMap::ShadowMapLevel &level
+                = shadowMapComponent.levels[i];
+            components::DirectionalLightShadowMap::ShadowMapLevel::StaticCache &cache
+                = level.staticCache;
+            const int levelY = i * size;
+
+            GL::viewport(0, levelY, size, size);
+
+            // The cached depth can be reused if only the texel aligned position of the level
+            // changed, then it is scrolled and only the uncovered borders are drawn again
+            const bool sameProjection = cache.valid
+                && cache.castersHash == m_staticShadowCastersHash
+                && cache.lightDirection == level.lightDirection
+                && cache.maxDiagonal == level.maxDiagonal
+                && cache.centerDepth == level.centerDepth;
+            const glm::ivec2 shift = level.centerInTexels - cache.centerInTexels;
+            const bool canScroll = sameProjection
+                && static_cast<uint32_t>(std::abs(shift.x)) < size
+                && static_cast<uint32_t>(std::abs(shift.y)) < size;
+
+            if (canScroll && shift == glm::ivec2(0))
+            {
+                Texture::copy(staticCasterAtlas, 0, levelY, atlas, 0, levelY, size, size);
+            }
+            else
+            {
+                // Rectangles of the level (relative to it) that have to be drawn again
+                std::array<glm::ivec4, 2> dirtyRects;
+                uint32_t dirtyRectCount = 0;
+                if (canScroll)
+                {
+                    // The content moves in the opposite direction to the level
+                    const int keptWidth = size - std::abs(shift.x);
+                    const int keptHeight = size - std::abs(shift.y);
+                    Texture::copy(
+                        staticCasterAtlas,
+                        std::max(shift.x, 0), levelY + std::max(shift.y, 0),
+                        atlas,
+                        std::max(-shift.x, 0), levelY + std::max(-shift.y, 0),
+                        keptWidth, keptHeight);
+
+                    if (shift.x != 0)
+                        dirtyRects[dirtyRectCount++] = glm::ivec4(shift.x > 0 ? keptWidth : 0, 0, std::abs(shift.x), size);
+                    if (shift.y != 0)
+                        dirtyRects[dirtyRectCount++] = glm::ivec4(0, shift.y > 0 ? keptHeight : 0, size, std::abs(shift.y));
+                }
+                else
+                {
+                    dirtyRects[dirtyRectCount++] = glm::ivec4(0, 0, size, size);
+                }
+
+                GL::setScissorTest(true);
+                for (uint32_t rectIndex = 0; rectIndex < dirtyRectCount; rectIndex++)
+                {
+                    const glm::ivec4 &rect = dirtyRects[rectIndex];
+                    GL::scissor(rect.x, levelY + rect.y, rect.z, rect.w);
+                    GL::clear();
+                    drawShadowCasters(level, size, true, receiverBounds[i]);
+                }
+                GL::setScissorTest(false);
+
+                Texture::copy(atlas, 0, levelY, staticCasterAtlas, 0, levelY, size, size);
+                cache = {
+                    .valid = true,
+                    .lightDirection = level.lightDirection,
+                    .centerInTexels = level.centerInTexels,
+                    .centerDepth = level.centerDepth,
+                    .maxDiagonal = level.maxDiagonal,
+                    .castersHash = m_staticShadowCastersHash,
+                };
+            }
+
+            if (!m_staticSinglePassShadowMapShaders[0])
+                drawShadowCasters(level, size, false, receiverBounds[i]);
         }
+
+        if (m_staticSinglePassShadowMapShaders[0])
+            drawDynamicShadowCastersSinglePass(shadowMapComponent, receiverBounds);
     });
+
+    GL::setDepthClamp(false);
+}
+
+void ForwardRenderer::drawShadowCasters(
+    const engine::components::DirectionalLightShadowMap::ShadowMapLevel &level,
+    uint32_t shadowMapSize,
+    bool staticCasters,
+    const AxisAlignedBoundingBox &receiverBounds)
+{
+    // The static casters stay in the cache while the camera moves, so they can't depend on
+    // what it sees. They are drawn if they can shadow something inside the level: they have to
+    // overlap its sides and be in front of its far plane, from the light's point of view
+    const Frustum frustum(level.projectionView);
+    m_shadowDrawList.clear();
+    for (uint32_t casterIndex = 0; casterIndex < m_shadowCasters.size(); casterIndex++)
+    {
+        const ShadowCaster &caster = m_shadowCasters[casterIndex];
+        if ((caster.animatedMesh == nullptr) != staticCasters)
+            continue;
+        const bool needed = staticCasters
+            ? frustum.intersects(caster.worldAABB, Frustum::ALL_PLANES & ~(1 << Frustum::Plane::near))
+            : shadowReachesReceivers(caster.worldAABB.transformed(level.projectionView), receiverBounds);
+        if (needed)
+            m_shadowDrawList.push_back(casterIndex);
+    }
+    if (m_shadowDrawList.empty())
+        return;
+
+    // Group the draws that use the same shader
+    std::sort(m_shadowDrawList.begin(), m_shadowDrawList.end(), [this](uint32_t a, uint32_t b) {
+        const ShadowCaster &casterA = m_shadowCasters[a], &casterB = m_shadowCasters[b];
+        return std::pair(casterA.isSkinnedInShader(), casterA.getVertexFormat())
+            < std::pair(casterB.isSkinnedInShader(), casterB.getVertexFormat());
+    });
+
+    Shader *boundShader = nullptr;
+    for (uint32_t casterIndex : m_shadowDrawList)
+    {
+        const ShadowCaster &caster = m_shadowCasters[casterIndex];
+        const ShaderPerVertexFormat &shaders = caster.isSkinnedInShader()
+            ? m_animatedShadowMapShaders
+            : m_staticShadowMapShaders;
+        Shader &shader = *shaders[std::to_underlying(caster.getVertexFormat())];
+        if (&shader != boundShader)
+        {
+            shader.bind();
+            boundShader = &shader;
+        }
+
+        if (!caster.preSkinnedVertexArray)
+            setVertexFormatUniforms(shader, *caster.mesh);
+        if (caster.isSkinnedInShader())
+            shader.setUniform(caster.firstBoneMatrix, "u_firstBoneMatrix");
+        shader.setUniform(level.projectionView * caster.modelMatrix, "u_lightSpaceModelMatrix");
+
+        const Mesh::Lod &lod = selectLod(*caster.mesh, caster.modelMatrix, level, shadowMapSize);
+        GL::drawIndexed(caster.getVertexArray(), lod.indexCount, lod.firstIndex);
+    }
+}
+
+void ForwardRenderer::drawDynamicShadowCastersSinglePass(
+    const engine::components::DirectionalLightShadowMap &shadowMapComponent,
+    const ReceiverBoundsPerLevel &receiverBounds)
+{
+    const uint32_t size = shadowMapComponent.shadowMapSize;
+    // The whole block is bound, the levels after levelCount aren't read
+    std::array<glm::mat4, components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS> projectionViews;
+    projectionViews.fill(glm::mat4(1.0f));
+    for (unsigned int i = 0; i < shadowMapComponent.levelCount; i++)
+    {
+        const components::DirectionalLightShadowMap::ShadowMapLevel &level
+            = shadowMapComponent.levels[i];
+        GL::viewport(i, 0, i * size, size, size);
+        projectionViews[i] = level.projectionView;
+    }
+    const StreamBuffer::Allocation levelsAllocation = m_streamBuffer->push(
+        projectionViews.data(),
+        sizeof(projectionViews),
+        StreamBuffer::getUniformAlignment());
+    if (!levelsAllocation.data)
+        return;
+    m_streamBuffer->bindUniformRange(SHADOW_MAP_LEVELS_BINDING, levelsAllocation);
+
+    Shader *boundShader = nullptr;
+    for (const ShadowCaster &caster : m_shadowCasters)
+    {
+        if (!caster.animatedMesh)
+            continue;
+
+        // Each instance draws the caster in one of the levels where its shadow reaches a receiver
+        uint32_t instanceLevels = 0, instanceCount = 0;
+        for (uint32_t i = 0; i < shadowMapComponent.levelCount; i++)
+        {
+            if (shadowReachesReceivers(
+                caster.worldAABB.transformed(projectionViews[i]),
+                receiverBounds[i]))
+            {
+                instanceLevels |= i << (4 * instanceCount++);
+            }
+        }
+        if (instanceCount == 0)
+            continue;
+
+        const ShaderPerVertexFormat &shaders = caster.isSkinnedInShader()
+            ? m_animatedSinglePassShadowMapShaders
+            : m_staticSinglePassShadowMapShaders;
+        Shader &shader = *shaders[std::to_underlying(caster.getVertexFormat())];
+        if (&shader != boundShader)
+        {
+            shader.bind();
+            boundShader = &shader;
+        }
+
+        if (!caster.preSkinnedVertexArray)
+            setVertexFormatUniforms(shader, *caster.mesh);
+        if (caster.isSkinnedInShader())
+            shader.setUniform(caster.firstBoneMatrix, "u_firstBoneMatrix");
+        shader.setUniform(caster.modelMatrix, "u_modelMatrix");
+        shader.setUniform(instanceLevels, "u_instanceLevels");
+
+        // One LOD for all the levels, the one for the first level has the smallest texels
+        const uint32_t firstLevel = instanceLevels & 0xF;
+        const Mesh::Lod &lod = selectLod(
+            *caster.mesh,
+            caster.modelMatrix,
+            shadowMapComponent.levels[firstLevel],
+            size);
+        GL::drawIndexedInstanced(caster.getVertexArray(), instanceCount, lod.indexCount, lod.firstIndex);
+    }
 }
 
 // nextFreeSlot gets incremented for each bound texture
@@ -581,68 +1342,64 @@ void ForwardRenderer::setMaterialUniforms(
     }
 }
 
-void ForwardRenderer::setLightUniforms(
-    Shader &shader,
-    const flecs::world &world,
-    const engine::components::Transform &cameraTransform,
-    int &nextFreeTextureSlot) const
+void ForwardRenderer::updateLightsBlock(const flecs::world &world)
 {
+    ForwardMeshLightsBlock block {};
+
     // Directional Light
-    int lightIndex = 0;
-    world.each([this, &nextFreeTextureSlot, &lightIndex, &cameraTransform, &shader](
+    int32_t lightIndex = 0;
+    world.each([this, &block, &lightIndex](
         const components::DirectionalLight &light,
         const components::Transform &transform,
         components::DirectionalLightShadowMap *shadowMapComponent)
     {
+        if (lightIndex == static_cast<int32_t>(components::MAX_DIRECTIONAL_LIGHTS))
+            return;
+
+        ForwardMeshLightsBlock::DirectionalLight &blockLight = block.directionalLights[lightIndex];
         if (std::to_underlying(m_flags & Flags::enableShadowMapping) && shadowMapComponent)
         {
-            shadowMapComponent->shadowMapAtlasFramebuffer.getDepthAttachment().bind(nextFreeTextureSlot);
-            shader.setUniform(nextFreeTextureSlot, "u_directionalLightsShadowMapAtlas[{}]", lightIndex);
-            nextFreeTextureSlot++;
+            // The atlas of each light is in the texture unit of its index
+            shadowMapComponent->shadowMapAtlasFramebuffer.getDepthAttachment().bind(lightIndex);
 
             for (unsigned int i = 0; i < shadowMapComponent->levelCount; i++)
             {
                 const components::DirectionalLightShadowMap::ShadowMapLevel &shadowMap
                     = shadowMapComponent->levels[i];
-                glm::mat4 cameraSpaceToLightSpace
-                    = shadowMap.projectionView * glm::inverse(cameraTransform.getView());
-                shader.setUniform(
-                    cameraSpaceToLightSpace,
-                    "u_directionalLights[{}].shadowMapLevels[{}].cameraSpaceToLightSpace",
-                    lightIndex, i);
-                shader.setUniform(
-                    shadowMap.cutoffDistance,
-                    "u_directionalLights[{}].shadowMapLevels[{}].cutoffDistance",
-                    lightIndex, i);
+                blockLight.shadowMapLevels[i].cameraSpaceToLightSpace
+                    = shadowMap.projectionView * glm::inverse(m_viewMatrix);
+                blockLight.shadowMapLevels[i].cutoffDistance = shadowMap.cutoffDistance;
             }
-            shader.setUniform(shadowMapComponent->levelCount, "u_directionalLights[{}].numOfShadowMapLevels", lightIndex);
+            blockLight.numOfShadowMapLevels = shadowMapComponent->levelCount;
         }
 
         glm::vec3 lightDirection = transform.getRotationMat3() * glm::vec3(0.0f, 0.0f, -1.0f);
-        shader.setUniform(
-            glm::mat3(cameraTransform.getView()) * lightDirection,
-            "u_directionalLights[{}].directionInViewSpace", lightIndex);
-        shader.setUniform(light.color, "u_directionalLights[{}].color", lightIndex);
-        shader.setUniform(light.intensity, "u_directionalLights[{}].intensity", lightIndex);
+        blockLight.directionInViewSpace = glm::mat3(m_viewMatrix) * lightDirection;
+        blockLight.color = light.color;
+        blockLight.intensity = light.intensity;
 
         lightIndex++;
     });
-    shader.setUniform(lightIndex, "u_numOfDirectionalLights");
+    block.numOfDirectionalLights = lightIndex;
 
-    int i = 0;
-    world.each([&i, &cameraTransform, &shader](
-        const components::PointLight &light,
-        const components::Transform & transform)
+    // Point lights are read from the light clusters storage buffers
+    block.clusterGridSize
+        = glm::uvec3(LightClusters::GRID_SIZE_X, LightClusters::GRID_SIZE_Y, LightClusters::GRID_SIZE_Z);
+    block.clusterDepthScale = m_lightClusters.getDepthSliceScale();
+    block.clusterDepthBias = m_lightClusters.getDepthSliceBias();
+
+    const uint32_t alignment = StreamBuffer::getUniformAlignment();
+    if (m_streamBuffer->fits(sizeof(block), alignment))
     {
-        glm::vec3 lightPosInViewSpace = cameraTransform.getView() * glm::vec4(transform.position, 1.0f);
+        const StreamBuffer::Allocation allocation
+            = m_streamBuffer->push(&block, sizeof(block), alignment);
+        m_streamBuffer->bindUniformRange(ForwardMeshLightsBlock::BINDING, allocation);
+        return;
+    }
 
-        shader.setUniform(lightPosInViewSpace, "u_pointLights[{}].posInViewSpace", i);
-        shader.setUniform(light.color, "u_pointLights[{}].color", i);
-        shader.setUniform(light.intensity, "u_pointLights[{}].intensity", i);
-        shader.setUniform(light.attenuation, "u_pointLights[{}].attenuation", i);
-        i++;
-    });
-    shader.setUniform(i, "u_numOfPointLights");
+    m_streamBufferOverflow += sizeof(block) + alignment;
+    m_lightsBuffer->setData(&block, sizeof(block));
+    m_lightsBuffer->bind(ForwardMeshLightsBlock::BINDING);
 }
 
 void ForwardRenderer::drawMesh(
@@ -662,18 +1419,25 @@ void ForwardRenderer::drawMesh(
         return;
     }
 
+    Shader &shader = *m_staticMeshShaders[std::to_underlying(mesh->getVertexFormat())];
     renderTarget.bind();
-    m_staticMeshShader->bind();
-    m_staticMeshShader->setUniform(camera.getProjection(), "u_projectionMatrix");
-    m_staticMeshShader->setUniform(cameraTransform.getView() * modelMatrix, "u_viewModelMatrix");
-    m_staticMeshShader->setUniform(0.05f, "u_parallaxScale");
+    shader.bind();
+    shader.setUniform(camera.getProjection(), "u_projectionMatrix");
+    shader.setUniform(m_viewMatrix * modelMatrix, "u_viewModelMatrix");
+    shader.setUniform(0.05f, "u_parallaxScale");
+    setVertexFormatUniforms(shader, *mesh);
     GL::setDepthTest(true);
 
-    setMaterialUniforms(*m_staticMeshShader, material, assetManager, nextFreeTextureSlot);
+    setMaterialUniforms(shader, material, assetManager, nextFreeTextureSlot);
 
+    const Mesh::Lod &lod = selectLod(
+        *mesh,
+        m_viewMatrix * modelMatrix,
+        camera,
+        renderTarget.getHeight());
     mesh->getVertexArray().bind();
     GL::viewport(renderTarget.getWidth(), renderTarget.getHeight());
-    GL::drawIndexed(mesh->getVertexArray());
+    GL::drawIndexed(mesh->getVertexArray(), lod.indexCount, lod.firstIndex);
 }
 
 void ForwardRenderer::drawMesh(
@@ -681,7 +1445,8 @@ void ForwardRenderer::drawMesh(
     const engine::components::Camera &camera,
     const engine::components::AnimatedMesh &meshComponent,
     const engine::components::Material *materialComponent,
-    const engine::components::AnimationPlayer *animationComponent,
+    uint32_t firstBoneMatrix,
+    const VertexArray *preSkinnedVertexArray,
     const glm::mat4 &modelMatrix,
     const AssetManager &assetManager,
     const FrameBuffer &renderTarget,
@@ -689,44 +1454,39 @@ void ForwardRenderer::drawMesh(
 {
     const AnimatedMesh *mesh = assetManager.get(meshComponent.id);
     const Material *material = materialComponent ? assetManager.get(materialComponent->id) : nullptr;
-    const Animation *animation = animationComponent ? assetManager.get(animationComponent->id) : nullptr;
     if (!mesh) {
         WARN("Animated mesh with id: {} does not exist", std::to_underlying(meshComponent.id));
         return;
     }
 
+    // Pre-skinned vertices are full static mesh vertices
+    Shader &shader = preSkinnedVertexArray
+        ? *m_staticMeshShaders[std::to_underlying(Mesh::VertexFormat::full)]
+        : *m_animatedMeshShaders[std::to_underlying(mesh->getVertexFormat())];
+    const VertexArray &vertexArray = preSkinnedVertexArray
+        ? *preSkinnedVertexArray
+        : mesh->getVertexArray();
     renderTarget.bind();
-    m_animatedMeshShader->bind();
-    m_animatedMeshShader->setUniform(camera.getProjection(), "u_projectionMatrix");
-    m_animatedMeshShader->setUniform(cameraTransform.getView() * modelMatrix, "u_viewModelMatrix");
-    m_animatedMeshShader->setUniform(0.05f, "u_parallaxScale");
-    GL::setDepthTest(true);
-
-    if (animationComponent && animation)
+    shader.bind();
+    shader.setUniform(camera.getProjection(), "u_projectionMatrix");
+    shader.setUniform(m_viewMatrix * modelMatrix, "u_viewModelMatrix");
+    shader.setUniform(0.05f, "u_parallaxScale");
+    if (!preSkinnedVertexArray)
     {
-        std::vector<glm::mat4> matrices
-            = animation->getTransformations(
-                animationComponent->progress,
-                mesh->getSkeleton());
-
-        for (BoneID boneId = 0; boneId < matrices.size(); boneId++)
-        {
-            m_animatedMeshShader->setUniform(matrices[boneId], "u_finalBonesMatrices[{}]", boneId);
-        }
-    }
-    else
-    {
-        for (BoneID boneId = 0; boneId < mesh->getSkeleton().bones.size(); boneId++)
-        {
-            m_animatedMeshShader->setUniform(glm::mat4(1.0f), "u_finalBonesMatrices[{}]", boneId);
-        }
+        setVertexFormatUniforms(shader, *mesh);
+        shader.setUniform(firstBoneMatrix, "u_firstBoneMatrix");
     }
+    GL::setDepthTest(true);
 
-    setMaterialUniforms(*m_animatedMeshShader, material, assetManager, nextFreeTextureSlot);
+    setMaterialUniforms(shader, material, assetManager, nextFreeTextureSlot);
 
-    mesh->getVertexArray().bind();
+    const Mesh::Lod &lod = selectLod(
+        *mesh,
+        m_viewMatrix * modelMatrix,
+        camera,
+        renderTarget.getHeight());
     GL::viewport(renderTarget.getWidth(), renderTarget.getHeight());
-    GL::drawIndexed(mesh->getVertexArray());
+    GL::drawIndexed(vertexArray, lod.indexCount, lod.firstIndex);
 }
 
 void ForwardRenderer::drawAABB(
@@ -747,7 +1507,7 @@ void ForwardRenderer::drawAABB(
     renderTarget.bind();
     m_cubeLinesShader->bind();
     glm::mat4 matrix
-        = camera.getProjection() * cameraTransform.getView()
+        = camera.getProjection() * m_viewMatrix
         * modelMatrix
         * glm::translate(glm::mat4(1.0f), aabb.min)
         * glm::scale(glm::mat4(1.0f), aabb.max - aabb.min);
@@ -765,7 +1525,7 @@ void ForwardRenderer::drawSkeleton(
     const engine::components::Transform &cameraTransform,
     const engine::components::Camera &camera,
     const engine::components::AnimatedMesh &meshComponent,
-    const engine::components::AnimationPlayer *animationComponent,
+    uint32_t firstBoneMatrix,
     const glm::mat4 &modelMatrix,
     const AssetManager &assetManager,
     const FrameBuffer &renderTarget) const
@@ -776,25 +1536,24 @@ void ForwardRenderer::drawSkeleton(
         return;
     }
 
-    const Animation *animation = animationComponent ? assetManager.get(animationComponent->id) : nullptr;
     const Skeleton &skeleton = mesh->getSkeleton();
 
     renderTarget.bind();
     m_cubeLinesShader->bind();
     glm::mat4 matrix
-        = camera.getProjection() * cameraTransform.getView()
+        = camera.getProjection() * m_viewMatrix
         * modelMatrix;
     m_cubeLinesShader->setUniform(matrix, "u_projectionView");
 
     GL::viewport(renderTarget.getWidth(), renderTarget.getHeight());
     GL::setDepthTestFunction(GL::DepthTestFunction::always);
-    m_linesBatchVertices.clear();
+    std::pmr::vector<glm::vec3> vertices(&FrameArena::get());
+    vertices.reserve(skeleton.bones.size() * 2);
 
-    std::vector<glm::mat4> animated
-        = animation->getTransformations(animationComponent->progress, skeleton);
+    const glm::mat4 *animated = &m_boneMatrices[firstBoneMatrix];
     for (size_t i = 1; i < skeleton.bones.size(); i++)
     {
-        m_linesBatchVertices.emplace_back(
+        vertices.emplace_back(
             toVec3(
                 (
                     animated[i]
@@ -802,7 +1561,7 @@ void ForwardRenderer::drawSkeleton(
                 )[3]
             )
         );
-        m_linesBatchVertices.emplace_back(
+        vertices.emplace_back(
             toVec3(
                 (
                     animated[skeleton.bones[i].parentID]
@@ -811,10 +1570,17 @@ void ForwardRenderer::drawSkeleton(
             )
         );
     }
-    m_linesBatchVertexBuffer->setData(
-        m_linesBatchVertices.data(),
-        m_linesBatchVertices.size() * sizeof(m_linesBatchVertices[0]));
-    GL::drawLines(*m_linesBatchVertexArray, m_linesBatchVertices.size());
+    const StreamBuffer::Allocation allocation = m_streamBuffer->push(
+        vertices.data(), vertices.size() * sizeof(vertices[0]), sizeof(vertices[0]));
+    // The index buffer has MAX_VERTICES_IN_LINES_BATCH indices, bigger skeletons take more draws
+    const uint32_t firstVertex = allocation.offset / sizeof(vertices[0]);
+    for (size_t first = 0; allocation.data && first < vertices.size(); first += MAX_VERTICES_IN_LINES_BATCH)
+    {
+        GL::drawLines(
+            *m_linesBatchVertexArray,
+            std::min(vertices.size() - first, MAX_VERTICES_IN_LINES_BATCH),
+            firstVertex + first);
+    }
     GL::setDepthTestFunction(GL::DepthTestFunction::less);
 }
 
@@ -829,7 +1595,7 @@ void ForwardRenderer::drawSkybox(
     GL::setDepthTestFunction(GL::DepthTestFunction::lessEqual);
     m_skyboxShader->bind();
     m_skyboxShader->setUniform(
-        camera.getProjection() * glm::mat4(glm::mat3(cameraTransform.getView())),
+        camera.getProjection() * glm::mat4(glm::mat3(m_viewMatrix)),
         "u_projectionView");
     cubemap.bind(0);
     m_skyboxShader->setUniform(0, "u_skybox");
@@ -0,0 +1,128 @@
+#include "engine/FrameArena.hpp"
+
+#include <utils/Assert.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+
+namespace engine {
+
+LinearArena::LinearArena(size_t blockSize, size_t maxCapacity)
+    : m_blockSize(blockSize),
+      m_maxCapacity(maxCapacity)
+{}
+
+void LinearArena::reset()
+{
+    if (m_blocks.size() > 1)
+    {
+        const size_t capacity = getCapacity();
+        m_blocks.clear();
+        m_blocks.push_back({.data = std::make_unique<std::byte[]>(capacity), .size = capacity});
+    }
+    m_offset = 0;
+    m_usedSize = 0;
+}
+
+size_t LinearArena::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const Block &block : m_blocks)
+        capacity += block.size;
+    return capacity;
+}
+
+void *LinearArena::do_allocate(size_t size, size_t alignment)
+{
+    ASSERT_MSG(std::has_single_bit(alignment), "The alignment has to be a power of 2");
+
+    if (!m_blocks.empty())
+    {
+        const Block &block = m_blocks.back();
+        const uintptr_t start = reinterpret_cast<uintptr_t>(block.data.get());
+        const uintptr_t aligned = (start + m_offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + size <= start + block.size)
+        {
+            m_usedSize += aligned + size - (start + m_offset);
+            m_offset = aligned + size - start;
+            return reinterpret_cast<void*>(aligned);
+        }
+    }
+
+    // The space left in the previous block is lost until the next reset
+    const size_t blockSize = std::max(m_blockSize, size + alignment);
+    ASSERT_MSG(
+        getCapacity() + blockSize <= m_maxCapacity,
+        "The arena needs more than its limit of {} bytes, is it reset? The FrameArenas are reset "
+        "by FrameArena::nextFrame(), that has to be called every frame",
+        m_maxCapacity);
+    const Block &block = m_blocks.emplace_back(std::make_unique<std::byte[]>(blockSize), blockSize);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(block.data.get());
+    const uintptr_t aligned = (start + alignment - 1) & ~(alignment - 1);
+    m_offset = aligned + size - start;
+    m_usedSize += m_offset;
+    return reinterpret_cast<void*>(aligned);
+}
+
+namespace {
+
+struct ThreadArenas {
+    LinearArena arenas[2] = {
+        LinearArena(LinearArena::DEFAULT_BLOCK_SIZE, FrameArena::MAX_THREAD_FRAME_SIZE),
+        LinearArena(LinearArena::DEFAULT_BLOCK_SIZE, FrameArena::MAX_THREAD_FRAME_SIZE),
+    };
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Never freed, nextFrame() resets the arenas of the threads that finished too
+    std::vector<std::unique_ptr<ThreadArenas>> threads;
+    std::atomic<uint64_t> frame = 0;
+};
+
+Registry &getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadArenas &createThreadArenas()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    return *registry.threads.emplace_back(std::make_unique<ThreadArenas>());
+}
+
+} // namespace
+
+LinearArena &FrameArena::get()
+{
+    thread_local ThreadArenas &threadArenas = createThreadArenas();
+    return threadArenas.arenas[getRegistry().frame.load(std::memory_order_relaxed) % 2];
+}
+
+void FrameArena::nextFrame()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    const uint64_t frame = registry.frame.load(std::memory_order_relaxed) + 1;
+    for (const std::unique_ptr<ThreadArenas> &threadArenas : registry.threads)
+        threadArenas->arenas[frame % 2].reset();
+    registry.frame.store(frame, std::memory_order_relaxed);
+}
+
+size_t FrameArena::getUsedSize()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    const uint64_t frame = registry.frame.load(std::memory_order_relaxed);
+    size_t usedSize = 0;
+    for (const std::unique_ptr<ThreadArenas> &threadArenas : registry.threads)
+        usedSize += threadArenas->arenas[frame % 2].getUsedSize();
+    return usedSize;
+}
+
+} // namespace engine
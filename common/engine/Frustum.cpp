@@ -0,0 +1,35 @@
+#include "engine/Frustum.hpp"
+
+Frustum::Frustum(const glm::mat4 &projectionView)
+{
+    // Gribb and Hartmann: each plane is the last row of the matrix plus or minus another row
+    const glm::mat4 m = glm::transpose(projectionView);
+    planes[Plane::left]   = m[3] + m[0];
+    planes[Plane::right]  = m[3] - m[0];
+    planes[Plane::bottom] = m[3] + m[1];
+    planes[Plane::top]    = m[3] - m[1];
+    planes[Plane::near]   = m[3] + m[2];
+    planes[Plane::far]    = m[3] - m[2];
+
+    for (glm::vec4 &plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const AxisAlignedBoundingBox &aabb, uint8_t planeMask) const
+{
+    for (uint8_t i = 0; i < Plane::last; i++)
+    {
+        if (!(planeMask & (1 << i)))
+            continue;
+
+        // The corner of the box that is furthest along the normal
+        const glm::vec4 &plane = planes[i];
+        const glm::vec3 corner(
+            plane.x >= 0.0f ? aabb.max.x : aabb.min.x,
+            plane.y >= 0.0f ? aabb.max.y : aabb.min.y,
+            plane.z >= 0.0f ? aabb.max.z : aabb.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
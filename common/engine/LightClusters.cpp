@@ -0,0 +1,165 @@
+#include "engine/LightClusters.hpp"
+
+#include <utils/Log.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace engine {
+
+// Contributions under this are not visible in an 8 bit per channel render target
+constexpr float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
+
+float LightClusters::getPointLightRadius(
+    const glm::vec3 &color,
+    float intensity,
+    float attenuation,
+    float maxRadius)
+{
+    // Solves intensity * color / (1 + attenuation * d^2) = cutoff for d
+    const float brightness = intensity * std::max({color.x, color.y, color.z});
+    if (brightness <= POINT_LIGHT_CUTOFF)
+        return 0.0f;
+    if (attenuation <= 0.0f)
+        return maxRadius;
+    return std::min(std::sqrt((brightness / POINT_LIGHT_CUTOFF - 1.0f) / attenuation), maxRadius);
+}
+
+void LightClusters::setProjection(float fov, float aspect, float near, float far)
+{
+    if (fov == m_fov && aspect == m_aspect && near == m_near && far == m_far)
+        return;
+
+    m_fov = fov, m_aspect = aspect, m_near = near, m_far = far;
+
+    const float logDepthRange = std::log(far / near);
+    m_depthSliceScale = GRID_SIZE_Z / logDepthRange;
+    m_depthSliceBias = -m_depthSliceScale * std::log(near);
+    for (uint32_t z = 0; z <= GRID_SIZE_Z; z++)
+        m_sliceDepths[z] = near * std::pow(far / near, static_cast<float>(z) / GRID_SIZE_Z);
+
+    const float tanHalfFovY = std::tan(glm::radians(fov) * 0.5f);
+    const float tanHalfFovX = tanHalfFovY * aspect;
+
+    m_minX.resize(CLUSTER_COUNT), m_minY.resize(CLUSTER_COUNT), m_minZ.resize(CLUSTER_COUNT);
+    m_maxX.resize(CLUSTER_COUNT), m_maxY.resize(CLUSTER_COUNT), m_maxZ.resize(CLUSTER_COUNT);
+    for (uint32_t z = 0; z < GRID_SIZE_Z; z++)
+    {
+        const float nearDepth = m_sliceDepths[z], farDepth = m_sliceDepths[z + 1];
+        for (uint32_t y = 0; y < GRID_SIZE_Y; y++)
+        {
+            for (uint32_t x = 0; x < GRID_SIZE_X; x++)
+            {
+                // The sides of the tile in normalized device coordinates
+                const float left = 2.0f * x / GRID_SIZE_X - 1.0f;
+                const float right = 2.0f * (x + 1) / GRID_SIZE_X - 1.0f;
+                const float bottom = 2.0f * y / GRID_SIZE_Y - 1.0f;
+                const float top = 2.0f * (y + 1) / GRID_SIZE_Y - 1.0f;
+
+                // The frustum of the tile gets wider with depth so the bounds come from the
+                // corners at both depths
+                const uint32_t index = x + y * GRID_SIZE_X + z * TILES_PER_SLICE;
+                m_minX[index] = std::min(left * nearDepth, left * farDepth) * tanHalfFovX;
+                m_maxX[index] = std::max(right * nearDepth, right * farDepth) * tanHalfFovX;
+                m_minY[index] = std::min(bottom * nearDepth, bottom * farDepth) * tanHalfFovY;
+                m_maxY[index] = std::max(top * nearDepth, top * farDepth) * tanHalfFovY;
+                m_minZ[index] = -farDepth;
+                m_maxZ[index] = -nearDepth;
+            }
+        }
+    }
+}
+
+void LightClusters::assignLights(
+    std::span<const ClusteredPointLight> lights,
+    ThreadPool &threadPool)
+{
+    m_clusterLightSlots.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+    m_clusterLightCounts.resize(CLUSTER_COUNT);
+
+    std::atomic<uint32_t> droppedAssignments = 0;
+    threadPool.parallelFor(GRID_SIZE_Z, 1, [this, lights, &droppedAssignments](uint32_t begin, uint32_t end) {
+        std::array<float, TILES_PER_SLICE> squaredDistances;
+        uint32_t dropped = 0;
+        for (uint32_t z = begin; z < end; z++)
+        {
+            const uint32_t firstCluster = z * TILES_PER_SLICE;
+            uint32_t *counts = &m_clusterLightCounts[firstCluster];
+            uint32_t *slots = &m_clusterLightSlots[firstCluster * MAX_LIGHTS_PER_CLUSTER];
+            std::fill_n(counts, TILES_PER_SLICE, 0);
+
+            for (uint32_t lightIndex = 0; lightIndex < lights.size(); lightIndex++)
+            {
+                const glm::vec4 &sphere = lights[lightIndex].positionAndRadius;
+                const float depth = -sphere.z;
+                if (depth + sphere.w < m_sliceDepths[z] || depth - sphere.w > m_sliceDepths[z + 1])
+                    continue;
+
+                // Squared distance from the center of the sphere to every cluster of the slice
+                const float *minX = &m_minX[firstCluster], *maxX = &m_maxX[firstCluster];
+                const float *minY = &m_minY[firstCluster], *maxY = &m_maxY[firstCluster];
+                const float *minZ = &m_minZ[firstCluster], *maxZ = &m_maxZ[firstCluster];
+                for (uint32_t i = 0; i < TILES_PER_SLICE; i++)
+                {
+                    const float dx = std::max(std::max(minX[i] - sphere.x, sphere.x - maxX[i]), 0.0f);
+                    const float dy = std::max(std::max(minY[i] - sphere.y, sphere.y - maxY[i]), 0.0f);
+                    const float dz = std::max(std::max(minZ[i] - sphere.z, sphere.z - maxZ[i]), 0.0f);
+                    squaredDistances[i] = dx * dx + dy * dy + dz * dz;
+                }
+
+                const float squaredRadius = sphere.w * sphere.w;
+                for (uint32_t i = 0; i < TILES_PER_SLICE; i++)
+                {
+                    if (squaredDistances[i] > squaredRadius)
+                        continue;
+                    if (counts[i] == MAX_LIGHTS_PER_CLUSTER)
+                    {
+                        dropped++;
+                        continue;
+                    }
+                    slots[i * MAX_LIGHTS_PER_CLUSTER + counts[i]++] = lightIndex;
+                }
+            }
+        }
+        if (dropped > 0)
+            droppedAssignments.fetch_add(dropped, std::memory_order_relaxed);
+    });
+
+    if (droppedAssignments > 0)
+    {
+        WARN("{} point light assignments dropped, clusters are limited to {} lights",
+            droppedAssignments.load(), MAX_LIGHTS_PER_CLUSTER);
+    }
+
+    // Compacts the slots of the clusters into one list for the storage buffer
+    m_clusters.resize(CLUSTER_COUNT);
+    m_lightIndices.clear();
+    for (uint32_t i = 0; i < CLUSTER_COUNT; i++)
+    {
+        const auto slots = m_clusterLightSlots.begin() + i * MAX_LIGHTS_PER_CLUSTER;
+        m_clusters[i] = {
+            .offset = static_cast<uint32_t>(m_lightIndices.size()),
+            .count = m_clusterLightCounts[i],
+        };
+        m_lightIndices.insert(m_lightIndices.end(), slots, slots + m_clusterLightCounts[i]);
+    }
+}
+
+uint32_t LightClusters::getClusterIndex(const glm::vec3 &viewPosition) const
+{
+    const float depth = -viewPosition.z;
+    const float tanHalfFovY = std::tan(glm::radians(m_fov) * 0.5f);
+    const float tanHalfFovX = tanHalfFovY * m_aspect;
+    const float ndcX = viewPosition.x / (depth * tanHalfFovX);
+    const float ndcY = viewPosition.y / (depth * tanHalfFovY);
+
+    const int32_t x = std::floor((ndcX * 0.5f + 0.5f) * GRID_SIZE_X);
+    const int32_t y = std::floor((ndcY * 0.5f + 0.5f) * GRID_SIZE_Y);
+    const int32_t z = std::floor(std::log(depth) * m_depthSliceScale + m_depthSliceBias);
+    return std::clamp<int32_t>(x, 0, GRID_SIZE_X - 1)
+        + std::clamp<int32_t>(y, 0, GRID_SIZE_Y - 1) * GRID_SIZE_X
+        + std::clamp<int32_t>(z, 0, GRID_SIZE_Z - 1) * TILES_PER_SLICE;
+}
+
+} // namespace engine
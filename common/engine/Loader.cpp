@@ -1,4 +1,5 @@
 #include "engine/Loader.hpp"
+#include "engine/MeshOptimizer.hpp"
 
 #include <filesystem>
 #include <glm/gtc/type_ptr.hpp>
@@ -7,6 +8,7 @@
 #include <limits>
 #include <unordered_map>
 #include <utils/Assert.hpp>
+#include <utils/MemoryTracker.hpp>
 
 #include <cgltf.h>
 
@@ -109,9 +111,9 @@ void readMesh(const cgltf_mesh &mesh, MeshType &outMesh)
         // Calculate AABB
         for (glm::length_t j = 0; j < outMesh.aabb.min.length(); j++)
         {
-            if (outMesh.vertices[i].position[j] > outMesh.aabb.min[j])
+            if (outMesh.vertices[i].position[j] < outMesh.aabb.min[j])
                 outMesh.aabb.min[j] = outMesh.vertices[i].position[j];
-            if (outMesh.vertices[i].position[j] < outMesh.aabb.max[j])
+            if (outMesh.vertices[i].position[j] > outMesh.aabb.max[j])
                 outMesh.aabb.max[j] = outMesh.vertices[i].position[j];
         }
 
@@ -225,6 +227,7 @@ inline glm::mat4 getTransform(const cgltf_node *node)
 template<>
 std::optional<paca::fileformats::StaticMesh> load<paca::fileformats::StaticMesh>(const char *path)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     cgltf_options options {cgltf_file_type_invalid, 0};
     cgltf_data *data = NULL;
     cgltf_result result = cgltf_parse_file(&options, path, &data);
@@ -245,6 +248,8 @@ std::optional<paca::fileformats::StaticMesh> load<paca::fileformats::StaticMesh>
 
     paca::fileformats::StaticMesh mesh;
     readMesh(data->meshes[0], mesh);
+    meshoptimizer::optimizeMesh(mesh);
+    meshoptimizer::generateLods(mesh);
 
     cgltf_free(data);
     return mesh;
@@ -276,6 +281,7 @@ void readSkeleton(const cgltf_node &skin, paca::fileformats::Skeleton &outSkelet
 template<>
 std::optional<paca::fileformats::AnimatedMesh> load<paca::fileformats::AnimatedMesh>(const char *path)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     cgltf_options options {cgltf_file_type_invalid, 0};
     cgltf_data *data = NULL;
     cgltf_result result = cgltf_parse_file(&options, path, &data);
@@ -296,6 +302,8 @@ std::optional<paca::fileformats::AnimatedMesh> load<paca::fileformats::AnimatedM
 
     paca::fileformats::AnimatedMesh mesh;
     readMesh(data->meshes[0], mesh);
+    meshoptimizer::optimizeMesh(mesh);
+    meshoptimizer::generateLods(mesh);
     ASSERT(data->skins[0].joints_count > 0);
     readSkeleton(*(data->skins[0].joints[0]), mesh.skeleton, std::numeric_limits<uint32_t>::max());
 
@@ -474,6 +482,7 @@ void readAnimation(
 template<>
 std::optional<paca::fileformats::Animation> load<paca::fileformats::Animation>(const char *path)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     cgltf_options options {cgltf_file_type_invalid, 0};
     cgltf_data *data = NULL;
     cgltf_result result = cgltf_parse_file(&options, path, &data);
@@ -512,6 +521,7 @@ std::optional<paca::fileformats::Animation> load<paca::fileformats::Animation>(c
 template<>
 std::optional<paca::fileformats::Texture> load<paca::fileformats::Texture>(const char *path)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     int width, height, channels;
     stbi_set_flip_vertically_on_load(0);
     stbi_uc *data = stbi_load(path, &width, &height, &channels, 0);
@@ -539,6 +549,7 @@ std::optional<paca::fileformats::Texture> load<paca::fileformats::Texture>(const
 template<>
 std::optional<paca::fileformats::CubeMap> load<paca::fileformats::CubeMap>(const char *path)
 {
+    MemoryTagScope memoryTag(MemoryTag::assets);
     const std::array<const char*, 6> facesNames = {
         "right.jpg",
         "left.jpg",
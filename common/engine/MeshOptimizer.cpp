@@ -0,0 +1,721 @@
+#include "engine/MeshOptimizer.hpp"
+
+#include <utils/Assert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
+namespace engine::meshoptimizer {
+
+namespace {
+
+constexpr uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
+// Parameters from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+constexpr uint32_t forsythCacheSize = 32;
+constexpr float forsythCacheDecayPower = 1.5f;
+constexpr float forsythLastTriangleScore = 0.75f;
+constexpr float forsythValenceBoostScale = 2.0f;
+constexpr float forsythValenceBoostPower = 0.5f;
+
+float forsythVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+{
+    // Vertices without triangles left dont add anything to the triangles score
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score so the next triangle doesnt favour
+        // any of the three
+        if (cachePosition < 3)
+        {
+            score = forsythLastTriangleScore;
+        }
+        else
+        {
+            const float scaler = 1.0f / (forsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, forsythCacheDecayPower);
+        }
+    }
+
+    // Boost vertices with few triangles left so they are finished and dont leave lone triangles
+    score += forsythValenceBoostScale
+        * std::pow(static_cast<float>(remainingTriangles), -forsythValenceBoostPower);
+    return score;
+}
+
+uint64_t hashBytes(const std::byte *data, size_t size)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<uint64_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Returns the number of cache misses of every triangle simulating a FIFO cache
+std::vector<uint8_t> simulateFifoCache(
+    std::span<const uint32_t> indices,
+    uint32_t vertexCount,
+    uint32_t cacheSize)
+{
+    std::vector<uint8_t> misses(indices.size() / 3, 0);
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    // Start after cacheSize so the initial timestamps of 0 are outside the cache
+    uint32_t timestamp = cacheSize + 1;
+
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const uint32_t index = indices[i];
+        ASSERT(index < vertexCount);
+        if (timestamp - cacheTimestamps[index] > cacheSize)
+        {
+            cacheTimestamps[index] = timestamp++;
+            misses[i / 3]++;
+        }
+    }
+
+    return misses;
+}
+
+} // namespace
+
+VertexCacheStatistics analyzeVertexCache(
+    std::span<const uint32_t> indices,
+    uint32_t vertexCount,
+    uint32_t cacheSize)
+{
+    ASSERT(indices.size() % 3 == 0);
+    if (indices.empty())
+        return { .acmr = 0.0f, .atvr = 0.0f };
+
+    const std::vector<uint8_t> misses = simulateFifoCache(indices, vertexCount, cacheSize);
+    const size_t totalMisses = std::accumulate(misses.begin(), misses.end(), size_t(0));
+
+    std::vector<bool> referenced(vertexCount, false);
+    size_t referencedCount = 0;
+    for (uint32_t index : indices)
+    {
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            referencedCount++;
+        }
+    }
+
+    return {
+        .acmr = static_cast<float>(totalMisses) / static_cast<float>(misses.size()),
+        .atvr = static_cast<float>(totalMisses) / static_cast<float>(referencedCount),
+    };
+}
+
+uint32_t generateVertexRemap(
+    std::vector<uint32_t> &remap,
+    const void *vertices,
+    size_t vertexCount,
+    size_t vertexSize)
+{
+    const std::byte *data = static_cast<const std::byte*>(vertices);
+    remap.assign(vertexCount, invalidIndex);
+
+    // Open addressing table with the index of the first vertex of each unique value
+    const size_t capacity = std::max(std::bit_ceil(vertexCount * 2), size_t(16));
+    std::vector<uint32_t> table(capacity, invalidIndex);
+
+    uint32_t nextIndex = 0;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const std::byte *vertex = data + i * vertexSize;
+        size_t bucket = hashBytes(vertex, vertexSize) & (capacity - 1);
+        while (true)
+        {
+            const uint32_t entry = table[bucket];
+            if (entry == invalidIndex)
+            {
+                table[bucket] = i;
+                remap[i] = nextIndex++;
+                break;
+            }
+            if (std::memcmp(data + entry * vertexSize, vertex, vertexSize) == 0)
+            {
+                remap[i] = remap[entry];
+                break;
+            }
+            bucket = (bucket + 1) & (capacity - 1);
+        }
+    }
+
+    return nextIndex;
+}
+
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount)
+{
+    ASSERT(indices.size() % 3 == 0);
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles that use each vertex, the first remainingTriangles[v] of each list are the ones
+    // that are not emitted yet
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+        ASSERT(index < vertexCount);
+        adjacencyOffsets[index + 1]++;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    std::vector<uint32_t> adjacency(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const uint32_t v = indices[i];
+        adjacency[adjacencyOffsets[v] + remainingTriangles[v]++] = i / 3;
+    }
+
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = forsythVertexScore(-1, remainingTriangles[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t]
+            = vertexScores[indices[t * 3 + 0]]
+            + vertexScores[indices[t * 3 + 1]]
+            + vertexScores[indices[t * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    std::array<uint32_t, forsythCacheSize + 3> cache;
+    std::array<uint32_t, forsythCacheSize + 3> newCache;
+    uint32_t cacheCount = 0;
+
+    uint32_t currentTriangle = std::distance(
+        triangleScores.begin(),
+        std::max_element(triangleScores.begin(), triangleScores.end()));
+    size_t fallbackCursor = 0;
+
+    while (currentTriangle != invalidIndex)
+    {
+        const uint32_t triangle[3] = {
+            indices[currentTriangle * 3 + 0],
+            indices[currentTriangle * 3 + 1],
+            indices[currentTriangle * 3 + 2],
+        };
+        result.insert(result.end(), std::begin(triangle), std::end(triangle));
+        emitted[currentTriangle] = true;
+
+        for (uint32_t v : triangle)
+        {
+            uint32_t *begin = &adjacency[adjacencyOffsets[v]];
+            uint32_t *end = begin + remainingTriangles[v];
+            uint32_t *it = std::find(begin, end, currentTriangle);
+            ASSERT(it != end);
+            *it = *(end - 1);
+            remainingTriangles[v]--;
+        }
+
+        // The vertices of the emitted triangle go to the front of the cache and push the others
+        uint32_t newCacheCount = 0;
+        for (uint32_t v : triangle)
+        {
+            if (std::find(newCache.begin(), newCache.begin() + newCacheCount, v)
+                == newCache.begin() + newCacheCount)
+            {
+                newCache[newCacheCount++] = v;
+            }
+        }
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache[newCacheCount++] = v;
+        }
+
+        // Update the scores of the vertices that changed position (including the evicted ones)
+        // and of their triangles
+        for (uint32_t i = 0; i < newCacheCount; i++)
+        {
+            const uint32_t v = newCache[i];
+            const int32_t position = i < forsythCacheSize ? i : -1;
+
+            const float score = forsythVertexScore(position, remainingTriangles[v]);
+            const float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+
+            const uint32_t *adjacent = &adjacency[adjacencyOffsets[v]];
+            for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+                triangleScores[adjacent[j]] += delta;
+        }
+
+        cacheCount = std::min(newCacheCount, forsythCacheSize);
+        std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+
+        // The best next triangle is always one that uses a vertex in the cache, if there are none
+        // left just continue with the next triangle in the original order
+        currentTriangle = invalidIndex;
+        float bestScore = -std::numeric_limits<float>::infinity();
+        for (uint32_t i = 0; i < cacheCount; i++)
+        {
+            const uint32_t v = cache[i];
+            const uint32_t *adjacent = &adjacency[adjacencyOffsets[v]];
+            for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+            {
+                if (triangleScores[adjacent[j]] > bestScore)
+                {
+                    bestScore = triangleScores[adjacent[j]];
+                    currentTriangle = adjacent[j];
+                }
+            }
+        }
+
+        if (currentTriangle == invalidIndex)
+        {
+            while (fallbackCursor < triangleCount && emitted[fallbackCursor])
+                fallbackCursor++;
+            if (fallbackCursor < triangleCount)
+                currentTriangle = fallbackCursor;
+        }
+    }
+
+    ASSERT(result.size() == indices.size());
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+void optimizeOverdraw(
+    std::span<uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    float threshold)
+{
+    ASSERT(indices.size() % 3 == 0);
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Same cache size as analyzeVertexCache so the threshold means the same in both
+    constexpr uint32_t cacheSize = 16;
+    const std::vector<uint8_t> misses = simulateFifoCache(indices, positions.size(), cacheSize);
+
+    // Hard boundaries are where the cache restarts (all vertices of the triangle miss), splitting
+    // there doesnt change the ACMR. Inside them we split again as soon as the ACMR of the part
+    // since the last split is within threshold of the one of the whole hard cluster.
+    std::vector<uint32_t> clusterStarts;
+    size_t hardStart = 0;
+    while (hardStart < triangleCount)
+    {
+        size_t hardEnd = hardStart + 1;
+        uint32_t hardMisses = misses[hardStart];
+        while (hardEnd < triangleCount && misses[hardEnd] != 3)
+            hardMisses += misses[hardEnd++];
+
+        const float hardAcmr = static_cast<float>(hardMisses) / (hardEnd - hardStart);
+
+        clusterStarts.push_back(hardStart);
+        size_t softStart = hardStart;
+        uint32_t softMisses = 0;
+        for (size_t t = hardStart; t + 1 < hardEnd; t++)
+        {
+            softMisses += misses[t];
+            const float softAcmr = static_cast<float>(softMisses) / (t + 1 - softStart);
+            if (softAcmr <= hardAcmr * threshold)
+            {
+                softStart = t + 1;
+                softMisses = 0;
+                clusterStarts.push_back(softStart);
+            }
+        }
+
+        hardStart = hardEnd;
+    }
+    clusterStarts.push_back(triangleCount);
+
+    const size_t clusterCount = clusterStarts.size() - 1;
+
+    auto triangleCentroidAndNormal = [&](size_t t, glm::vec3 &centroid, glm::vec3 &normal) {
+        const glm::vec3 &a = positions[indices[t * 3 + 0]];
+        const glm::vec3 &b = positions[indices[t * 3 + 1]];
+        const glm::vec3 &c = positions[indices[t * 3 + 2]];
+        centroid = (a + b + c) / 3.0f;
+        // Length is twice the area of the triangle
+        normal = glm::cross(b - a, c - a);
+    };
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        glm::vec3 centroid, normal;
+        triangleCentroidAndNormal(t, centroid, normal);
+        const float area = glm::length(normal);
+        meshCentroid += centroid * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters that are further out from the center of the mesh in the direction they face are
+    // more likely to occlude others so they go first
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 clusterCentroid(0.0f);
+        glm::vec3 clusterNormal(0.0f);
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            glm::vec3 centroid, normal;
+            triangleCentroidAndNormal(t, centroid, normal);
+            const float area = glm::length(normal);
+            clusterCentroid += centroid * area;
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+
+        const float normalLength = glm::length(clusterNormal);
+        if (clusterArea <= 0.0f || normalLength <= 0.0f)
+        {
+            sortKeys[c] = 0.0f;
+            continue;
+        }
+
+        clusterCentroid /= clusterArea;
+        sortKeys[c] = glm::dot(clusterCentroid - meshCentroid, clusterNormal / normalLength);
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : clusterOrder)
+    {
+        result.insert(
+            result.end(),
+            indices.begin() + clusterStarts[c] * 3,
+            indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indices.begin());
+}
+
+uint32_t generateVertexFetchRemap(
+    std::vector<uint32_t> &remap,
+    std::span<const uint32_t> indices,
+    uint32_t vertexCount)
+{
+    remap.assign(vertexCount, invalidIndex);
+
+    uint32_t nextIndex = 0;
+    for (uint32_t index : indices)
+    {
+        ASSERT(index < vertexCount);
+        if (remap[index] == invalidIndex)
+            remap[index] = nextIndex++;
+    }
+
+    return nextIndex;
+}
+
+void remapIndices(std::span<uint32_t> indices, std::span<const uint32_t> remap)
+{
+    for (uint32_t &index : indices)
+    {
+        ASSERT(remap[index] != invalidIndex);
+        index = remap[index];
+    }
+}
+
+namespace {
+
+// Weight of the planes added along open borders so they are not eroded
+constexpr double simplifyBorderWeight = 10.0;
+
+// Sum of the squared distances to a set of planes (Garland and Heckbert) stored as the upper half
+// of a symmetric 4x4 matrix, weighted so the error can be normalized
+struct Quadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double weight = 0.0;
+
+    // Plane with the equation dot(normal, p) + distance = 0
+    static Quadric fromPlane(const glm::vec3 &normal, float distance, double weight)
+    {
+        const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+        return {
+            a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+            b * b * weight, b * c * weight, b * d * weight,
+            c * c * weight, c * d * weight,
+            d * d * weight,
+            weight,
+        };
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances from the point to the planes
+    double evaluate(const glm::vec3 &point) const
+    {
+        const double x = point.x, y = point.y, z = point.z;
+        const double error
+            = a2 * x * x + 2.0 * ab * x * y + 2.0 * ac * x * z + 2.0 * ad * x
+            + b2 * y * y + 2.0 * bc * y * z + 2.0 * bd * y
+            + c2 * z * z + 2.0 * cd * z
+            + d2;
+        return weight > 0.0 ? std::abs(error) / weight : 0.0;
+    }
+};
+
+uint64_t edgeKey(uint32_t from, uint32_t to)
+{
+    return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+} // namespace
+
+float simplify(
+    std::vector<uint32_t> &destination,
+    std::span<const uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    size_t targetIndexCount,
+    float targetError)
+{
+    ASSERT(indices.size() % 3 == 0);
+    const uint32_t vertexCount = positions.size();
+    destination.assign(indices.begin(), indices.end());
+
+    glm::vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+    for (const glm::vec3 &position : positions)
+    {
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    const float extent = std::max(glm::length(max - min), std::numeric_limits<float>::epsilon());
+    const double errorLimit = static_cast<double>(targetError) * targetError * extent * extent;
+
+    // Vertices that share their position with others are on an attribute seam (uvs or normals),
+    // moving them would open a crack so they stay where they are
+    std::vector<uint32_t> positionRemap;
+    generateVertexRemap(positionRemap, positions.data(), vertexCount, sizeof(glm::vec3));
+    std::vector<uint32_t> verticesWithPosition(vertexCount, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        verticesWithPosition[positionRemap[vertex]]++;
+    std::vector<bool> locked(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+        locked[vertex] = verticesWithPosition[positionRemap[vertex]] > 1;
+
+    std::unordered_set<uint64_t> edges;
+    auto collectEdges = [&edges, &destination]() {
+        edges.clear();
+        for (size_t i = 0; i < destination.size(); i += 3)
+        {
+            edges.insert(edgeKey(destination[i + 0], destination[i + 1]));
+            edges.insert(edgeKey(destination[i + 1], destination[i + 2]));
+            edges.insert(edgeKey(destination[i + 2], destination[i + 0]));
+        }
+    };
+
+    // The quadrics are only computed from the original surface so the error accumulates
+    std::vector<Quadric> quadrics(vertexCount);
+    collectEdges();
+    for (size_t i = 0; i < destination.size(); i += 3)
+    {
+        const std::array<uint32_t, 3> triangle = {destination[i], destination[i + 1], destination[i + 2]};
+        const glm::vec3 &p0 = positions[triangle[0]];
+        glm::vec3 normal = glm::cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+        const float doubleArea = glm::length(normal);
+        if (doubleArea == 0.0f)
+            continue;
+        normal /= doubleArea;
+
+        const Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0), doubleArea * 0.5f);
+        for (uint32_t vertex : triangle)
+            quadrics[vertex] += plane;
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t from = triangle[k], to = triangle[(k + 1) % 3];
+            if (edges.contains(edgeKey(to, from)))
+                continue;
+
+            // Open border: plane perpendicular to the triangle that contains the edge
+            const glm::vec3 edge = positions[to] - positions[from];
+            const float length = glm::length(edge);
+            if (length == 0.0f)
+                continue;
+            const glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+            const Quadric border = Quadric::fromPlane(
+                borderNormal,
+                -glm::dot(borderNormal, positions[from]),
+                length * length * simplifyBorderWeight);
+            quadrics[from] += border;
+            quadrics[to] += border;
+        }
+    }
+
+    struct Collapse {
+        uint32_t from, to;
+        double cost;
+    };
+
+    std::vector<uint32_t> adjacencyOffsets, adjacency, remap(vertexCount);
+    std::vector<bool> border(vertexCount), touched(vertexCount);
+    std::vector<Collapse> collapses;
+    double resultCost = 0.0;
+
+    // Every pass collapses the cheapest edges that dont share triangles with each other
+    while (destination.size() > targetIndexCount)
+    {
+        const uint32_t triangleCount = destination.size() / 3;
+
+        // Triangles around each vertex
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : destination)
+            adjacencyOffsets[index + 1]++;
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(destination.size());
+        std::vector<uint32_t> nextAdjacency(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+                adjacency[nextAdjacency[destination[triangle * 3 + k]]++] = triangle;
+        }
+
+        collectEdges();
+        std::fill(border.begin(), border.end(), false);
+        for (uint64_t edge : edges)
+        {
+            const uint32_t from = edge >> 32, to = edge & 0xFFFFFFFF;
+            if (!edges.contains(edgeKey(to, from)))
+                border[from] = border[to] = true;
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < destination.size(); i++)
+        {
+            const uint32_t a = destination[i];
+            const uint32_t b = destination[i - i % 3 + (i + 1) % 3];
+            const bool borderEdge = !edges.contains(edgeKey(b, a));
+
+            // Interior edges are found once from each side
+            if (!borderEdge && a > b)
+                continue;
+
+            for (auto [from, to] : {std::pair(a, b), std::pair(b, a)})
+            {
+                // Vertices on a border can only slide along it
+                if (locked[from] || (border[from] && !borderEdge))
+                    continue;
+
+                Quadric quadric = quadrics[from];
+                quadric += quadrics[to];
+                collapses.push_back({from, to, quadric.evaluate(positions[to])});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost;
+        });
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        const uint32_t trianglesToRemove = (destination.size() - targetIndexCount + 2) / 3;
+        uint32_t removedTriangles = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (collapse.cost > errorLimit || removedTriangles >= trianglesToRemove)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // Reject collapses that flip or degenerate the triangles that are left
+            bool flips = false;
+            uint32_t collapsedTriangles = 0;
+            for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++)
+            {
+                const uint32_t *triangle = &destination[adjacency[j] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    collapsedTriangles++;
+                    continue;
+                }
+
+                std::array<glm::vec3, 3> corners;
+                for (uint32_t k = 0; k < 3; k++)
+                    corners[k] = positions[triangle[k]];
+                const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    if (triangle[k] == collapse.from)
+                        corners[k] = positions[collapse.to];
+                }
+                const glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                    touched[destination[adjacency[j] * 3 + k]] = true;
+            }
+            removedTriangles += collapsedTriangles;
+            resultCost = std::max(resultCost, collapse.cost);
+        }
+
+        if (removedTriangles == 0)
+            break;
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < destination.size(); i += 3)
+        {
+            const uint32_t a = remap[destination[i]];
+            const uint32_t b = remap[destination[i + 1]];
+            const uint32_t c = remap[destination[i + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            destination[writeIndex++] = a;
+            destination[writeIndex++] = b;
+            destination[writeIndex++] = c;
+        }
+        destination.resize(writeIndex);
+    }
+
+    return std::sqrt(resultCost) / extent;
+}
+
+} // namespace engine::meshoptimizer
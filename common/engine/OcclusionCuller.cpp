@@ -0,0 +1,248 @@
+#include "engine/OcclusionCuller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace engine {
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+{
+    m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_width = m_tilesX * TILE_WIDTH;
+    m_height = m_tilesY * TILE_HEIGHT;
+    m_trianglesPerTile.resize(m_tilesX * m_tilesY);
+
+    glm::uvec2 size(m_width, m_height);
+    for (;;)
+    {
+        m_levelSizes.push_back(size);
+        m_depthPyramid.emplace_back(size.x * size.y, 1.0f);
+        if (size.x == 1 && size.y == 1)
+            break;
+        size = glm::uvec2((size.x + 1) / 2, (size.y + 1) / 2);
+    }
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4 &projectionView)
+{
+    m_projectionView = projectionView;
+    m_triangles.clear();
+    for (std::vector<uint32_t> &triangles : m_trianglesPerTile)
+        triangles.clear();
+    std::fill(m_depthPyramid[0].begin(), m_depthPyramid[0].end(), 1.0f);
+    m_stats = {};
+}
+
+void OcclusionCuller::addOccluder(
+    std::span<const glm::vec3> positions,
+    std::span<const uint32_t> indices,
+    const glm::mat4 &modelMatrix)
+{
+    const glm::mat4 matrix = m_projectionView * modelMatrix;
+    m_stats.occluders++;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const std::array<glm::vec4, 3> vertices = {
+            matrix * glm::vec4(positions[indices[i]], 1.0f),
+            matrix * glm::vec4(positions[indices[i + 1]], 1.0f),
+            matrix * glm::vec4(positions[indices[i + 2]], 1.0f),
+        };
+
+        // Clip against the near plane (z >= -w), the result has at most 4 vertices
+        std::array<glm::vec4, 4> clipped;
+        uint32_t clippedCount = 0;
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            const glm::vec4 &current = vertices[j];
+            const glm::vec4 &next = vertices[(j + 1) % 3];
+            const float currentDistance = current.z + current.w;
+            const float nextDistance = next.z + next.w;
+            if (currentDistance >= 0.0f)
+                clipped[clippedCount++] = current;
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            {
+                const float t = currentDistance / (currentDistance - nextDistance);
+                clipped[clippedCount++] = current + (next - current) * t;
+            }
+        }
+
+        for (uint32_t j = 2; j < clippedCount; j++)
+            addTriangle(clipped[0], clipped[j - 1], clipped[j]);
+    }
+}
+
+void OcclusionCuller::addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+{
+    // To pixels and depth from 0 to 1
+    auto toScreen = [this](const glm::vec4 &clip) {
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3(
+            (ndc.x * 0.5f + 0.5f) * m_width,
+            (ndc.y * 0.5f + 0.5f) * m_height,
+            std::clamp(ndc.z * 0.5f + 0.5f, 0.0f, 1.0f));
+    };
+    glm::vec3 v0 = toScreen(a), v1 = toScreen(b), v2 = toScreen(c);
+
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (std::abs(area) < 1e-6f)
+        return;
+    // Both sides occlude, the edge functions are positive inside for counter clockwise triangles
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max<int32_t>(std::floor(std::min({v0.x, v1.x, v2.x})), 0);
+    triangle.minY = std::max<int32_t>(std::floor(std::min({v0.y, v1.y, v2.y})), 0);
+    triangle.maxX = std::min<int32_t>(std::ceil(std::max({v0.x, v1.x, v2.x})), m_width - 1);
+    triangle.maxY = std::min<int32_t>(std::ceil(std::max({v0.y, v1.y, v2.y})), m_height - 1);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    // Edge function of the edge from p to q, positive on the left side
+    auto edge = [](const glm::vec3 &p, const glm::vec3 &q) {
+        return glm::vec3(p.y - q.y, q.x - p.x, p.x * q.y - p.y * q.x);
+    };
+    triangle.edges[0] = edge(v1, v2); // Weight of v0
+    triangle.edges[1] = edge(v2, v0); // Weight of v1
+    triangle.edges[2] = edge(v0, v1); // Weight of v2
+    triangle.depth
+        = (triangle.edges[0] * v0.z + triangle.edges[1] * v1.z + triangle.edges[2] * v2.z) / area;
+
+    const uint32_t index = m_triangles.size();
+    m_triangles.push_back(triangle);
+    m_stats.occluderTriangles++;
+
+    for (int32_t tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / int32_t(TILE_HEIGHT); tileY++)
+        for (int32_t tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / int32_t(TILE_WIDTH); tileX++)
+            m_trianglesPerTile[tileX + tileY * m_tilesX].push_back(index);
+}
+
+void OcclusionCuller::rasterizeOccluders(ThreadPool &threadPool)
+{
+    threadPool.parallelFor(m_tilesX * m_tilesY, 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t tile = begin; tile < end; tile++)
+            rasterizeTile(tile % m_tilesX, tile / m_tilesX);
+    });
+    buildDepthPyramid();
+}
+
+void OcclusionCuller::rasterizeTile(uint32_t tileX, uint32_t tileY)
+{
+    const int32_t tileMinX = tileX * TILE_WIDTH, tileMinY = tileY * TILE_HEIGHT;
+    const int32_t tileMaxX = tileMinX + TILE_WIDTH - 1, tileMaxY = tileMinY + TILE_HEIGHT - 1;
+
+    for (uint32_t triangleIndex : m_trianglesPerTile[tileX + tileY * m_tilesX])
+    {
+        const Triangle &triangle = m_triangles[triangleIndex];
+        const int32_t minY = std::max(triangle.minY, tileMinY);
+        const int32_t maxY = std::min(triangle.maxY, tileMaxY);
+        // Blocks of SIMD_WIDTH pixels aligned to the start of the tile
+        const int32_t minX = tileMinX
+            + (std::max(triangle.minX, tileMinX) - tileMinX) / SIMD_WIDTH * SIMD_WIDTH;
+        const int32_t maxX = std::min(triangle.maxX, tileMaxX);
+
+        for (int32_t y = minY; y <= maxY; y++)
+        {
+            const float centerY = y + 0.5f;
+            float *row = &m_depthPyramid[0][y * m_width];
+            for (int32_t blockX = minX; blockX <= maxX; blockX += SIMD_WIDTH)
+            {
+                float *depths = row + blockX;
+                for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++)
+                {
+                    const float centerX = blockX + lane + 0.5f;
+                    const float w0 = triangle.edges[0].x * centerX + triangle.edges[0].y * centerY + triangle.edges[0].z;
+                    const float w1 = triangle.edges[1].x * centerX + triangle.edges[1].y * centerY + triangle.edges[1].z;
+                    const float w2 = triangle.edges[2].x * centerX + triangle.edges[2].y * centerY + triangle.edges[2].z;
+                    const float depth = triangle.depth.x * centerX + triangle.depth.y * centerY + triangle.depth.z;
+                    const bool inside = w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f;
+                    depths[lane] = inside ? std::min(depths[lane], depth) : depths[lane];
+                }
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildDepthPyramid()
+{
+    for (size_t level = 1; level < m_depthPyramid.size(); level++)
+    {
+        const glm::uvec2 previousSize = m_levelSizes[level - 1], size = m_levelSizes[level];
+        const std::vector<float> &previous = m_depthPyramid[level - 1];
+        std::vector<float> &current = m_depthPyramid[level];
+        for (uint32_t y = 0; y < size.y; y++)
+        {
+            const uint32_t y0 = 2 * y, y1 = std::min(2 * y + 1, previousSize.y - 1);
+            for (uint32_t x = 0; x < size.x; x++)
+            {
+                const uint32_t x0 = 2 * x, x1 = std::min(2 * x + 1, previousSize.x - 1);
+                current[x + y * size.x] = std::max({
+                    previous[x0 + y0 * previousSize.x],
+                    previous[x1 + y0 * previousSize.x],
+                    previous[x0 + y1 * previousSize.x],
+                    previous[x1 + y1 * previousSize.x],
+                });
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const AxisAlignedBoundingBox &aabb)
+{
+    m_stats.testedObjects++;
+
+    glm::vec2 minScreen(INFINITY), maxScreen(-INFINITY);
+    float minDepth = INFINITY;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec4 clip = m_projectionView * glm::vec4(
+            i & 1 ? aabb.max.x : aabb.min.x,
+            i & 2 ? aabb.max.y : aabb.min.y,
+            i & 4 ? aabb.max.z : aabb.min.z,
+            1.0f);
+        if (clip.z < -clip.w)
+            return true;
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const glm::vec2 screen(
+            (ndc.x * 0.5f + 0.5f) * m_width,
+            (ndc.y * 0.5f + 0.5f) * m_height);
+        minScreen = glm::min(minScreen, screen);
+        maxScreen = glm::max(maxScreen, screen);
+        minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (maxScreen.x < 0.0f || maxScreen.y < 0.0f || minScreen.x >= m_width || minScreen.y >= m_height)
+        return true;
+
+    const uint32_t minX = std::max(minScreen.x, 0.0f), minY = std::max(minScreen.y, 0.0f);
+    const uint32_t maxX = std::min<float>(maxScreen.x, m_width - 1);
+    const uint32_t maxY = std::min<float>(maxScreen.y, m_height - 1);
+
+    // Level where the rectangle covers at most 2x2 texels
+    uint32_t level = 0;
+    while ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1)
+        level++;
+
+    const std::vector<float> &depths = m_depthPyramid[level];
+    const uint32_t levelWidth = m_levelSizes[level].x;
+    float maxDepth = 0.0f;
+    for (uint32_t y = minY >> level; y <= maxY >> level; y++)
+        for (uint32_t x = minX >> level; x <= maxX >> level; x++)
+            maxDepth = std::max(maxDepth, depths[x + y * levelWidth]);
+
+    if (minDepth > maxDepth)
+    {
+        m_stats.culledObjects++;
+        return false;
+    }
+    return true;
+}
+
+} // namespace engine
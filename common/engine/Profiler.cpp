@@ -0,0 +1,312 @@
+#include "engine/Profiler.hpp"
+
+#include <opengl/TimerQuery.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+namespace {
+
+struct Event {
+    const char *name;
+    int64_t start, end;
+};
+
+// Written only by its thread, read by writeChromeTrace()
+struct ThreadBuffer {
+    std::unique_ptr<Event[]> events = std::make_unique<Event[]>(Profiler::EVENTS_PER_THREAD);
+    std::atomic<uint64_t> written = 0; // Since the last clear, the ring keeps the last ones
+    uint32_t number;
+    std::string name; // Guarded by the registry mutex
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Never freed so the zones of the threads that finished stay in the trace
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry &getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer &createThreadBuffer(std::string name)
+{
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->number = registry.buffers.size();
+    buffer->name = name.empty() ? std::format("Thread {}", buffer->number) : std::move(name);
+    return *registry.buffers.emplace_back(std::move(buffer));
+}
+
+// The name of a thread is kept here until its first zone creates its buffer
+thread_local std::string t_threadName;
+thread_local ThreadBuffer *t_threadBuffer = nullptr;
+
+// Only called while recording so the threads that never record don't have a buffer
+ThreadBuffer &getThreadBuffer()
+{
+    if (!t_threadBuffer)
+        t_threadBuffer = &createThreadBuffer(t_threadName);
+    return *t_threadBuffer;
+}
+
+void writeEvent(ThreadBuffer &buffer, const Event &event)
+{
+    const uint64_t written = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[written % Profiler::EVENTS_PER_THREAD] = event;
+    buffer.written.store(written + 1, std::memory_order_release);
+}
+
+// Only used from the thread with the GL context
+struct GpuState {
+    struct Zone {
+        const char *name;
+        TimerQuery begin, end;
+        bool ended = false;
+    };
+
+    ThreadBuffer &buffer = createThreadBuffer("GPU");
+    std::deque<Zone> zones; // In the order they began, a zone stays until its queries finish
+    std::vector<Zone*> openZones;
+    std::vector<TimerQuery> freeQueries;
+    int64_t gpuToCpuOffset = 0;
+
+    TimerQuery takeQuery()
+    {
+        if (freeQueries.empty())
+            return TimerQuery();
+        TimerQuery query = std::move(freeQueries.back());
+        freeQueries.pop_back();
+        return query;
+    }
+};
+
+// The totals are only modified by the frame thread
+struct FrameState {
+    std::atomic<std::thread::id> thread = std::thread::id();
+    std::vector<Profiler::ZoneTotal> totals;
+    std::vector<Profiler::ZoneTotal> lastFrameTotals;
+
+    Profiler::ZoneTotal &getTotal(const char *name)
+    {
+        for (Profiler::ZoneTotal &total : totals)
+            if (total.name == name || std::strcmp(total.name, name) == 0)
+                return total;
+        return totals.emplace_back(name);
+    }
+};
+
+FrameState &getFrameState()
+{
+    static FrameState frameState;
+    return frameState;
+}
+
+float toMiliseconds(int64_t nanoseconds)
+{
+    return nanoseconds / 1e6f;
+}
+
+GpuState &getGpuState()
+{
+    static GpuState gpuState;
+    return gpuState;
+}
+
+void writeJsonString(std::ofstream &file, std::string_view string)
+{
+    file << '"';
+    for (char c : string)
+    {
+        if (c == '"' || c == '\\')
+            file << '\\';
+        file << c;
+    }
+    file << '"';
+}
+
+} // namespace
+
+std::atomic<bool> Profiler::s_enabled = false;
+
+void Profiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string &name)
+{
+    t_threadName = name;
+    if (t_threadBuffer)
+    {
+        std::lock_guard lock(getRegistry().mutex);
+        t_threadBuffer->name = name;
+    }
+}
+
+int64_t Profiler::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::recordCpuZone(const char *name, int64_t start, int64_t end)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    writeEvent(buffer, Event{.name = name, .start = start, .end = end});
+
+    FrameState &frameState = getFrameState();
+    if (frameState.thread.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        frameState.getTotal(name).cpuTime += toMiliseconds(end - start);
+}
+
+void Profiler::beginGpuZone(const char *name)
+{
+    GpuState &gpuState = getGpuState();
+    GpuState::Zone &zone = gpuState.zones.emplace_back(
+        name, gpuState.takeQuery(), gpuState.takeQuery());
+    zone.begin.record();
+    gpuState.openZones.push_back(&zone);
+}
+
+void Profiler::endGpuZone()
+{
+    GpuState &gpuState = getGpuState();
+    ASSERT_MSG(!gpuState.openZones.empty(), "Ending a gpu zone that wasn't begun");
+    GpuState::Zone &zone = *gpuState.openZones.back();
+    gpuState.openZones.pop_back();
+    zone.end.record();
+    zone.ended = true;
+}
+
+void Profiler::collectGpuZones()
+{
+    GpuState &gpuState = getGpuState();
+    if (gpuState.zones.empty())
+        return;
+
+    gpuState.gpuToCpuOffset
+        = now() - static_cast<int64_t>(TimerQuery::getCurrentTimestamp());
+
+    FrameState &frameState = getFrameState();
+    const bool isFrameThread = frameState.thread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+
+    // The queries finish in order so the first one not available stops the loop
+    while (!gpuState.zones.empty()
+        && gpuState.zones.front().ended
+        && gpuState.zones.front().end.isAvailable())
+    {
+        GpuState::Zone &zone = gpuState.zones.front();
+        const Event event{
+            .name = zone.name,
+            .start = static_cast<int64_t>(zone.begin.getTimestamp()) + gpuState.gpuToCpuOffset,
+            .end = static_cast<int64_t>(zone.end.getTimestamp()) + gpuState.gpuToCpuOffset,
+        };
+        writeEvent(gpuState.buffer, event);
+        if (isFrameThread)
+            frameState.getTotal(zone.name).gpuTime += toMiliseconds(event.end - event.start);
+        gpuState.freeQueries.push_back(std::move(zone.begin));
+        gpuState.freeQueries.push_back(std::move(zone.end));
+        gpuState.zones.pop_front();
+    }
+}
+
+void Profiler::endFrame()
+{
+    FrameState &frameState = getFrameState();
+    const std::thread::id frameThread = std::this_thread::get_id();
+    std::thread::id expected;
+    frameState.thread.compare_exchange_strong(expected, frameThread);
+    ASSERT_MSG(expected == std::thread::id() || expected == frameThread,
+        "Profiler::endFrame() has to be called always from the same thread");
+
+    // Keeps the names so the zones that didn't run in this frame are in the totals with 0
+    frameState.lastFrameTotals = frameState.totals;
+    for (ZoneTotal &total : frameState.totals)
+        total.cpuTime = total.gpuTime = 0.0f;
+}
+
+const std::vector<Profiler::ZoneTotal> &Profiler::getFrameZoneTotals()
+{
+    return getFrameState().lastFrameTotals;
+}
+
+bool Profiler::writeChromeTrace(const std::string &path)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        ERROR("Couldn't open {} to write the trace", path);
+        return false;
+    }
+
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    std::vector<Event> events;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry.buffers)
+    {
+        file << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->number
+            << ",\"args\":{\"name\":";
+        writeJsonString(file, buffer->name);
+        file << "}}";
+        first = false;
+
+        // The thread keeps writing while the events are copied, the ones it could have
+        // overwritten in the meantime are dropped
+        const uint64_t end = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = end > EVENTS_PER_THREAD ? end - EVENTS_PER_THREAD : 0;
+        events.clear();
+        for (uint64_t i = begin; i < end; i++)
+            events.push_back(buffer->events[i % EVENTS_PER_THREAD]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t writtenAfterCopy = buffer->written.load(std::memory_order_relaxed);
+        const uint64_t firstValid
+            = writtenAfterCopy > EVENTS_PER_THREAD ? writtenAfterCopy - EVENTS_PER_THREAD : 0;
+
+        for (uint64_t i = std::max(begin, firstValid); i < end; i++)
+        {
+            const Event &event = events[i - begin];
+            // Chrome traces are in microseconds
+            file << ",\n{\"name\":";
+            writeJsonString(file, event.name);
+            file << std::format(
+                ",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                buffer->number,
+                event.start / 1000.0,
+                (event.end - event.start) / 1000.0);
+        }
+    }
+    file << "\n]}\n";
+
+    INFO("Wrote profiler trace to {}", path);
+    return static_cast<bool>(file);
+}
+
+void Profiler::clear()
+{
+    Registry &registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry.buffers)
+        buffer->written.store(0, std::memory_order_release);
+}
+
+} // namespace engine
@@ -1,172 +1,364 @@
 #include "engine/Renderer2D.hpp"
 
-#include "opengl/VertexArray.hpp"
+#include "opengl/IndexBuffer.hpp"
 #include "opengl/Shader.hpp"
+#include "opengl/StreamBuffer.hpp"
+#include "opengl/VertexArray.hpp"
 #include "opengl/gl.hpp"
-#include "opengl/Texture.hpp"
-#include "opengl/VertexBuffer.hpp"
 
-#include <codecvt>
-#include <glm/ext/matrix_transform.hpp>
-#include <locale>
+#include <utils/Log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <list>
 #include <memory>
+#include <string>
 #include <unordered_map>
-#include <fontatlas/fontatlas.hpp>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// How the fragment shader uses the texture, the same values as in renderer2DFragment.glsl
+enum class QuadMode : uint32_t {
+    texture,
+    coverageText, // Single channel atlas with the coverage of the pixels
+    distanceFieldText, // Single channel atlas with the distance to the edges of the glyphs
+};
 
 struct QuadVertex {
     glm::vec3 position;
     glm::vec2 uv;
+    glm::vec4 color;
+    uint32_t textureIndex; // In the textures of the batch
+    QuadMode mode;
 };
 
-static struct {
-    std::shared_ptr<VertexArray> quadsVertexArray;
-    std::shared_ptr<VertexBuffer> quadsVertexBuffer;
-    std::shared_ptr<Shader> quadsShader;
-
-    std::shared_ptr<Texture> whiteTexture;
-
-    const glm::vec4 squareVertices[4] = {
-        {0.0f, 0.0f, 0.0f, 1.0f},
-        {1.0f, 0.0f, 0.0f, 1.0f},
-        {1.0f, 1.0f, 0.0f, 1.0f},
-        {0.0f, 1.0f, 0.0f, 1.0f}
-    };
-
-    const glm::vec2 squareUVCoords[4] = {
-        {0.0f, 0.0f},
-        {1.0f, 0.0f},
-        {1.0f, 1.0f},
-        {0.0f, 1.0f}
-    };
+// Fits a few full batches, when the next one doesn't fit it moves to the next region
+constexpr uint32_t STREAM_BUFFER_REGION_SIZE = 4 << 20;
+
+static_assert(
+    STREAM_BUFFER_REGION_SIZE >= Renderer2D::MAX_QUADS_IN_BATCH * 4 * sizeof(QuadVertex) + sizeof(QuadVertex),
+    "A full batch has to fit in a region of the stream buffer");
+
+// Quads of the glyphs of a string relative to its position, they don't have the color or the
+// texture index. Reused while the same string is drawn
+struct TextLayout {
+    std::string text;
+    const Font *font = nullptr;
+    float size = 0.0f;
+    std::vector<QuadVertex> vertices;
+    uint64_t lastUsedScene = 0;
+};
+
+const glm::vec2 squareVertices[4] = {
+    {0.0f, 0.0f},
+    {1.0f, 0.0f},
+    {1.0f, 1.0f},
+    {0.0f, 1.0f}
+};
+
+struct {
+    std::unique_ptr<StreamBuffer> streamBuffer;
+    std::unique_ptr<VertexArray> quadsVertexArray;
+    std::unique_ptr<Shader> quadsShader;
+    std::unique_ptr<Texture> whiteTexture;
+
+    // Of the batch being accumulated
+    std::vector<QuadVertex> vertices;
+    std::array<const Texture*, Renderer2D::MAX_TEXTURES_IN_BATCH> textures;
+    uint32_t textureCount = 0;
+
+    std::unordered_map<uint64_t, TextLayout> textLayouts; // By hash of the text, font and size
+    glm::mat4 viewProjection; // Of the scene, set in each flush because the program is rebound
+    uint64_t scene = 0; // Counts the calls to endScene()
+    bool blendingBeforeScene = false; // Restored by endScene()
 } s_data;
 
+uint64_t hashTextLayout(std::string_view text, const Font &font, float size)
+{
+    uint64_t hash = std::hash<std::string_view>()(text);
+    hash ^= std::hash<const Font*>()(&font) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<float>()(size) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+// Returns the code point that starts at the iterator and moves it to the next one. Invalid
+// bytes are skipped
+char32_t decodeUtf8(std::string_view::const_iterator &it, std::string_view::const_iterator end)
+{
+    const uint8_t first = *it++;
+    uint32_t continuationBytes;
+    char32_t codePoint;
+    if (first < 0x80)
+        return first;
+    else if ((first & 0xE0) == 0xC0) { continuationBytes = 1; codePoint = first & 0x1F; }
+    else if ((first & 0xF0) == 0xE0) { continuationBytes = 2; codePoint = first & 0x0F; }
+    else if ((first & 0xF8) == 0xF0) { continuationBytes = 3; codePoint = first & 0x07; }
+    else return 0;
+
+    for (uint32_t i = 0; i < continuationBytes; i++)
+    {
+        if (it == end || (static_cast<uint8_t>(*it) & 0xC0) != 0x80)
+            return 0;
+        codePoint = (codePoint << 6) | (static_cast<uint8_t>(*it++) & 0x3F);
+    }
+    return codePoint;
+}
+
+void buildTextLayout(
+    TextLayout &layout,
+    std::string_view text,
+    const Font &font,
+    const Texture &atlas,
+    float size)
+{
+    layout.text = text;
+    layout.font = &font;
+    layout.size = size;
+    layout.vertices.clear();
+
+    const float width = atlas.getWidth();
+    const float height = atlas.getHeight();
+    glm::vec3 currentGlyphPosition(0.0f);
+    for (auto it = text.begin(); it != text.end();)
+    {
+        const GlyphData *glyph = font.getGlyph(decodeUtf8(it, text.end()));
+        if (!glyph)
+            continue;
+
+        if (glyph->size.x != 0 && glyph->size.y != 0)
+        {
+            // The textures are inverted vertically when they are imported
+            const glm::vec2 uvMin = {
+                glyph->textureCoords.x / width,
+                (height - glyph->textureCoords.y - glyph->size.y) / height,
+            };
+            const glm::vec2 uvMax = uvMin + glm::vec2(glyph->size) / glm::vec2(width, height);
+            const glm::vec3 origin = currentGlyphPosition + glm::vec3(
+                size * glyph->offset.x,
+                size * (glyph->offset.y - static_cast<int>(glyph->size.y)),
+                0.0f);
+            for (const glm::vec2 &vertex : squareVertices)
+            {
+                layout.vertices.push_back({
+                    .position = origin + glm::vec3(vertex * glm::vec2(glyph->size) * size, 0.0f),
+                    .uv = uvMin + vertex * (uvMax - uvMin),
+                });
+            }
+        }
+        currentGlyphPosition.x += size * glyph->advance.x;
+        currentGlyphPosition.y += size * glyph->advance.y;
+    }
+}
+
+} // namespace
+
+Renderer2D::Stats Renderer2D::s_stats;
+
 void Renderer2D::init()
 {
-    s_data.quadsVertexArray = std::make_shared<VertexArray>();
+    s_data.streamBuffer = std::make_unique<StreamBuffer>(STREAM_BUFFER_REGION_SIZE);
 
-    s_data.quadsVertexBuffer = std::make_shared<VertexBuffer>(4 * sizeof(QuadVertex));
-    s_data.quadsVertexBuffer->setLayout({
+    s_data.quadsVertexArray = std::make_unique<VertexArray>();
+    s_data.quadsVertexArray->addVertexBuffer(*s_data.streamBuffer, {
         {ShaderDataType::float3, "a_position"},
-        {ShaderDataType::float2, "a_uv"}
+        {ShaderDataType::float2, "a_uv"},
+        {ShaderDataType::float4, "a_color"},
+        {ShaderDataType::uint1, "a_textureIndex"},
+        {ShaderDataType::uint1, "a_mode"},
     });
 
-    s_data.quadsVertexArray->addVertexBuffer(s_data.quadsVertexBuffer);
-    
-    uint32_t squareIndices[] = { 0, 1, 2, 2, 3, 0 };
-    std::shared_ptr<IndexBuffer> quadIndexBuffer;
-    quadIndexBuffer = std::make_shared<IndexBuffer>(squareIndices, sizeof(squareIndices) / sizeof(uint32_t));
-    s_data.quadsVertexArray->setIndexBuffer(quadIndexBuffer);
+    // The same for every batch, the quads are selected with the base vertex
+    std::vector<uint32_t> indices(MAX_QUADS_IN_BATCH * 6);
+    for (uint32_t i = 0; i < MAX_QUADS_IN_BATCH; i++)
+    {
+        const uint32_t quadIndices[] = { 0, 1, 2, 2, 3, 0 };
+        for (uint32_t j = 0; j < 6; j++)
+            indices[i * 6 + j] = i * 4 + quadIndices[j];
+    }
+    s_data.quadsVertexArray->setIndexBuffer(std::make_shared<IndexBuffer>(indices.data(), indices.size()));
+
+    const uint8_t whitePixel[] = { 255, 255, 255, 255 };
+    s_data.whiteTexture = std::make_unique<Texture>(Texture::Specification{
+        .data = whitePixel,
+        .width = 1,
+        .height = 1,
+        .format = Texture::Format::RGBA8,
+    });
 
-    unsigned char whitePixel[] = { 255, 255, 255, 255 };
+    s_data.quadsShader = std::make_unique<Shader>(
+        "assets/shaders/renderer2DVertex.glsl",
+        "assets/shaders/renderer2DFragment.glsl",
+        std::list<ShaderCompileTimeParameter>{{"MAX_TEXTURES_IN_BATCH", MAX_TEXTURES_IN_BATCH}});
 
-    s_data.whiteTexture = std::make_shared<Texture>(whitePixel, 1, 1, Texture::Format::RGBA8);
+    s_data.vertices.reserve(MAX_QUADS_IN_BATCH * 4);
+}
 
-    s_data.quadsShader = std::make_shared<Shader>("assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl");
+void Renderer2D::shutdown()
+{
+    s_data.quadsShader.reset();
+    s_data.whiteTexture.reset();
+    s_data.quadsVertexArray.reset();
+    s_data.streamBuffer.reset();
 }
 
 void Renderer2D::beginScene(const Camera &camera)
 {
-    s_data.quadsShader->bind();
-    s_data.quadsShader->setMat4("u_viewProjection", camera.getViewProjectionMatrix());
+    s_data.viewProjection = camera.getViewProjectionMatrix();
+    s_data.blendingBeforeScene = GL::isBlending();
     GL::setBlending(true);
 }
 
 void Renderer2D::endScene()
-{}
-
-void Renderer2D::drawQuad(const glm::vec3 &position, const glm::vec2 &size, const glm::vec4 &color)
 {
-    drawQuad(position, size, *s_data.whiteTexture, color);
-}
+    flush();
+    GL::setBlending(s_data.blendingBeforeScene);
+    // The vertices of the scene can't be overwritten until the gpu draws them
+    s_data.streamBuffer->nextFrame();
 
-void Renderer2D::drawQuad(const glm::vec3 &position, const glm::vec2 &size, const Texture &texture, const glm::vec4 &color)
-{
-    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position)
-        * glm::scale(glm::mat4(1.0f), { size.x, size.y, 1.0f });
-    
-    QuadVertex quadVertex[4];
-    for (size_t i = 0; i < 4; i++)
+    s_data.scene++;
+    if (s_data.scene % TEXT_LAYOUT_LIFETIME == 0)
     {
-        quadVertex[i].position = transform * s_data.squareVertices[i];
-        quadVertex[i].uv = s_data.squareUVCoords[i];
+        std::erase_if(s_data.textLayouts, [](const auto &entry) {
+            return entry.second.lastUsedScene + TEXT_LAYOUT_LIFETIME < s_data.scene;
+        });
     }
+}
 
-    s_data.quadsVertexBuffer->setData(quadVertex, 4 * sizeof(QuadVertex));
-
-    s_data.quadsShader->bind();
-    s_data.quadsShader->setFloat4("u_color", color);
-
-    texture.bind(0);
-    s_data.quadsShader->setInt("u_texture", 0);
-
-    s_data.quadsVertexArray->bind();
-    GL::drawIndexed(*s_data.quadsVertexArray);
+void Renderer2D::clearTextLayoutCache()
+{
+    s_data.textLayouts.clear();
 }
 
+void Renderer2D::drawQuad(const glm::vec3 &position, const glm::vec2 &size, const glm::vec4 &color)
+{
+    drawQuad(position, size, *s_data.whiteTexture, glm::vec2(0.0f), glm::vec2(1.0f), color);
+}
 
-void Renderer2D::drawString(const glm::vec3 &position, const std::string &text, Font &font, const glm::vec4 &color, float size)
+void Renderer2D::drawQuad(const glm::vec3 &position, const glm::vec2 &size, const Texture &texture, const glm::vec4 &color)
 {
-    std::u32string u32text = std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t>().from_bytes(text);
-    glm::vec3 currentGlyphPos = position;
+    drawQuad(position, size, texture, glm::vec2(0.0f), glm::vec2(1.0f), color);
+}
 
-    float w = font.getTexture()->getWidth();
-    float h = font.getTexture()->getHeight();
+void Renderer2D::drawQuad(
+    const glm::vec3 &position,
+    const glm::vec2 &size,
+    const Texture &texture,
+    const glm::vec2 &uvMin,
+    const glm::vec2 &uvMax,
+    const glm::vec4 &color)
+{
+    if (s_data.vertices.size() == MAX_QUADS_IN_BATCH * 4)
+        flush();
+    const uint32_t textureIndex = getTextureIndex(texture);
 
-    const std::unordered_map<uint32_t, fontatlas::glyph_data> &glyphsData = font.getGlyphsData();
+    for (const glm::vec2 &vertex : squareVertices)
+    {
+        s_data.vertices.push_back({
+            .position = position + glm::vec3(vertex * size, 0.0f),
+            .uv = uvMin + vertex * (uvMax - uvMin),
+            .color = color,
+            .textureIndex = textureIndex,
+            .mode = QuadMode::texture,
+        });
+    }
+    s_stats.quads++;
+}
 
-    s_data.quadsShader->bind();
-    s_data.quadsShader->setFloat4("u_color", color);
+void Renderer2D::drawString(
+    const glm::vec3 &position,
+    std::string_view text,
+    const Font &font,
+    const AssetManager &assetManager,
+    const glm::vec4 &color,
+    float size)
+{
+    const Texture *atlas = assetManager.get(font.getTextureId());
+    if (!atlas)
+    {
+        WARN("Texture with id: {} of font does not exist", std::to_underlying(font.getTextureId()));
+        return;
+    }
 
-    font.getTexture()->bind(0);
-    s_data.quadsShader->setInt("u_texture", 0);
+    // Reused if the same text was drawn recently, if there is a different text with the same hash
+    // it is replaced
+    TextLayout &layout = s_data.textLayouts[hashTextLayout(text, font, size)];
+    layout.lastUsedScene = s_data.scene;
+    if (layout.font == &font && layout.size == size && layout.text == text)
+    {
+        s_stats.textLayoutsReused++;
+    }
+    else
+    {
+        buildTextLayout(layout, text, font, *atlas, size);
+        s_stats.textLayoutsBuilt++;
+    }
 
-    for (const char32_t &u32char : u32text) {
-        std::unordered_map<uint32_t, fontatlas::glyph_data>::const_iterator it = glyphsData.find(u32char);
-        if (it == glyphsData.end()) {
-            continue;
+    const QuadMode mode = font.isDistanceField() ? QuadMode::distanceFieldText : QuadMode::coverageText;
+    const std::vector<QuadVertex> &vertices = layout.vertices;
+    for (size_t first = 0; first < vertices.size();)
+    {
+        if (s_data.vertices.size() == MAX_QUADS_IN_BATCH * 4)
+            flush();
+        const uint32_t textureIndex = getTextureIndex(*atlas);
+
+        const size_t count = std::min(vertices.size() - first, MAX_QUADS_IN_BATCH * 4 - s_data.vertices.size());
+        for (size_t i = first; i < first + count; i++)
+        {
+            s_data.vertices.push_back({
+                .position = position + vertices[i].position,
+                .uv = vertices[i].uv,
+                .color = color,
+                .textureIndex = textureIndex,
+                .mode = mode,
+            });
         }
+        first += count;
+    }
+    s_stats.quads += vertices.size() / 4;
+}
 
-        fontatlas::glyph_data glyphData = it->second;
-
-        if (glyphData.size.w != 0 && glyphData.size.h != 0) {
-            float sizeX    = glyphData.size.w;
-            float sizeY    = glyphData.size.h;
-
-            float textureX      = glyphData.texture_coords.x/w;
-            float textureY      = (h - glyphData.texture_coords.y - glyphData.size.h)/h; // Because we invert textures vertically on import
-            float textureSizeX  = glyphData.size.w/w;
-            float textureSizeY  = glyphData.size.h/h;
-
-            glm::vec3 offset = { size * glyphData.offset.x, size * (glyphData.offset.y -  static_cast<int>(glyphData.size.h)), 0.0f };
-
-            QuadVertex quadVertex[4];
+uint32_t Renderer2D::getTextureIndex(const Texture &texture)
+{
+    const auto end = s_data.textures.begin() + s_data.textureCount;
+    const auto it = std::find(s_data.textures.begin(), end, &texture);
+    if (it != end)
+        return it - s_data.textures.begin();
 
-            glm::vec3 relativeSize[4] = {
-                { 0.0f,  0.0f, 0.0f},
-                {sizeX,  0.0f, 0.0f},
-                {sizeX, sizeY, 0.0f},
-                { 0.0f, sizeY, 0.0f}
-            };
+    if (s_data.textureCount == MAX_TEXTURES_IN_BATCH)
+    {
+        s_stats.batchesEndedByTextures++;
+        flush();
+    }
+    s_data.textures[s_data.textureCount] = &texture;
+    return s_data.textureCount++;
+}
 
-            glm::vec2 uvCoords[] = {
-                {               textureX,                textureY},
-                {textureX + textureSizeX,                textureY},
-                {textureX + textureSizeX, textureY + textureSizeY},
-                {               textureX, textureY + textureSizeY}
-            };
+void Renderer2D::flush()
+{
+    if (s_data.vertices.empty())
+        return;
 
-            glm::vec3 glyphOrigin = currentGlyphPos + offset;
-            for (size_t i = 0; i < 4; i++)
-            {
-                quadVertex[i].position = glyphOrigin + relativeSize[i] * size;
-                quadVertex[i].uv = uvCoords[i];
-            }
+    // Moving to the next region only waits if the gpu is still drawing what was written to it
+    StreamBuffer &streamBuffer = *s_data.streamBuffer;
+    const uint32_t size = s_data.vertices.size() * sizeof(QuadVertex);
+    if (streamBuffer.getUsedSize() + size + sizeof(QuadVertex) > streamBuffer.getRegionSize())
+        streamBuffer.nextFrame();
+    const StreamBuffer::Allocation allocation
+        = streamBuffer.push(s_data.vertices.data(), size, sizeof(QuadVertex));
 
-            s_data.quadsVertexBuffer->setData(quadVertex, 4 * sizeof(QuadVertex));
-            s_data.quadsVertexArray->bind();
-            GL::drawIndexed(s_data.quadsVertexArray);
-        }
-        currentGlyphPos.x += size * (glyphData.advance.x);
-        currentGlyphPos.y += size * (glyphData.advance.y);
-    } 
+    s_data.quadsShader->bind();
+    s_data.quadsShader->setUniform(s_data.viewProjection, "u_viewProjection");
+    for (uint32_t i = 0; i < s_data.textureCount; i++)
+        s_data.textures[i]->bind(i);
+    GL::drawIndexed(
+        *s_data.quadsVertexArray,
+        s_data.vertices.size() / 4 * 6,
+        0,
+        allocation.offset / sizeof(QuadVertex));
+    s_stats.batches++;
+
+    s_data.vertices.clear();
+    s_data.textureCount = 0;
 }
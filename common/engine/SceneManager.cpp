@@ -4,6 +4,7 @@
 
 #include <ResourceFileFormats.hpp>
 #include <utils/Log.hpp>
+#include <utils/MemoryTracker.hpp>
 
 #include <variant>
 
@@ -78,11 +79,13 @@ private:
 
 void SceneManager::loadScene(const paca::fileformats::Scene &scene)
 {
+    MemoryTagScope memoryTag(MemoryTag::ecs);
     m_world.reset();
     
     m_world.component<engine::tags::SceneEntityTag>("SceneEntityTag");
 
-    m_world.component<engine::components::Transform>("Transform");
+    m_world.component<engine::components::Transform>("Transform")
+        .add(flecs::With, m_world.component<engine::components::WorldTransform>("WorldTransform"));
     m_world.component<engine::components::Material>("Material");
     m_world.component<engine::components::StaticMesh>("StaticMesh");
     m_world.component<engine::components::AnimatedMesh>("AnimatedMesh");
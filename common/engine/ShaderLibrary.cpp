@@ -0,0 +1,128 @@
+#include "engine/ShaderLibrary.hpp"
+
+#include "engine/Components.hpp"
+
+#include <utils/MemoryTracker.hpp>
+
+#include <bit>
+#include <list>
+#include <unordered_map>
+
+namespace engine {
+
+namespace {
+
+struct ProgramSources {
+    const char *vertexPath = nullptr; // Null for compute programs
+    const char *fragmentPath = nullptr;
+    const char *computePath = nullptr;
+    ShaderFeatures features = ShaderFeatures::none; // The ones the sources use
+};
+
+const ProgramSources programSources[] = {
+    // forwardMesh
+    {
+        .vertexPath = "assets/shaders/forwardStaticMeshVertex.glsl",
+        .fragmentPath = "assets/shaders/forwardStaticMeshFragment.glsl",
+        .features = ShaderFeatures::packedVertices | ShaderFeatures::skinning
+            | ShaderFeatures::shadowMapping | ShaderFeatures::parallaxMapping,
+    },
+    // shadowMap
+    {
+        .vertexPath = "assets/shaders/shadowMapVertex.glsl",
+        .fragmentPath = "assets/shaders/shadowMapFragment.glsl",
+        .features = ShaderFeatures::packedVertices | ShaderFeatures::skinning
+            | ShaderFeatures::singlePassCascades,
+    },
+    // skinning
+    {
+        .computePath = "assets/shaders/skinningCompute.glsl",
+        .features = ShaderFeatures::packedVertices,
+    },
+    // skybox
+    {
+        .vertexPath = "assets/shaders/skyboxVertex.glsl",
+        .fragmentPath = "assets/shaders/skyboxFragment.glsl",
+    },
+    // cubeLines
+    {
+        .vertexPath = "assets/shaders/renderCubeLinesVertex.glsl",
+        .fragmentPath = "assets/shaders/renderCubeLinesFragment.glsl",
+    },
+};
+
+static_assert(
+    std::to_underlying(ShaderLibrary::Program::last) == sizeof(programSources)/sizeof(ProgramSources),
+    "Missing sources for shader program");
+
+// In the order of the bits
+const char *featureDefines[] = {
+    "USE_PACKED_VERTICES",
+    "USE_SKINNING",
+    "USE_SHADOW_MAPPING",
+    "USE_PARALLAX_MAPPING",
+    "USE_SINGLE_PASS_CASCADES",
+};
+
+static_assert(
+    std::to_underlying(ShaderFeatures::last) == 1u << sizeof(featureDefines)/sizeof(const char*),
+    "Missing define for shader feature");
+
+struct {
+    // By program and features
+    std::unordered_map<uint32_t, std::shared_ptr<Shader>> variants;
+    uint32_t requests = 0;
+} s_data;
+
+} // namespace
+
+std::shared_ptr<Shader> ShaderLibrary::get(Program program, ShaderFeatures features)
+{
+    s_data.requests++;
+
+    const ProgramSources &sources = programSources[std::to_underlying(program)];
+    features = features & sources.features;
+    const uint32_t key = std::to_underlying(program) << 16 | std::to_underlying(features);
+    std::shared_ptr<Shader> &shader = s_data.variants[key];
+    if (shader)
+        return shader;
+
+    // Sizes shared with the engine
+    std::list<ShaderCompileTimeParameter> parameters = {
+        {"MAX_SHADOW_MAP_LEVELS", components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS},
+        {"MAX_DIRECTIONAL_LIGHTS", components::MAX_DIRECTIONAL_LIGHTS},
+    };
+    for (uint32_t bits = std::to_underlying(features); bits != 0; bits &= bits - 1)
+        parameters.emplace_back(featureDefines[std::countr_zero(bits)]);
+
+    MemoryTagScope memoryTag(MemoryTag::render);
+    shader = sources.computePath
+        ? std::make_shared<Shader>(sources.computePath, parameters)
+        : std::make_shared<Shader>(sources.vertexPath, sources.fragmentPath, parameters);
+    return shader;
+}
+
+void ShaderLibrary::prewarm(std::span<const Variant> variants)
+{
+    for (const Variant &variant : variants)
+        get(variant.program, variant.features);
+
+    // All of them were sent to the driver before waiting for any
+    for (auto &[key, shader] : s_data.variants)
+        shader->waitUntilLinked();
+}
+
+void ShaderLibrary::clear()
+{
+    s_data.variants.clear();
+}
+
+ShaderLibrary::Stats ShaderLibrary::getStats()
+{
+    return {
+        .variants = static_cast<uint32_t>(s_data.variants.size()),
+        .requests = s_data.requests,
+    };
+}
+
+} // namespace engine
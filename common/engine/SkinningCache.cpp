@@ -0,0 +1,79 @@
+#include "engine/SkinningCache.hpp"
+
+#include "engine/ShaderLibrary.hpp"
+#include "engine/assets/StaticMesh.hpp"
+
+#include <opengl/gl.hpp>
+
+namespace engine {
+
+constexpr uint32_t SKINNING_WORKGROUP_SIZE = 64;
+constexpr uint32_t SOURCE_VERTICES_BINDING = 4;
+constexpr uint32_t SKINNED_VERTICES_BINDING = 5;
+
+SkinningCache::SkinningCache()
+{
+    for (Mesh::VertexFormat format : {Mesh::VertexFormat::full, Mesh::VertexFormat::packed})
+    {
+        m_shaders[std::to_underlying(format)] = ShaderLibrary::get(
+            ShaderLibrary::Program::skinning,
+            format == Mesh::VertexFormat::packed ? ShaderFeatures::packedVertices : ShaderFeatures::none);
+    }
+}
+
+void SkinningCache::beginFrame()
+{
+    for (auto &[entityId, entry] : m_entries)
+        entry.used = false;
+}
+
+void SkinningCache::endFrame()
+{
+    std::erase_if(m_entries, [](const auto &item) { return !item.second.used; });
+
+    // The vertices are read as attributes by the next draws
+    GL::vertexAttributeBarrier();
+}
+
+void SkinningCache::skin(uint64_t entityId, const AnimatedMesh &mesh, uint32_t firstBoneMatrix)
+{
+    Entry &entry = m_entries[entityId];
+    if (entry.mesh != &mesh)
+    {
+        entry.mesh = &mesh;
+        entry.vertexBuffer = std::make_shared<VertexBuffer>(
+            mesh.getVertexCount() * sizeof(StaticMesh::Vertex));
+        entry.vertexBuffer->setLayout({
+            {ShaderDataType::float3, "a_position"},
+            {ShaderDataType::float3, "a_normal"},
+            {ShaderDataType::float3, "a_tangent"},
+            {ShaderDataType::float2, "a_uvCoords"}
+        });
+        entry.vertexArray = std::make_shared<VertexArray>();
+        entry.vertexArray->addVertexBuffer(entry.vertexBuffer);
+        entry.vertexArray->setIndexBuffer(mesh.getVertexArray().getIndexBuffer());
+    }
+    entry.used = true;
+
+    Shader &shader = *m_shaders[std::to_underlying(mesh.getVertexFormat())];
+    shader.bind();
+    shader.setUniform(mesh.getVertexCount(), "u_vertexCount");
+    shader.setUniform(firstBoneMatrix, "u_firstBoneMatrix");
+    if (mesh.getVertexFormat() == Mesh::VertexFormat::packed)
+    {
+        const AxisAlignedBoundingBox &aabb = mesh.getAABB();
+        shader.setUniform(aabb.min, "u_positionOffset");
+        shader.setUniform(aabb.max - aabb.min, "u_positionScale");
+    }
+    mesh.getVertexBuffer().bindAsStorageBuffer(SOURCE_VERTICES_BINDING);
+    entry.vertexBuffer->bindAsStorageBuffer(SKINNED_VERTICES_BINDING);
+    GL::dispatchCompute((mesh.getVertexCount() + SKINNING_WORKGROUP_SIZE - 1) / SKINNING_WORKGROUP_SIZE);
+}
+
+const VertexArray *SkinningCache::getVertexArray(uint64_t entityId) const
+{
+    const auto entry = m_entries.find(entityId);
+    return entry != m_entries.end() && entry->second.used ? entry->second.vertexArray.get() : nullptr;
+}
+
+} // namespace engine
@@ -0,0 +1,284 @@
+#include "engine/SpatialIndex.hpp"
+
+#include <utils/Assert.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace engine {
+
+namespace {
+
+bool intersects(const AxisAlignedBoundingBox &a, const AxisAlignedBoundingBox &b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool intersectsSphere(const AxisAlignedBoundingBox &aabb, const glm::vec3 &center, float radius)
+{
+    const glm::vec3 closest = glm::max(aabb.min, glm::min(center, aabb.max));
+    const glm::vec3 offset = closest - center;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+// Slab test, returns the distance where the ray enters the box or a negative value if it misses
+float intersectRay(
+    const AxisAlignedBoundingBox &aabb,
+    const glm::vec3 &origin,
+    const glm::vec3 &inverseDirection,
+    float maxDistance)
+{
+    float near = 0.0f, far = maxDistance;
+    for (glm::length_t i = 0; i < 3; i++)
+    {
+        float t0 = (aabb.min[i] - origin[i]) * inverseDirection[i];
+        float t1 = (aabb.max[i] - origin[i]) * inverseDirection[i];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        // NaN when the origin is on the plane of a side parallel to the ray, the comparisons
+        // ignore it
+        near = t0 > near ? t0 : near;
+        far = t1 < far ? t1 : far;
+        if (near > far)
+            return -1.0f;
+    }
+    return near;
+}
+
+} // namespace
+
+SpatialIndex::SpatialIndex(const glm::vec3 &center, float halfSize, uint32_t maxDepth)
+    : m_maxDepth(maxDepth)
+{
+    ASSERT_MSG(maxDepth <= MAX_DEPTH, "The maximum depth of the spatial index is {}", MAX_DEPTH);
+    m_nodes.push_back({.center = center, .halfSize = halfSize, .depth = 0, .children = {}, .items = {}});
+}
+
+void SpatialIndex::set(uint64_t id, const AxisAlignedBoundingBox &aabb)
+{
+    const auto [it, inserted] = m_itemOfId.try_emplace(id, m_items.size());
+    if (inserted)
+    {
+        m_items.push_back({.id = id, .aabb = aabb, .node = 0, .indexInNode = 0});
+        addToNode(it->second, findNode(aabb));
+        return;
+    }
+
+    Item &item = m_items[it->second];
+    if (item.aabb.min == aabb.min && item.aabb.max == aabb.max)
+        return;
+
+    item.aabb = aabb;
+    const uint32_t node = findNode(aabb);
+    if (node != item.node)
+    {
+        removeFromNode(it->second);
+        addToNode(it->second, node);
+    }
+}
+
+void SpatialIndex::remove(uint64_t id)
+{
+    const auto it = m_itemOfId.find(id);
+    if (it != m_itemOfId.end())
+        removeItem(it->second);
+}
+
+const AxisAlignedBoundingBox &SpatialIndex::getAABB(uint64_t id) const
+{
+    const auto it = m_itemOfId.find(id);
+    ASSERT_MSG(it != m_itemOfId.end(), "Id {} is not in the spatial index", id);
+    return m_items[it->second].aabb;
+}
+
+void SpatialIndex::clear()
+{
+    m_nodes.resize(1);
+    m_nodes[0].children = {};
+    m_nodes[0].items.clear();
+    m_items.clear();
+    m_itemOfId.clear();
+}
+
+uint32_t SpatialIndex::findNode(const AxisAlignedBoundingBox &aabb)
+{
+    const glm::vec3 center = (aabb.min + aabb.max) * 0.5f;
+    const glm::vec3 extents = (aabb.max - aabb.min) * 0.5f;
+    const float maxExtent = std::max({extents.x, extents.y, extents.z});
+
+    const Node &root = m_nodes[0];
+    const glm::vec3 offset = glm::abs(center - root.center);
+    if (maxExtent > root.halfSize
+        || std::max({offset.x, offset.y, offset.z}) > root.halfSize)
+        return 0;
+
+    uint32_t node = 0;
+    while (m_nodes[node].depth < m_maxDepth && maxExtent <= m_nodes[node].halfSize * 0.5f)
+    {
+        const glm::vec3 nodeCenter = m_nodes[node].center;
+        const float childHalfSize = m_nodes[node].halfSize * 0.5f;
+        const uint32_t octant
+            = (center.x >= nodeCenter.x ? 1 : 0)
+            | (center.y >= nodeCenter.y ? 2 : 0)
+            | (center.z >= nodeCenter.z ? 4 : 0);
+
+        if (m_nodes[node].children[octant] == 0)
+        {
+            const glm::vec3 childCenter = nodeCenter + glm::vec3(
+                octant & 1 ? childHalfSize : -childHalfSize,
+                octant & 2 ? childHalfSize : -childHalfSize,
+                octant & 4 ? childHalfSize : -childHalfSize);
+            const uint32_t depth = m_nodes[node].depth + 1;
+            m_nodes[node].children[octant] = m_nodes.size();
+            // Invalidates references to the nodes
+            m_nodes.push_back({
+                .center = childCenter,
+                .halfSize = childHalfSize,
+                .depth = depth,
+                .children = {},
+                .items = {},
+            });
+        }
+        node = m_nodes[node].children[octant];
+    }
+    return node;
+}
+
+void SpatialIndex::addToNode(uint32_t itemIndex, uint32_t node)
+{
+    Item &item = m_items[itemIndex];
+    item.node = node;
+    item.indexInNode = m_nodes[node].items.size();
+    m_nodes[node].items.push_back(itemIndex);
+}
+
+void SpatialIndex::removeFromNode(uint32_t itemIndex)
+{
+    const Item &item = m_items[itemIndex];
+    std::vector<uint32_t> &items = m_nodes[item.node].items;
+    items[item.indexInNode] = items.back();
+    m_items[items[item.indexInNode]].indexInNode = item.indexInNode;
+    items.pop_back();
+}
+
+void SpatialIndex::removeItem(uint32_t itemIndex)
+{
+    removeFromNode(itemIndex);
+    m_itemOfId.erase(m_items[itemIndex].id);
+
+    // Move the last item to the free slot
+    const uint32_t lastIndex = m_items.size() - 1;
+    if (itemIndex != lastIndex)
+    {
+        m_items[itemIndex] = m_items[lastIndex];
+        const Item &moved = m_items[itemIndex];
+        m_nodes[moved.node].items[moved.indexInNode] = itemIndex;
+        m_itemOfId[moved.id] = itemIndex;
+    }
+    m_items.pop_back();
+}
+
+template<typename NodeTest, typename ItemVisitor>
+void SpatialIndex::visit(const NodeTest &nodeTest, const ItemVisitor &itemVisitor) const
+{
+    // Popping one node and pushing its 8 children at every level
+    std::array<uint32_t, 7 * MAX_DEPTH + 8> stack;
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node &node = m_nodes[stack[--stackSize]];
+        // The root also has the boxes outside of its cell so it is always visited
+        if (node.depth > 0)
+        {
+            const glm::vec3 looseHalfSize(node.halfSize * 2.0f);
+            if (!nodeTest(AxisAlignedBoundingBox{node.center - looseHalfSize, node.center + looseHalfSize}))
+                continue;
+        }
+
+        for (uint32_t item : node.items)
+            itemVisitor(m_items[item]);
+        for (uint32_t child : node.children)
+        {
+            if (child != 0)
+                stack[stackSize++] = child;
+        }
+    }
+}
+
+void SpatialIndex::queryFrustum(
+    const Frustum &frustum,
+    std::vector<uint64_t> &ids,
+    uint8_t planeMask) const
+{
+    visit(
+        [&](const AxisAlignedBoundingBox &bounds) { return frustum.intersects(bounds, planeMask); },
+        [&](const Item &item) {
+            if (frustum.intersects(item.aabb, planeMask))
+                ids.push_back(item.id);
+        });
+}
+
+void SpatialIndex::querySphere(const glm::vec3 &center, float radius, std::vector<uint64_t> &ids) const
+{
+    visit(
+        [&](const AxisAlignedBoundingBox &bounds) { return intersectsSphere(bounds, center, radius); },
+        [&](const Item &item) {
+            if (intersectsSphere(item.aabb, center, radius))
+                ids.push_back(item.id);
+        });
+}
+
+void SpatialIndex::queryBox(const AxisAlignedBoundingBox &aabb, std::vector<uint64_t> &ids) const
+{
+    visit(
+        [&](const AxisAlignedBoundingBox &bounds) { return intersects(bounds, aabb); },
+        [&](const Item &item) {
+            if (intersects(item.aabb, aabb))
+                ids.push_back(item.id);
+        });
+}
+
+void SpatialIndex::queryRay(
+    const glm::vec3 &origin,
+    const glm::vec3 &direction,
+    float maxDistance,
+    std::vector<uint64_t> &ids) const
+{
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    visit(
+        [&](const AxisAlignedBoundingBox &bounds) {
+            return intersectRay(bounds, origin, inverseDirection, maxDistance) >= 0.0f;
+        },
+        [&](const Item &item) {
+            if (intersectRay(item.aabb, origin, inverseDirection, maxDistance) >= 0.0f)
+                ids.push_back(item.id);
+        });
+}
+
+std::optional<SpatialIndex::RayHit> SpatialIndex::raycast(
+    const glm::vec3 &origin,
+    const glm::vec3 &direction,
+    float maxDistance) const
+{
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    std::optional<RayHit> closest;
+    // Nodes further than the closest hit so far are skipped
+    visit(
+        [&](const AxisAlignedBoundingBox &bounds) {
+            const float limit = closest ? closest->distance : maxDistance;
+            return intersectRay(bounds, origin, inverseDirection, limit) >= 0.0f;
+        },
+        [&](const Item &item) {
+            const float limit = closest ? closest->distance : maxDistance;
+            const float distance = intersectRay(item.aabb, origin, inverseDirection, limit);
+            if (distance >= 0.0f && (!closest || distance < closest->distance))
+                closest = RayHit{.id = item.id, .distance = distance};
+        });
+    return closest;
+}
+
+} // namespace engine
@@ -1,28 +1,87 @@
 #include "engine/assets/StaticMesh.hpp"
 
+#include "engine/assets/VertexPacking.hpp"
+
+#include <unordered_map>
+#include <vector>
+
 StaticMesh::StaticMesh(
     std::span<const Vertex> vertices,
     std::span<const uint32_t> indices,
-    const AxisAlignedBoundingBox &aabb)
-    : m_aabb(aabb)
+    std::span<const Lod> lods,
+    const AxisAlignedBoundingBox &aabb,
+    VertexFormat vertexFormat)
+    : m_aabb(aabb), m_vertexFormat(vertexFormat), m_lods(lods.begin(), lods.end())
 {
+    if (m_lods.empty())
+        m_lods.push_back({.firstIndex = 0, .indexCount = uint32_t(indices.size()), .error = 0.0f});
+
     m_vertex_array = std::make_shared<VertexArray>();
 
-    m_vertex_buffer = std::make_shared<VertexBuffer>(
-        vertices.data(),
-        vertices.size() * sizeof(vertices[0]));
-    m_vertex_buffer->setLayout({
-        {ShaderDataType::float3, "a_position"},
-        {ShaderDataType::float3, "a_normal"},
-        {ShaderDataType::float3, "a_tangent"},
-        {ShaderDataType::float2, "a_uvCoords"}
-    });
+    switch (m_vertexFormat) {
+    case VertexFormat::full:
+        m_vertex_buffer = std::make_shared<VertexBuffer>(
+            vertices.data(),
+            vertices.size() * sizeof(vertices[0]));
+        m_vertex_buffer->setLayout({
+            {ShaderDataType::float3, "a_position"},
+            {ShaderDataType::float3, "a_normal"},
+            {ShaderDataType::float3, "a_tangent"},
+            {ShaderDataType::float2, "a_uvCoords"}
+        });
+        break;
+    case VertexFormat::packed:
+        {
+            std::vector<PackedVertex> packedVertices(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                packedVertices[i] = {
+                    .position = engine::packing::packPositionUnorm16(vertices[i].position, m_aabb),
+                    .normal = engine::packing::packOctahedralSnorm16(vertices[i].normal),
+                    .tangent = engine::packing::packOctahedralSnorm16(vertices[i].tangent),
+                    .texture = engine::packing::packHalf2(vertices[i].texture),
+                };
+            }
+
+            m_vertex_buffer = std::make_shared<VertexBuffer>(
+                packedVertices.data(),
+                packedVertices.size() * sizeof(packedVertices[0]));
+            m_vertex_buffer->setLayout({
+                {ShaderDataType::ushort4, "a_position", true},
+                {ShaderDataType::short2,  "a_normal", true},
+                {ShaderDataType::short2,  "a_tangent", true},
+                {ShaderDataType::half2,   "a_uvCoords"}
+            });
+            break;
+        }
+    default:
+        ASSERT_MSG(false, "Invalid vertex format!");
+        break;
+    }
 
     m_vertex_array->addVertexBuffer(m_vertex_buffer);
 
     m_index_buffer = std::make_shared<IndexBuffer>(indices.data(), indices.size());
 
     m_vertex_array->setIndexBuffer(m_index_buffer);
+
+    // The occluder only keeps the vertices that the least detailed LOD uses
+    const Lod &coarsestLod = m_lods.back();
+    if (coarsestLod.indexCount / 3 <= MAX_OCCLUDER_TRIANGLES)
+    {
+        Occluder occluder;
+        std::unordered_map<uint32_t, uint32_t> occluderIndexOfVertex;
+        for (uint32_t i = 0; i < coarsestLod.indexCount; i++)
+        {
+            const uint32_t vertex = indices[coarsestLod.firstIndex + i];
+            const auto [it, inserted]
+                = occluderIndexOfVertex.try_emplace(vertex, occluder.positions.size());
+            if (inserted)
+                occluder.positions.push_back(vertices[vertex].position);
+            occluder.indices.push_back(it->second);
+        }
+        m_occluder = std::move(occluder);
+    }
 }
 
 StaticMesh::~StaticMesh()
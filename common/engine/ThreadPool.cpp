@@ -0,0 +1,120 @@
+#include "engine/ThreadPool.hpp"
+
+#include "engine/Profiler.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace engine {
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+void ThreadPool::parallelFor(
+    uint32_t count,
+    uint32_t batchSize,
+    const std::function<void(uint32_t begin, uint32_t end)> &function)
+{
+    if (count == 0)
+        return;
+
+    batchSize = std::max(batchSize, 1u);
+    Job job;
+    job.function = &function;
+    job.count = count;
+    job.batchSize = batchSize;
+    job.batchCount = (count + batchSize - 1) / batchSize;
+    job.nextBatch = 0;
+    job.finishedBatches = 0;
+
+    // Not worth waking up the workers
+    if (job.batchCount == 1 || m_threads.empty())
+    {
+        runBatches(job);
+        return;
+    }
+
+    std::lock_guard submitLock(m_submitMutex);
+    {
+        std::lock_guard lock(m_mutex);
+        m_job = &job;
+        m_jobGeneration++;
+    }
+    m_workAvailable.notify_all();
+
+    runBatches(job);
+
+    // The job lives in this stack frame so wait until no worker is looking at it
+    std::unique_lock lock(m_mutex);
+    m_workFinished.wait(lock, [this, &job]() {
+        return job.finishedBatches == job.batchCount && m_activeWorkers == 0;
+    });
+    m_job = nullptr;
+}
+
+void ThreadPool::runBatches(Job &job)
+{
+    PROFILE_SCOPE("ThreadPool batches");
+    for (;;)
+    {
+        const uint32_t batch = job.nextBatch.fetch_add(1);
+        if (batch >= job.batchCount)
+            return;
+
+        const uint32_t begin = batch * job.batchSize;
+        const uint32_t end = std::min(begin + job.batchSize, job.count);
+        (*job.function)(begin, end);
+        job.finishedBatches.fetch_add(1);
+    }
+}
+
+void ThreadPool::workerLoop(uint32_t index)
+{
+    Profiler::setThreadName(std::format("Worker {}", index));
+
+    uint64_t lastGeneration = 0;
+    for (;;)
+    {
+        Job *job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_workAvailable.wait(lock, [this, lastGeneration]() {
+                return m_stopping || (m_job && m_jobGeneration != lastGeneration);
+            });
+            if (m_stopping)
+                return;
+
+            job = m_job;
+            lastGeneration = m_jobGeneration;
+            m_activeWorkers++;
+        }
+
+        runBatches(*job);
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_activeWorkers--;
+        }
+        m_workFinished.notify_all();
+    }
+}
+
+} // namespace engine
@@ -0,0 +1,150 @@
+#include "engine/WorldTransforms.hpp"
+
+#include <utils/Assert.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// Table columns are split in tasks of at most this many entities
+constexpr uint32_t ENTITIES_PER_TASK = 256;
+
+namespace engine {
+
+void computeWorldMatrices(
+    std::span<const components::Transform> transforms,
+    std::span<components::WorldTransform> worldTransforms)
+{
+    ASSERT(transforms.size() == worldTransforms.size());
+
+    constexpr float halfDegreesToRadians = 3.14159265358979f / 360.0f;
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        const components::Transform &transform = transforms[i];
+
+        // Quaternion from the euler angles, like glm::quat(glm::radians(rotation))
+        const float cx = std::cos(transform.rotation.x * halfDegreesToRadians);
+        const float sx = std::sin(transform.rotation.x * halfDegreesToRadians);
+        const float cy = std::cos(transform.rotation.y * halfDegreesToRadians);
+        const float sy = std::sin(transform.rotation.y * halfDegreesToRadians);
+        const float cz = std::cos(transform.rotation.z * halfDegreesToRadians);
+        const float sz = std::sin(transform.rotation.z * halfDegreesToRadians);
+        const float w = cx * cy * cz + sx * sy * sz;
+        const float x = sx * cy * cz - cx * sy * sz;
+        const float y = cx * sy * cz + sx * cy * sz;
+        const float z = cx * cy * sz - sx * sy * cz;
+
+        // translate * scale * rotation, the scale multiplies the rows of the rotation
+        const glm::vec3 &scale = transform.scale;
+        glm::mat4 &matrix = worldTransforms[i].matrix;
+        matrix[0][0] = scale.x * (1.0f - 2.0f * (y * y + z * z));
+        matrix[0][1] = scale.y * (2.0f * (x * y + w * z));
+        matrix[0][2] = scale.z * (2.0f * (x * z - w * y));
+        matrix[0][3] = 0.0f;
+        matrix[1][0] = scale.x * (2.0f * (x * y - w * z));
+        matrix[1][1] = scale.y * (1.0f - 2.0f * (x * x + z * z));
+        matrix[1][2] = scale.z * (2.0f * (y * z + w * x));
+        matrix[1][3] = 0.0f;
+        matrix[2][0] = scale.x * (2.0f * (x * z + w * y));
+        matrix[2][1] = scale.y * (2.0f * (y * z - w * x));
+        matrix[2][2] = scale.z * (1.0f - 2.0f * (x * x + y * y));
+        matrix[2][3] = 0.0f;
+        matrix[3][0] = transform.position.x;
+        matrix[3][1] = transform.position.y;
+        matrix[3][2] = transform.position.z;
+        matrix[3][3] = 1.0f;
+    }
+}
+
+void WorldTransforms::update(const flecs::world &world, ThreadPool &threadPool)
+{
+    if (world.c_ptr() != m_world)
+    {
+        m_world = world.c_ptr();
+        m_query = world.query_builder<
+                const components::Transform,
+                components::WorldTransform,
+                const components::WorldTransform*>()
+            // Only written, otherwise the tables would be seen as changed after every update
+            .term_at(1).out()
+            // Only for the breadth first order and to know the parent, its data is read from
+            // the parent entity so its changes are not seen as changes of the children, they
+            // are propagated here
+            .term_at(2).parent().cascade().inout_none()
+            .cached()
+            .detect_changes()
+            .build();
+    }
+
+    // Children are only recomputed when their parent is, so nothing changed if no table did
+    if (!m_query.changed())
+        return;
+
+    m_levelOfUpdatedEntity.clear();
+    uint32_t level = 0;
+    m_query.run([this, &threadPool, &level](flecs::iter &it) {
+        while (it.next())
+        {
+            // Every entity of a table has the same parent
+            const bool hasParent = it.is_set(2);
+            const flecs::entity parent = hasParent ? it.src(2) : flecs::entity();
+            const auto parentLevel = hasParent
+                ? m_levelOfUpdatedEntity.find(parent.id())
+                : m_levelOfUpdatedEntity.end();
+            const bool parentUpdated = parentLevel != m_levelOfUpdatedEntity.end();
+
+            // Skipping the table does not mark its WorldTransforms as changed
+            if (!it.changed() && !parentUpdated)
+            {
+                it.skip();
+                continue;
+            }
+
+            // The parent's matrix is in the tasks that were not run yet
+            if (parentUpdated && parentLevel->second == level)
+            {
+                runTasks(threadPool);
+                level++;
+            }
+
+            flecs::field<const components::Transform> transforms
+                = it.field<const components::Transform>(0);
+            flecs::field<components::WorldTransform> worldTransforms
+                = it.field<components::WorldTransform>(1);
+            const glm::mat4 *parentMatrix
+                = hasParent ? &parent.get<components::WorldTransform>()->matrix : nullptr;
+            const uint32_t count = it.count();
+            for (uint32_t offset = 0; offset < count; offset += ENTITIES_PER_TASK)
+            {
+                m_tasks.push_back({
+                    .transforms = &transforms[offset],
+                    .worldTransforms = &worldTransforms[offset],
+                    .parentMatrix = parentMatrix,
+                    .count = std::min(count - offset, ENTITIES_PER_TASK),
+                });
+            }
+            for (uint32_t i = 0; i < count; i++)
+                m_levelOfUpdatedEntity[it.entity(i).id()] = level;
+        }
+        runTasks(threadPool);
+    });
+}
+
+void WorldTransforms::runTasks(ThreadPool &threadPool)
+{
+    threadPool.parallelFor(m_tasks.size(), 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const Task &task = m_tasks[i];
+            std::span<components::WorldTransform> worldTransforms(task.worldTransforms, task.count);
+            computeWorldMatrices(std::span(task.transforms, task.count), worldTransforms);
+            if (task.parentMatrix)
+            {
+                for (components::WorldTransform &worldTransform : worldTransforms)
+                    worldTransform.matrix = *task.parentMatrix * worldTransform.matrix;
+            }
+        }
+    });
+    m_tasks.clear();
+}
+
+} // namespace engine
@@ -12,6 +12,15 @@
 class AssetManager
 {
 public:
+    // In bytes, of video memory except for the animations
+    struct MemoryUsage {
+        uint64_t staticMeshes = 0;
+        uint64_t animatedMeshes = 0;
+        uint64_t textures = 0;
+        uint64_t cubemaps = 0;
+        uint64_t animations = 0;
+    };
+
     const StaticMesh *get(StaticMeshId id) const;
     const AnimatedMesh *get(AnimatedMeshId id) const;
     const Texture *get(TextureId id) const;
@@ -44,6 +53,13 @@ public:
     void add(paca::fileformats::Animation &animation);
     void add(paca::fileformats::Font &font);
 
+    // Vertex format used for the meshes added after calling this
+    void setMeshVertexFormat(Mesh::VertexFormat format) { m_meshVertexFormat = format; }
+    Mesh::VertexFormat getMeshVertexFormat() const { return m_meshVertexFormat; }
+
+    // Goes through every asset
+    MemoryUsage getMemoryUsage() const;
+
     auto &staticMeshes() { return m_staticMeshes; }
     auto &animatedMeshes() { return m_animatedMeshes; }
     auto &textures() { return m_textures; }
@@ -62,4 +78,6 @@ private:
     std::unordered_map<MaterialId,     Material>     m_materials;
     std::unordered_map<AnimationId,    Animation>    m_animations;
     std::unordered_map<FontId,         Font>         m_fonts;
+
+    Mesh::VertexFormat m_meshVertexFormat = Mesh::VertexFormat::full;
 };
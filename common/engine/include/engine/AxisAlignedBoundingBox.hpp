@@ -5,4 +5,16 @@
 struct AxisAlignedBoundingBox
 {
     glm::vec3 min, max;
+
+    // Smallest box that contains this one after being transformed by the matrix
+    AxisAlignedBoundingBox transformed(const glm::mat4 &matrix) const
+    {
+        const glm::vec3 center = matrix * glm::vec4((min + max) * 0.5f, 1.0f);
+        const glm::vec3 extents = (max - min) * 0.5f;
+        const glm::vec3 transformedExtents
+            = glm::abs(glm::vec3(matrix[0])) * extents.x
+            + glm::abs(glm::vec3(matrix[1])) * extents.y
+            + glm::abs(glm::vec3(matrix[2])) * extents.z;
+        return {center - transformedExtents, center + transformedExtents};
+    }
 };
@@ -51,6 +51,14 @@ struct Transform
     }
 };
 
+// Model matrix of the entity: its Transform relative to the WorldTransform of its flecs ChildOf
+// parent, if it has one. Recomputed by WorldTransforms only when the Transform or one of the
+// parents change. Every entity with a Transform gets one
+struct WorldTransform
+{
+    glm::mat4 matrix = glm::mat4(1.0f);
+};
+
 struct Material
 {
     NAME("Material")
@@ -104,6 +112,8 @@ struct DirectionalLight
     float intensity;
 };
 
+// The renderers ignore the directional lights after this many
+constexpr size_t MAX_DIRECTIONAL_LIGHTS = 10;
 constexpr size_t MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS = 5;
 
 struct DirectionalLightShadowMap
@@ -122,6 +132,22 @@ struct DirectionalLightShadowMap
         float near, far;
         float cutoffDistance;
         float maxDiagonal;
+
+        // Placement of the level in light space, the center is snapped to the texels in x and y
+        // and to the side of the level in z
+        glm::vec3 lightDirection;
+        glm::ivec2 centerInTexels;
+        float centerDepth;
+
+        // Placement the static casters in staticCasterAtlas were rendered with
+        struct StaticCache {
+            bool valid = false;
+            glm::vec3 lightDirection;
+            glm::ivec2 centerInTexels;
+            float centerDepth;
+            float maxDiagonal;
+            uint64_t castersHash;
+        } staticCache;
     };
 
     DirectionalLightShadowMap(const DirectionalLightShadowMap&) = delete;
@@ -134,6 +160,10 @@ struct DirectionalLightShadowMap
     ShadowMapLevel levels[MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS];
     uint8_t levelCount;
     FrameBuffer shadowMapAtlasFramebuffer;
+
+    // Depth of only the static casters, copied to the atlas every frame before drawing the
+    // dynamic ones
+    Texture staticCasterAtlas;
 };
 
 struct Skybox
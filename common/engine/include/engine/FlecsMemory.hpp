@@ -0,0 +1,9 @@
+#pragma once
+
+namespace engine {
+
+// Makes flecs allocate with the MemoryTracker, counting its memory in MemoryTag::ecs. Has to be
+// called before any flecs world is created, memory allocated before can't be freed after it
+void trackFlecsMemory();
+
+} // namespace engine
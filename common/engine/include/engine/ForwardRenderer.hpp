@@ -4,8 +4,24 @@
 #include "assets/StaticMesh.hpp"
 #include "assets/AnimatedMesh.hpp"
 #include "Components.hpp"
+#include "Frustum.hpp"
+#include "LightClusters.hpp"
+#include "OcclusionCuller.hpp"
+#include "SkinningCache.hpp"
+#include "SpatialIndex.hpp"
+#include "ThreadPool.hpp"
+#include "WorldTransforms.hpp"
 #include <opengl/FrameBuffer.hpp>
 #include <opengl/Shader.hpp>
+#include <opengl/StorageBuffer.hpp>
+#include <opengl/StreamBuffer.hpp>
+#include <opengl/UniformBuffer.hpp>
+
+#include <array>
+#include <memory_resource>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace flecs {
     struct world;
@@ -17,7 +33,20 @@ class ForwardRenderer {
 public:
     enum class Flags : uint32_t {
         enableParallaxMapping = 0x1,
-        enableShadowMapping = 0x2
+        enableShadowMapping = 0x2,
+        // Skin animated meshes once per frame with a compute shader and draw the result as a
+        // static mesh in every pass
+        enablePreSkinning = 0x4,
+        // Skip meshes hidden behind the big static meshes of the view, tested against a depth
+        // buffer rasterized on the cpu
+        enableOcclusionCulling = 0x8
+    };
+
+    // Of the main pass of the last renderWorld()
+    struct Stats {
+        uint32_t meshes = 0;
+        uint32_t inFrustum = 0;
+        uint32_t occluded = 0; // Of the ones in the frustum
     };
 
     ForwardRenderer();
@@ -34,34 +63,92 @@ public:
         const AssetManager &assetManager,
         const FrameBuffer &renderTarget);
 
+    // World AABBs of the entities with meshes as of the last renderWorld(), by flecs entity id
+    const SpatialIndex &getSpatialIndex() const { return m_spatialIndex; }
+    // Null if occlusion culling is disabled, the stats are the ones of the last frame
+    const OcclusionCuller *getOcclusionCuller() const { return m_occlusionCuller.get(); }
+    const Stats &getStats() const { return m_stats; }
+
 private:
     void updateShadowMapLevels(
         const engine::components::Transform &cameraTransform,
         const engine::components::Camera &camera,
         const flecs::world &world);
+
+    void updateLightClusters(
+        const engine::components::Transform &cameraTransform,
+        const engine::components::Camera &camera,
+        const flecs::world &world);
     
-    void drawMeshInShadowMaps(
-        const engine::components::StaticMesh &meshComponent,
-        const glm::mat4 &modelMatrix,
+    // Calculates the pose of every animated mesh and uploads all of them in one buffer
+    void updateBonePalettes(
+        const flecs::world &world,
+        const AssetManager &assetManager);
+
+    void collectShadowCasters(
+        const flecs::world &world,
+        const AssetManager &assetManager);
+    void drawShadowMaps(
+        const flecs::world &world,
+        const AssetManager &assetManager);
+    // Bounds of what the camera sees of each level, in the clip space of the level
+    using ReceiverBoundsPerLevel
+        = std::array<AxisAlignedBoundingBox, components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS>;
+    // Draws the static (meshes without animations) casters that are visible from the level or
+    // the dynamic casters whose shadow reaches the receivers. The framebuffer and viewport have
+    // to be already set
+    void drawShadowCasters(
+        const engine::components::DirectionalLightShadowMap::ShadowMapLevel &level,
+        uint32_t shadowMapSize,
+        bool staticCasters,
+        const AxisAlignedBoundingBox &receiverBounds);
+    // Draws the dynamic casters in every level with one instanced draw each, the shader picks
+    // the viewport of the level. Needs supportsViewportIndexInVertexShader()
+    void drawDynamicShadowCastersSinglePass(
+        const engine::components::DirectionalLightShadowMap &shadowMapComponent,
+        const ReceiverBoundsPerLevel &receiverBounds);
+    // Keeps the world AABBs in m_spatialIndex in sync with the entities with meshes, only the
+    // entities that changed since the last call are updated
+    void updateSpatialIndex(const flecs::world &world, const AssetManager &assetManager);
+    void updateOcclusionCulling(
+        const engine::components::Transform &cameraTransform,
+        const engine::components::Camera &camera,
+        const flecs::world &world,
+        const AssetManager &assetManager);
+    // Creates m_streamBuffer and m_linesBatchVertexArray, that reads from it
+    void createStreamBuffer(uint32_t regionSize);
+    // Copies the data to m_streamBuffer and binds its range. If the region is full the data goes
+    // to the fallback buffer for this frame
+    void pushStorageData(
+        uint32_t bindingPoint,
+        const void *data,
+        uint32_t size,
+        StorageBuffer &fallbackBuffer);
+    // Always false if occlusion culling is disabled
+    bool isOccluded(uint64_t entityId);
+
+    // Main pass, the visible meshes that aren't occluded
+    void drawOpaqueMeshes(
+        const engine::components::Transform &cameraTransform,
+        const engine::components::Camera &camera,
+        const flecs::world &world,
         const AssetManager &assetManager,
-        const flecs::world &world) const;
-    void drawMeshInShadowMaps(
-        const engine::components::AnimatedMesh &meshComponent,
-        const engine::components::AnimationPlayer *animationComponent,
-        const glm::mat4 &modelMatrix,
+        const FrameBuffer &renderTarget);
+    // AABBs of the static meshes and skeletons of the animated ones
+    void drawDebug(
+        const engine::components::Transform &cameraTransform,
+        const engine::components::Camera &camera,
+        const flecs::world &world,
         const AssetManager &assetManager,
-        const flecs::world &world) const;
+        const FrameBuffer &renderTarget);
 
     void setMaterialUniforms(
         Shader &shader,
         const Material *material,
         const AssetManager &assetManager,
         int &nextFreeTextureSlot) const;
-    void setLightUniforms(
-        Shader &shader,
-        const flecs::world &world,
-        const engine::components::Transform &cameraTransform,
-        int &nextFreeTextureSlot) const;
+    // Fills the Lights block of the mesh programs and binds the shadow map atlases
+    void updateLightsBlock(const flecs::world &world);
 
     void drawMesh(
         const engine::components::Transform &cameraTransform,
@@ -78,7 +165,8 @@ private:
         const engine::components::Camera &camera,
         const engine::components::AnimatedMesh &meshComponent,
         const engine::components::Material *materialComponent,
-        const engine::components::AnimationPlayer *animationComponent,
+        uint32_t firstBoneMatrix, // In the bone palettes buffer
+        const VertexArray *preSkinnedVertexArray, // Null to skin it in the vertex shader
         const glm::mat4 &modelMatrix,
         const AssetManager &assetManager,
         const FrameBuffer &renderTarget,
@@ -95,7 +183,7 @@ private:
         const engine::components::Transform &cameraTransform,
         const engine::components::Camera &camera,
         const engine::components::AnimatedMesh &meshComponent,
-        const engine::components::AnimationPlayer *animationComponent,
+        uint32_t firstBoneMatrix,
         const glm::mat4 &modelMatrix,
         const AssetManager &assetManager,
         const FrameBuffer &renderTarget) const;
@@ -118,19 +206,90 @@ private:
         float maxDiagonal;
     };
 
+    // Mesh shaders have a variant for each Mesh::VertexFormat
+    using ShaderPerVertexFormat
+        = std::array<std::shared_ptr<Shader>, std::to_underlying(Mesh::VertexFormat::last)>;
+
     Flags m_flags;
-    std::shared_ptr<Shader> m_staticMeshShader;      // Get the shaders from the ResourceManager
-    std::shared_ptr<Shader> m_animatedMeshShader;    // so they arent recreated with multiple
-    std::shared_ptr<Shader> m_staticShadowMapShader; // renderers
-    std::shared_ptr<Shader> m_animatedShadowMapShader;
+    Stats m_stats;
+    // From the ShaderLibrary, shared with the other renderers
+    ShaderPerVertexFormat m_staticMeshShaders;
+    ShaderPerVertexFormat m_animatedMeshShaders;
+    ShaderPerVertexFormat m_staticShadowMapShaders;
+    ShaderPerVertexFormat m_animatedShadowMapShaders;
+    ShaderPerVertexFormat m_staticSinglePassShadowMapShaders;   // Empty if not supported
+    ShaderPerVertexFormat m_animatedSinglePassShadowMapShaders;
     std::shared_ptr<Shader> m_skyboxShader;
     std::shared_ptr<Shader> m_cubeLinesShader;
 
+    ThreadPool m_threadPool;
+
+    WorldTransforms m_worldTransforms;
+    glm::mat4 m_viewMatrix; // Of the camera of the current renderWorld()
+
+    // Mesh that casts shadows with everything needed to draw it in any shadow map level
+    struct ShadowCaster {
+        const Mesh *mesh;
+        const AnimatedMesh *animatedMesh; // Null for static meshes
+        glm::mat4 modelMatrix;
+        AxisAlignedBoundingBox worldAABB;
+        uint32_t firstBoneMatrix; // In m_boneMatrices
+        const VertexArray *preSkinnedVertexArray; // Null if it is skinned in the vertex shader
+
+        bool isSkinnedInShader() const { return animatedMesh && !preSkinnedVertexArray; }
+        const VertexArray &getVertexArray() const
+        {
+            return preSkinnedVertexArray ? *preSkinnedVertexArray : mesh->getVertexArray();
+        }
+        // Pre-skinned vertices are always full vertices
+        Mesh::VertexFormat getVertexFormat() const
+        {
+            return preSkinnedVertexArray ? Mesh::VertexFormat::full : mesh->getVertexFormat();
+        }
+    };
+    std::vector<ShadowCaster> m_shadowCasters;
+    std::vector<uint32_t> m_shadowDrawList; // Indices of the casters in the current level
+    // Changes when a static caster is added, removed or moved so the cached shadows are redrawn
+    uint64_t m_staticShadowCastersHash = 0;
+
+    // Poses of all the animated meshes of the frame, each one is a range of matrices
+    std::vector<glm::mat4> m_boneMatrices;
+    // The nodes of the map go back to the pool when it is cleared and are reused next frame
+    std::pmr::unsynchronized_pool_resource m_firstBoneMatrixPool;
+    std::pmr::unordered_map<uint64_t, uint32_t> m_firstBoneMatrixOfEntity{&m_firstBoneMatrixPool}; // By flecs entity id
+    std::shared_ptr<StorageBuffer> m_boneMatricesBuffer; // Only when m_streamBuffer is full
+    std::shared_ptr<SkinningCache> m_skinningCache; // Null if pre-skinning is disabled
+
+    SpatialIndex m_spatialIndex;
+    // Detect changes so the index is only updated for the tables where a WorldTransform or a
+    // mesh was written
+    const flecs::world_t *m_spatialIndexWorld = nullptr; // The queries are for this world
+    flecs::query<const components::StaticMesh, const components::WorldTransform> m_staticMeshesQuery;
+    flecs::query<const components::AnimatedMesh, const components::WorldTransform> m_animatedMeshesQuery;
+    // Entities that lost their mesh or WorldTransform since the last update, by flecs id
+    std::shared_ptr<std::vector<uint64_t>> m_entitiesRemovedFromSpatialIndex;
+    // Entities with a mesh whose asset isn't loaded, they are added to the index when it is
+    std::unordered_set<uint64_t> m_entitiesWithoutMeshAsset;
+    std::vector<uint64_t> m_visibleEntities; // In the camera frustum
+
+    std::shared_ptr<OcclusionCuller> m_occlusionCuller; // Null if occlusion culling is disabled
+
+    LightClusters m_lightClusters;
+    std::vector<ClusteredPointLight> m_pointLights;
+    // Only used when m_streamBuffer is full
+    std::shared_ptr<StorageBuffer> m_pointLightsBuffer;
+    std::shared_ptr<StorageBuffer> m_lightClusterIndicesBuffer;
+    std::shared_ptr<UniformBuffer> m_lightsBuffer;
+
     std::shared_ptr<VertexArray> m_cubeVertexArray;
     std::shared_ptr<VertexArray> m_cubeVertexArrayForLines;
-    std::shared_ptr<VertexArray> m_linesBatchVertexArray;
-    mutable std::shared_ptr<VertexBuffer> m_linesBatchVertexBuffer;
-    mutable std::vector<glm::vec3> m_linesBatchVertices;
+    std::shared_ptr<VertexArray> m_linesBatchVertexArray; // Reads the vertices from m_streamBuffer
+
+    // Data written every frame: the lights block, the point lights, the light clusters and their
+    // indices, the bone matrices, the projectionView of every shadow map level and the debug lines
+    std::shared_ptr<StreamBuffer> m_streamBuffer;
+    // Bytes that didn't fit in the region of the current frame, it grows before the next one
+    uint32_t m_streamBufferOverflow = 0;
 };
 
 inline ForwardRenderer::Flags operator|(ForwardRenderer::Flags a, ForwardRenderer::Flags b)
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace engine {
+
+// Allocates by moving forward inside big blocks and frees everything at once in reset(),
+// deallocating does nothing. Usable by std::pmr containers. Not thread safe
+class LinearArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    // Asserts if it needs more than maxCapacity bytes, to catch arenas that are never reset
+    LinearArena(
+        size_t blockSize = DEFAULT_BLOCK_SIZE,
+        size_t maxCapacity = std::numeric_limits<size_t>::max());
+
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    // Everything allocated before is invalid after it. If more than one block was needed they
+    // are replaced by one with the size of all of them, so the next time it doesn't allocate
+    void reset();
+
+    // Bytes allocated since the last reset, with the padding for the alignments
+    size_t getUsedSize() const { return m_usedSize; }
+    size_t getCapacity() const;
+
+private:
+    void *do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t m_blockSize;
+    size_t m_maxCapacity;
+    std::vector<Block> m_blocks; // Allocating from the last one
+    size_t m_offset = 0; // In the last block
+    size_t m_usedSize = 0;
+};
+
+// Arenas for temporaries of the frame, each thread has its own so worker jobs can allocate
+// without locking. There are two per thread used in alternate frames, the memory allocated in
+// a frame is still valid during the next one.
+//
+//     std::pmr::vector<glm::mat4> matrices(&FrameArena::get());
+class FrameArena {
+public:
+    // Of the arena of each thread in a frame. Reaching it usually means that nextFrame() is
+    // not being called
+    static constexpr size_t MAX_THREAD_FRAME_SIZE = 256 << 20;
+
+    // Of the calling thread for the current frame
+    static LinearArena &get();
+
+    // Frees the memory allocated two frames ago. No other thread can be allocating from its
+    // arena while it is called, call it between frames from the thread that drives them
+    static void nextFrame();
+
+    // Bytes used in the current frame by all the threads, with the same restriction
+    static size_t getUsedSize();
+};
+
+} // namespace engine
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AxisAlignedBoundingBox.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+
+// Volume that a projection view matrix maps to the clip space cube, as 6 planes
+struct Frustum
+{
+    enum Plane : uint8_t {
+        left, right, bottom, top, near, far,
+
+        last
+    };
+
+    static constexpr uint8_t ALL_PLANES = (1 << Plane::last) - 1;
+
+    Frustum(const glm::mat4 &projectionView);
+
+    // Only tests the planes in planeMask (bits of Frustum::Plane). Conservative: boxes near the
+    // corners can be reported as intersecting when they are outside.
+    bool intersects(const AxisAlignedBoundingBox &aabb, uint8_t planeMask = ALL_PLANES) const;
+
+    // xyz is the normal pointing inside and w the distance, inside when dot(plane, (p, 1)) >= 0
+    std::array<glm::vec4, Plane::last> planes;
+};
@@ -14,6 +14,7 @@ namespace Key {
         d      = SDL_SCANCODE_D,
         f      = SDL_SCANCODE_F,
         b      = SDL_SCANCODE_B,
+        p      = SDL_SCANCODE_P,
         right  = SDL_SCANCODE_RIGHT,
         left   = SDL_SCANCODE_LEFT,
         down   = SDL_SCANCODE_DOWN,
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace engine {
+
+// Point light as the shaders read it from the storage buffer (std430 layout)
+struct ClusteredPointLight {
+    glm::vec4 positionAndRadius; // Position in view space and radius of influence
+    glm::vec4 colorAndIntensity;
+    glm::vec4 attenuation;       // Only x is used
+};
+
+// Splits the camera frustum in a grid of clusters (tiles in screen space and exponentially
+// growing slices in depth) and stores the point lights that reach each one of them so the
+// shaders only iterate over the lights that can affect the fragment
+class LightClusters {
+public:
+    static constexpr uint32_t GRID_SIZE_X = 16;
+    static constexpr uint32_t GRID_SIZE_Y = 9;
+    static constexpr uint32_t GRID_SIZE_Z = 24;
+    static constexpr uint32_t TILES_PER_SLICE = GRID_SIZE_X * GRID_SIZE_Y;
+    static constexpr uint32_t CLUSTER_COUNT = TILES_PER_SLICE * GRID_SIZE_Z;
+    // Lights past this in a cluster are left out of it
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+    // Range of getLightIndices() with the lights of the cluster
+    struct Cluster {
+        uint32_t offset, count;
+    };
+
+    // Distance at which the light contributes less than one 8 bit color step. Lights without
+    // attenuation reach everything so they get maxRadius
+    static float getPointLightRadius(
+        const glm::vec3 &color,
+        float intensity,
+        float attenuation,
+        float maxRadius);
+
+    // Recomputes the bounds of the clusters if the projection changed. fov in degrees
+    void setProjection(float fov, float aspect, float near, float far);
+
+    // Lights have to be in view space
+    void assignLights(std::span<const ClusteredPointLight> lights, ThreadPool &threadPool);
+
+    std::span<const Cluster> getClusters() const { return m_clusters; }
+    std::span<const uint32_t> getLightIndices() const { return m_lightIndices; }
+
+    // The depth slice of a point at distance d from the camera is log(d) * scale + bias
+    float getDepthSliceScale() const { return m_depthSliceScale; }
+    float getDepthSliceBias() const { return m_depthSliceBias; }
+
+    // Same calculation the shaders do to find the cluster of a fragment
+    uint32_t getClusterIndex(const glm::vec3 &viewPosition) const;
+
+private:
+    float m_fov = 0.0f, m_aspect = 0.0f, m_near = 0.0f, m_far = 0.0f;
+    float m_depthSliceScale = 0.0f, m_depthSliceBias = 0.0f;
+
+    std::array<float, GRID_SIZE_Z + 1> m_sliceDepths;
+
+    // View space bounds of the clusters in structure of arrays form so the compiler can vectorize
+    // the sphere tests over the tiles of a slice when optimizing
+    std::vector<float> m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ;
+
+    // Filled by the threads, each one only writes the clusters of its slices. Every cluster has
+    // MAX_LIGHTS_PER_CLUSTER slots starting at index * MAX_LIGHTS_PER_CLUSTER
+    std::vector<uint32_t> m_clusterLightSlots;
+    std::vector<uint32_t> m_clusterLightCounts;
+
+    std::vector<Cluster> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+};
+
+} // namespace engine
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <ResourceFileFormats.hpp>
+#include <utils/Log.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace engine::meshoptimizer {
+
+struct VertexCacheStatistics {
+    // Average cache miss ratio: transformed vertices per triangle (0.5 is the best possible in a
+    // regular grid and 3.0 the worst)
+    float acmr;
+    // Average transformed vertex ratio: transformed vertices per referenced vertex (1.0 is the
+    // best possible)
+    float atvr;
+};
+
+struct OptimizationStatistics {
+    uint32_t vertexCountBefore, vertexCountAfter;
+    VertexCacheStatistics before, after;
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over the index buffer
+VertexCacheStatistics analyzeVertexCache(
+    std::span<const uint32_t> indices,
+    uint32_t vertexCount,
+    uint32_t cacheSize = 16);
+
+// Fills remap with the new index of every vertex so that binary equal vertices share the same
+// index. Returns the number of unique vertices.
+uint32_t generateVertexRemap(
+    std::vector<uint32_t> &remap,
+    const void *vertices,
+    size_t vertexCount,
+    size_t vertexSize);
+
+// Reorders the triangles to maximize post-transform cache hits (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount);
+
+// Reorders clusters of triangles (keeping the cache efficiency inside them) so the ones facing
+// outwards are drawn first. threshold is how much ACMR degradation is allowed to get smaller
+// clusters (1.05 allows 5%)
+void optimizeOverdraw(
+    std::span<uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    float threshold = 1.05f);
+
+// Fills remap with the new index of every vertex so vertices are in the order they are first
+// referenced by the index buffer. Unreferenced vertices are discarded. Returns the number of
+// vertices referenced.
+uint32_t generateVertexFetchRemap(
+    std::vector<uint32_t> &remap,
+    std::span<const uint32_t> indices,
+    uint32_t vertexCount);
+
+void remapIndices(std::span<uint32_t> indices, std::span<const uint32_t> remap);
+
+// Simplifies the mesh collapsing edges (quadric error metric) into destination until it has
+// targetIndexCount indices or the error would get over targetError. Vertices are not moved or
+// created so the result uses the same vertex buffer. Errors are relative to the size of the mesh.
+// Returns the error of the result.
+float simplify(
+    std::vector<uint32_t> &destination,
+    std::span<const uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    size_t targetIndexCount,
+    float targetError);
+
+template<typename Vertex>
+void remapVertices(
+    std::vector<Vertex> &vertices,
+    std::span<const uint32_t> remap,
+    uint32_t newVertexCount)
+{
+    std::vector<Vertex> result(newVertexCount);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (remap[i] != UINT32_MAX)
+            result[remap[i]] = vertices[i];
+    }
+    vertices = std::move(result);
+}
+
+// Runs the whole optimization pipeline over a mesh in the paca file format: vertex
+// deduplication, vertex cache optimization, overdraw optimization and vertex fetch optimization
+template<typename MeshType>
+OptimizationStatistics optimizeMesh(MeshType &mesh)
+{
+    OptimizationStatistics statistics;
+    statistics.vertexCountBefore = mesh.vertices.size();
+    statistics.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    std::vector<uint32_t> remap;
+    uint32_t vertexCount = generateVertexRemap(
+        remap,
+        mesh.vertices.data(),
+        mesh.vertices.size(),
+        sizeof(typename MeshType::Vertex));
+    remapIndices(mesh.indices, remap);
+    remapVertices(mesh.vertices, remap, vertexCount);
+
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+        positions[i] = mesh.vertices[i].position;
+    optimizeOverdraw(mesh.indices, positions);
+
+    vertexCount = generateVertexFetchRemap(remap, mesh.indices, mesh.vertices.size());
+    remapIndices(mesh.indices, remap);
+    remapVertices(mesh.vertices, remap, vertexCount);
+
+    statistics.vertexCountAfter = mesh.vertices.size();
+    statistics.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    INFO("Optimized mesh \"{}\": vertices {} -> {}, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+        mesh.name,
+        statistics.vertexCountBefore, statistics.vertexCountAfter,
+        statistics.before.acmr, statistics.after.acmr,
+        statistics.before.atvr, statistics.after.atvr);
+
+    return statistics;
+}
+
+// Fills mesh.lods with simplified versions of the mesh each one with about half the triangles of
+// the previous one. Stops when the error would get over maxError or when the simplification
+// doesnt reduce the triangle count enough to be worth another level
+template<typename MeshType>
+void generateLods(MeshType &mesh, uint32_t maxLodCount = 4, float maxError = 0.05f)
+{
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+        positions[i] = mesh.vertices[i].position;
+
+    mesh.lods.clear();
+    size_t previousIndexCount = mesh.indices.size();
+    float previousError = 0.0f;
+    while (mesh.lods.size() < maxLodCount)
+    {
+        const size_t targetIndexCount = previousIndexCount / 6 * 3;
+
+        // Always simplify from the original mesh so the error is measured against it
+        paca::fileformats::MeshLod lod;
+        lod.error = simplify(lod.indices, mesh.indices, positions, targetIndexCount, maxError);
+        if (lod.indices.empty() || lod.indices.size() > previousIndexCount * 0.8f)
+            break;
+
+        lod.error = std::max(lod.error, previousError);
+        optimizeVertexCache(lod.indices, mesh.vertices.size());
+
+        previousIndexCount = lod.indices.size();
+        previousError = lod.error;
+        mesh.lods.push_back(std::move(lod));
+    }
+
+    for (size_t i = 0; i < mesh.lods.size(); i++)
+    {
+        INFO("Mesh \"{}\" LOD {}: triangles {} -> {}, error {:.4f}",
+            mesh.name,
+            i + 1,
+            mesh.indices.size() / 3, mesh.lods[i].indices.size() / 3,
+            mesh.lods[i].error);
+    }
+}
+
+} // namespace engine::meshoptimizer
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "AxisAlignedBoundingBox.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace engine {
+
+// Software occlusion culling. Occluders (low poly meshes) are rasterized into a small depth
+// buffer on the CPU and the bounding boxes of the objects are tested against a pyramid with the
+// farthest depth of each region. Does not need a graphics context.
+class OcclusionCuller {
+public:
+    // The tiles of the depth buffer are rasterized in parallel
+    static constexpr uint32_t TILE_WIDTH = 32;
+    static constexpr uint32_t TILE_HEIGHT = 16;
+    // Pixels of a row processed together, the inner loop is written so it gets vectorized
+    static constexpr uint32_t SIMD_WIDTH = 8;
+
+    struct Stats {
+        uint32_t occluders = 0;
+        uint32_t occluderTriangles = 0; // After clipping
+        uint32_t testedObjects = 0;
+        uint32_t culledObjects = 0;
+    };
+
+    // The size gets rounded up to a multiple of the tile size
+    OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+
+    // Clears the depth buffer and the stats
+    void beginFrame(const glm::mat4 &projectionView);
+
+    void addOccluder(
+        std::span<const glm::vec3> positions,
+        std::span<const uint32_t> indices,
+        const glm::mat4 &modelMatrix);
+
+    // Rasterizes the occluders added since beginFrame and builds the depth pyramid
+    void rasterizeOccluders(ThreadPool &threadPool);
+
+    // False if the box is completely behind the occluders. Boxes outside of the screen or
+    // crossing the near plane are visible, frustum culling is not done here
+    bool isVisible(const AxisAlignedBoundingBox &aabb);
+
+    const Stats &getStats() const { return m_stats; }
+
+    uint32_t getWidth() const { return m_width; }
+    uint32_t getHeight() const { return m_height; }
+
+    // Depth (0 to 1) of the nearest occluder at the pixel, 1 where there is none
+    float getDepth(uint32_t x, uint32_t y) const { return m_depthPyramid[0][x + y * m_width]; }
+
+private:
+    // Edge functions and depth plane of a triangle in screen space, as A*x + B*y + C
+    struct Triangle {
+        glm::vec3 edges[3];
+        glm::vec3 depth;
+        int32_t minX, minY, maxX, maxY;
+    };
+
+    void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+    void rasterizeTile(uint32_t tileX, uint32_t tileY);
+    void buildDepthPyramid();
+
+    uint32_t m_width, m_height;
+    uint32_t m_tilesX, m_tilesY;
+    glm::mat4 m_projectionView;
+
+    std::vector<Triangle> m_triangles;
+    std::vector<std::vector<uint32_t>> m_trianglesPerTile;
+
+    // Level 0 is the depth buffer, each next level has the maximum of 2x2 texels of the previous
+    std::vector<std::vector<float>> m_depthPyramid;
+    std::vector<glm::uvec2> m_levelSizes;
+
+    Stats m_stats;
+};
+
+} // namespace engine
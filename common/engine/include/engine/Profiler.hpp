@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace engine {
+
+// Records timed zones of the cpu threads and of the gpu while enabled. Each thread writes its
+// zones to its own ring buffer without locking, the buffers keep the last EVENTS_PER_THREAD
+// zones and can be written as a Chrome trace at any moment.
+//
+// Use the PROFILE_* macros, defining DISABLE_PROFILING removes them.
+class Profiler {
+public:
+    static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+    // Time of all the zones with the same name in a frame, in miliseconds
+    struct ZoneTotal {
+        const char *name;
+        float cpuTime = 0.0f;
+        float gpuTime = 0.0f; // Of the zones collected in the frame, recorded some frames before
+    };
+
+    // Zones are only recorded while it is enabled, starts disabled
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Shown in the trace instead of the thread number. The buffer of the thread is only
+    // allocated when it records its first zone
+    static void setThreadName(const std::string &name);
+
+    // Nanoseconds of the clock used for the zones
+    static int64_t now();
+
+    static void recordCpuZone(const char *name, int64_t start, int64_t end);
+
+    // Gpu zones are timed with timestamp queries so they can only be used from the thread with
+    // the GL context. They can be nested
+    static void beginGpuZone(const char *name);
+    static void endGpuZone();
+    // Records the gpu zones whose queries have finished, without waiting for the others. Call
+    // it once per frame
+    static void collectGpuZones();
+
+    // Makes the totals of the zones of this frame available in getFrameZoneTotals(). Only the
+    // cpu zones of the thread that calls it are added up, it has to be always the same one
+    static void endFrame();
+    static const std::vector<ZoneTotal> &getFrameZoneTotals();
+
+    // For chrome://tracing or https://ui.perfetto.dev
+    static bool writeChromeTrace(const std::string &path);
+
+    // Forgets the recorded zones. Not safe while other threads are recording
+    static void clear();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class CpuProfileZone {
+public:
+    CpuProfileZone(const char *name)
+        : m_name(name), m_start(Profiler::isEnabled() ? Profiler::now() : -1)
+    {}
+
+    ~CpuProfileZone()
+    {
+        if (m_start >= 0)
+            Profiler::recordCpuZone(m_name, m_start, Profiler::now());
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+    const char *m_name;
+    int64_t m_start; // Negative if the profiler was disabled at the start
+};
+
+class GpuProfileZone {
+public:
+    GpuProfileZone(const char *name)
+        : m_recording(Profiler::isEnabled())
+    {
+        if (m_recording)
+            Profiler::beginGpuZone(name);
+    }
+
+    ~GpuProfileZone()
+    {
+        if (m_recording)
+            Profiler::endGpuZone();
+    }
+
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+private:
+    bool m_recording;
+};
+
+} // namespace engine
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifndef DISABLE_PROFILING
+    // The name has to be a string literal, only its pointer is stored
+    #define PROFILE_SCOPE(name) \
+        ::engine::CpuProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+    #define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+    #define PROFILE_GPU_SCOPE(name) \
+        ::engine::GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+    #define PROFILE_SCOPE(name)
+    #define PROFILE_FUNCTION()
+    #define PROFILE_GPU_SCOPE(name)
+#endif
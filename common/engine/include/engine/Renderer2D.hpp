@@ -1,20 +1,70 @@
 #pragma once
 
+#include "engine/AssetManager.hpp"
 #include "engine/Camera.hpp"
-#include "engine/Font.hpp"
+#include "engine/assets/Font.hpp"
 #include "opengl/Texture.hpp"
 
 #include <glm/glm.hpp>
-#include <string>
+#include <string_view>
 
+// Draws quads in batches. The quads are accumulated until MAX_QUADS_IN_BATCH of them or
+// MAX_TEXTURES_IN_BATCH different textures are used, or until endScene(), and then drawn with a
+// single draw call. They are drawn in the order they were submitted
 class Renderer2D {
 public:
+    static constexpr uint32_t MAX_QUADS_IN_BATCH = 10000;
+    static constexpr uint32_t MAX_TEXTURES_IN_BATCH = 16;
+    // The layouts of texts not drawn in this many scenes are removed from the cache
+    static constexpr uint32_t TEXT_LAYOUT_LIFETIME = 120;
+
+    // Counted since the last resetStats()
+    struct Stats {
+        uint32_t quads = 0;
+        uint32_t batches = 0; // One draw call each
+        uint32_t batchesEndedByTextures = 0; // Flushed because a texture didn't fit in the batch
+        uint32_t textLayoutsReused = 0;
+        uint32_t textLayoutsBuilt = 0;
+    };
+
     static void init();
-    
+    // Frees the gpu objects, has to be called before the context is destroyed
+    static void shutdown();
+
+    // Blending is enabled during the scene, endScene() leaves it as it was before
     static void beginScene(const Camera &camera);
     static void endScene();
 
     static void drawQuad(const glm::vec3 &position, const glm::vec2 &size, const glm::vec4 &color);
     static void drawQuad(const glm::vec3 &position, const glm::vec2 &size, const Texture &texture, const glm::vec4 &color = glm::vec4(1.0f));
-    static void drawString(const glm::vec3 &position, const std::string &text, Font &font, const glm::vec4 &color, float size = 1.0f);
+    // With the part of the texture between the uv coordinates
+    static void drawQuad(
+        const glm::vec3 &position,
+        const glm::vec2 &size,
+        const Texture &texture,
+        const glm::vec2 &uvMin,
+        const glm::vec2 &uvMax,
+        const glm::vec4 &color = glm::vec4(1.0f));
+    // The text is in utf-8, the position is on the baseline at the start of the text. The glyph
+    // quads are cached by text, font and size, drawing the same text again only copies them
+    static void drawString(
+        const glm::vec3 &position,
+        std::string_view text,
+        const Font &font,
+        const AssetManager &assetManager,
+        const glm::vec4 &color,
+        float size = 1.0f);
+
+    // Has to be called when a font is removed, the cache refers to the fonts by their address
+    static void clearTextLayoutCache();
+
+    static const Stats &getStats() { return s_stats; }
+    static void resetStats() { s_stats = {}; }
+
+private:
+    // Slot of the texture in the current batch, flushes it first if there are no free slots
+    static uint32_t getTextureIndex(const Texture &texture);
+    static void flush();
+
+    static Stats s_stats;
 };
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <engine/Components.hpp>
+
+#include <opengl/Shader.hpp>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace engine {
+
+// Optional parts of the shader programs, each one is a #define in the sources
+enum class ShaderFeatures : uint32_t {
+    none = 0x0,
+    packedVertices = 0x1,     // USE_PACKED_VERTICES
+    skinning = 0x2,           // USE_SKINNING
+    shadowMapping = 0x4,      // USE_SHADOW_MAPPING
+    parallaxMapping = 0x8,    // USE_PARALLAX_MAPPING
+    singlePassCascades = 0x10, // USE_SINGLE_PASS_CASCADES
+
+    last = 0x20
+};
+
+inline ShaderFeatures operator|(ShaderFeatures a, ShaderFeatures b)
+{
+    return ShaderFeatures(std::to_underlying(a) | std::to_underlying(b));
+}
+
+inline ShaderFeatures operator&(ShaderFeatures a, ShaderFeatures b)
+{
+    return ShaderFeatures(std::to_underlying(a) & std::to_underlying(b));
+}
+
+// Lights uniform block of the forwardMesh program (std140 layout). Each renderer that draws with
+// the program owns the buffer with its lights and binds it to BINDING before drawing
+struct ForwardMeshLightsBlock {
+    static constexpr uint32_t BINDING = 1;
+
+    struct ShadowMapLevel {
+        glm::mat4 cameraSpaceToLightSpace;
+        float cutoffDistance;
+        float padding[3];
+    };
+
+    struct DirectionalLight {
+        glm::vec3 directionInViewSpace;
+        float padding0;
+        glm::vec3 color;
+        float intensity;
+        ShadowMapLevel shadowMapLevels[components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS];
+        int32_t numOfShadowMapLevels; // Zero when the light has no shadow map
+        float padding1[3];
+    };
+
+    DirectionalLight directionalLights[components::MAX_DIRECTIONAL_LIGHTS];
+    glm::uvec3 clusterGridSize; // Zero when there are no light clusters (no point lights)
+    int32_t numOfDirectionalLights;
+    float clusterDepthScale;
+    float clusterDepthBias;
+    float padding[2];
+};
+
+static_assert(sizeof(ForwardMeshLightsBlock::ShadowMapLevel) == 80);
+static_assert(sizeof(ForwardMeshLightsBlock::DirectionalLight)
+    == 48 + 80 * components::MAX_DIRECTIONAL_LIGHT_SHADOW_MAP_LEVELS);
+static_assert(sizeof(ForwardMeshLightsBlock) % 16 == 0);
+
+// Compiles each variant of the shader programs once and shares it between all the renderers.
+// The features a program doesn't use are ignored, so they don't make different variants.
+//
+// The values of the uniforms are stored in the programs, so they are shared too. The state that
+// lasts more than one draw is in uniform blocks that each renderer owns and binds, like
+// ForwardMeshLightsBlock. The rest of the uniforms have to be set after every bind() of the
+// program, the DEBUG builds check it before each draw (except for the samplers, that only hold
+// texture units).
+class ShaderLibrary {
+public:
+    enum class Program : uint8_t {
+        forwardMesh,
+        shadowMap,
+        skinning, // Compute
+        skybox,
+        cubeLines,
+
+        last
+    };
+
+    struct Variant {
+        Program program;
+        ShaderFeatures features = ShaderFeatures::none;
+    };
+
+    struct Stats {
+        uint32_t variants = 0; // Compiled or loaded from the ProgramCache
+        uint32_t requests = 0;
+    };
+
+    // Starts compiling the variant if it isn't in the library
+    static std::shared_ptr<Shader> get(Program program, ShaderFeatures features = ShaderFeatures::none);
+
+    // Creates the variants that will be needed and waits until all the programs of the library
+    // are linked, so the first frames don't wait for the driver
+    static void prewarm(std::span<const Variant> variants = {});
+
+    // Releases the programs not used by anyone else, has to be called before the context is
+    // destroyed
+    static void clear();
+
+    static Stats getStats();
+};
+
+} // namespace engine
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "assets/AnimatedMesh.hpp"
+
+#include <opengl/Shader.hpp>
+#include <opengl/VertexArray.hpp>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace engine {
+
+// Skins animated meshes once per frame with a compute shader into vertex buffers with the
+// layout of the full StaticMesh vertices, so every pass draws them as static meshes instead of
+// skinning them again in the vertex shader
+class SkinningCache {
+public:
+    SkinningCache();
+
+    SkinningCache(const SkinningCache&) = delete;
+    SkinningCache& operator=(const SkinningCache&) = delete;
+
+    // Entities not skinned between beginFrame and endFrame lose their vertices
+    void beginFrame();
+    void endFrame();
+
+    // The bone matrices have to be bound to the binding point the skinning shaders read them from
+    void skin(uint64_t entityId, const AnimatedMesh &mesh, uint32_t firstBoneMatrix);
+
+    // Null if the entity was not skinned this frame
+    const VertexArray *getVertexArray(uint64_t entityId) const;
+
+private:
+    struct Entry {
+        const AnimatedMesh *mesh;
+        std::shared_ptr<VertexBuffer> vertexBuffer;
+        std::shared_ptr<VertexArray> vertexArray;
+        bool used;
+    };
+
+    std::array<std::shared_ptr<Shader>, std::to_underlying(Mesh::VertexFormat::last)> m_shaders;
+    std::unordered_map<uint64_t, Entry> m_entries; // By flecs entity id
+};
+
+} // namespace engine
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "AxisAlignedBoundingBox.hpp"
+#include "Frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+// Loose octree of boxes identified by an id (the flecs entity id for the scene). Each box is
+// stored in the deepest node whose cell contains its center and is at least as big as the box,
+// the bounds of a node are twice its cell so the box always fits in them. Boxes outside of the
+// root cell stay in the root.
+class SpatialIndex {
+public:
+    static constexpr uint32_t MAX_DEPTH = 16;
+
+    struct RayHit {
+        uint64_t id;
+        float distance; // Along the ray, in units of its direction
+    };
+
+    SpatialIndex(
+        const glm::vec3 &center = glm::vec3(0.0f),
+        float halfSize = 1024.0f,
+        uint32_t maxDepth = 10);
+
+    // Inserts the box or moves it if the id is already in the index
+    void set(uint64_t id, const AxisAlignedBoundingBox &aabb);
+    void remove(uint64_t id);
+    bool contains(uint64_t id) const { return m_itemOfId.contains(id); }
+    const AxisAlignedBoundingBox &getAABB(uint64_t id) const;
+    size_t size() const { return m_items.size(); }
+    void clear();
+
+    // The queries append the ids of the boxes that intersect the volume to the vector
+    void queryFrustum(
+        const Frustum &frustum,
+        std::vector<uint64_t> &ids,
+        uint8_t planeMask = Frustum::ALL_PLANES) const;
+    void querySphere(const glm::vec3 &center, float radius, std::vector<uint64_t> &ids) const;
+    void queryBox(const AxisAlignedBoundingBox &aabb, std::vector<uint64_t> &ids) const;
+    void queryRay(
+        const glm::vec3 &origin,
+        const glm::vec3 &direction,
+        float maxDistance,
+        std::vector<uint64_t> &ids) const;
+
+    // Closest box hit by the ray
+    std::optional<RayHit> raycast(
+        const glm::vec3 &origin,
+        const glm::vec3 &direction,
+        float maxDistance = INFINITY) const;
+
+private:
+    struct Node {
+        glm::vec3 center;
+        float halfSize; // Of the cell, the loose bounds are twice as big
+        uint32_t depth;
+        std::array<uint32_t, 8> children; // Indices in m_nodes, 0 if there is no child
+        std::vector<uint32_t> items;      // Indices in m_items
+    };
+
+    struct Item {
+        uint64_t id;
+        AxisAlignedBoundingBox aabb;
+        uint32_t node;
+        uint32_t indexInNode;
+    };
+
+    // Node where the box belongs, creating it if needed
+    uint32_t findNode(const AxisAlignedBoundingBox &aabb);
+    void addToNode(uint32_t itemIndex, uint32_t node);
+    void removeFromNode(uint32_t itemIndex);
+    void removeItem(uint32_t itemIndex);
+
+    // Calls the visitor with every item whose node bounds pass the test
+    template<typename NodeTest, typename ItemVisitor>
+    void visit(const NodeTest &nodeTest, const ItemVisitor &itemVisitor) const;
+
+    uint32_t m_maxDepth;
+    std::vector<Node> m_nodes; // The first one is the root
+    std::vector<Item> m_items;
+    std::unordered_map<uint64_t, uint32_t> m_itemOfId;
+};
+
+} // namespace engine
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+// Fixed set of worker threads for data parallel work. Only one parallelFor runs at a time, calls
+// from other threads wait for the current one to finish.
+class ThreadPool {
+public:
+    // 0 uses one thread less than the hardware threads because the calling thread also works
+    ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls function(begin, end) with ranges covering [0, count) of at least batchSize elements
+    // (except the last one) from the workers and the calling thread. Returns when every range
+    // was processed.
+    void parallelFor(
+        uint32_t count,
+        uint32_t batchSize,
+        const std::function<void(uint32_t begin, uint32_t end)> &function);
+
+    uint32_t getThreadCount() const { return m_threads.size() + 1; }
+
+private:
+    struct Job {
+        const std::function<void(uint32_t, uint32_t)> *function;
+        uint32_t count, batchSize, batchCount;
+        std::atomic<uint32_t> nextBatch;
+        std::atomic<uint32_t> finishedBatches;
+    };
+
+    void workerLoop(uint32_t index);
+    static void runBatches(Job &job);
+
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_submitMutex; // Held for the whole parallelFor
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workFinished;
+    Job *m_job = nullptr;
+    uint64_t m_jobGeneration = 0;
+    uint32_t m_activeWorkers = 0;
+    bool m_stopping = false;
+};
+
+} // namespace engine
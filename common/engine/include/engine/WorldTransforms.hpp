@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Components.hpp"
+#include "ThreadPool.hpp"
+
+#include <flecs.h>
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+// Same matrices as Transform::getTransform() for a whole column of transforms. The loop has no
+// branches or calls other than sin and cos so the compiler can vectorize it
+void computeWorldMatrices(
+    std::span<const components::Transform> transforms,
+    std::span<components::WorldTransform> worldTransforms);
+
+// Keeps the WorldTransform of the entities up to date. Uses flecs change detection so only the
+// tables where a Transform was written since the last update are recomputed, code that writes
+// a Transform through get_mut() has to call modified() for it to be noticed.
+//
+// The Transform of an entity with a flecs ChildOf parent is relative to the parent's
+// WorldTransform. The tables are visited breadth first (cascade) and the children of
+// recomputed entities are recomputed too, each level is split in tasks for the thread pool
+// after the level before it is finished
+class WorldTransforms {
+public:
+    void update(const flecs::world &world, ThreadPool &threadPool);
+
+private:
+    // Range of a table column
+    struct Task {
+        const components::Transform *transforms;
+        components::WorldTransform *worldTransforms;
+        const glm::mat4 *parentMatrix; // Null for entities without a parent
+        uint32_t count;
+    };
+
+    void runTasks(ThreadPool &threadPool);
+
+    const flecs::world_t *m_world = nullptr; // The query is for this world
+    flecs::query<
+        const components::Transform,
+        components::WorldTransform,
+        const components::WorldTransform*> m_query;
+
+    std::vector<Task> m_tasks; // Of the level being collected
+    // Level of every entity recomputed in the current update, by flecs entity id
+    std::unordered_map<uint64_t, uint32_t> m_levelOfUpdatedEntity;
+};
+
+} // namespace engine
@@ -3,6 +3,10 @@
 #include "Animation.hpp"
 #include "Mesh.hpp"
 
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
 class AnimatedMesh : public Mesh {
 public:
     // We are assuming that this struct has no padding in between the members
@@ -15,19 +19,46 @@ public:
         glm::vec4 boneWeights;
     };
 
+    // Layout used with VertexFormat::packed
+    struct PackedVertex {
+        glm::u16vec4 position;   // unorm16 relative to the AABB, w is padding
+        glm::i16vec2 normal;     // octahedral snorm16
+        glm::i16vec2 tangent;    // octahedral snorm16
+        glm::u16vec2 texture;    // half floats
+        glm::u8vec4 boneIDs;     // INVALID_PACKED_BONE_ID for unused influences
+        glm::u8vec4 boneWeights; // unorm8
+    };
+    static_assert(sizeof(PackedVertex) == 28);
+
+    static constexpr uint8_t INVALID_PACKED_BONE_ID = 0xFF;
+
     AnimatedMesh(std::span<const Vertex> vertices, 
          std::span<const uint32_t> indices, 
-         Skeleton &&skeleton);
+         std::span<const Lod> lods,
+         const AxisAlignedBoundingBox &aabb,
+         Skeleton &&skeleton,
+         VertexFormat vertexFormat = VertexFormat::full);
     virtual ~AnimatedMesh();
 
     const VertexArray &getVertexArray() const override { return *m_vertex_array; }
+    const AxisAlignedBoundingBox &getAABB() const override { return m_aabb; }
+    VertexFormat getVertexFormat() const override { return m_vertexFormat; }
+    std::span<const Lod> getLods() const override { return m_lods; }
 
     const Skeleton &getSkeleton() const { return m_skeleton; }
 
+    // For skinning the vertices outside of the vertex shader
+    const VertexBuffer &getVertexBuffer() const { return *m_vertex_buffer; }
+    uint32_t getVertexCount() const { return m_vertexCount; }
+
 private:
     std::shared_ptr<VertexArray> m_vertex_array;
     std::shared_ptr<VertexBuffer> m_vertex_buffer;
     std::shared_ptr<IndexBuffer> m_index_buffer;
 
+    AxisAlignedBoundingBox m_aabb;
+    VertexFormat m_vertexFormat;
+    uint32_t m_vertexCount;
+    std::vector<Lod> m_lods;
     Skeleton m_skeleton;
 };
@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <span>
 #include <vector>
 
 using BoneKeyFrames = paca::fileformats::BoneKeyFrames;
@@ -30,10 +31,13 @@ public:
           m_boneKeyframes(boneKeyframes)
     {}
 
-    // the time parameter need to be in ticks
-    std::vector<glm::mat4> getTransformations(float time, const Skeleton &skeleton) const;
+    // the time parameter need to be in ticks. Writes the matrix of each bone of the animation to
+    // out, which needs space for all of them
+    void getTransformations(float time, const Skeleton &skeleton, std::span<glm::mat4> out) const;
     float getDuration() const { return m_duration; }
     float getTicksPerSecond() const { return m_ticksPerSecond; }
+    // Bytes of the keyframes
+    size_t getMemorySize() const;
 
 private:
     glm::vec3 getPosition(BoneID bone, float time) const;
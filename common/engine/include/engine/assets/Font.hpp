@@ -3,8 +3,10 @@
 #include "ResourceFileFormats.hpp"
 #include "engine/IdTypes.hpp"
 
+#include <array>
 #include <cstdint>
 #include <unordered_map>
+#include <vector>
 
 struct GlyphData {
     glm::vec<2, int32_t> textureCoords;
@@ -15,17 +17,42 @@ struct GlyphData {
 
 class Font {
 public:
+    // Code points below this are looked up by index, the others in a map
+    static constexpr uint32_t DIRECT_GLYPH_COUNT = 256;
+
     Font(
         TextureId fontAtlasTextureId,
         unsigned int fontHeight,
+        unsigned int distanceFieldSpread,
         const std::vector<paca::fileformats::GlyphData> &glyphsData);
 
-    TextureId getTextureId() { return m_atlas; }
-    const std::unordered_map<uint32_t, GlyphData> &getGlyphsData() { return m_glyphsData; }
-    unsigned int getHeight() { return m_fontHeight; }
+    TextureId getTextureId() const { return m_atlas; }
+    unsigned int getHeight() const { return m_fontHeight; }
+
+    // The atlas stores the distance to the edges of the glyphs instead of their coverage, up to
+    // this many pixels away
+    unsigned int getDistanceFieldSpread() const { return m_distanceFieldSpread; }
+    bool isDistanceField() const { return m_distanceFieldSpread > 0; }
+
+    // Null if the font doesn't have it
+    const GlyphData *getGlyph(uint32_t codePoint) const
+    {
+        if (codePoint < DIRECT_GLYPH_COUNT)
+        {
+            const uint32_t index = m_directGlyphIndices[codePoint];
+            return index != NO_GLYPH ? &m_glyphs[index] : nullptr;
+        }
+        const auto it = m_otherGlyphIndices.find(codePoint);
+        return it != m_otherGlyphIndices.end() ? &m_glyphs[it->second] : nullptr;
+    }
 
 private:
+    static constexpr uint32_t NO_GLYPH = UINT32_MAX;
+
     TextureId m_atlas;
-    std::unordered_map<uint32_t, GlyphData> m_glyphsData;
+    std::vector<GlyphData> m_glyphs;
+    std::array<uint32_t, DIRECT_GLYPH_COUNT> m_directGlyphIndices; // In m_glyphs
+    std::unordered_map<uint32_t, uint32_t> m_otherGlyphIndices; // By code point
     unsigned int m_fontHeight;
+    unsigned int m_distanceFieldSpread;
 };
@@ -1,8 +1,53 @@
 #pragma once
 
+#include "engine/AxisAlignedBoundingBox.hpp"
+
 #include "opengl/VertexArray.hpp"
 
+#include <span>
+
 class Mesh {
 public:
+    enum class VertexFormat : uint8_t {
+        // Every attribute stored as floats
+        full,
+        // Quantized attributes: position relative to the AABB in unorm16, octahedral normals and
+        // tangents in snorm16, half float uvs, 8 bit bone ids and unorm8 bone weights
+        packed,
+
+        last
+    };
+
+    // Range of the index buffer with one level of detail, the first one is the full mesh
+    struct Lod {
+        uint32_t firstIndex, indexCount;
+        float error; // Relative to the size of the mesh
+    };
+
     virtual const VertexArray &getVertexArray() const = 0;
+    virtual const AxisAlignedBoundingBox &getAABB() const = 0;
+    virtual VertexFormat getVertexFormat() const = 0;
+    virtual std::span<const Lod> getLods() const = 0;
+
+    // Index of the least detailed level with an error smaller than maxError
+    uint32_t selectLod(float maxError) const
+    {
+        const std::span<const Lod> lods = getLods();
+        uint32_t lod = 0;
+        while (lod + 1 < lods.size() && lods[lod + 1].error <= maxError)
+            lod++;
+        return lod;
+    }
+
+    // Bytes of the vertex and index buffers
+    uint64_t getMemorySize() const
+    {
+        const VertexArray &vertexArray = getVertexArray();
+        uint64_t size = vertexArray.getIndexBuffer()
+            ? uint64_t(vertexArray.getIndexBuffer()->getCount()) * sizeof(uint32_t)
+            : 0;
+        for (const std::shared_ptr<VertexBuffer> &vertexBuffer : vertexArray.getVertexBuffers())
+            size += vertexBuffer->getSize();
+        return size;
+    }
 };
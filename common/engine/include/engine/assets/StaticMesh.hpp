@@ -4,6 +4,11 @@
 
 #include "engine/AxisAlignedBoundingBox.hpp"
 
+#include <glm/gtc/type_precision.hpp>
+
+#include <optional>
+#include <vector>
+
 class StaticMesh : public Mesh
 {
 public:
@@ -15,14 +20,38 @@ public:
         glm::vec2 texture;
     };
 
+    // Layout used with VertexFormat::packed
+    struct PackedVertex {
+        glm::u16vec4 position; // unorm16 relative to the AABB, w is padding
+        glm::i16vec2 normal;   // octahedral snorm16
+        glm::i16vec2 tangent;  // octahedral snorm16
+        glm::u16vec2 texture;  // half floats
+    };
+    static_assert(sizeof(PackedVertex) == 20);
+
+    // Low poly version of the mesh that the occlusion culler rasterizes
+    struct Occluder {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    // Meshes whose least detailed LOD has more triangles than this are not used as occluders
+    static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 256;
+
     StaticMesh(
         std::span<const Vertex> vertices,
         std::span<const uint32_t> indices,
-        const AxisAlignedBoundingBox &aabb);
+        std::span<const Lod> lods,
+        const AxisAlignedBoundingBox &aabb,
+        VertexFormat vertexFormat = VertexFormat::full);
     virtual ~StaticMesh();
 
     const VertexArray &getVertexArray() const override { return *m_vertex_array; }
-    const AxisAlignedBoundingBox &getAABB() const { return m_aabb; }
+    const AxisAlignedBoundingBox &getAABB() const override { return m_aabb; }
+    VertexFormat getVertexFormat() const override { return m_vertexFormat; }
+    std::span<const Lod> getLods() const override { return m_lods; }
+    // Null if the mesh is too detailed to be an occluder
+    const Occluder *getOccluder() const { return m_occluder ? &*m_occluder : nullptr; }
 
 private:
     std::shared_ptr<VertexArray> m_vertex_array;
@@ -30,4 +59,7 @@ private:
     std::shared_ptr<IndexBuffer> m_index_buffer;
 
     AxisAlignedBoundingBox m_aabb;
+    VertexFormat m_vertexFormat;
+    std::vector<Lod> m_lods;
+    std::optional<Occluder> m_occluder;
 };
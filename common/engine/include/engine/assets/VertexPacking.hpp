@@ -0,0 +1,89 @@
+#pragma once
+
+#include "engine/AxisAlignedBoundingBox.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cmath>
+
+// Helpers to quantize vertex attributes for the packed vertex formats, the shaders decode them in
+// the USE_PACKED_VERTICES path
+namespace engine::packing {
+
+// Maps a direction to the octahedron unfolded over the [-1, 1] square and stores it as snorm16
+inline glm::i16vec2 packOctahedralSnorm16(const glm::vec3 &direction)
+{
+    const float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (sum == 0.0f)
+        return {0, 0};
+
+    const glm::vec3 n = direction / sum;
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        encoded = glm::vec2(
+            (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    return {
+        static_cast<int16_t>(glm::packSnorm1x16(encoded.x)),
+        static_cast<int16_t>(glm::packSnorm1x16(encoded.y)),
+    };
+}
+
+inline glm::vec3 unpackOctahedralSnorm16(const glm::i16vec2 &packed)
+{
+    const glm::vec2 encoded(
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packed.x)),
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packed.y)));
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (n.z < 0.0f)
+    {
+        const float x = n.x;
+        n.x = (1.0f - std::abs(n.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        n.y = (1.0f - std::abs(x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(n);
+}
+
+// Position relative to the AABB of the mesh, w is left as 0
+inline glm::u16vec4 packPositionUnorm16(const glm::vec3 &position, const AxisAlignedBoundingBox &aabb)
+{
+    glm::u16vec4 result(0);
+    const glm::vec3 extent = aabb.max - aabb.min;
+    for (glm::length_t i = 0; i < 3; i++)
+    {
+        if (extent[i] > 0.0f)
+            result[i] = glm::packUnorm1x16((position[i] - aabb.min[i]) / extent[i]);
+    }
+    return result;
+}
+
+inline glm::u16vec2 packHalf2(const glm::vec2 &value)
+{
+    return { glm::packHalf1x16(value.x), glm::packHalf1x16(value.y) };
+}
+
+// Quantizes the weights to unorm8 so they still add up exactly to 1 (255)
+inline glm::u8vec4 packWeightsUnorm8(const glm::vec4 &weights)
+{
+    glm::u8vec4 result;
+    int sum = 0;
+    glm::length_t largest = 0;
+    for (glm::length_t i = 0; i < 4; i++)
+    {
+        result[i] = static_cast<uint8_t>(std::round(glm::clamp(weights[i], 0.0f, 1.0f) * 255.0f));
+        sum += result[i];
+        if (weights[i] > weights[largest])
+            largest = i;
+    }
+
+    if (sum != 0)
+        result[largest] = static_cast<uint8_t>(glm::clamp(result[largest] + 255 - sum, 0, 255));
+    return result;
+}
+
+} // namespace engine::packing
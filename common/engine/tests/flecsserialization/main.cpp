@@ -0,0 +1,77 @@
+#include <engine/Components.hpp>
+#include <engine/FlecsSerialization.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <flecs.h>
+
+#include <filesystem>
+
+int main (int argc, char *argv[]) {
+    using engine::components::Transform;
+    using engine::tags::SceneEntityTag;
+
+    // Two vehicles with children with the same names. The wheel of the truck is created before
+    // the truck so the file can have children before their parents
+    flecs::world world;
+    flecs::entity car = world.entity("Car")
+        .add<SceneEntityTag>()
+        .set<Transform>({{1.0f, 0.0f, 0.0f}});
+    flecs::entity carWheel = world.entity()
+        .child_of(car)
+        .set_name("Wheel")
+        .add<SceneEntityTag>()
+        .set<Transform>({{2.0f, 0.0f, 0.0f}});
+    world.entity()
+        .child_of(carWheel)
+        .set_name("Bolt")
+        .add<SceneEntityTag>()
+        .set<Transform>({{3.0f, 0.0f, 0.0f}});
+    flecs::entity truckWheel = world.entity()
+        .add<SceneEntityTag>()
+        .set<Transform>({{5.0f, 0.0f, 0.0f}});
+    flecs::entity truck = world.entity("Truck")
+        .add<SceneEntityTag>()
+        .set<Transform>({{4.0f, 0.0f, 0.0f}});
+    truckWheel.child_of(truck).set_name("Wheel");
+    world.entity()
+        .child_of(truckWheel)
+        .set_name("Bolt")
+        .add<SceneEntityTag>()
+        .set<Transform>({{6.0f, 0.0f, 0.0f}});
+
+    const std::filesystem::path path
+        = std::filesystem::temp_directory_path() / "flecsserialization-test.yaml";
+    {
+        engine::serializers::FlecsSerializer serializer(path.string());
+        serializer(world);
+        serializer.write();
+    }
+
+    flecs::world loadedWorld;
+    {
+        engine::serializers::FlecsUnserializer unserializer(path.string());
+        unserializer(loadedWorld);
+    }
+    std::filesystem::remove(path);
+
+    // Each child has to be under the parent it was saved with
+    const auto check = [&loadedWorld](const char *entityPath, const char *parentPath, float x) {
+        const flecs::entity e = loadedWorld.lookup(entityPath);
+        ASSERT_MSG(e.is_valid(), "{} wasn't loaded", entityPath);
+        const flecs::entity parent = parentPath ? loadedWorld.lookup(parentPath) : flecs::entity();
+        ASSERT_MSG(e.parent() == parent, "{} has a wrong parent", entityPath);
+        const Transform *transform = e.get<Transform>();
+        ASSERT_MSG(transform && transform->position.x == x, "{} has a wrong transform", entityPath);
+    };
+    check("Car", nullptr, 1.0f);
+    check("Car::Wheel", "Car", 2.0f);
+    check("Car::Wheel::Bolt", "Car::Wheel", 3.0f);
+    check("Truck", nullptr, 4.0f);
+    check("Truck::Wheel", "Truck", 5.0f);
+    check("Truck::Wheel::Bolt", "Truck::Wheel", 6.0f);
+
+    INFO("Saved and loaded a hierarchy with repeated names");
+
+    return 0;
+}
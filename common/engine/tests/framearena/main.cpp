@@ -0,0 +1,132 @@
+#include <engine/FrameArena.hpp>
+#include <engine/ThreadPool.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+#include <utils/MemoryTracker.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace {
+
+bool isAligned(const void *pointer, size_t alignment)
+{
+    return reinterpret_cast<uintptr_t>(pointer) % alignment == 0;
+}
+
+} // namespace
+
+#ifdef TRACK_HEAP_ALLOCATIONS
+// The MemoryTracker already replaces the global operator new
+uint64_t getAllocationCount()
+{
+    const MemoryTracker::Snapshot snapshot = MemoryTracker::takeSnapshot();
+    uint64_t count = 0;
+    for (const MemoryTracker::TagUsage &usage : snapshot.tags)
+        count += usage.totalHeapAllocations;
+    return count;
+}
+#else
+std::atomic<uint64_t> allocationCount = 0;
+
+uint64_t getAllocationCount()
+{
+    return allocationCount.load();
+}
+
+// Counts every allocation of the program that goes through the global operator new
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+int main (int argc, char *argv[]) {
+    // Allocations are aligned and don't overlap, the ones that don't fit go to new blocks
+    engine::LinearArena arena(1024);
+    std::vector<std::pair<uint8_t*, size_t>> allocations;
+    for (size_t i = 0; i < 100; i++)
+    {
+        const size_t size = 1 + i * 7 % 300;
+        const size_t alignment = size_t(1) << (i % 7);
+        uint8_t *pointer = static_cast<uint8_t*>(arena.allocate(size, alignment));
+        ASSERT(isAligned(pointer, alignment));
+        std::fill(pointer, pointer + size, static_cast<uint8_t>(i));
+        allocations.emplace_back(pointer, size);
+    }
+    for (size_t i = 0; i < allocations.size(); i++)
+        for (size_t j = 0; j < allocations[i].second; j++)
+            ASSERT(allocations[i].first[j] == static_cast<uint8_t>(i));
+    ASSERT(arena.getCapacity() > 1024);
+
+    // After a reset everything fits in one block
+    const size_t usedSize = arena.getUsedSize();
+    arena.reset();
+    ASSERT(arena.getUsedSize() == 0 && arena.getCapacity() >= usedSize);
+    const size_t capacity = arena.getCapacity();
+    const uint64_t allocationsBeforeReuse = getAllocationCount();
+    for (size_t i = 0; i < 100; i++)
+        ASSERT(arena.allocate(1 + i * 7 % 300, size_t(1) << (i % 7)));
+    ASSERT(getAllocationCount() == allocationsBeforeReuse);
+    ASSERT(arena.getCapacity() == capacity);
+
+    engine::ThreadPool threadPool(4);
+    std::vector<uint64_t> sums(threadPool.getThreadCount() * 4);
+    uint32_t *previousFrameData = nullptr;
+    uint64_t allocationsBeforeSteadyState = 0;
+    for (uint32_t frameIndex = 0; frameIndex < 20; frameIndex++)
+    {
+        // The first frames create the blocks of the arenas of every thread
+        if (frameIndex == 4)
+            allocationsBeforeSteadyState = getAllocationCount();
+
+        // The temporaries of the previous frame are still there
+        if (previousFrameData)
+            for (uint32_t i = 0; i < 256; i++)
+                ASSERT(previousFrameData[i] == frameIndex - 1 + i);
+        std::pmr::vector<uint32_t> data(&engine::FrameArena::get());
+        for (uint32_t i = 0; i < 256; i++)
+            data.push_back(frameIndex + i);
+        previousFrameData = data.data();
+
+        // Each worker allocates from its own arena
+        threadPool.parallelFor(sums.size(), 1, [&sums](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                std::pmr::vector<uint64_t> values(1000, i, &engine::FrameArena::get());
+                sums[i] = 0;
+                for (uint64_t value : values)
+                    sums[i] += value;
+            }
+        });
+        for (uint32_t i = 0; i < sums.size(); i++)
+            ASSERT(sums[i] == 1000 * i);
+        ASSERT(engine::FrameArena::getUsedSize() >= 256 * sizeof(uint32_t) + sums.size() * 1000 * sizeof(uint64_t));
+
+        engine::FrameArena::nextFrame();
+    }
+
+    // The frames of the renderer are checked in render-bench/tests/frameallocations
+    const uint64_t steadyStateAllocations = getAllocationCount() - allocationsBeforeSteadyState;
+    INFO("{} heap allocations in {} steady state frames", steadyStateAllocations, 16);
+    ASSERT(steadyStateAllocations == 0);
+
+    return 0;
+}
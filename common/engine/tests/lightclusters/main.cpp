@@ -0,0 +1,74 @@
+#include <engine/LightClusters.hpp>
+#include <engine/ThreadPool.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <vector>
+
+int main (int argc, char *argv[]) {
+    engine::ThreadPool threadPool(3);
+
+    // Every element has to be processed exactly once
+    std::vector<std::atomic<uint32_t>> timesProcessed(1000);
+    threadPool.parallelFor(timesProcessed.size(), 7, [&timesProcessed](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+            timesProcessed[i]++;
+    });
+    for (const std::atomic<uint32_t> &times : timesProcessed)
+        ASSERT(times == 1);
+
+    constexpr float fov = 60.0f, aspect = 16.0f / 9.0f, near = 0.1f, far = 100.0f;
+    engine::LightClusters clusters;
+    clusters.setProjection(fov, aspect, near, far);
+
+    // Random points inside the view frustum (in view space)
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> depthDistribution(near, far);
+    const float tanHalfFovY = std::tan(glm::radians(fov) * 0.5f);
+    auto randomPointInFrustum = [&]() {
+        const float depth = depthDistribution(random);
+        return glm::vec3(
+            unit(random) * depth * tanHalfFovY * aspect,
+            unit(random) * depth * tanHalfFovY,
+            -depth);
+    };
+
+    std::uniform_real_distribution<float> radiusDistribution(0.5f, 5.0f);
+    std::vector<engine::ClusteredPointLight> lights(300);
+    for (engine::ClusteredPointLight &light : lights)
+    {
+        light.positionAndRadius = glm::vec4(randomPointInFrustum(), radiusDistribution(random));
+        light.colorAndIntensity = glm::vec4(1.0f);
+        light.attenuation = glm::vec4(1.0f);
+    }
+
+    clusters.assignLights(lights, threadPool);
+
+    // Every light that reaches a point has to be in the cluster of the point
+    const auto clusterList = clusters.getClusters();
+    const auto lightIndices = clusters.getLightIndices();
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        const glm::vec3 point = randomPointInFrustum();
+        const engine::LightClusters::Cluster &cluster = clusterList[clusters.getClusterIndex(point)];
+        const auto begin = lightIndices.begin() + cluster.offset;
+        const auto end = begin + cluster.count;
+        for (uint32_t lightIndex = 0; lightIndex < lights.size(); lightIndex++)
+        {
+            const glm::vec4 &sphere = lights[lightIndex].positionAndRadius;
+            if (glm::distance(glm::vec3(sphere), point) <= sphere.w)
+                ASSERT(std::find(begin, end, lightIndex) != end);
+        }
+    }
+
+    // Small lights shouldnt be in most of the clusters
+    INFO("{} light assignments in {} clusters", lightIndices.size(), clusterList.size());
+    ASSERT(lightIndices.size() < lights.size() * clusterList.size() / 10);
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <ResourceFileFormats.hpp>
+#include <engine/MeshOptimizer.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using Triangle = std::array<glm::vec3, 3>;
+
+// Triangles with their first vertex being the smallest one so they can be compared without
+// caring about which vertex the index buffer starts with
+std::vector<Triangle> getCanonicalTriangles(const paca::fileformats::StaticMesh &mesh)
+{
+    auto less = [](const glm::vec3 &a, const glm::vec3 &b) {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    };
+
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        Triangle triangle = {
+            mesh.vertices[mesh.indices[i + 0]].position,
+            mesh.vertices[mesh.indices[i + 1]].position,
+            mesh.vertices[mesh.indices[i + 2]].position,
+        };
+        while (less(triangle[1], triangle[0]) || less(triangle[2], triangle[0]))
+            std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+        triangles.push_back(triangle);
+    }
+
+    std::sort(triangles.begin(), triangles.end(), [&](const Triangle &a, const Triangle &b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+    });
+    return triangles;
+}
+
+int main (int argc, char *argv[]) {
+    // Grid of quads as a triangle soup in random order: every triangle has its own vertices
+    constexpr uint32_t gridSize = 32;
+    paca::fileformats::StaticMesh mesh;
+    mesh.name = "grid";
+
+    std::vector<std::array<glm::vec3, 3>> triangles;
+    for (uint32_t y = 0; y < gridSize; y++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            const glm::vec3 a(x, y, 0.0f), b(x + 1, y, 0.0f), c(x, y + 1, 0.0f), d(x + 1, y + 1, 0.0f);
+            triangles.push_back({a, b, d});
+            triangles.push_back({a, d, c});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+
+    for (const auto &triangle : triangles)
+    {
+        for (const glm::vec3 &position : triangle)
+        {
+            mesh.indices.push_back(mesh.vertices.size());
+            mesh.vertices.push_back({
+                .position = position,
+                .normal = {0.0f, 0.0f, 1.0f},
+                .tangent = {1.0f, 0.0f, 0.0f},
+                .texture = {position.x / gridSize, position.y / gridSize},
+            });
+        }
+    }
+
+    const std::vector<Triangle> trianglesBefore = getCanonicalTriangles(mesh);
+
+    const engine::meshoptimizer::OptimizationStatistics statistics
+        = engine::meshoptimizer::optimizeMesh(mesh);
+
+    INFO("ACMR {} -> {}", statistics.before.acmr, statistics.after.acmr);
+    INFO("ATVR {} -> {}", statistics.before.atvr, statistics.after.atvr);
+
+    ASSERT(mesh.vertices.size() == (gridSize + 1) * (gridSize + 1));
+    ASSERT(statistics.vertexCountAfter == mesh.vertices.size());
+    ASSERT(statistics.after.acmr < statistics.before.acmr);
+    ASSERT(statistics.after.acmr < 1.0f);
+    ASSERT(getCanonicalTriangles(mesh) == trianglesBefore);
+
+    // Vertices have to be in the order they are first used
+    uint32_t nextVertex = 0;
+    for (uint32_t index : mesh.indices)
+    {
+        ASSERT(index <= nextVertex);
+        if (index == nextVertex)
+            nextVertex++;
+    }
+
+    // A flat grid can be simplified to two triangles without error, the area has to be the same
+    // and the borders cant move
+    std::vector<glm::vec3> positions(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+        positions[i] = mesh.vertices[i].position;
+
+    std::vector<uint32_t> simplified;
+    const size_t targetIndexCount = mesh.indices.size() / 4;
+    const float error = engine::meshoptimizer::simplify(
+        simplified,
+        mesh.indices,
+        positions,
+        targetIndexCount,
+        0.01f);
+    INFO("Simplified {} -> {} triangles, error {}", mesh.indices.size() / 3, simplified.size() / 3, error);
+
+    ASSERT(simplified.size() % 3 == 0);
+    ASSERT(simplified.size() <= targetIndexCount);
+    ASSERT(error <= 0.01f);
+
+    float area = 0.0f;
+    for (size_t i = 0; i < simplified.size(); i += 3)
+    {
+        const glm::vec3 &a = positions[simplified[i + 0]];
+        const glm::vec3 &b = positions[simplified[i + 1]];
+        const glm::vec3 &c = positions[simplified[i + 2]];
+        area += glm::cross(b - a, c - a).z * 0.5f;
+    }
+    ASSERT(std::abs(area - gridSize * gridSize) < 0.001f);
+
+    engine::meshoptimizer::generateLods(mesh);
+    ASSERT(!mesh.lods.empty());
+    for (size_t i = 1; i < mesh.lods.size(); i++)
+    {
+        ASSERT(mesh.lods[i].indices.size() < mesh.lods[i - 1].indices.size());
+        ASSERT(mesh.lods[i].error >= mesh.lods[i - 1].error);
+    }
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <engine/OcclusionCuller.hpp>
+#include <engine/ThreadPool.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <array>
+#include <cstdint>
+
+int main (int argc, char *argv[]) {
+    engine::ThreadPool threadPool(3);
+    engine::OcclusionCuller culler(256, 128);
+
+    // Camera at the origin looking at -z
+    const glm::mat4 projectionView
+        = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f)
+        * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // A wall of 4x4 centered at z = -5, covering the center of the screen
+    const std::array<glm::vec3, 4> wallPositions = {
+        glm::vec3(-1.0f, -1.0f, 0.0f),
+        glm::vec3( 1.0f, -1.0f, 0.0f),
+        glm::vec3( 1.0f,  1.0f, 0.0f),
+        glm::vec3(-1.0f,  1.0f, 0.0f),
+    };
+    const std::array<uint32_t, 6> wallIndices = {0, 1, 2, 0, 2, 3};
+    const glm::mat4 wallModelMatrix
+        = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f))
+        * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+
+    culler.beginFrame(projectionView);
+    culler.addOccluder(wallPositions, wallIndices, wallModelMatrix);
+    culler.rasterizeOccluders(threadPool);
+
+    // The center is covered and the corners are not
+    ASSERT(culler.getDepth(culler.getWidth() / 2, culler.getHeight() / 2) < 1.0f);
+    ASSERT(culler.getDepth(0, 0) == 1.0f);
+    ASSERT(culler.getDepth(culler.getWidth() - 1, culler.getHeight() - 1) == 1.0f);
+
+    // Behind the wall
+    ASSERT(!culler.isVisible({glm::vec3(-0.5f, -0.5f, -20.0f), glm::vec3(0.5f, 0.5f, -19.0f)}));
+    // In front of the wall
+    ASSERT(culler.isVisible({glm::vec3(-0.5f, -0.5f, -3.0f), glm::vec3(0.5f, 0.5f, -2.0f)}));
+    // Behind the wall but sticking out from its side
+    ASSERT(culler.isVisible({glm::vec3(-0.5f, -0.5f, -20.0f), glm::vec3(12.0f, 0.5f, -19.0f)}));
+    // Crossing the wall
+    ASSERT(culler.isVisible({glm::vec3(-0.5f, -0.5f, -6.0f), glm::vec3(0.5f, 0.5f, -4.0f)}));
+    // Crossing the near plane
+    ASSERT(culler.isVisible({glm::vec3(-0.5f, -0.5f, -20.0f), glm::vec3(0.5f, 0.5f, 1.0f)}));
+
+    const engine::OcclusionCuller::Stats &stats = culler.getStats();
+    INFO("{} of {} objects culled", stats.culledObjects, stats.testedObjects);
+    ASSERT(stats.occluders == 1);
+    ASSERT(stats.occluderTriangles == 2);
+    ASSERT(stats.testedObjects == 5);
+    ASSERT(stats.culledObjects == 1);
+
+    // A floor crossing the near plane gets clipped and still hides what is under it
+    const glm::mat4 floorModelMatrix
+        = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f))
+        * glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f))
+        * glm::scale(glm::mat4(1.0f), glm::vec3(50.0f));
+    culler.beginFrame(projectionView);
+    culler.addOccluder(wallPositions, wallIndices, floorModelMatrix);
+    culler.rasterizeOccluders(threadPool);
+    ASSERT(culler.getStats().occluderTriangles > 2);
+    ASSERT(!culler.isVisible({glm::vec3(-0.5f, -3.0f, -20.0f), glm::vec3(0.5f, -2.0f, -19.0f)}));
+    ASSERT(culler.isVisible({glm::vec3(-0.5f, 1.0f, -20.0f), glm::vec3(0.5f, 2.0f, -19.0f)}));
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <engine/Profiler.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    std::string name;
+    uint32_t thread;
+    double start, duration;
+};
+
+std::string getValue(const std::string &line, const std::string &key)
+{
+    const size_t start = line.find("\"" + key + "\":");
+    if (start == std::string::npos)
+        return {};
+    size_t valueStart = start + key.size() + 3;
+    if (line[valueStart] == '"')
+    {
+        // Until the closing quote that isn't escaped
+        size_t end = valueStart + 1;
+        while (line[end] != '"')
+            end += line[end] == '\\' ? 2 : 1;
+        return line.substr(valueStart + 1, end - valueStart - 1);
+    }
+    return line.substr(valueStart, line.find_first_of(",}", valueStart) - valueStart);
+}
+
+// Every event of the trace is in its own line
+std::vector<TraceEvent> readTrace(const std::string &path, std::vector<std::string> &threadNames)
+{
+    std::vector<TraceEvent> events;
+    threadNames.clear();
+    std::ifstream file(path);
+    ASSERT(file);
+    for (std::string line; std::getline(file, line);)
+    {
+        if (line.find("\"ph\":\"M\"") != std::string::npos)
+        {
+            const uint32_t thread = std::stoul(getValue(line, "tid"));
+            if (threadNames.size() <= thread)
+                threadNames.resize(thread + 1);
+            threadNames[thread] = getValue(line.substr(line.find("\"args\"")), "name");
+        }
+        else if (line.find("\"ph\":\"X\"") != std::string::npos)
+        {
+            events.push_back({
+                .name = getValue(line, "name"),
+                .thread = static_cast<uint32_t>(std::stoul(getValue(line, "tid"))),
+                .start = std::stod(getValue(line, "ts")),
+                .duration = std::stod(getValue(line, "dur")),
+            });
+        }
+    }
+    return events;
+}
+
+const TraceEvent *findEvent(const std::vector<TraceEvent> &events, const std::string &name)
+{
+    for (const TraceEvent &event : events)
+        if (event.name == name)
+            return &event;
+    return nullptr;
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    const std::string tracePath = "profiler-test-trace.json";
+    std::vector<std::string> threadNames;
+
+    // Nothing is recorded while disabled, not even the threads get a buffer
+    std::thread idleThread([]() {
+        engine::Profiler::setThreadName("Idle");
+        PROFILE_SCOPE("disabled");
+    });
+    idleThread.join();
+    {
+        PROFILE_SCOPE("disabled");
+    }
+    ASSERT(engine::Profiler::writeChromeTrace(tracePath));
+    ASSERT(!findEvent(readTrace(tracePath, threadNames), "disabled"));
+    ASSERT(threadNames.empty());
+
+    engine::Profiler::setEnabled(true);
+    engine::Profiler::setThreadName("Main");
+    {
+        PROFILE_SCOPE("outer");
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            PROFILE_SCOPE("inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // A thread that records more zones than its buffer keeps
+    const uint32_t overflowZoneCount = engine::Profiler::EVENTS_PER_THREAD + 1000;
+    std::thread overflowThread([overflowZoneCount]() {
+        engine::Profiler::setThreadName("Overflow \"thread\"");
+        for (uint32_t i = 0; i < overflowZoneCount; i++)
+        {
+            PROFILE_SCOPE("overflow");
+        }
+        PROFILE_SCOPE("last");
+    });
+    overflowThread.join();
+
+    // Threads recording while the trace is written
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop = false;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        threads.emplace_back([&stop]() {
+            while (!stop)
+            {
+                PROFILE_SCOPE("concurrent");
+            }
+        });
+    }
+    ASSERT(engine::Profiler::writeChromeTrace(tracePath));
+    stop = true;
+    for (std::thread &thread : threads)
+        thread.join();
+
+    const std::vector<TraceEvent> events = readTrace(tracePath, threadNames);
+
+    const TraceEvent *outer = findEvent(events, "outer");
+    ASSERT(outer && threadNames[outer->thread] == "Main");
+    uint32_t innerCount = 0;
+    for (const TraceEvent &event : events)
+    {
+        if (event.name != "inner")
+            continue;
+        innerCount++;
+        ASSERT(event.thread == outer->thread);
+        ASSERT(event.duration >= 1000.0); // At least the millisecond of sleep
+        ASSERT(event.start >= outer->start
+            && event.start + event.duration <= outer->start + outer->duration + 1e-3);
+    }
+    ASSERT(innerCount == 3);
+
+    const TraceEvent *last = findEvent(events, "last");
+    ASSERT(last && threadNames[last->thread] == "Overflow \\\"thread\\\"");
+    uint32_t overflowCount = 0;
+    for (const TraceEvent &event : events)
+    {
+        if (event.name == "overflow")
+        {
+            ASSERT(event.thread == last->thread);
+            overflowCount++;
+        }
+        ASSERT(event.duration >= 0.0);
+    }
+    // The ring keeps the last zones, including the one after the loop
+    ASSERT(overflowCount == engine::Profiler::EVENTS_PER_THREAD - 1);
+    INFO("{} events in the trace", events.size());
+
+    engine::Profiler::clear();
+    ASSERT(engine::Profiler::writeChromeTrace(tracePath));
+    ASSERT(readTrace(tracePath, threadNames).empty());
+
+    std::remove(tracePath.c_str());
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <engine/SpatialIndex.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool intersects(const AxisAlignedBoundingBox &a, const AxisAlignedBoundingBox &b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x
+        && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool sameIds(std::vector<uint64_t> a, std::vector<uint64_t> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    engine::SpatialIndex index(glm::vec3(0.0f), 128.0f, 8);
+
+    // Random boxes of very different sizes, some of them outside of the root cell
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> logSize(-2.0f, 5.0f);
+    auto randomBox = [&]() {
+        const glm::vec3 center(position(random), position(random), position(random));
+        const glm::vec3 extents(std::exp2(logSize(random)) * 0.5f);
+        return AxisAlignedBoundingBox{center - extents, center + extents};
+    };
+
+    std::vector<AxisAlignedBoundingBox> boxes(2000);
+    for (uint64_t id = 0; id < boxes.size(); id++)
+    {
+        boxes[id] = randomBox();
+        index.set(id, boxes[id]);
+    }
+    ASSERT(index.size() == boxes.size());
+
+    // Move some boxes and remove others
+    std::vector<bool> removed(boxes.size(), false);
+    for (uint64_t id = 0; id < boxes.size(); id += 3)
+    {
+        boxes[id] = randomBox();
+        index.set(id, boxes[id]);
+    }
+    for (uint64_t id = 1; id < boxes.size(); id += 7)
+    {
+        index.remove(id);
+        removed[id] = true;
+    }
+    for (uint64_t id = 0; id < boxes.size(); id++)
+    {
+        ASSERT(index.contains(id) == !removed[id]);
+        if (!removed[id])
+            ASSERT(index.getAABB(id).min == boxes[id].min && index.getAABB(id).max == boxes[id].max);
+    }
+
+    // Every query has to return the same as testing all the boxes
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        const AxisAlignedBoundingBox queryBox = randomBox();
+        std::vector<uint64_t> ids, expected;
+        index.queryBox(queryBox, ids);
+        for (uint64_t id = 0; id < boxes.size(); id++)
+            if (!removed[id] && intersects(boxes[id], queryBox))
+                expected.push_back(id);
+        ASSERT(sameIds(ids, expected));
+
+        const glm::vec3 center(position(random), position(random), position(random));
+        const float radius = std::exp2(logSize(random));
+        ids.clear(), expected.clear();
+        index.querySphere(center, radius, ids);
+        for (uint64_t id = 0; id < boxes.size(); id++)
+        {
+            const glm::vec3 closest = glm::max(boxes[id].min, glm::min(center, boxes[id].max));
+            if (!removed[id] && glm::dot(closest - center, closest - center) <= radius * radius)
+                expected.push_back(id);
+        }
+        ASSERT(sameIds(ids, expected));
+    }
+
+    const glm::mat4 projectionView
+        = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f)
+        * glm::lookAt(glm::vec3(10.0f, 5.0f, 0.0f), glm::vec3(50.0f, 0.0f, -20.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum(projectionView);
+    std::vector<uint64_t> ids, expected;
+    index.queryFrustum(frustum, ids);
+    for (uint64_t id = 0; id < boxes.size(); id++)
+        if (!removed[id] && frustum.intersects(boxes[id]))
+            expected.push_back(id);
+    ASSERT(sameIds(ids, expected));
+    INFO("{} of {} boxes in the frustum", ids.size(), index.size());
+
+    // The closest hit is the box that the ray enters first
+    const glm::vec3 origin(-150.0f, 3.0f, 2.0f);
+    const glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 0.02f, -0.01f));
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    const std::optional<engine::SpatialIndex::RayHit> hit = index.raycast(origin, direction);
+    float expectedDistance = INFINITY;
+    ids.clear(), expected.clear();
+    index.queryRay(origin, direction, INFINITY, ids);
+    for (uint64_t id = 0; id < boxes.size(); id++)
+    {
+        if (removed[id])
+            continue;
+        const glm::vec3 t0 = (boxes[id].min - origin) * inverseDirection;
+        const glm::vec3 t1 = (boxes[id].max - origin) * inverseDirection;
+        const glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+        const float near = std::max({tMin.x, tMin.y, tMin.z, 0.0f});
+        const float far = std::min({tMax.x, tMax.y, tMax.z});
+        if (near <= far)
+        {
+            expected.push_back(id);
+            expectedDistance = std::min(expectedDistance, near);
+        }
+    }
+    ASSERT(sameIds(ids, expected));
+    ASSERT(!expected.empty() && hit);
+    ASSERT(std::abs(hit->distance - expectedDistance) < 1e-3f);
+    // Going away from every box
+    ASSERT(!index.raycast(glm::vec3(1000.0f), glm::normalize(glm::vec3(1.0f))));
+
+    ASSERT(index.size() == static_cast<size_t>(std::count(removed.begin(), removed.end(), false)));
+    // Removing the odd ids, some of them were already removed and that does nothing
+    for (uint64_t id = 1; id < boxes.size(); id += 2)
+        index.remove(id);
+    for (uint64_t id = 0; id < boxes.size(); id++)
+        ASSERT(index.contains(id) == (!removed[id] && id % 2 == 0));
+
+    index.clear();
+    ASSERT(index.size() == 0);
+    ids.clear();
+    index.queryFrustum(frustum, ids);
+    ASSERT(ids.empty());
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <engine/Components.hpp>
+#include <engine/ThreadPool.hpp>
+#include <engine/WorldTransforms.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <flecs.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool approximatelyEqual(const glm::mat4 &a, const glm::mat4 &b)
+{
+    for (glm::length_t column = 0; column < 4; column++)
+        for (glm::length_t row = 0; row < 4; row++)
+            if (std::abs(a[column][row] - b[column][row]) > 1e-4f * std::max(1.0f, std::abs(b[column][row])))
+                return false;
+    return true;
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(-360.0f, 360.0f);
+    std::uniform_real_distribution<float> scale(0.01f, 10.0f);
+
+    // Odd count so a vectorized loop also has a remainder
+    std::vector<engine::components::Transform> transforms(1001);
+    for (engine::components::Transform &transform : transforms)
+    {
+        transform.position = {position(random), position(random), position(random)};
+        transform.rotation = {angle(random), angle(random), angle(random)};
+        transform.scale = {scale(random), scale(random), scale(random)};
+    }
+    transforms[0] = {};
+
+    std::vector<engine::components::WorldTransform> worldTransforms(transforms.size());
+    engine::computeWorldMatrices(transforms, worldTransforms);
+
+    // Has to match the matrix that Transform builds for a single entity
+    float maxError = 0.0f;
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        const glm::mat4 expected = transforms[i].getTransform();
+        const glm::mat4 &matrix = worldTransforms[i].matrix;
+        for (glm::length_t column = 0; column < 4; column++)
+        {
+            for (glm::length_t row = 0; row < 4; row++)
+            {
+                const float error = std::abs(matrix[column][row] - expected[column][row])
+                    / std::max(1.0f, std::abs(expected[column][row]));
+                maxError = std::max(maxError, error);
+            }
+        }
+    }
+    INFO("Max relative error: {}", maxError);
+    ASSERT(maxError < 1e-5f);
+
+    ASSERT(worldTransforms[0].matrix[0][0] == 1.0f && worldTransforms[0].matrix[3][3] == 1.0f);
+    ASSERT(worldTransforms[0].matrix[1][0] == 0.0f && worldTransforms[0].matrix[3][0] == 0.0f);
+
+    // Hierarchy: a vehicle with a turret with a gun, and a lot of props so the levels are split
+    // in several tasks
+    using engine::components::Transform;
+    using engine::components::WorldTransform;
+    flecs::world world;
+    world.component<Transform>("Transform")
+        .add(flecs::With, world.component<WorldTransform>("WorldTransform"));
+    engine::ThreadPool threadPool(3);
+    engine::WorldTransforms hierarchy;
+
+    flecs::entity vehicle = world.entity("Vehicle")
+        .set<Transform>({{10.0f, 0.0f, 0.0f}, {0.0f, 90.0f, 0.0f}, {2.0f, 2.0f, 2.0f}});
+    flecs::entity turret = world.entity("Turret")
+        .child_of(vehicle)
+        .set<Transform>({{0.0f, 1.0f, 0.0f}, {0.0f, 45.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+    flecs::entity gun = world.entity("Gun")
+        .child_of(turret)
+        .set<Transform>({{0.0f, 0.0f, -1.0f}, {10.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 3.0f}});
+    std::vector<flecs::entity> props;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        props.push_back(world.entity()
+            .child_of(vehicle)
+            .set<Transform>({{float(i), 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}));
+    }
+    flecs::entity unrelated = world.entity()
+        .set<Transform>({{0.0f, 5.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+
+    auto checkHierarchy = [&]() {
+        const glm::mat4 vehicleMatrix = vehicle.get<Transform>()->getTransform();
+        const glm::mat4 turretMatrix = vehicleMatrix * turret.get<Transform>()->getTransform();
+        const glm::mat4 gunMatrix = turretMatrix * gun.get<Transform>()->getTransform();
+        ASSERT(approximatelyEqual(vehicle.get<WorldTransform>()->matrix, vehicleMatrix));
+        ASSERT(approximatelyEqual(turret.get<WorldTransform>()->matrix, turretMatrix));
+        ASSERT(approximatelyEqual(gun.get<WorldTransform>()->matrix, gunMatrix));
+        for (const flecs::entity &prop : props)
+        {
+            ASSERT(approximatelyEqual(
+                prop.get<WorldTransform>()->matrix,
+                vehicleMatrix * prop.get<Transform>()->getTransform()));
+        }
+        ASSERT(approximatelyEqual(
+            unrelated.get<WorldTransform>()->matrix,
+            unrelated.get<Transform>()->getTransform()));
+    };
+
+    hierarchy.update(world, threadPool);
+    checkHierarchy();
+
+    // Moving the root moves everything under it
+    vehicle.get_mut<Transform>()->position.x = 20.0f;
+    vehicle.modified<Transform>();
+    hierarchy.update(world, threadPool);
+    checkHierarchy();
+
+    // Only the gun
+    gun.get_mut<Transform>()->rotation.x = -20.0f;
+    gun.modified<Transform>();
+    hierarchy.update(world, threadPool);
+    checkHierarchy();
+
+    // Changes that are not notified are not seen
+    turret.get_mut<Transform>()->position.y = 2.0f;
+    const glm::mat4 staleTurretMatrix = turret.get<WorldTransform>()->matrix;
+    hierarchy.update(world, threadPool);
+    ASSERT(turret.get<WorldTransform>()->matrix == staleTurretMatrix);
+    turret.modified<Transform>();
+    hierarchy.update(world, threadPool);
+    checkHierarchy();
+
+    return 0;
+}
@@ -8,11 +8,13 @@ IndexBuffer::IndexBuffer(const uint32_t *indices, uint32_t count)
     glCreateBuffers(1, &m_id);
     glBindBuffer(GL_ARRAY_BUFFER, m_id);
     glBufferData(GL_ARRAY_BUFFER, count * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_count * sizeof(uint32_t));
 }
 
 IndexBuffer::~IndexBuffer()
 {
     glDeleteBuffers(1, &m_id);
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_count * sizeof(uint32_t)));
 }
 
 void IndexBuffer::bind()
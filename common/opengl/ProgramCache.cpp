@@ -0,0 +1,166 @@
+#include "opengl/ProgramCache.hpp"
+
+#include "utils/Log.hpp"
+
+#include <GL/glew.h>
+
+#include <format>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+constexpr uint32_t FILE_MAGIC = 0x50524743; // "PRGC"
+constexpr uint32_t FILE_VERSION = 1;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+// FNV-1a
+constexpr uint64_t HASH_OFFSET = 0xcbf29ce484222325;
+
+uint64_t hashBytes(uint64_t hash, std::string_view bytes)
+{
+    for (char byte : bytes)
+    {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= 0x100000001b3;
+    }
+    // So the boundaries between the strings change the hash too
+    hash ^= bytes.size();
+    hash *= 0x100000001b3;
+    return hash;
+}
+
+std::string_view getString(GLenum name)
+{
+    const GLubyte *string = glGetString(name);
+    return string ? reinterpret_cast<const char*>(string) : "";
+}
+
+} // namespace
+
+std::filesystem::path ProgramCache::s_directory;
+uint64_t ProgramCache::s_driverHash = HASH_OFFSET;
+ProgramCache::Stats ProgramCache::s_stats;
+
+void ProgramCache::setDirectory(const std::filesystem::path &directory)
+{
+    s_directory.clear();
+    if (directory.empty())
+        return;
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0)
+    {
+        WARN("The driver doesn't support program binaries, the shader program cache is disabled");
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        WARN("Couldn't create shader program cache directory {}: {}", directory.string(), error.message());
+        return;
+    }
+
+    s_directory = directory;
+    s_driverHash = HASH_OFFSET;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        s_driverHash = hashBytes(s_driverHash, getString(name));
+}
+
+uint64_t ProgramCache::computeKey(const std::vector<std::string_view> &sources)
+{
+    uint64_t hash = s_driverHash;
+    for (std::string_view source : sources)
+        hash = hashBytes(hash, source);
+    return hash;
+}
+
+bool ProgramCache::load(uint64_t key, uint32_t program)
+{
+    if (!isEnabled())
+        return false;
+
+    std::ifstream file(getPath(key), std::ios::binary);
+    FileHeader header;
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.key != key)
+    {
+        s_stats.misses++;
+        return false;
+    }
+
+    std::vector<char> binary(header.binarySize);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        s_stats.misses++;
+        return false;
+    }
+
+    glProgramBinary(program, header.binaryFormat, binary.data(), binary.size());
+    s_stats.hits++;
+    return true;
+}
+
+void ProgramCache::store(uint64_t key, uint32_t program)
+{
+    if (!isEnabled())
+        return;
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size == 0)
+        return;
+
+    FileHeader header = {
+        .magic = FILE_MAGIC,
+        .version = FILE_VERSION,
+        .key = key,
+    };
+    std::vector<char> binary(size);
+    GLsizei length = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &length, &format, binary.data());
+    header.binaryFormat = format;
+    header.binarySize = length;
+
+    // Written to another file and renamed so other instances never read a partial file
+    const std::filesystem::path path = getPath(key);
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            WARN("Couldn't write shader program cache file {}", temporaryPath.string());
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+        WARN("Couldn't write shader program cache file {}: {}", path.string(), error.message());
+}
+
+void ProgramCache::reject(uint64_t key)
+{
+    s_stats.rejected++;
+    std::error_code error;
+    std::filesystem::remove(getPath(key), error);
+}
+
+std::filesystem::path ProgramCache::getPath(uint64_t key)
+{
+    return s_directory / std::format("{:016x}.bin", key);
+}
@@ -1,10 +1,14 @@
 #include "opengl/Shader.hpp"
 
+#include "opengl/ProgramCache.hpp"
+#include "opengl/gl.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Log.hpp"
 
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iosfwd>
 #include <vector>
@@ -30,205 +34,404 @@ std::string readFile(const std::string &path)
     return result;
 }
 
-Shader::Shader()
-    : m_id(0)
-{}
+namespace {
 
-Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, std::list<ShaderCompileTimeParameter> parameters)
+// Replaces the lines with #include "path" by the file, the path is relative to the file that
+// includes it and each file is included once. The #line directives make the errors show the
+// line in the included file, with its index in the list as the file number
+void resolveIncludes(
+    std::string &source,
+    const std::filesystem::path path, // Not a reference to includedFiles, it grows
+    std::vector<std::filesystem::path> &includedFiles)
 {
-    init(vertexPath, fragmentPath, parameters);
+    const size_t fileIndex = includedFiles.size() - 1;
+    std::string result;
+    size_t lineNumber = 1;
+    for (size_t lineStart = 0; lineStart < source.size(); lineNumber++)
+    {
+        size_t lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = source.size();
+        const std::string_view line = std::string_view(source).substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        const size_t directive = line.find_first_not_of(" \t");
+        if (directive == std::string_view::npos || !line.substr(directive).starts_with("#include"))
+        {
+            result.append(line);
+            result += '\n';
+            continue;
+        }
+
+        const size_t nameStart = line.find('"', directive);
+        const size_t nameEnd = nameStart == std::string_view::npos
+            ? std::string_view::npos
+            : line.find('"', nameStart + 1);
+        if (nameEnd == std::string_view::npos)
+        {
+            ERROR("Invalid #include in {}:{}", path.string(), lineNumber);
+            result += '\n';
+            continue;
+        }
+
+        const std::filesystem::path includePath = (path.parent_path()
+            / line.substr(nameStart + 1, nameEnd - nameStart - 1)).lexically_normal();
+        if (std::find(includedFiles.begin(), includedFiles.end(), includePath) != includedFiles.end())
+        {
+            result += '\n';
+            continue;
+        }
+
+        const size_t includeIndex = includedFiles.size();
+        includedFiles.push_back(includePath);
+        std::string includedSource = readFile(includePath.string());
+        resolveIncludes(includedSource, includePath, includedFiles);
+        result += std::format("#line 1 {}\n", includeIndex);
+        result += includedSource;
+        result += std::format("#line {} {}\n", lineNumber + 1, fileIndex);
+    }
+    source = std::move(result);
 }
 
-void Shader::init(const std::string &vertexPath, const std::string &fragmentPath, std::list<ShaderCompileTimeParameter> parameters)
+std::string loadSource(const std::string &path)
+{
+    std::string source = readFile(path);
+    std::vector<std::filesystem::path> includedFiles = {std::filesystem::path(path).lexically_normal()};
+    resolveIncludes(source, includedFiles[0], includedFiles);
+    return source;
+}
+
+// Inserted after the #version line
+void addParameters(std::string &source, const std::list<ShaderCompileTimeParameter> &parameters)
 {
-    // Read our shaders into the appropriate buffers
-    std::string vertexSource = readFile(vertexPath); // Get source code for vertex shader.
-    std::string fragmentSource = readFile(fragmentPath); // Get source code for fragment shader.
-    
-    // Set parameters (#define)
     std::string parametersAll;
     for (const ShaderCompileTimeParameter &param : parameters)
     {
         parametersAll += "#define " + param.value + "\n";
     }
-    size_t secondLinePosVertex = vertexSource.find('\n') + 1;
-    size_t secondLinePosFragment = fragmentSource.find('\n') + 1;
-    vertexSource.insert(secondLinePosVertex, parametersAll);
-    fragmentSource.insert(secondLinePosFragment, parametersAll);
-    
-    // Create an empty vertex shader handle
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    
-    // Send the vertex shader source code to GL
-    // Note that std::string's .c_str is NULL character terminated.
-    const GLchar *source = (const GLchar *)vertexSource.c_str();
-    glShaderSource(vertexShader, 1, &source, 0);
-    
-    // Compile the vertex shader
-    glCompileShader(vertexShader);
-    
-    GLint isCompiled = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &isCompiled);
-    if(isCompiled == GL_FALSE)
+    source.insert(source.find('\n') + 1, parametersAll);
+}
+
+const char *getStageName(GLenum type)
+{
+    switch (type)
     {
-    	GLint maxLength = 0;
-    	glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-    
-    	// The maxLength includes the NULL character
-    	std::vector<GLchar> infoLog(maxLength);
-    	glGetShaderInfoLog(vertexShader, maxLength, &maxLength, &infoLog[0]);
-    	
-    	// We don't need the shader anymore.
-    	glDeleteShader(vertexShader);
-    
-    	// Use the infoLog as you see fit.
-        ERROR("{}", infoLog.data());
-        ERROR("Error compiling vertex shader!: {}.", vertexPath);
-        ASSERT(false);
-    	
-    	// In this simple program, we'll just leave
-    	return;
+    case GL_VERTEX_SHADER: return "vertex";
+    case GL_FRAGMENT_SHADER: return "fragment";
+    case GL_COMPUTE_SHADER: return "compute";
+    default: return "unknown";
     }
-    
-    // Create an empty fragment shader handle
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    
-    // Send the fragment shader source code to GL
-    // Note that std::string's .c_str is NULL character terminated.
-    source = (const GLchar *)fragmentSource.c_str();
-    glShaderSource(fragmentShader, 1, &source, 0);
-    
-    // Compile the fragment shader
-    glCompileShader(fragmentShader);
-    
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
+}
+
+} // namespace
+
+Shader::Shader()
+    : m_id(0)
+{}
+
+Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, std::list<ShaderCompileTimeParameter> parameters)
+{
+    init(vertexPath, fragmentPath, parameters);
+}
+
+void Shader::init(const std::string &vertexPath, const std::string &fragmentPath, std::list<ShaderCompileTimeParameter> parameters)
+{
+    Stages stages = {
+        {GL_VERTEX_SHADER, loadSource(vertexPath)},
+        {GL_FRAGMENT_SHADER, loadSource(fragmentPath)},
+    };
+    for (auto &[type, source] : stages)
+        addParameters(source, parameters);
+
+    build(std::move(stages), vertexPath + ", " + fragmentPath);
+}
+
+Shader::Shader(const std::string &computePath, std::list<ShaderCompileTimeParameter> parameters)
+{
+    initCompute(computePath, parameters);
+}
+
+void Shader::initCompute(const std::string &computePath, std::list<ShaderCompileTimeParameter> parameters)
+{
+    Stages stages = {{GL_COMPUTE_SHADER, loadSource(computePath)}};
+    addParameters(stages[0].second, parameters);
+
+    build(std::move(stages), computePath);
+}
+
+void Shader::build(Stages stages, std::string name)
+{
+    m_stages = std::move(stages);
+    m_name = std::move(name);
+
+    std::vector<std::string_view> sources;
+    for (const auto &[type, source] : m_stages)
+        sources.push_back(source);
+    m_cacheKey = ProgramCache::computeKey(sources);
+
+    m_id = glCreateProgram();
+    m_linkPending = true;
+    m_loadedFromCache = ProgramCache::load(m_cacheKey, m_id);
+    if (!m_loadedFromCache)
+        compileAndLink();
+}
+
+void Shader::compileAndLink()
+{
+    // Nothing is queried here so the driver can compile while the other programs are created
+    for (const auto &[type, source] : m_stages)
     {
-    	GLint maxLength = 0;
-    	glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
-    
-    	// The maxLength includes the NULL character
-    	std::vector<GLchar> infoLog(maxLength);
-    	glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, &infoLog[0]);
-    	
-    	// We don't need the shader anymore.
-    	glDeleteShader(fragmentShader);
-    	// Either of them. Don't leak shaders.
-    	glDeleteShader(vertexShader);
-    
-    	// Use the infoLog as you see fit.
-        ERROR("{}", infoLog.data());
-        ERROR("Error compiling fragment shader!: {}.", fragmentPath);
-        ASSERT(false);
-    	
-    	// In this simple program, we'll just leave
-    	return;
+        GLuint shader = glCreateShader(type);
+        const GLchar *sourcePointer = source.c_str();
+        glShaderSource(shader, 1, &sourcePointer, 0);
+        glCompileShader(shader);
+        glAttachShader(m_id, shader);
+        m_shaders.push_back(shader);
     }
-    
-    // Vertex and fragment shaders are successfully compiled.
-    // Now time to link them together into a program.
-    // Get a program object.
-    m_id = glCreateProgram();
-    
-    // Attach our shaders to our program
-    glAttachShader(m_id, vertexShader);
-    glAttachShader(m_id, fragmentShader);
-    
-    // Link our program
+
+    if (ProgramCache::isEnabled())
+        glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(m_id);
-    
-    // Note the different functions here: glGetProgram* instead of glGetShader*.
+}
+
+void Shader::finishLinking()
+{
+    m_linkPending = false;
+
     GLint isLinked = 0;
-    glGetProgramiv(m_id, GL_LINK_STATUS, (int *)&isLinked);
+    glGetProgramiv(m_id, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE && m_loadedFromCache)
+    {
+        // The driver changed in a way its version doesn't show
+        WARN("Cached program binary of {} was rejected, compiling it", m_name);
+        ProgramCache::reject(m_cacheKey);
+        m_loadedFromCache = false;
+        compileAndLink();
+        glGetProgramiv(m_id, GL_LINK_STATUS, &isLinked);
+    }
+
     if (isLinked == GL_FALSE)
     {
-    	GLint maxLength = 0;
-    	glGetProgramiv(m_id, GL_INFO_LOG_LENGTH, &maxLength);
-    
-    	// The maxLength includes the NULL character
-    	std::vector<GLchar> infoLog(maxLength);
-    	glGetProgramInfoLog(m_id, maxLength, &maxLength, &infoLog[0]);
-    	
-    	// We don't need the program anymore.
-    	glDeleteProgram(m_id);
-    	// Don't leak shaders either.
-    	glDeleteShader(vertexShader);
-    	glDeleteShader(fragmentShader);
-    
-    	// Use the infoLog as you see fit.
-        ERROR("{}", infoLog.data());
-        ERROR("Error linking shader program!");
+        for (size_t i = 0; i < m_shaders.size(); i++)
+        {
+            GLint isCompiled = 0;
+            glGetShaderiv(m_shaders[i], GL_COMPILE_STATUS, &isCompiled);
+            if (isCompiled == GL_FALSE)
+            {
+                GLint maxLength = 0;
+                glGetShaderiv(m_shaders[i], GL_INFO_LOG_LENGTH, &maxLength);
+
+                // The maxLength includes the NULL character
+                std::vector<GLchar> infoLog(maxLength);
+                glGetShaderInfoLog(m_shaders[i], maxLength, &maxLength, &infoLog[0]);
+                ERROR("{}", infoLog.data());
+                ERROR("Error compiling {} shader!: {}.", getStageName(m_stages[i].first), m_name);
+            }
+        }
+
+        GLint maxLength = 0;
+        glGetProgramiv(m_id, GL_INFO_LOG_LENGTH, &maxLength);
+        if (maxLength > 0)
+        {
+            std::vector<GLchar> infoLog(maxLength);
+            glGetProgramInfoLog(m_id, maxLength, &maxLength, &infoLog[0]);
+            ERROR("{}", infoLog.data());
+        }
+        ERROR("Error linking shader program!: {}.", m_name);
         ASSERT(false);
-    	
-    	// In this simple program, we'll just leave
-    	return;
     }
-    
+    else if (!m_loadedFromCache)
+    {
+        ProgramCache::store(m_cacheKey, m_id);
+    }
+
     // Always detach shaders after a successful link.
-    glDetachShader(m_id, vertexShader);
-    glDetachShader(m_id, fragmentShader);
+    for (GLuint shader : m_shaders)
+    {
+        glDetachShader(m_id, shader);
+        glDeleteShader(shader);
+    }
+    m_shaders.clear();
+    m_stages.clear();
 }
 
+Shader *Shader::s_boundShader = nullptr;
+
 Shader::~Shader()
 {
+    for (GLuint shader : m_shaders)
+        glDeleteShader(shader);
     glDeleteProgram(m_id);
+    if (s_boundShader == this)
+        s_boundShader = nullptr;
 }
 
 void Shader::bind()
 {
+    waitUntilLinked();
     glUseProgram(m_id);
+    s_boundShader = this;
+    m_setUniformLocations.clear();
+}
+
+void Shader::waitUntilLinked()
+{
+    if (m_linkPending)
+        finishLinking();
 }
 
 void Shader::unbind()
 {
     glUseProgram(0);
+    s_boundShader = nullptr;
+}
+
+namespace {
+
+bool isSamplerType(GLenum type)
+{
+    switch (type)
+    {
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D:
+        case GL_UNSIGNED_INT_SAMPLER_2D:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+void Shader::checkBoundUniforms()
+{
+#ifdef DEBUG
+    Shader *shader = s_boundShader;
+    if (!shader)
+        return;
+
+    if (!shader->m_checkedUniformsRead)
+        shader->readCheckedUniforms();
+    for (const auto &[location, name] : shader->m_checkedUniforms)
+    {
+        ASSERT_MSG(
+            std::ranges::find(shader->m_setUniformLocations, location)
+                != shader->m_setUniformLocations.end(),
+            "Uniform {} of {} was not set after the program was bound",
+            name, shader->m_name);
+    }
+#endif
+}
+
+void Shader::readCheckedUniforms()
+{
+    m_checkedUniformsRead = true;
+
+    GLint count = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &count);
+    for (GLuint i = 0; i < static_cast<GLuint>(count); i++)
+    {
+        GLint blockIndex = -1, type = 0;
+        glGetActiveUniformsiv(m_id, 1, &i, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        glGetActiveUniformsiv(m_id, 1, &i, GL_UNIFORM_TYPE, &type);
+        if (blockIndex != -1 || isSamplerType(type))
+            continue;
+
+        char name[128];
+        glGetActiveUniformName(m_id, i, sizeof(name), nullptr, name);
+        m_checkedUniforms.emplace_back(glGetUniformLocation(m_id, name), name);
+    }
+}
+
+void Shader::markUniformSet(int32_t location)
+{
+#ifdef DEBUG
+    if (location >= 0
+        && std::ranges::find(m_setUniformLocations, location) == m_setUniformLocations.end())
+    {
+        m_setUniformLocations.push_back(location);
+    }
+#endif
 }
 
 void Shader::setUniform(const char *name, int value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform1i(location, value);
 }
 
 void Shader::setUniform(const char *name, unsigned int value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform1ui(location, value);
 }
 
 void Shader::setUniform(const char *name, const float &value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform1f(location, value);
 }
 
 void Shader::setUniform(const char *name, const glm::vec2 &value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform2f(location, value.x, value.y);
 }
 
 void Shader::setUniform(const char *name, const glm::vec3 &value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform3f(location, value.x, value.y, value.z);
 }
 
 void Shader::setUniform(const char *name, const glm::vec4 &value)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniform4f(location, value.x, value.y, value.z, value.w);
 }
 
+void Shader::setUniform(const char *name, const glm::uvec3 &value)
+{
+    GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
+    glUniform3ui(location, value.x, value.y, value.z);
+}
+
 void Shader::setUniform(const char *name, const glm::mat3 &matrix)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
 void Shader::setUniform(const char *name, const glm::mat4 &matrix)
 {
     GLint location = glGetUniformLocation(m_id, name);
+    GL::countUniformUpload();
+    markUniformSet(location);
     glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
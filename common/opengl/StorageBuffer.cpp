@@ -0,0 +1,34 @@
+#include "opengl/StorageBuffer.hpp"
+
+#include <GL/glew.h>
+
+StorageBuffer::StorageBuffer(uint32_t size)
+    : m_size(size)
+{
+    glCreateBuffers(1, &m_id);
+    glNamedBufferData(m_id, m_size, nullptr, GL_DYNAMIC_DRAW);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_size);
+}
+
+StorageBuffer::~StorageBuffer()
+{
+    glDeleteBuffers(1, &m_id);
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_size));
+}
+
+void StorageBuffer::bind(uint32_t bindingPoint) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, m_id);
+}
+
+void StorageBuffer::setData(const void *data, uint32_t size)
+{
+    if (size > m_size)
+    {
+        // Leave room so it doesnt have to grow again every time a bit more data is added
+        MemoryTracker::addGpuMemory(m_memoryTag, size + size / 2 - m_size);
+        m_size = size + size / 2;
+        glNamedBufferData(m_id, m_size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glNamedBufferSubData(m_id, 0, size, data);
+}
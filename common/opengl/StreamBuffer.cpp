@@ -0,0 +1,130 @@
+#include "opengl/StreamBuffer.hpp"
+
+#include "utils/Assert.hpp"
+#include "utils/Log.hpp"
+
+#include <GL/glew.h>
+
+#include <cstring>
+
+namespace {
+
+constexpr GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// 1 ms, the wait is repeated until the fence is signaled
+constexpr GLuint64 FENCE_WAIT_TIMEOUT = 1'000'000;
+
+} // namespace
+
+StreamBuffer::StreamBuffer(uint32_t regionSize)
+    : m_regionSize(regionSize)
+{
+    glCreateBuffers(1, &m_id);
+    glNamedBufferStorage(m_id, m_regionSize * REGION_COUNT, nullptr, MAP_FLAGS);
+    m_data = static_cast<std::byte*>(glMapNamedBufferRange(m_id, 0, m_regionSize * REGION_COUNT, MAP_FLAGS));
+    ASSERT_MSG(m_data, "Couldn't map stream buffer of {} bytes", m_regionSize * REGION_COUNT);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_regionSize * REGION_COUNT);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (void *fence : m_fences)
+        if (fence)
+            glDeleteSync(static_cast<GLsync>(fence));
+    glUnmapNamedBuffer(m_id);
+    glDeleteBuffers(1, &m_id);
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_regionSize * REGION_COUNT));
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(uint32_t size, uint32_t alignment)
+{
+    // Aligned from the start of the buffer, the regions don't need to be a multiple of it
+    const uint32_t regionStart = m_region * m_regionSize;
+    const uint32_t offset = (regionStart + m_offset + alignment - 1) / alignment * alignment;
+    if (offset + size > regionStart + m_regionSize)
+    {
+        ASSERT_MSG(false, "Stream buffer region of {} bytes is full, {} bytes more don't fit", m_regionSize, size);
+        return {};
+    }
+
+    m_offset = offset + size - regionStart;
+    return {.data = m_data + offset, .offset = offset, .size = size};
+}
+
+bool StreamBuffer::fits(uint32_t size, uint32_t alignment) const
+{
+    const uint32_t regionStart = m_region * m_regionSize;
+    const uint32_t offset = (regionStart + m_offset + alignment - 1) / alignment * alignment;
+    return offset + size <= regionStart + m_regionSize;
+}
+
+StreamBuffer::Allocation StreamBuffer::push(const void *data, uint32_t size, uint32_t alignment)
+{
+    const Allocation allocation = allocate(size, alignment);
+    if (allocation.data)
+        std::memcpy(allocation.data, data, size);
+    return allocation;
+}
+
+void StreamBuffer::nextFrame()
+{
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % REGION_COUNT;
+    m_offset = 0;
+
+    GLsync fence = static_cast<GLsync>(m_fences[m_region]);
+    if (!fence)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        m_stallCount++;
+        // The flush makes sure the fence gets to the gpu so the wait can finish
+        do
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+        while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED)
+        ERROR("Waiting for the fence of a stream buffer region failed");
+
+    glDeleteSync(fence);
+    m_fences[m_region] = nullptr;
+}
+
+void StreamBuffer::bind() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, m_id);
+}
+
+void StreamBuffer::bindUniformRange(uint32_t bindingPoint, const Allocation &allocation) const
+{
+    ASSERT(allocation.offset % getUniformAlignment() == 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_id, allocation.offset, allocation.size);
+}
+
+void StreamBuffer::bindStorageRange(uint32_t bindingPoint, const Allocation &allocation) const
+{
+    ASSERT(allocation.offset % getStorageAlignment() == 0);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingPoint, m_id, allocation.offset, allocation.size);
+}
+
+uint32_t StreamBuffer::getUniformAlignment()
+{
+    static const uint32_t alignment = []() {
+        GLint value;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        return static_cast<uint32_t>(value);
+    }();
+    return alignment;
+}
+
+uint32_t StreamBuffer::getStorageAlignment()
+{
+    static const uint32_t alignment = []() {
+        GLint value;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &value);
+        return static_cast<uint32_t>(value);
+    }();
+    return alignment;
+}
@@ -1,7 +1,9 @@
 #include "opengl/Texture.hpp"
 
+#include "opengl/gl.hpp"
 #include "utils/Assert.hpp"
 
+#include <algorithm>
 #include <array>
 #include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
@@ -22,6 +24,21 @@ GLenum formatToOpenGLFormat(Texture::Format format)
     ASSERT_MSG(false, "Invalid Texture Format!");
 }
 
+uint32_t formatBytesPerPixel(Texture::Format format)
+{
+    switch (format)
+    {
+        case Texture::Format::G8:    return 1;
+        case Texture::Format::GA8:   return 2;
+        case Texture::Format::RGB8:  return 3;
+        case Texture::Format::RGBA8: return 4;
+        case Texture::Format::RGBA16F: return 8;
+        case Texture::Format::depth24stencil8: return 4;
+        case Texture::Format::depth24: return 4;
+    }
+    ASSERT_MSG(false, "Invalid Texture Format!");
+}
+
 GLenum formatToOpenGLInternalFormat(Texture::Format format)
 {
     switch (format)
@@ -73,9 +90,13 @@ Texture::Texture(Texture &&texture)
     : m_id(texture.m_id),
       m_width(texture.m_width),
       m_height(texture.m_height),
-      m_format(texture.m_format)
+      m_format(texture.m_format),
+      m_mipmapLevels(texture.m_mipmapLevels),
+      m_memoryTag(texture.m_memoryTag),
+      m_trackedMemorySize(texture.m_trackedMemorySize)
 {
     texture.m_id = 0;
+    texture.m_trackedMemorySize = 0;
 }
 
 Texture& Texture::operator=(Texture&& source)
@@ -85,7 +106,11 @@ Texture& Texture::operator=(Texture&& source)
     m_width = source.m_width;
     m_height = source.m_height;
     m_format = source.m_format;
+    m_mipmapLevels = source.m_mipmapLevels;
+    m_memoryTag = source.m_memoryTag;
+    m_trackedMemorySize = source.m_trackedMemorySize;
     source.m_id = 0;
+    source.m_trackedMemorySize = 0;
     return *this;
 }
 
@@ -94,10 +119,12 @@ void Texture::init(const Specification &specification)
     m_format = specification.format;
     m_width = specification.width;
     m_height = specification.height;
+    m_mipmapLevels = specification.mipmapLevels;
 
     glCreateTextures(GL_TEXTURE_2D, 1, &m_id);
     glTextureStorage2D(m_id, specification.mipmapLevels, formatToOpenGLInternalFormat(m_format), m_width, m_height);
     ASSERT(glGetError() == 0);
+    trackMemory(getMemorySize());
 
     if (specification.mipmapLevels > 1)
     {
@@ -143,6 +170,17 @@ void Texture::destroy()
 {
     if (m_id != 0) glDeleteTextures(1, &m_id);
     m_id = 0;
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_trackedMemorySize));
+    m_trackedMemorySize = 0;
+}
+
+void Texture::trackMemory(uint64_t size)
+{
+    // In case it is initialized again without destroying it
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_trackedMemorySize));
+    m_memoryTag = MemoryTracker::getCurrentTag();
+    m_trackedMemorySize = size;
+    MemoryTracker::addGpuMemory(m_memoryTag, size);
 }
 
 
@@ -151,8 +189,24 @@ void Texture::destroy()
 //    glTextureSubImage2D(m_id, 0, 0, 0, m_width, m_height, formatToOpenGLFormat(m_format), GL_UNSIGNED_BYTE, data);
 //}
 
+void Texture::getData(void *data, uint32_t size) const
+{
+    ASSERT(m_format == Format::G8 || m_format == Format::GA8
+        || m_format == Format::RGB8 || m_format == Format::RGBA8);
+    glGetTextureImage(m_id, 0, formatToOpenGLFormat(m_format), GL_UNSIGNED_BYTE, size, data);
+}
+
+uint64_t Texture::getMemorySize() const
+{
+    uint64_t size = 0;
+    for (uint32_t level = 0; level < m_mipmapLevels; level++)
+        size += uint64_t(std::max(m_width >> level, 1u)) * std::max(m_height >> level, 1u);
+    return size * formatBytesPerPixel(m_format);
+}
+
 void Texture::bind(uint32_t slot) const
 {
+    GL::countTextureBind();
     glBindTextureUnit(slot, m_id);
 }
 
@@ -177,6 +231,20 @@ void Texture::setBorderColor(const glm::vec4 color)
     glTextureParameterfv(m_id, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(color));
 }
 
+void Texture::copy(
+    const Texture &from,
+    int fromX, int fromY,
+    const Texture &to,
+    int toX, int toY,
+    uint32_t width, uint32_t height)
+{
+    ASSERT(from.m_format == to.m_format);
+    glCopyImageSubData(
+        from.m_id, GL_TEXTURE_2D, 0, fromX, fromY, 0,
+        to.m_id, GL_TEXTURE_2D, 0, toX, toY, 0,
+        width, height, 1);
+}
+
 Cubemap::Cubemap(const Specification &specification)
 {
     init(specification);
@@ -187,9 +255,11 @@ void Cubemap::init(const Specification &specification)
     m_format = specification.format;
     m_width = specification.width;
     m_height = specification.height;
+    m_mipmapLevels = specification.mipmapLevels;
 
     glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_id);
     glTextureStorage2D(m_id, specification.mipmapLevels, formatToOpenGLInternalFormat(m_format), m_width, m_height);
+    trackMemory(getMemorySize());
 
     if (specification.mipmapLevels > 1)
     {
@@ -0,0 +1,55 @@
+#include "opengl/TimerQuery.hpp"
+
+#include <GL/glew.h>
+
+TimerQuery::TimerQuery()
+{
+    glCreateQueries(GL_TIMESTAMP, 1, &m_id);
+}
+
+TimerQuery::~TimerQuery()
+{
+    if (m_id)
+        glDeleteQueries(1, &m_id);
+}
+
+TimerQuery::TimerQuery(TimerQuery &&source)
+    : m_id(source.m_id)
+{
+    source.m_id = 0;
+}
+
+TimerQuery &TimerQuery::operator=(TimerQuery &&source)
+{
+    if (m_id)
+        glDeleteQueries(1, &m_id);
+    m_id = source.m_id;
+    source.m_id = 0;
+    return *this;
+}
+
+void TimerQuery::record()
+{
+    glQueryCounter(m_id, GL_TIMESTAMP);
+}
+
+bool TimerQuery::isAvailable() const
+{
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_id, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available == GL_TRUE;
+}
+
+uint64_t TimerQuery::getTimestamp() const
+{
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(m_id, GL_QUERY_RESULT, &timestamp);
+    return timestamp;
+}
+
+uint64_t TimerQuery::getCurrentTimestamp()
+{
+    GLint64 timestamp = 0;
+    glGetInteger64v(GL_TIMESTAMP, &timestamp);
+    return timestamp;
+}
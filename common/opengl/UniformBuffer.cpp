@@ -0,0 +1,30 @@
+#include "opengl/UniformBuffer.hpp"
+
+#include "utils/Assert.hpp"
+
+#include <GL/glew.h>
+
+UniformBuffer::UniformBuffer(uint32_t size)
+    : m_size(size)
+{
+    glCreateBuffers(1, &m_id);
+    glNamedBufferData(m_id, m_size, nullptr, GL_DYNAMIC_DRAW);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_size);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_id);
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_size));
+}
+
+void UniformBuffer::bind(uint32_t bindingPoint) const
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_id);
+}
+
+void UniformBuffer::setData(const void *data, uint32_t size)
+{
+    ASSERT_MSG(size <= m_size, "Uniform buffer of {} bytes can't hold {} bytes", m_size, size);
+    glNamedBufferSubData(m_id, 0, size, data);
+}
@@ -23,6 +23,14 @@ static GLenum ShaderDataTypeToOpenGLBaseType(ShaderDataType type)
         case ShaderDataType::uint2:  return GL_UNSIGNED_INT;
         case ShaderDataType::uint3:  return GL_UNSIGNED_INT;
         case ShaderDataType::uint4:  return GL_UNSIGNED_INT;
+        case ShaderDataType::half2:   return GL_HALF_FLOAT;
+        case ShaderDataType::half4:   return GL_HALF_FLOAT;
+        case ShaderDataType::short2:  return GL_SHORT;
+        case ShaderDataType::short4:  return GL_SHORT;
+        case ShaderDataType::ushort2: return GL_UNSIGNED_SHORT;
+        case ShaderDataType::ushort4: return GL_UNSIGNED_SHORT;
+        case ShaderDataType::byte4:   return GL_BYTE;
+        case ShaderDataType::ubyte4:  return GL_UNSIGNED_BYTE;
         default: break;
     }
 
@@ -55,8 +63,19 @@ void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer> &vertexBuf
 {
     glBindVertexArray(m_id);
     vertexBuffer->bind();
+    addAttributes(vertexBuffer->getLayout());
+    m_vertexBuffers.push_back(vertexBuffer);
+}
 
-    const BufferLayout &layout = vertexBuffer->getLayout();
+void VertexArray::addVertexBuffer(const StreamBuffer &streamBuffer, const BufferLayout &layout)
+{
+    glBindVertexArray(m_id);
+    streamBuffer.bind();
+    addAttributes(layout);
+}
+
+void VertexArray::addAttributes(const BufferLayout &layout)
+{
     for (const BufferElement &element : layout) // BUG: Cant iterate through layout
     {
         switch (element.type) {
@@ -64,6 +83,8 @@ void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer> &vertexBuf
         case ShaderDataType::float2:
         case ShaderDataType::float3:
         case ShaderDataType::float4:
+        case ShaderDataType::half2:
+        case ShaderDataType::half4:
             {
                 glEnableVertexAttribArray(m_vertexBufferIndex);
                 glVertexAttribPointer(m_vertexBufferIndex,
@@ -75,6 +96,34 @@ void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer> &vertexBuf
                 m_vertexBufferIndex++;
                 break;
             }
+        case ShaderDataType::short2:
+        case ShaderDataType::short4:
+        case ShaderDataType::ushort2:
+        case ShaderDataType::ushort4:
+        case ShaderDataType::byte4:
+        case ShaderDataType::ubyte4:
+            {
+                glEnableVertexAttribArray(m_vertexBufferIndex);
+                if (element.normalized)
+                {
+                    glVertexAttribPointer(m_vertexBufferIndex,
+                            element.getComponentCount(),
+                            ShaderDataTypeToOpenGLBaseType(element.type),
+                            GL_TRUE,
+                            layout.getStride(),
+                            (const void*)element.offset);
+                }
+                else
+                {
+                    glVertexAttribIPointer(m_vertexBufferIndex,
+                            element.getComponentCount(),
+                            ShaderDataTypeToOpenGLBaseType(element.type),
+                            layout.getStride(),
+                            (const void*)element.offset);
+                }
+                m_vertexBufferIndex++;
+                break;
+            }
         case ShaderDataType::int1:
         case ShaderDataType::int2:
         case ShaderDataType::int3:
@@ -116,7 +165,6 @@ void VertexArray::addVertexBuffer(const std::shared_ptr<VertexBuffer> &vertexBuf
             }
         }
     }
-    m_vertexBuffers.push_back(vertexBuffer);
 }
 
 void VertexArray::setIndexBuffer(const std::shared_ptr<IndexBuffer> &indexBuffer)
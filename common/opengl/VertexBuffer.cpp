@@ -3,22 +3,27 @@
 #include <GL/glew.h>
 
 VertexBuffer::VertexBuffer(const void *vertices, uint32_t size)
+    : m_size(size)
 {
     glCreateBuffers(1, &m_id);
     glBindBuffer(GL_ARRAY_BUFFER, m_id);
     glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_size);
 }
 
 VertexBuffer::VertexBuffer(uint32_t size)
+    : m_size(size)
 {
     glCreateBuffers(1, &m_id);
     glBindBuffer(GL_ARRAY_BUFFER, m_id);
     glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    MemoryTracker::addGpuMemory(m_memoryTag, m_size);
 }
 
 VertexBuffer::~VertexBuffer()
 {
     glDeleteBuffers(1, &m_id);
+    MemoryTracker::addGpuMemory(m_memoryTag, -static_cast<int64_t>(m_size));
 }
 
 void VertexBuffer::bind() const
@@ -31,6 +36,11 @@ void VertexBuffer::unbind() const
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void VertexBuffer::bindAsStorageBuffer(uint32_t bindingPoint) const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, m_id);
+}
+
 void VertexBuffer::setData(const void *data, uint32_t size)
 {
     glBindBuffer(GL_ARRAY_BUFFER, m_id);
@@ -1,10 +1,13 @@
 #include "opengl/gl.hpp"
+#include "opengl/Shader.hpp"
 
 #include <glm/glm.hpp>
 
 #include <GL/glew.h>
 #include <cstddef>
 
+GL::Stats GL::s_stats;
+
 void GL::init()
 {
     glEnable(GL_BLEND);
@@ -16,6 +19,13 @@ void GL::init()
     glFrontFace(GL_CCW);
 	//glEnable(GL_LINE_SMOOTH);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // if textures are not 4-byte aligned (default)
+
+    // Lets the driver compile the shaders in its own threads with as many as it wants, the
+    // Shader class doesn't wait for them until the programs are used
+    if (GLEW_KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    else if (GLEW_ARB_parallel_shader_compile)
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
 }
 
 void GL::setClearColor(const glm::vec4 &color)
@@ -29,25 +39,73 @@ void GL::clear()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-void GL::drawIndexed(const VertexArray &vertexArray, uint32_t indexCount)
+void GL::drawIndexed(
+    const VertexArray &vertexArray,
+    uint32_t indexCount,
+    uint32_t firstIndex,
+    uint32_t baseVertex)
 {
+    Shader::checkBoundUniforms();
     vertexArray.bind();
     uint32_t count = indexCount ? indexCount : vertexArray.getIndexBuffer()->getCount();
-    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
+    s_stats.drawCalls++;
+    s_stats.indices += count;
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        count,
+        GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(firstIndex * sizeof(uint32_t)),
+        baseVertex);
+}
+
+void GL::drawIndexedInstanced(
+    const VertexArray &vertexArray,
+    uint32_t instanceCount,
+    uint32_t indexCount,
+    uint32_t firstIndex)
+{
+    Shader::checkBoundUniforms();
+    vertexArray.bind();
+    uint32_t count = indexCount ? indexCount : vertexArray.getIndexBuffer()->getCount();
+    s_stats.drawCalls++;
+    s_stats.indices += uint64_t(count) * instanceCount;
+    glDrawElementsInstanced(
+        GL_TRIANGLES,
+        count,
+        GL_UNSIGNED_INT,
+        reinterpret_cast<const void*>(firstIndex * sizeof(uint32_t)),
+        instanceCount);
+}
+
+void GL::dispatchCompute(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
+{
+    Shader::checkBoundUniforms();
+    glDispatchCompute(groupsX, groupsY, groupsZ);
 }
 
-void GL::drawLines(const VertexArray &vertexArray, uint32_t indexCount)
+void GL::vertexAttributeBarrier()
 {
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+void GL::drawLines(const VertexArray &vertexArray, uint32_t indexCount, uint32_t baseVertex)
+{
+    Shader::checkBoundUniforms();
     vertexArray.bind();
     uint32_t count = indexCount ? indexCount : vertexArray.getIndexBuffer()->getCount();
-    glDrawElements(GL_LINES, count, GL_UNSIGNED_INT, nullptr);
+    s_stats.drawCalls++;
+    s_stats.indices += count;
+    glDrawElementsBaseVertex(GL_LINES, count, GL_UNSIGNED_INT, nullptr, baseVertex);
 }
 
 void GL::drawPoints(const VertexArray &vertexArray, uint32_t indexCount)
 {
+    Shader::checkBoundUniforms();
     glPointSize(6.0);
     vertexArray.bind();
     uint32_t count = indexCount ? indexCount : vertexArray.getIndexBuffer()->getCount();
+    s_stats.drawCalls++;
+    s_stats.indices += count;
     glDrawElements(GL_POINTS, count, GL_UNSIGNED_INT, nullptr);
 }
 
@@ -59,6 +117,14 @@ void GL::setDepthTest(bool value)
         glDisable(GL_DEPTH_TEST);
 }
 
+void GL::setDepthClamp(bool value)
+{
+    if (value)
+        glEnable(GL_DEPTH_CLAMP);
+    else
+        glDisable(GL_DEPTH_CLAMP);
+}
+
 void GL::setDepthTestFunction(DepthTestFunction function)
 {
     constexpr GLenum depthTestFuncToGLDepthFunc[static_cast<size_t>(DepthTestFunction::last)] = {
@@ -77,6 +143,11 @@ void GL::setBlending(bool value)
         glDisable(GL_BLEND);
 }
 
+bool GL::isBlending()
+{
+    return glIsEnabled(GL_BLEND);
+}
+
 void GL::setBlendFunction(BlendFunction src, BlendFunction dst)
 {
     constexpr GLenum blendFuncToGLBlendFunc[static_cast<size_t>(BlendFunction::last)] = {
@@ -99,6 +170,29 @@ void GL::viewport(int x, int y, unsigned int width, unsigned int height)
     glViewport(x, y, width, height);
 }
 
+void GL::viewport(uint32_t index, int x, int y, unsigned int width, unsigned int height)
+{
+    glViewportIndexedf(index, x, y, width, height);
+}
+
+bool GL::supportsViewportIndexInVertexShader()
+{
+    return GLEW_ARB_shader_viewport_layer_array || GLEW_AMD_vertex_shader_viewport_index;
+}
+
+void GL::setScissorTest(bool value)
+{
+    if (value)
+        glEnable(GL_SCISSOR_TEST);
+    else
+        glDisable(GL_SCISSOR_TEST);
+}
+
+void GL::scissor(int x, int y, unsigned int width, unsigned int height)
+{
+    glScissor(x, y, width, height);
+}
+
 void GL::setPolygonMode(PolygonMode mode)
 {
     constexpr GLenum polygonModeToGLPolygonMode[static_cast<size_t>(PolygonMode::last)] = {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utils/MemoryTracker.hpp>
+
 #include <cstdint>
 
 class IndexBuffer {
@@ -15,4 +17,5 @@ public:
 private:
     uint32_t m_id;
     uint32_t m_count;
+    MemoryTag m_memoryTag = MemoryTracker::getCurrentTag(); // Of the thread that created it
 };
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+// Stores the binaries of linked shader programs on disk so the next runs load them instead of
+// compiling the sources again. The programs are looked up by a hash of their final sources and
+// the vendor, renderer and version of the driver, so a driver update makes them compile again.
+// Disabled until a directory is set.
+class ProgramCache {
+public:
+    struct Stats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        uint32_t rejected = 0; // Loaded but the driver didn't accept them
+    };
+
+    // Has to be called with the context current. Empty disables the cache
+    static void setDirectory(const std::filesystem::path &directory);
+    static bool isEnabled() { return !s_directory.empty(); }
+
+    // Of the sources of all the stages after adding the defines
+    static uint64_t computeKey(const std::vector<std::string_view> &sources);
+
+    // Loads the binary into the program, its link status says if the driver accepted it
+    static bool load(uint64_t key, uint32_t program);
+    // The program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    static void store(uint64_t key, uint32_t program);
+    // When the binary loaded for the key wasn't accepted
+    static void reject(uint64_t key);
+
+    static const Stats &getStats() { return s_stats; }
+
+private:
+    static std::filesystem::path getPath(uint64_t key);
+
+    static std::filesystem::path s_directory;
+    static uint64_t s_driverHash;
+    static Stats s_stats;
+};
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <list>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct ShaderCompileTimeParameter {
     ShaderCompileTimeParameter(const std::string &name)
@@ -21,6 +23,9 @@ struct ShaderCompileTimeParameter {
     std::string value;
 };
 
+// The program is compiled and linked in the background when the driver supports it, its status
+// is checked and the errors reported on the first bind(). Linked programs are stored in the
+// ProgramCache when it is enabled.
 class Shader {
 public:
     Shader();
@@ -28,16 +33,31 @@ public:
         const std::string &vertexPath,
         const std::string &fragmentPath,
         std::list<ShaderCompileTimeParameter> parameters = {});
+    // Compute shader program
+    Shader(
+        const std::string &computePath,
+        std::list<ShaderCompileTimeParameter> parameters = {});
     ~Shader();
 
     void init(
         const std::string &vertexPath,
         const std::string &fragmentPath,
         std::list<ShaderCompileTimeParameter> parameters = {});
+    void initCompute(
+        const std::string &computePath,
+        std::list<ShaderCompileTimeParameter> parameters = {});
 
     void bind();
     void unbind();
 
+    // Reports the errors if it failed, bind() calls it
+    void waitUntilLinked();
+
+    // Asserts that every uniform of the bound program was set after its last bind(), except the
+    // samplers and the ones in uniform blocks. The draw and dispatch functions of GL call it, it
+    // does nothing without DEBUG
+    static void checkBoundUniforms();
+
     template<typename T, class ...Args>
     void setUniform(T value, std::format_string<Args...> fmt, Args &&...args)
     {
@@ -74,8 +94,33 @@ private:
     void setUniform(const char *name, const glm::vec2 &value);
     void setUniform(const char *name, const glm::vec3 &value);
     void setUniform(const char *name, const glm::vec4 &value);
+    void setUniform(const char *name, const glm::uvec3 &value);
     void setUniform(const char *name, const glm::mat3 &matrix);
     void setUniform(const char *name, const glm::mat4 &matrix);
 
+    void markUniformSet(int32_t location);
+    // Reads the uniforms that checkBoundUniforms() checks
+    void readCheckedUniforms();
+
+    // Stages of the program with their types and final sources
+    using Stages = std::vector<std::pair<uint32_t, std::string>>;
+
+    void build(Stages stages, std::string name);
+    void compileAndLink();
+    // Waits for the link to finish, if it failed the binary from the cache is compiled again
+    void finishLinking();
+
     uint32_t m_id;
+    bool m_linkPending = false;
+    bool m_loadedFromCache = false;
+    uint64_t m_cacheKey = 0;
+    std::string m_name; // The paths of the sources, for the errors
+    Stages m_stages; // Kept until the link finishes
+    std::vector<uint32_t> m_shaders; // Attached until the link finishes
+
+    // Only used in DEBUG builds, by checkBoundUniforms()
+    std::vector<std::pair<int32_t, std::string>> m_checkedUniforms; // Location and name
+    bool m_checkedUniformsRead = false;
+    std::vector<int32_t> m_setUniformLocations; // Since the last bind()
+    static Shader *s_boundShader;
 };
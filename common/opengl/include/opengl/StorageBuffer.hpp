@@ -0,0 +1,27 @@
+#pragma once
+
+#include <utils/MemoryTracker.hpp>
+
+#include <cstdint>
+
+// Shader storage buffer, read in the shaders from the binding point it is bound to
+class StorageBuffer {
+public:
+    StorageBuffer(uint32_t size);
+    virtual ~StorageBuffer();
+
+    StorageBuffer(const StorageBuffer&) = delete;
+    StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+    void bind(uint32_t bindingPoint) const;
+
+    // The buffer grows if the data doesnt fit
+    void setData(const void *data, uint32_t size);
+
+    uint32_t getSize() const { return m_size; }
+
+private:
+    uint32_t m_id;
+    uint32_t m_size;
+    MemoryTag m_memoryTag = MemoryTracker::getCurrentTag(); // Of the thread that created it
+};
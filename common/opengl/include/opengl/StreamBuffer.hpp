@@ -0,0 +1,68 @@
+#pragma once
+
+#include <utils/MemoryTracker.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Buffer for data written by the cpu every frame. It stays mapped, so writing to it doesn't
+// make the driver synchronize like glBufferSubData does. It is split in regions used in
+// consecutive frames, a region is written again only after the gpu finished the commands of
+// the frame that used it last, so the memory given out is valid until nextFrame().
+//
+//     StreamBuffer::Allocation allocation = streamBuffer.allocate(size, alignment);
+//     std::memcpy(allocation.data, data, size);
+//     streamBuffer.bindStorageRange(bindingPoint, allocation);
+class StreamBuffer {
+public:
+    static constexpr uint32_t REGION_COUNT = 3;
+
+    struct Allocation {
+        void *data = nullptr; // Null if it didn't fit in the region
+        uint32_t offset = 0; // From the start of the buffer
+        uint32_t size = 0;
+    };
+
+    StreamBuffer(uint32_t regionSize);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // The offset is a multiple of the alignment, which doesn't need to be a power of 2 so the
+    // offset of vertices can be a multiple of their size
+    Allocation allocate(uint32_t size, uint32_t alignment = 16);
+    // If allocate() would succeed, for the callers that can put the data somewhere else
+    bool fits(uint32_t size, uint32_t alignment = 16) const;
+    // Allocates and copies the data
+    Allocation push(const void *data, uint32_t size, uint32_t alignment = 16);
+
+    // Called after the draws that use the current region are sent, waits if the gpu is still
+    // using the next one. A frame can be any group of draws, nothing else depends on it
+    void nextFrame();
+
+    void bind() const; // As the vertex buffer
+    void bindUniformRange(uint32_t bindingPoint, const Allocation &allocation) const;
+    void bindStorageRange(uint32_t bindingPoint, const Allocation &allocation) const;
+
+    // Required alignments of the offsets of the ranges bound
+    static uint32_t getUniformAlignment();
+    static uint32_t getStorageAlignment();
+
+    uint32_t getRegionSize() const { return m_regionSize; }
+    // Bytes allocated in the current region
+    uint32_t getUsedSize() const { return m_offset; }
+    // Times nextFrame() had to wait for the gpu since the buffer was created
+    uint32_t getStallCount() const { return m_stallCount; }
+
+private:
+    uint32_t m_id;
+    uint32_t m_regionSize;
+    std::byte *m_data;
+    uint32_t m_region = 0;
+    uint32_t m_offset = 0; // In the current region
+    std::array<void*, REGION_COUNT> m_fences{}; // GLsync of the last frame that used each region
+    uint32_t m_stallCount = 0;
+    MemoryTag m_memoryTag = MemoryTracker::getCurrentTag(); // Of the thread that created it
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utils/MemoryTracker.hpp>
+
 #include <cstdint>
 #include <glm/fwd.hpp>
 #include <array>
@@ -50,8 +52,13 @@ public:
     uint32_t getWidth() const { return m_width; }
     uint32_t getHeight() const { return m_height; }
     Format getFormat() const { return m_format; }
+    // Estimate of the video memory used by every mipmap level, drivers can pad it
+    uint64_t getMemorySize() const;
 
     void setData(void *data, uint32_t size);
+    // Reads back the first mipmap level, the size is of the buffer in bytes. Only for the 8 bit
+    // color formats
+    void getData(void *data, uint32_t size) const;
 
     void bind(uint32_t slot = 0) const;
 
@@ -59,6 +66,14 @@ public:
     void setRepeat(bool value);
     void setBorderColor(const glm::vec4 color);
 
+    // Copies a rectangle of the first mipmap level between textures of the same format
+    static void copy(
+        const Texture &from,
+        int fromX, int fromY,
+        const Texture &to,
+        int toX, int toY,
+        uint32_t width, uint32_t height);
+
     // Needed for the framebuffer class. Is there a better way without exposing the id?
     uint32_t getId() const { return m_id; }
 protected:
@@ -66,6 +81,12 @@ protected:
     uint32_t m_id;
     uint32_t m_width, m_height;
     Format m_format;
+    uint32_t m_mipmapLevels = 1;
+    // Counted in the MemoryTracker when it was created
+    MemoryTag m_memoryTag = MemoryTag::untagged;
+    uint64_t m_trackedMemorySize = 0;
+
+    void trackMemory(uint64_t size);
 };
 
 class Cubemap : public Texture
@@ -86,4 +107,6 @@ public:
     Cubemap(const Specification &specification);
 
     void init(const Specification &specification);
+
+    uint64_t getMemorySize() const { return 6 * Texture::getMemorySize(); }
 };
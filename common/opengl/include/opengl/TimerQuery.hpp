@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// GPU timestamp of the moment the commands sent before record() finish. The result is ready
+// some time later, read it once isAvailable() so the cpu doesn't wait for the gpu
+class TimerQuery {
+public:
+    TimerQuery();
+    ~TimerQuery();
+
+    TimerQuery(const TimerQuery&) = delete;
+    TimerQuery& operator=(const TimerQuery&) = delete;
+
+    TimerQuery(TimerQuery &&source);
+    TimerQuery& operator=(TimerQuery &&source);
+
+    void record();
+
+    bool isAvailable() const;
+    // In nanoseconds, waits for the result if it isn't available
+    uint64_t getTimestamp() const;
+
+    // GPU time when the command is received, without waiting for the previous commands
+    static uint64_t getCurrentTimestamp();
+
+private:
+    uint32_t m_id;
+};
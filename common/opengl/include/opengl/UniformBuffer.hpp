@@ -0,0 +1,27 @@
+#pragma once
+
+#include <utils/MemoryTracker.hpp>
+
+#include <cstdint>
+
+// Uniform buffer, read in the shaders as the uniform block bound to the same binding point
+class UniformBuffer {
+public:
+    UniformBuffer(uint32_t size);
+    virtual ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    void bind(uint32_t bindingPoint) const;
+
+    // The data has to fit in the size the buffer was created with
+    void setData(const void *data, uint32_t size);
+
+    uint32_t getSize() const { return m_size; }
+
+private:
+    uint32_t m_id;
+    uint32_t m_size;
+    MemoryTag m_memoryTag = MemoryTracker::getCurrentTag(); // Of the thread that created it
+};
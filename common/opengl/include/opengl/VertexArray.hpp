@@ -1,6 +1,7 @@
 #pragma once
 
 #include "opengl/IndexBuffer.hpp"
+#include "opengl/StreamBuffer.hpp"
 #include "opengl/VertexBuffer.hpp"
 #include <memory>
 #include <vector>
@@ -14,12 +15,17 @@ public:
     void unbind() const;
 
     void addVertexBuffer(const std::shared_ptr<VertexBuffer> &vertexBuffer); // TODO: See if this can be unique ptrs
+    // The vertices are read from the start of the stream buffer, draws select them with the
+    // base vertex. The stream buffer has to outlive the vertex array
+    void addVertexBuffer(const StreamBuffer &streamBuffer, const BufferLayout &layout);
     void setIndexBuffer(const std::shared_ptr<IndexBuffer> &indexBuffer);
 
     const std::vector<std::shared_ptr<VertexBuffer>> &getVertexBuffers() const { return m_vertexBuffers; }
     const std::shared_ptr<IndexBuffer> &getIndexBuffer() const { return m_indexBuffer; }
 
 private:
+    void addAttributes(const BufferLayout &layout);
+
     uint32_t m_id;
     uint32_t m_vertexBufferIndex = 0;
     std::vector<std::shared_ptr<VertexBuffer>>  m_vertexBuffers;
@@ -2,6 +2,7 @@
 
 #include "utils/Assert.hpp"
 #include "utils/Log.hpp"
+#include "utils/MemoryTracker.hpp"
 
 #include <cstddef>
 #include <cstdint>
@@ -24,6 +25,17 @@ enum class ShaderDataType {
     uint2,
     uint3,
     uint4,
+
+    // Compact types for quantized vertex attributes. The integer ones are read as floats in the
+    // shader when the BufferElement is normalized and as integers when it is not
+    half2,
+    half4,
+    short2,
+    short4,
+    ushort2,
+    ushort4,
+    byte4,
+    ubyte4,
 };
 
 static uint32_t getSizeOfDataType(ShaderDataType type)
@@ -42,6 +54,14 @@ static uint32_t getSizeOfDataType(ShaderDataType type)
         case ShaderDataType::uint2:  return 4 * 2;
         case ShaderDataType::uint3:  return 4 * 3;
         case ShaderDataType::uint4:  return 4 * 4;
+        case ShaderDataType::half2:   return 2 * 2;
+        case ShaderDataType::half4:   return 2 * 4;
+        case ShaderDataType::short2:  return 2 * 2;
+        case ShaderDataType::short4:  return 2 * 4;
+        case ShaderDataType::ushort2: return 2 * 2;
+        case ShaderDataType::ushort4: return 2 * 4;
+        case ShaderDataType::byte4:   return 4;
+        case ShaderDataType::ubyte4:  return 4;
         default: break;
     }
 
@@ -77,6 +97,14 @@ struct BufferElement {
             case ShaderDataType::uint2:  return 2;
             case ShaderDataType::uint3:  return 3;
             case ShaderDataType::uint4:  return 4;
+            case ShaderDataType::half2:   return 2;
+            case ShaderDataType::half4:   return 4;
+            case ShaderDataType::short2:  return 2;
+            case ShaderDataType::short4:  return 4;
+            case ShaderDataType::ushort2: return 2;
+            case ShaderDataType::ushort4: return 4;
+            case ShaderDataType::byte4:   return 4;
+            case ShaderDataType::ubyte4:  return 4;
             default: break;
         }
 
@@ -130,10 +158,16 @@ public:
     void unbind() const;
 
     void setData(const void *data, uint32_t size);
+    // So compute shaders can read or write the vertices as a shader storage buffer
+    void bindAsStorageBuffer(uint32_t bindingPoint) const;
     void setLayout(const BufferLayout &layout) { m_layout = layout; }
     const BufferLayout &getLayout() const { return m_layout; }
 
+    uint32_t getSize() const { return m_size; }
+
 private:
     uint32_t m_id;
+    uint32_t m_size;
+    MemoryTag m_memoryTag = MemoryTracker::getCurrentTag(); // Of the thread that created it
     BufferLayout m_layout;
 };
@@ -29,20 +29,60 @@ public:
         last
     };
 
+    // Counted by the wrappers since the last resetStats()
+    struct Stats {
+        uint32_t drawCalls = 0;
+        uint64_t indices = 0; // Of all the instances
+        uint32_t uniformUploads = 0;
+        uint32_t textureBinds = 0;
+    };
+
     static void init();
 
     static void setClearColor(const glm::vec4 &color);
     static void clear();
-    static void drawIndexed(const VertexArray &vertexArray, uint32_t indexCount = 0);
-    static void drawLines(const VertexArray &vertexArray, uint32_t indexCount = 0);
+    // The base vertex is added to the indices, to draw vertices in a StreamBuffer
+    static void drawIndexed(
+        const VertexArray &vertexArray,
+        uint32_t indexCount = 0,
+        uint32_t firstIndex = 0,
+        uint32_t baseVertex = 0);
+    static void drawIndexedInstanced(
+        const VertexArray &vertexArray,
+        uint32_t instanceCount,
+        uint32_t indexCount = 0,
+        uint32_t firstIndex = 0);
+    static void dispatchCompute(uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1);
+    // Makes storage buffer writes of previous compute dispatches visible to vertex fetching
+    static void vertexAttributeBarrier();
+    static void drawLines(const VertexArray &vertexArray, uint32_t indexCount = 0, uint32_t baseVertex = 0);
     static void drawPoints(const VertexArray &vertexArray, uint32_t indexCount = 0);
     static void setDepthTest(bool value);
     static void setDepthTestFunction(DepthTestFunction function);
+    // Clamps the depth of the fragments in front of the near plane instead of clipping them
+    static void setDepthClamp(bool value);
     static void setBlending(bool value);
+    static bool isBlending();
     static void setBlendFunction(BlendFunction src, BlendFunction dst);
     static void viewport(unsigned int width, unsigned int height);
     static void viewport(int x, int y, unsigned int width, unsigned int height);
+    // Sets one of the viewports vertex shaders can select with gl_ViewportIndex
+    static void viewport(uint32_t index, int x, int y, unsigned int width, unsigned int height);
+    // If vertex shaders can write gl_ViewportIndex (needs an extension in OpenGL 4.5)
+    static bool supportsViewportIndexInVertexShader();
+    // Limits drawing and clearing to the rectangle while the scissor test is enabled
+    static void setScissorTest(bool value);
+    static void scissor(int x, int y, unsigned int width, unsigned int height);
 
     static void setPolygonMode(PolygonMode mode);
+
+    static const Stats &getStats() { return s_stats; }
+    static void resetStats() { s_stats = {}; }
+    // For the other wrappers
+    static void countUniformUpload() { s_stats.uniformUploads++; }
+    static void countTextureBind() { s_stats.textureBinds++; }
+
+private:
+    static Stats s_stats;
 };
 
@@ -46,10 +46,21 @@ struct AxisAlignedBoundingBox
     glm::vec3 min, max;
 };
 
+// Simplified version of a mesh that uses the same vertices
+struct MeshLod
+{
+    NAME("MeshLod")
+    FIELDS(indices, error)
+    FIELD_NAMES("indices", "error")
+    std::vector<uint32_t> indices;
+    // Distance between the simplified and the original surface relative to the size of the mesh
+    float error;
+};
+
 struct StaticMesh {
     NAME("StaticMesh")
-    FIELDS(name, id, vertices, indices, aabb)
-    FIELD_NAMES("name", "id", "vertices", "indices", "aabb")
+    FIELDS(name, id, vertices, indices, aabb, lods)
+    FIELD_NAMES("name", "id", "vertices", "indices", "aabb", "lods")
 
     struct Vertex {
         NAME("StaticMesh::Vertex")
@@ -66,6 +77,7 @@ struct StaticMesh {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     AxisAlignedBoundingBox aabb;
+    std::vector<MeshLod> lods; // Ordered from the most to the least detailed
 
     // @ glm::vec3 position
     // @ glm::vec3 normal
@@ -86,8 +98,8 @@ struct StaticMeshRef
 
 struct AnimatedMesh {
     NAME("AnimatedMesh")
-    FIELDS(name, id, vertices, indices, aabb, skeleton)
-    FIELD_NAMES("name", "id", "vertices", "indices", "aabb", "skeleton")
+    FIELDS(name, id, vertices, indices, aabb, skeleton, lods)
+    FIELD_NAMES("name", "id", "vertices", "indices", "aabb", "skeleton", "lods")
 
     struct Vertex {
         NAME("AnimatedMesh::Vertex")
@@ -107,6 +119,7 @@ struct AnimatedMesh {
     std::vector<uint32_t> indices;
     AxisAlignedBoundingBox aabb;
     Skeleton skeleton;
+    std::vector<MeshLod> lods; // Ordered from the most to the least detailed
 
     // @ glm::vec3 position
     // @ glm::vec3 normal
@@ -260,11 +273,12 @@ struct GlyphData
 
 struct Font {
     NAME("Font")
-    FIELDS(name, id, fontHeight, glyphs, atlasTextureId)
-    FIELD_NAMES("name", "id", "fontHeight", "glyphs", "atlasTextureId")
+    FIELDS(name, id, fontHeight, distanceFieldSpread, glyphs, atlasTextureId)
+    FIELD_NAMES("name", "id", "fontHeight", "distanceFieldSpread", "glyphs", "atlasTextureId")
     std::string name;
     FontId id;
     uint16_t fontHeight;
+    uint16_t distanceFieldSpread; // 0 if the atlas has the coverage of the pixels
     std::vector<GlyphData> glyphs;
     TextureId atlasTextureId;
 };
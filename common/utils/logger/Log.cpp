@@ -0,0 +1,328 @@
+#include "utils/Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct MessageHeader {
+    uint32_t size; // Of the header and the arguments, a multiple of alignof(MessageHeader)
+    LogLevel level; // LogLevel::last for the padding that skips the end of the buffer
+    int64_t time;
+    std::string_view format;
+    Logger::FormatFunction formatFunction;
+};
+
+// Only the size and the level are written for the padding, there could be no space for more
+static_assert(sizeof(uint32_t) + sizeof(LogLevel) <= alignof(MessageHeader));
+
+// Waiting time of the background thread when there is nothing to write
+constexpr std::chrono::milliseconds IDLE_WAIT(2);
+
+// Written only by its thread and read only by the one that holds the mutex of the State
+struct ThreadBuffer {
+    std::unique_ptr<std::byte[]> data = std::make_unique<std::byte[]>(Logger::BUFFER_SIZE);
+    std::atomic<uint64_t> writeIndex = 0;
+    std::atomic<uint64_t> readIndex = 0;
+    std::atomic<uint64_t> dropped = 0;
+    uint64_t pendingWriteIndex = 0; // Where the message being written ends
+};
+
+struct Message {
+    int64_t time;
+    LogLevel level;
+    std::string text;
+};
+
+int64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+class State {
+public:
+    State()
+        : m_thread([this]() { run(); })
+    {
+        std::atexit([]() { getState().stop(); });
+    }
+
+    static State &getState()
+    {
+        // Never destroyed, the messages logged by destructors of other static objects still work
+        static State *state = new State();
+        return *state;
+    }
+
+    ThreadBuffer &createThreadBuffer()
+    {
+        std::lock_guard lock(m_buffersMutex);
+        return *m_buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    }
+
+    // Doesn't wait for the mutex, the background thread could miss it and wake up on its own later
+    void wakeUp()
+    {
+        m_wakeUpRequested.store(true, std::memory_order_relaxed);
+        m_wakeUp.notify_one();
+    }
+
+    // After it messages are written by the thread that logs them
+    bool isStopped() const { return m_stopped.load(std::memory_order_acquire); }
+
+    void flush()
+    {
+        std::lock_guard lock(m_mutex);
+        writeMessages();
+    }
+
+    void setConsoleOutput(bool enabled)
+    {
+        std::lock_guard lock(m_mutex);
+        m_consoleOutput = enabled;
+    }
+
+    bool addFileOutput(const std::string &path)
+    {
+        std::ofstream file(path, std::ios::app);
+        if (!file)
+            return false;
+        std::lock_guard lock(m_mutex);
+        m_files.push_back(std::move(file));
+        return true;
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock lock(m_mutex);
+        while (!m_stopping)
+        {
+            if (!writeMessages())
+                m_wakeUp.wait_for(lock, IDLE_WAIT, [this]() {
+                    return m_stopping || m_wakeUpRequested.exchange(false, std::memory_order_relaxed);
+                });
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeUp.notify_one();
+        m_thread.join();
+        m_stopped.store(true, std::memory_order_release);
+        flush();
+    }
+
+    // Formats and writes the messages of every thread in the order they were logged, returns
+    // false if there were none. The mutex has to be locked
+    bool writeMessages()
+    {
+        {
+            std::lock_guard lock(m_buffersMutex);
+            m_buffersToRead.clear();
+            for (const std::unique_ptr<ThreadBuffer> &buffer : m_buffers)
+                m_buffersToRead.push_back(buffer.get());
+        }
+
+        size_t messageCount = 0;
+        auto addMessage = [&](int64_t time, LogLevel level) -> Message& {
+            if (messageCount == m_messages.size())
+                m_messages.emplace_back();
+            Message &message = m_messages[messageCount++];
+            message.time = time;
+            message.level = level;
+            message.text.clear();
+            return message;
+        };
+
+        for (ThreadBuffer *buffer : m_buffersToRead)
+        {
+            uint64_t readIndex = buffer->readIndex.load(std::memory_order_relaxed);
+            const uint64_t writeIndex = buffer->writeIndex.load(std::memory_order_acquire);
+            while (readIndex < writeIndex)
+            {
+                const std::byte *data = buffer->data.get() + readIndex % Logger::BUFFER_SIZE;
+                uint32_t size;
+                LogLevel level;
+                std::memcpy(&size, data, sizeof(size));
+                std::memcpy(&level, data + sizeof(size), sizeof(level));
+                if (level != LogLevel::last)
+                {
+                    MessageHeader header;
+                    std::memcpy(&header, data, sizeof(header));
+                    Message &message = addMessage(header.time, header.level);
+                    try {
+                        header.formatFunction(header.format, data + sizeof(header), message.text);
+                    } catch (const std::format_error &error) {
+                        message.text = std::format("Couldn't format \"{}\": {}", header.format, error.what());
+                    }
+                }
+                readIndex += size;
+            }
+            buffer->readIndex.store(readIndex, std::memory_order_release);
+
+            if (const uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed))
+            {
+                addMessage(now(), LogLevel::warn).text = std::format(
+                    "{} messages were dropped because the log buffer of their thread was full",
+                    dropped);
+            }
+        }
+
+        if (messageCount == 0)
+            return false;
+
+        std::stable_sort(m_messages.begin(), m_messages.begin() + messageCount,
+            [](const Message &a, const Message &b) { return a.time < b.time; });
+        for (size_t i = 0; i < messageCount; i++)
+        {
+            const Message &message = m_messages[i];
+            const std::string_view levelName = logLevelNames[static_cast<size_t>(message.level)];
+            if (m_consoleOutput)
+                std::cout << levelName << message.text << '\n';
+            for (std::ofstream &file : m_files)
+                file << levelName << message.text << '\n';
+        }
+        // Once for all the messages instead of once per line
+        if (m_consoleOutput)
+            std::cout.flush();
+        for (std::ofstream &file : m_files)
+            file.flush();
+        return true;
+    }
+
+    std::mutex m_buffersMutex;
+    // Never freed so the messages of the threads that finished are still written
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+
+    // Guards everything below it
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping = false;
+    std::atomic<bool> m_wakeUpRequested = false;
+    std::atomic<bool> m_stopped = false;
+    bool m_consoleOutput = true;
+    std::vector<std::ofstream> m_files;
+    std::vector<ThreadBuffer*> m_buffersToRead;
+    std::vector<Message> m_messages; // Reused so the strings keep their memory
+
+    std::thread m_thread; // Last so it starts after everything else is constructed
+};
+
+ThreadBuffer &getThreadBuffer()
+{
+    thread_local ThreadBuffer &buffer = State::getState().createThreadBuffer();
+    return buffer;
+}
+
+void writePadding(std::byte *data, uint32_t size)
+{
+    const LogLevel level = LogLevel::last;
+    std::memcpy(data, &size, sizeof(size));
+    std::memcpy(data + sizeof(size), &level, sizeof(level));
+}
+
+} // namespace
+
+std::atomic<LogLevel> Logger::s_level = LogLevel::info;
+
+void Logger::setLevel(LogLevel level)
+{
+    s_level.store(level, std::memory_order_relaxed);
+}
+
+void Logger::setConsoleOutput(bool enabled)
+{
+    State::getState().setConsoleOutput(enabled);
+}
+
+bool Logger::addFileOutput(const std::string &path)
+{
+    return State::getState().addFileOutput(path);
+}
+
+void Logger::flush()
+{
+    State::getState().flush();
+}
+
+std::byte *Logger::beginMessage(
+    LogLevel level,
+    std::string_view format,
+    FormatFunction formatFunction,
+    size_t argumentsSize)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    constexpr size_t alignment = alignof(MessageHeader);
+    const uint64_t size = (sizeof(MessageHeader) + argumentsSize + alignment - 1) / alignment * alignment;
+    // Bigger messages could need the whole buffer when they don't fit at the end
+    if (size > BUFFER_SIZE / 2)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint64_t writeIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+    const uint64_t offset = writeIndex % BUFFER_SIZE;
+    const uint64_t spaceAtEnd = BUFFER_SIZE - offset;
+    const uint64_t neededSize = size <= spaceAtEnd ? size : spaceAtEnd + size;
+    while (writeIndex + neededSize - buffer.readIndex.load(std::memory_order_acquire) > BUFFER_SIZE)
+    {
+        if (level != LogLevel::fatal)
+        {
+            buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        flush();
+    }
+
+    if (size > spaceAtEnd)
+    {
+        writePadding(buffer.data.get() + offset, spaceAtEnd);
+        writeIndex += spaceAtEnd;
+    }
+
+    const MessageHeader header{
+        .size = static_cast<uint32_t>(size),
+        .level = level,
+        .time = now(),
+        .format = format,
+        .formatFunction = formatFunction,
+    };
+    std::byte *data = buffer.data.get() + writeIndex % BUFFER_SIZE;
+    std::memcpy(data, &header, sizeof(header));
+    buffer.pendingWriteIndex = writeIndex + size;
+    return data + sizeof(header);
+}
+
+void Logger::endMessage(LogLevel level)
+{
+    ThreadBuffer &buffer = getThreadBuffer();
+    const uint64_t previousWriteIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+    buffer.writeIndex.store(buffer.pendingWriteIndex, std::memory_order_release);
+
+    State &state = State::getState();
+    if (level == LogLevel::fatal || state.isStopped())
+    {
+        flush();
+        return;
+    }
+
+    // Once when the buffer gets half full, without waiting for the background thread
+    const uint64_t halfFullIndex = buffer.readIndex.load(std::memory_order_relaxed) + BUFFER_SIZE / 2;
+    if (previousWriteIndex < halfFullIndex && buffer.pendingWriteIndex >= halfFullIndex)
+        state.wakeUp();
+}
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <format>
-#include <iostream>
+#include <iterator>
+#include <string>
 #include <string_view>
-#include <utility>
+#include <tuple>
+#include <type_traits>
 
 enum class LogLevel {
     fatal,
@@ -23,21 +29,190 @@ constexpr std::string_view logLevelNames[] = {
 
 static_assert(static_cast<size_t>(LogLevel::last) == sizeof(logLevelNames)/sizeof(std::string_view), "Missing name for log level");
 
+// The messages with a level above LOG_LEVEL are removed at compile time
+#define LOG_LEVEL_FATAL 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+
+#ifndef LOG_LEVEL
+    #ifdef DEBUG
+        #define LOG_LEVEL LOG_LEVEL_INFO
+    #else
+        #define LOG_LEVEL LOG_LEVEL_ERROR
+    #endif
+#endif
+
+// The messages are written with their arguments to a ring buffer of the calling thread without
+// locking, a background thread formats them and writes them to the outputs. Logging never waits
+// for the outputs, if the buffer of the thread is full the message is dropped and the number of
+// dropped messages is logged later. Fatal messages are the exception: they wait for the buffer
+// and are written before log() returns, they usually come before a crash.
+class Logger {
+public:
+    static constexpr uint32_t BUFFER_SIZE = 1 << 18; // Of each thread, in bytes
+
+    // The messages with a level above it are ignored, starts at LogLevel::info
+    static void setLevel(LogLevel level);
+    static bool isEnabled(LogLevel level)
+    {
+        return level <= s_level.load(std::memory_order_relaxed);
+    }
+
+    // Standard output, enabled at the start
+    static void setConsoleOutput(bool enabled);
+    // Appends the messages to the file, returns false if it couldn't be opened
+    static bool addFileOutput(const std::string &path);
+
+    // Writes the messages logged before the call, waiting for them
+    static void flush();
+
+    // Appends the formatted arguments to out, used by log()
+    using FormatFunction = void (*)(std::string_view format, const std::byte *arguments, std::string &out);
+
+    // Returns where the arguments have to be written, or nullptr if the message was dropped. Only
+    // the pointer of the format is stored so it has to outlive the message, like a string literal
+    static std::byte *beginMessage(
+        LogLevel level,
+        std::string_view format,
+        FormatFunction formatFunction,
+        size_t argumentsSize);
+    static void endMessage(LogLevel level);
+
+private:
+    static std::atomic<LogLevel> s_level;
+};
+
+namespace logging {
+
+// Strings are stored as their length followed by the characters
+inline std::byte *writeString(std::byte *out, std::string_view string)
+{
+    const uint32_t length = string.size();
+    std::memcpy(out, &length, sizeof(length));
+    std::memcpy(out + sizeof(length), string.data(), length);
+    return out + sizeof(length) + length;
+}
+
+inline std::string_view readString(const std::byte *&in)
+{
+    uint32_t length;
+    std::memcpy(&length, in, sizeof(length));
+    const std::string_view string(reinterpret_cast<const char*>(in + sizeof(length)), length);
+    in += sizeof(length) + length;
+    return string;
+}
+
+// How an argument is stored in the buffer and given to std::format later. Strings are copied,
+// numbers and pointers stored as they are and the other types formatted when logged
+template<typename T>
+struct Argument {
+    using Decoded = std::string_view;
+
+    static size_t size(const T &value)
+    {
+        return sizeof(uint32_t) + std::formatted_size("{}", value);
+    }
+
+    static std::byte *write(std::byte *out, const T &value)
+    {
+        const uint32_t length = std::formatted_size("{}", value);
+        std::memcpy(out, &length, sizeof(length));
+        std::format_to(reinterpret_cast<char*>(out + sizeof(length)), "{}", value);
+        return out + sizeof(length) + length;
+    }
+
+    static std::string_view read(const std::byte *&in) { return readString(in); }
+};
+
+template<typename T>
+    requires std::is_convertible_v<const T&, std::string_view>
+struct Argument<T> {
+    using Decoded = std::string_view;
+
+    static size_t size(const T &value)
+    {
+        return sizeof(uint32_t) + std::string_view(value).size();
+    }
+
+    static std::byte *write(std::byte *out, const T &value)
+    {
+        return writeString(out, value);
+    }
+
+    static std::string_view read(const std::byte *&in) { return readString(in); }
+};
+
+template<typename T>
+    requires (std::is_arithmetic_v<T> || std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+        && (!std::is_convertible_v<const T&, std::string_view>)
+struct Argument<T> {
+    using Decoded = T;
+
+    static size_t size(const T&) { return sizeof(T); }
+
+    static std::byte *write(std::byte *out, const T &value)
+    {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    static T read(const std::byte *&in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+template<typename... Args>
+void formatMessage(std::string_view format, const std::byte *arguments, std::string &out)
+{
+    // The arguments are read in order, braced initialization evaluates them left to right
+    std::tuple<typename Argument<Args>::Decoded...> values{Argument<Args>::read(arguments)...};
+    std::apply([&](auto &...values) {
+        std::vformat_to(std::back_inserter(out), format, std::make_format_args(values...));
+    }, values);
+}
+
+} // namespace logging
+
 template<typename... Args>
 void log(LogLevel level, std::format_string<Args...> fmt, Args &&...args)
 {
-    std::cout << std::format("{}", logLevelNames[static_cast<size_t>(level)]);
-    std::cout << std::format(fmt, std::forward<Args>(args)...) << std::endl;
+    if (!Logger::isEnabled(level))
+        return;
+
+    const size_t argumentsSize
+        = (size_t(0) + ... + logging::Argument<std::remove_cvref_t<Args>>::size(args));
+    std::byte *out = Logger::beginMessage(
+        level,
+        fmt.get(),
+        &logging::formatMessage<std::remove_cvref_t<Args>...>,
+        argumentsSize);
+    if (!out)
+        return;
+    ((out = logging::Argument<std::remove_cvref_t<Args>>::write(out, args)), ...);
+    Logger::endMessage(level);
 }
 
 #define FATAL(...) log(LogLevel::fatal, __VA_ARGS__)
-#define ERROR(...) log(LogLevel::error, __VA_ARGS__)
 
-#ifdef DEBUG
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+    #define ERROR(...) log(LogLevel::error, __VA_ARGS__)
+#else
+    #define ERROR(...)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
     #define WARN(...) log(LogLevel::warn, __VA_ARGS__)
-    #define INFO(...) log(LogLevel::info, __VA_ARGS__)
 #else
     #define WARN(...)
-    #define INFO(...)
 #endif
 
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    #define INFO(...) log(LogLevel::info, __VA_ARGS__)
+#else
+    #define INFO(...)
+#endif
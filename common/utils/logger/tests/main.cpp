@@ -0,0 +1,84 @@
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t THREADS = 4;
+constexpr uint32_t MESSAGES_PER_THREAD = 20000;
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    const std::string path = (std::filesystem::temp_directory_path() / "logger-test.log").string();
+    std::filesystem::remove(path);
+    ASSERT(Logger::addFileOutput(path));
+    Logger::setConsoleOutput(false);
+
+    // Enough messages for the buffers to fill up, the ones dropped have to be counted
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < THREADS; thread++)
+    {
+        threads.emplace_back([thread]() {
+            for (uint32_t i = 0; i < MESSAGES_PER_THREAD; i++)
+                INFO("thread {} message {} {}", thread, i, std::string("text") + std::to_string(i));
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    // The arguments are copied, the string is destroyed before the message is written
+    INFO("temporary {}", std::string(100, 'x'));
+
+    Logger::setLevel(LogLevel::error);
+    INFO("filtered");
+    ERROR("not filtered {}", 1.5f);
+    Logger::setLevel(LogLevel::info);
+
+    // Too big for the buffer
+    INFO("{}", std::string(Logger::BUFFER_SIZE, 'y'));
+
+    Logger::flush();
+    Logger::setConsoleOutput(true);
+
+    std::ifstream file(path);
+    ASSERT(file);
+    std::vector<int64_t> lastMessage(THREADS, -1);
+    uint64_t received = 0, dropped = 0;
+    bool temporaryFound = false, filteredFound = false, notFilteredFound = false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        uint32_t thread, message;
+        char text[32];
+        unsigned long long droppedInLine;
+        if (std::sscanf(line.c_str(), "[INFO]:  thread %u message %u %31s", &thread, &message, text) == 3)
+        {
+            // The messages of a thread are in order
+            ASSERT(thread < THREADS && message > lastMessage[thread]);
+            ASSERT(std::string(text) == "text" + std::to_string(message));
+            lastMessage[thread] = message;
+            received++;
+        }
+        else if (std::sscanf(line.c_str(), "[WARN]:  %llu messages were dropped", &droppedInLine) == 1)
+            dropped += droppedInLine;
+        else if (line == "[INFO]:  temporary " + std::string(100, 'x'))
+            temporaryFound = true;
+        else if (line == "[INFO]:  filtered")
+            filteredFound = true;
+        else if (line == "[ERROR]: not filtered 1.5")
+            notFilteredFound = true;
+    }
+    INFO("{} messages written, {} dropped", received, dropped);
+    ASSERT(received + dropped == THREADS * MESSAGES_PER_THREAD + 1);
+    ASSERT(temporaryFound && !filteredFound && notFilteredFound);
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "utils/MemoryTracker.hpp"
+
+#include <new>
+
+// Replaces the global operator new so every allocation is counted in the tag of its thread. The
+// other forms of new and delete of the standard library end up calling these
+
+void *operator new(size_t size)
+{
+    if (void *pointer = MemoryTracker::allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    if (void *pointer = MemoryTracker::allocateAligned(size, static_cast<size_t>(alignment)))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    MemoryTracker::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    MemoryTracker::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept
+{
+    MemoryTracker::free(pointer);
+}
+
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept
+{
+    MemoryTracker::free(pointer);
+}
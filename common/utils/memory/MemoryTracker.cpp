@@ -0,0 +1,167 @@
+#include "utils/MemoryTracker.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <iterator>
+
+namespace {
+
+// Before every allocation, so free() knows how much to subtract and from which tag
+struct AllocationHeader {
+    uint64_t size;
+    uint32_t offset; // From the start of the block returned by malloc
+    MemoryTag tag;
+};
+
+// Keeps the alignment of malloc()
+constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+static_assert(sizeof(AllocationHeader) <= HEADER_SIZE);
+
+// Constant initialized so the global operator new can use it at any moment
+thread_local MemoryTag currentTag = MemoryTag::untagged;
+
+AllocationHeader &getHeader(void *pointer)
+{
+    return *reinterpret_cast<AllocationHeader*>(static_cast<std::byte*>(pointer) - HEADER_SIZE);
+}
+
+std::string formatBytes(int64_t bytes, bool withSign)
+{
+    return withSign
+        ? std::format("{:+.2f} MiB", bytes / (1024.0 * 1024.0))
+        : std::format("{:.2f} MiB", bytes / (1024.0 * 1024.0));
+}
+
+} // namespace
+
+std::array<MemoryTracker::TagCounters, static_cast<size_t>(MemoryTag::last)> MemoryTracker::s_counters;
+
+MemoryTag MemoryTracker::getCurrentTag()
+{
+    return currentTag;
+}
+
+void MemoryTracker::setCurrentTag(MemoryTag tag)
+{
+    currentTag = tag;
+}
+
+bool MemoryTracker::isTrackingHeap()
+{
+#ifdef TRACK_HEAP_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void *MemoryTracker::allocate(size_t size)
+{
+    return allocateAligned(size, HEADER_SIZE);
+}
+
+void *MemoryTracker::allocateAligned(size_t size, size_t alignment)
+{
+    // The header goes right before the memory given out, bigger alignments leave a gap before it
+    const size_t offset = std::max(alignment, HEADER_SIZE);
+    std::byte *block = static_cast<std::byte*>(alignment <= HEADER_SIZE
+        ? std::malloc(size + offset)
+        : std::aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment));
+    if (!block)
+        return nullptr;
+
+    void *pointer = block + offset;
+    getHeader(pointer) = {.size = size, .offset = static_cast<uint32_t>(offset), .tag = currentTag};
+    TagCounters &counters = s_counters[static_cast<size_t>(currentTag)];
+    counters.heapBytes.fetch_add(size, std::memory_order_relaxed);
+    counters.heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.totalHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return pointer;
+}
+
+void *MemoryTracker::reallocate(void *pointer, size_t size)
+{
+    if (!pointer)
+        return allocate(size);
+
+    // Only for memory from allocate(), whose header is at the start of the block
+    const AllocationHeader header = getHeader(pointer);
+    std::byte *block = static_cast<std::byte*>(
+        std::realloc(static_cast<std::byte*>(pointer) - HEADER_SIZE, size + HEADER_SIZE));
+    if (!block)
+        return nullptr;
+
+    pointer = block + HEADER_SIZE;
+    getHeader(pointer).size = size;
+    s_counters[static_cast<size_t>(header.tag)].heapBytes.fetch_add(
+        static_cast<int64_t>(size) - static_cast<int64_t>(header.size),
+        std::memory_order_relaxed);
+    return pointer;
+}
+
+void MemoryTracker::free(void *pointer)
+{
+    if (!pointer)
+        return;
+
+    const AllocationHeader &header = getHeader(pointer);
+    TagCounters &counters = s_counters[static_cast<size_t>(header.tag)];
+    counters.heapBytes.fetch_sub(header.size, std::memory_order_relaxed);
+    counters.heapAllocations.fetch_sub(1, std::memory_order_relaxed);
+    std::free(static_cast<std::byte*>(pointer) - header.offset);
+}
+
+void MemoryTracker::addGpuMemory(MemoryTag tag, int64_t bytes)
+{
+    s_counters[static_cast<size_t>(tag)].gpuBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+MemoryTracker::Snapshot MemoryTracker::takeSnapshot()
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < snapshot.tags.size(); i++)
+    {
+        snapshot.tags[i] = {
+            .heapBytes = s_counters[i].heapBytes.load(std::memory_order_relaxed),
+            .heapAllocations = s_counters[i].heapAllocations.load(std::memory_order_relaxed),
+            .totalHeapAllocations = s_counters[i].totalHeapAllocations.load(std::memory_order_relaxed),
+            .gpuBytes = s_counters[i].gpuBytes.load(std::memory_order_relaxed),
+        };
+    }
+    return snapshot;
+}
+
+std::string MemoryTracker::formatReport(const Snapshot &snapshot)
+{
+    std::string report;
+    for (size_t i = 0; i < snapshot.tags.size(); i++)
+    {
+        const TagUsage &usage = snapshot.tags[i];
+        std::format_to(std::back_inserter(report),
+            "{:<10} heap: {} in {} allocations, gpu: {}\n",
+            memoryTagNames[i],
+            formatBytes(usage.heapBytes, false),
+            usage.heapAllocations,
+            formatBytes(usage.gpuBytes, false));
+    }
+    return report;
+}
+
+std::string MemoryTracker::formatDiff(const Snapshot &before, const Snapshot &after)
+{
+    std::string report;
+    for (size_t i = 0; i < before.tags.size(); i++)
+    {
+        const TagUsage &a = before.tags[i], &b = after.tags[i];
+        std::format_to(std::back_inserter(report),
+            "{:<10} heap: {} in {:+} allocations ({} made), gpu: {}\n",
+            memoryTagNames[i],
+            formatBytes(b.heapBytes - a.heapBytes, true),
+            b.heapAllocations - a.heapAllocations,
+            b.totalHeapAllocations - a.totalHeapAllocations,
+            formatBytes(b.gpuBytes - a.gpuBytes, true));
+    }
+    return report;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Subsystem that owns the memory, set for the thread with a MemoryTagScope
+enum class MemoryTag : uint8_t {
+    untagged,
+    assets,
+    render,
+    ecs,
+    editor,
+
+    last
+};
+
+constexpr std::string_view memoryTagNames[] = {
+    "Untagged",
+    "Assets",
+    "Render",
+    "ECS",
+    "Editor",
+};
+
+static_assert(static_cast<size_t>(MemoryTag::last) == sizeof(memoryTagNames)/sizeof(std::string_view), "Missing name for memory tag");
+
+// Memory in use by each tag. The heap is counted by the global operator new when the program is
+// built with TRACK_HEAP_ALLOCATIONS, and by allocate() and the others for libraries with their
+// own allocation functions. The gpu memory is accounted by the opengl objects when they are
+// created and destroyed.
+class MemoryTracker {
+public:
+    struct TagUsage {
+        int64_t heapBytes = 0;
+        int64_t heapAllocations = 0; // Not freed yet
+        int64_t totalHeapAllocations = 0; // Since the start
+        int64_t gpuBytes = 0;
+    };
+
+    struct Snapshot {
+        std::array<TagUsage, static_cast<size_t>(MemoryTag::last)> tags;
+
+        const TagUsage &operator[](MemoryTag tag) const { return tags[static_cast<size_t>(tag)]; }
+    };
+
+    // Of the calling thread
+    static MemoryTag getCurrentTag();
+    static void setCurrentTag(MemoryTag tag);
+
+    // True if the global operator new counts the allocations
+    static bool isTrackingHeap();
+
+    // Like malloc(), realloc() and free() but counted in the current tag, the memory has to be
+    // freed with free() of this class
+    static void *allocate(size_t size);
+    static void *reallocate(void *pointer, size_t size);
+    static void free(void *pointer);
+
+    // Used by the global operator new, the alignment can be bigger than the one of malloc()
+    static void *allocateAligned(size_t size, size_t alignment);
+
+    // Negative to release it, the same tag has to be used in both
+    static void addGpuMemory(MemoryTag tag, int64_t bytes);
+
+    static Snapshot takeSnapshot();
+    // A line per tag with its usage, or with the difference from before to after
+    static std::string formatReport(const Snapshot &snapshot);
+    static std::string formatDiff(const Snapshot &before, const Snapshot &after);
+
+private:
+    struct TagCounters {
+        std::atomic<int64_t> heapBytes = 0;
+        std::atomic<int64_t> heapAllocations = 0;
+        std::atomic<int64_t> totalHeapAllocations = 0;
+        std::atomic<int64_t> gpuBytes = 0;
+    };
+
+    static std::array<TagCounters, static_cast<size_t>(MemoryTag::last)> s_counters;
+};
+
+// Sets the tag of the thread until the end of the scope
+class MemoryTagScope {
+public:
+    MemoryTagScope(MemoryTag tag)
+        : m_previousTag(MemoryTracker::getCurrentTag())
+    {
+        MemoryTracker::setCurrentTag(tag);
+    }
+
+    ~MemoryTagScope()
+    {
+        MemoryTracker::setCurrentTag(m_previousTag);
+    }
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+private:
+    MemoryTag m_previousTag;
+};
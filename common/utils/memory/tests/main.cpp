@@ -0,0 +1,93 @@
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+#include <utils/MemoryTracker.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+int main (int argc, char *argv[]) {
+    const MemoryTracker::Snapshot before = MemoryTracker::takeSnapshot();
+
+    // The scopes nest and restore the previous tag
+    ASSERT(MemoryTracker::getCurrentTag() == MemoryTag::untagged);
+    void *assetMemory;
+    void *renderMemory;
+    {
+        MemoryTagScope assetsTag(MemoryTag::assets);
+        assetMemory = MemoryTracker::allocate(1000);
+        {
+            MemoryTagScope renderTag(MemoryTag::render);
+            renderMemory = MemoryTracker::allocate(300);
+        }
+        ASSERT(MemoryTracker::getCurrentTag() == MemoryTag::assets);
+    }
+    ASSERT(MemoryTracker::getCurrentTag() == MemoryTag::untagged);
+
+    // Each thread has its own tag
+    std::thread([]() {
+        ASSERT(MemoryTracker::getCurrentTag() == MemoryTag::untagged);
+    }).join();
+
+    MemoryTracker::Snapshot after = MemoryTracker::takeSnapshot();
+    ASSERT(after[MemoryTag::assets].heapBytes - before[MemoryTag::assets].heapBytes == 1000);
+    ASSERT(after[MemoryTag::assets].heapAllocations - before[MemoryTag::assets].heapAllocations == 1);
+    ASSERT(after[MemoryTag::render].heapBytes - before[MemoryTag::render].heapBytes == 300);
+
+    // Reallocating keeps the contents and the tag of the allocation, not the current one
+    std::memset(assetMemory, 7, 1000);
+    assetMemory = MemoryTracker::reallocate(assetMemory, 5000);
+    for (size_t i = 0; i < 1000; i++)
+        ASSERT(static_cast<uint8_t*>(assetMemory)[i] == 7);
+    after = MemoryTracker::takeSnapshot();
+    ASSERT(after[MemoryTag::assets].heapBytes - before[MemoryTag::assets].heapBytes == 5000);
+    ASSERT(after[MemoryTag::assets].heapAllocations - before[MemoryTag::assets].heapAllocations == 1);
+
+    // Bigger alignments than the one of malloc()
+    void *alignedMemory;
+    {
+        MemoryTagScope ecsTag(MemoryTag::ecs);
+        alignedMemory = MemoryTracker::allocateAligned(100, 256);
+    }
+    ASSERT(reinterpret_cast<uintptr_t>(alignedMemory) % 256 == 0);
+
+    MemoryTracker::free(assetMemory);
+    MemoryTracker::free(renderMemory);
+    MemoryTracker::free(alignedMemory);
+
+    MemoryTracker::addGpuMemory(MemoryTag::render, 4096);
+    MemoryTracker::addGpuMemory(MemoryTag::assets, 1 << 20);
+    MemoryTracker::addGpuMemory(MemoryTag::render, -1024);
+
+    after = MemoryTracker::takeSnapshot();
+    for (MemoryTag tag : {MemoryTag::assets, MemoryTag::render, MemoryTag::ecs})
+    {
+        ASSERT(after[tag].heapBytes == before[tag].heapBytes);
+        ASSERT(after[tag].heapAllocations == before[tag].heapAllocations);
+    }
+    ASSERT(after[MemoryTag::assets].totalHeapAllocations - before[MemoryTag::assets].totalHeapAllocations == 1);
+    ASSERT(after[MemoryTag::render].gpuBytes - before[MemoryTag::render].gpuBytes == 3072);
+    ASSERT(after[MemoryTag::assets].gpuBytes - before[MemoryTag::assets].gpuBytes == 1 << 20);
+
+#ifdef TRACK_HEAP_ALLOCATIONS
+    // The global operator new counts in the tag of the thread
+    {
+        const MemoryTracker::Snapshot beforeNew = MemoryTracker::takeSnapshot();
+        MemoryTagScope editorTag(MemoryTag::editor);
+        auto values = std::make_unique<uint64_t[]>(1000);
+        ASSERT(MemoryTracker::takeSnapshot()[MemoryTag::editor].heapBytes
+            - beforeNew[MemoryTag::editor].heapBytes >= 8000);
+    }
+#endif
+
+    const std::string diff = MemoryTracker::formatDiff(before, after);
+    INFO("Difference:\n{}", diff);
+    ASSERT(std::count(diff.begin(), diff.end(), '\n') == static_cast<ptrdiff_t>(MemoryTag::last));
+    ASSERT(diff.find("Assets") != std::string::npos && diff.find("(1 made)") != std::string::npos);
+    INFO("Usage:\n{}", MemoryTracker::formatReport(after));
+
+    return 0;
+}
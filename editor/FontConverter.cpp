@@ -2,108 +2,322 @@
 
 #include "ResourceFileFormats.hpp"
 
-#include <locale>
+#include <engine/ThreadPool.hpp>
 #include <utils/Log.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <codecvt>
-#include <ft2build.h>
+#include <cstring>
+#include <locale>
+#include <numeric>
+#include <span>
 #include <string>
+#include <vector>
+
+#include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
 
-constexpr unsigned int atlasWidth = 256;
-constexpr unsigned int atlasHeight = 256;
-constexpr unsigned int FONT_HEIGHT = 12;
-const std::string charSet = " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRST"
-                            "UVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~ÁÉÍÓÚáéíóúñ";
+namespace {
 
-paca::fileformats::AssetPack fontToPacaFormat(const std::string &fontPath, const std::string &outName)
-{
-    paca::fileformats::AssetPack pack;
-    pack.fonts.emplace_back();
-    pack.textures.emplace_back();
-    paca::fileformats::Font &font = pack.fonts.back();
-    paca::fileformats::Texture &fontAtlas = pack.textures.back();
+// Empty space around every glyph so the interpolation doesn't read the neighbours
+constexpr uint32_t GLYPH_PADDING = 1;
+constexpr uint32_t MIN_ATLAS_SIZE = 64;
+constexpr uint32_t MAX_ATLAS_SIZE = 8192;
+// Glyphs rasterized by each job, every job loads the font again because FreeType faces can't
+// be shared between threads
+constexpr uint32_t GLYPHS_PER_JOB = 32;
+
+struct RasterizedGlyph {
+    uint32_t codePoint;
+    bool valid = false;
+    uint32_t width = 0, height = 0;
+    std::vector<uint8_t> pixels; // Rows from the top
+    int16_t advanceX = 0, advanceY = 0; // In pixels
+    int16_t left = 0, top = 0;
+    glm::ivec2 position{0}; // In the atlas, stays 0 for the glyphs without pixels
+};
+
+// Bottom-left skyline packer: keeps the top edge of the used area as horizontal segments and
+// puts each rectangle where its top is the lowest
+class SkylinePacker {
+public:
+    SkylinePacker(uint32_t width, uint32_t height)
+        : m_width(width), m_height(height), m_skyline{{0, 0, width}}
+    {}
+
+    // False if it doesn't fit
+    bool pack(uint32_t width, uint32_t height, glm::ivec2 &position)
+    {
+        size_t bestSegment = m_skyline.size();
+        uint32_t bestTop = UINT32_MAX, bestY = 0;
+        for (size_t i = 0; i < m_skyline.size(); i++)
+        {
+            uint32_t y;
+            if (fits(i, width, height, y) && y + height < bestTop)
+            {
+                bestSegment = i;
+                bestTop = y + height;
+                bestY = y;
+            }
+        }
+        if (bestSegment == m_skyline.size())
+            return false;
+
+        position = {m_skyline[bestSegment].x, bestY};
+        addSegment(bestSegment, {m_skyline[bestSegment].x, bestY + height, width});
+        return true;
+    }
+
+private:
+    struct Segment {
+        uint32_t x, y, width;
+    };
+
+    // Height at which the rectangle rests if its left side is at the start of the segment
+    bool fits(size_t segment, uint32_t width, uint32_t height, uint32_t &y) const
+    {
+        if (m_skyline[segment].x + width > m_width)
+            return false;
+
+        y = 0;
+        for (size_t i = segment; width > 0; i++)
+        {
+            y = std::max(y, m_skyline[i].y);
+            if (y + height > m_height)
+                return false;
+            width -= std::min(width, m_skyline[i].width);
+        }
+        return true;
+    }
 
-    unsigned int fontHeight = FONT_HEIGHT;
+    void addSegment(size_t index, const Segment &segment)
+    {
+        m_skyline.insert(m_skyline.begin() + index, segment);
 
+        // The segments under the new one are removed or shortened
+        const uint32_t end = segment.x + segment.width;
+        for (size_t i = index + 1; i < m_skyline.size();)
+        {
+            if (m_skyline[i].x >= end)
+                break;
+            const uint32_t overlap = end - m_skyline[i].x;
+            if (m_skyline[i].width <= overlap)
+            {
+                m_skyline.erase(m_skyline.begin() + i);
+                continue;
+            }
+            m_skyline[i].x += overlap;
+            m_skyline[i].width -= overlap;
+            break;
+        }
+
+        for (size_t i = 0; i + 1 < m_skyline.size();)
+        {
+            if (m_skyline[i].y == m_skyline[i + 1].y)
+            {
+                m_skyline[i].width += m_skyline[i + 1].width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+            }
+            else
+                i++;
+        }
+    }
+
+    uint32_t m_width, m_height;
+    std::vector<Segment> m_skyline; // From left to right covering the whole width
+};
+
+void rasterizeGlyphs(
+    const std::string &fontPath,
+    const FontConversionOptions &options,
+    std::span<RasterizedGlyph> glyphs,
+    std::atomic<uint32_t> &lineHeight)
+{
     FT_Library ft;
     if (FT_Init_FreeType(&ft))
+    {
         ERROR("Error initializing FreeType library.");
+        return;
+    }
+
+    // Pixels around the edges encoded in the distance field
+    FT_Int spread = options.distanceFieldSpread;
+    if (spread > 0)
+    {
+        FT_Property_Set(ft, "sdf", "spread", &spread);
+        FT_Property_Set(ft, "bsdf", "spread", &spread);
+    }
 
     FT_Face face;
     if (FT_New_Face(ft, fontPath.c_str(), 0, &face))
+    {
         ERROR("Error loading font.");
-
-    if (FT_Set_Pixel_Sizes(face, 0, fontHeight))
+        FT_Done_FreeType(ft);
+        return;
+    }
+    if (FT_Set_Pixel_Sizes(face, 0, options.fontHeight))
         ERROR("Error setting font size.");
+    // The same for every job
+    lineHeight = std::max<uint32_t>(
+        options.fontHeight,
+        (face->size->metrics.ascender - face->size->metrics.descender) >> 6);
 
-    fontAtlas.name = outName;
-    fontAtlas.id = 0;
-    fontAtlas.width = atlasWidth;
-    fontAtlas.height = atlasHeight;
-    fontAtlas.channels = 1;
-    fontAtlas.pixelData.resize(atlasWidth * atlasHeight, 0);
-
-    font.name = outName;
-    font.id = 0;
-    font.fontHeight = fontHeight;
-    font.atlasTextureId = 0;
-
-    std::u32string u32charSet = std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t>().from_bytes(charSet);
-
-    int padding = 1;
-    int col = padding, row = 0;
-    for (size_t i = 0; i < u32charSet.size(); i++) {
-        FT_ULong charCode = u32charSet[i];
-        
-        FT_UInt glyphIndex = FT_Get_Char_Index(face, charCode);
+    const FT_Render_Mode renderMode = spread > 0 ? FT_RENDER_MODE_SDF : FT_RENDER_MODE_NORMAL;
+    for (RasterizedGlyph &glyph : glyphs)
+    {
+        const FT_UInt glyphIndex = FT_Get_Char_Index(face, glyph.codePoint);
         if (glyphIndex == 0)
         {
-            ERROR("Invalid char index: {}", charCode);
+            ERROR("Invalid char index: {}", glyph.codePoint);
             continue;
         }
-
         if (FT_Load_Glyph(face, glyphIndex, FT_LOAD_DEFAULT))
         {
-            ERROR("Error loading glyph: {}", charCode);
+            ERROR("Error loading glyph: {}", glyph.codePoint);
             continue;
         }
 
-        if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL))
+        glyph.valid = true;
+        glyph.advanceX = face->glyph->advance.x >> 6;
+        glyph.advanceY = face->glyph->advance.y >> 6;
+
+        // Glyphs without outline like the space only have the advance
+        if (face->glyph->format == FT_GLYPH_FORMAT_OUTLINE && face->glyph->outline.n_contours == 0)
+            continue;
+
+        if (FT_Render_Glyph(face->glyph, renderMode))
         {
-            ERROR("Error rendering glyph: {}", charCode);
+            ERROR("Error rendering glyph: {}", glyph.codePoint);
+            glyph.valid = false;
             continue;
         }
 
-        if (col + face->glyph->bitmap.width + padding >= atlasWidth) {
-            col = padding;
-            row += fontHeight + padding;
-        }
+        const FT_Bitmap &bitmap = face->glyph->bitmap;
+        glyph.width = bitmap.width;
+        glyph.height = bitmap.rows;
+        glyph.left = face->glyph->bitmap_left;
+        glyph.top = face->glyph->bitmap_top;
+        glyph.pixels.resize(glyph.width * glyph.height);
+        for (uint32_t y = 0; y < glyph.height; y++)
+            std::memcpy(&glyph.pixels[y * glyph.width], bitmap.buffer + y * bitmap.pitch, glyph.width);
+    }
 
-        if ((face->size->metrics.ascender - face->size->metrics.descender) >> 6 > fontHeight) {
-            fontHeight = (face->size->metrics.ascender - face->size->metrics.descender) >> 6;
-        }
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
+}
 
-        for (unsigned int y = 0; y < face->glyph->bitmap.rows; y++) {
-            for (unsigned int x = 0; x < face->glyph->bitmap.width; x++) {
-                char val = face->glyph->bitmap.buffer[y * face->glyph->bitmap.width + x];
-                fontAtlas.pixelData[(row + y)*atlasWidth + col+x] = val;
+// Tries atlases of increasing size until all the glyphs fit, returns false if they don't fit in
+// the biggest one
+bool packGlyphs(std::vector<RasterizedGlyph> &glyphs, uint32_t &atlasWidth, uint32_t &atlasHeight)
+{
+    // The tallest first leaves less space under the skyline
+    std::vector<uint32_t> order(glyphs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&glyphs](uint32_t a, uint32_t b) {
+        return glyphs[a].height != glyphs[b].height
+            ? glyphs[a].height > glyphs[b].height
+            : glyphs[a].width > glyphs[b].width;
+    });
+
+    atlasWidth = MIN_ATLAS_SIZE;
+    atlasHeight = MIN_ATLAS_SIZE;
+    while (atlasWidth <= MAX_ATLAS_SIZE)
+    {
+        SkylinePacker packer(atlasWidth, atlasHeight);
+        bool packed = true;
+        for (uint32_t index : order)
+        {
+            RasterizedGlyph &glyph = glyphs[index];
+            if (glyph.width == 0 || glyph.height == 0)
+                continue;
+
+            glm::ivec2 position;
+            if (!packer.pack(glyph.width + GLYPH_PADDING * 2, glyph.height + GLYPH_PADDING * 2, position))
+            {
+                packed = false;
+                break;
             }
+            glyph.position = position + glm::ivec2(GLYPH_PADDING);
         }
+        if (packed)
+            return true;
 
-        font.glyphs.emplace_back(paca::fileformats::GlyphData{
-            .characterCode = static_cast<uint32_t>(charCode),
-            .textureCoords = {col, row},
-            .size = {static_cast<uint16_t>(face->glyph->bitmap.width), static_cast<uint16_t>(face->glyph->bitmap.rows)},
-            .advance = {static_cast<int16_t>(face->glyph->advance.x), static_cast<int16_t>(face->glyph->advance.y)},
-            .offset = {static_cast<int16_t>(face->glyph->bitmap_left), static_cast<int16_t>(face->glyph->bitmap_top)}
-        });
+        if (atlasWidth == atlasHeight)
+            atlasWidth *= 2;
+        else
+            atlasHeight *= 2;
+    }
+    return false;
+}
+
+} // namespace
+
+paca::fileformats::AssetPack fontToPacaFormat(
+    const std::string &fontPath,
+    const std::string &outName,
+    const FontConversionOptions &options)
+{
+    std::vector<RasterizedGlyph> glyphs;
+    const std::u32string codePoints
+        = std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t>().from_bytes(options.charSet);
+    for (char32_t codePoint : codePoints)
+        glyphs.push_back({.codePoint = static_cast<uint32_t>(codePoint)});
+
+    // Computing the distance fields is the slow part
+    std::atomic<uint32_t> lineHeight = options.fontHeight;
+    engine::ThreadPool threadPool;
+    threadPool.parallelFor(glyphs.size(), GLYPHS_PER_JOB, [&](uint32_t begin, uint32_t end) {
+        rasterizeGlyphs(fontPath, options, std::span(glyphs).subspan(begin, end - begin), lineHeight);
+    });
+    std::erase_if(glyphs, [](const RasterizedGlyph &glyph) { return !glyph.valid; });
 
-        col += face->glyph->bitmap.width + padding;
+    paca::fileformats::AssetPack pack;
+    pack.fonts.emplace_back();
+    pack.textures.emplace_back();
+    paca::fileformats::Font &font = pack.fonts.back();
+    paca::fileformats::Texture &fontAtlas = pack.textures.back();
+
+    uint32_t atlasWidth, atlasHeight;
+    if (!packGlyphs(glyphs, atlasWidth, atlasHeight))
+    {
+        ERROR("The glyphs of {} don't fit in a {}x{} atlas", fontPath, MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+        return pack;
     }
 
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
+    fontAtlas.name = outName;
+    fontAtlas.id = 0;
+    fontAtlas.width = atlasWidth;
+    fontAtlas.height = atlasHeight;
+    fontAtlas.channels = 1;
+    fontAtlas.pixelData.resize(atlasWidth * atlasHeight, 0);
+
+    font.name = outName;
+    font.id = 0;
+    font.fontHeight = lineHeight;
+    font.distanceFieldSpread = options.distanceFieldSpread;
+    font.atlasTextureId = 0;
+
+    for (const RasterizedGlyph &glyph : glyphs)
+    {
+        for (uint32_t y = 0; y < glyph.height; y++)
+        {
+            std::memcpy(
+                &fontAtlas.pixelData[(glyph.position.y + y) * atlasWidth + glyph.position.x],
+                &glyph.pixels[y * glyph.width],
+                glyph.width);
+        }
+
+        font.glyphs.emplace_back(paca::fileformats::GlyphData{
+            .characterCode = glyph.codePoint,
+            .textureCoords = glyph.position,
+            .size = {static_cast<uint16_t>(glyph.width), static_cast<uint16_t>(glyph.height)},
+            .advance = {glyph.advanceX, glyph.advanceY},
+            .offset = {glyph.left, glyph.top},
+        });
+    }
 
+    INFO("Converted {} glyphs of {} to a {}x{} atlas", font.glyphs.size(), fontPath, atlasWidth, atlasHeight);
     return pack;
 }
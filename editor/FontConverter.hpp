@@ -2,4 +2,22 @@
 
 #include <ResourceFileFormats.hpp>
 
-paca::fileformats::AssetPack fontToPacaFormat(const std::string &path, const std::string &outName);
+#include <string>
+
+struct FontConversionOptions {
+    // Of the glyphs in the atlas. With distance fields the text looks sharp when drawn a few
+    // times bigger than this
+    uint32_t fontHeight = 32;
+    // Pixels around the edges of the glyphs that store the distance to them, 0 stores the
+    // coverage of the pixels like a normal bitmap font
+    uint32_t distanceFieldSpread = 4;
+    // In utf-8
+    std::string charSet =
+        " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRST"
+        "UVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~ÁÉÍÓÚáéíóúñ";
+};
+
+paca::fileformats::AssetPack fontToPacaFormat(
+    const std::string &path,
+    const std::string &outName,
+    const FontConversionOptions &options = {});
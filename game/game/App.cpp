@@ -7,6 +7,7 @@
 #include <engine/OrthoCamera.hpp>
 #include <engine/NewResourceManager.hpp>
 #include <opengl/gl.hpp>
+#include <opengl/ProgramCache.hpp>
 #include "game/PerspectiveCameraController.hpp"
 
 #include <SDL2/SDL.h>
@@ -43,6 +44,7 @@ void App::init(std::string title)
         engine::ForwardRenderer::Parameters::enableShadowMapping;
 
     GL::init();
+    ProgramCache::setDirectory("shader-cache");
     Input::init();
     BindingsManager::init();
     m_renderer.init(rendererParams);
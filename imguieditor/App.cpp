@@ -11,9 +11,15 @@
 #include <engine/BinarySerialization.hpp>
 #include <engine/YamlSerialization.hpp>
 #include <utils/Assert.hpp>
+#include <utils/MemoryTracker.hpp>
 #include <engine/OrthoCamera.hpp>
 #include <engine/AssetManager.hpp>
+#include <engine/FlecsMemory.hpp>
+#include <engine/FrameArena.hpp>
+#include <engine/Profiler.hpp>
+#include <engine/ShaderLibrary.hpp>
 #include <opengl/gl.hpp>
+#include <opengl/ProgramCache.hpp>
 
 #include <SDL2/SDL.h>
 #include <format>
@@ -33,6 +39,7 @@ App::App()
 
 App::~App()
 {
+    engine::ShaderLibrary::clear();
     BindingsManager::shutdown();
     SDL_Quit();
 
@@ -44,6 +51,10 @@ App::~App()
 
 void App::init(std::string title)
 {
+    // Whatever the engine doesn't tag while running in the main thread is memory of the editor
+    MemoryTracker::setCurrentTag(MemoryTag::editor);
+    engine::trackFlecsMemory();
+
     if (SDL_Init(SDL_INIT_EVERYTHING) < 0) {
         ERROR("Error initializing SDL: {}", SDL_GetError());
         ASSERT(false);
@@ -56,13 +67,21 @@ void App::init(std::string title)
 
     engine::ForwardRenderer::Flags flags =
         //engine::ForwardRenderer::Flags::enableParallaxMapping |
-        engine::ForwardRenderer::Flags::enableShadowMapping;
+        engine::ForwardRenderer::Flags::enableShadowMapping |
+        engine::ForwardRenderer::Flags::enablePreSkinning |
+        engine::ForwardRenderer::Flags::enableOcclusionCulling;
 
     GL::init();
+    ProgramCache::setDirectory("shader-cache");
+    m_assetManager.setMeshVertexFormat(Mesh::VertexFormat::packed);
     m_assetMetadataManager.init();
     Input::init();
     BindingsManager::init();
+    engine::Profiler::setThreadName("Main");
+    engine::Profiler::setEnabled(true);
     m_renderer.init(flags);
+    // The renderers only started compiling their shaders
+    engine::ShaderLibrary::prewarm();
     //Renderer2D::init();
     
     IMGUI_CHECKVERSION();
@@ -169,6 +188,12 @@ void App::run()
     });
     BindingsManager::bind(Key::q, "wireframe_toggle");
 
+    Action writeProfilerTrace;
+    writeProfilerTrace.init("write_profiler_trace", []() {
+        engine::Profiler::writeChromeTrace("trace.json");
+    });
+    BindingsManager::bind(Key::p, "write_profiler_trace");
+
     float lastFrameTime = SDL_GetTicks();
     UI ui({
         .assetManager = m_assetManager,
@@ -178,6 +203,7 @@ void App::run()
     });
 
     while (m_running) {
+        PROFILE_SCOPE("Frame");
         float time = SDL_GetTicks();
         float timeDelta = time - lastFrameTime;
         lastFrameTime = time;
@@ -207,5 +233,7 @@ void App::run()
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         m_window.swapBuffers();
+        engine::Profiler::endFrame();
+        engine::FrameArena::nextFrame();
     }
 }
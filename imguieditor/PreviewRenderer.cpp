@@ -7,18 +7,22 @@
 
 #include <engine/PerspectiveCamera.hpp>
 #include <engine/AxisAlignedBoundingBox.hpp>
+#include <engine/ShaderLibrary.hpp>
 
 void PreviewRenderer::init()
 {
-    std::list<ShaderCompileTimeParameter> staticMeshShaderParams;
-    m_staticMeshShader = std::make_shared<Shader>(
-        "assets/shaders/forwardStaticMeshVertex.glsl",
-        "assets/shaders/forwardStaticMeshFragment.glsl",
-        staticMeshShaderParams);
-
-    m_cubeLinesShader = std::make_shared<Shader>(
-        "assets/shaders/renderCubeLinesVertex.glsl",
-        "assets/shaders/renderCubeLinesFragment.glsl");
+    for (Mesh::VertexFormat format : {Mesh::VertexFormat::full, Mesh::VertexFormat::packed})
+    {
+        m_staticMeshShaders[std::to_underlying(format)] = engine::ShaderLibrary::get(
+            engine::ShaderLibrary::Program::forwardMesh,
+            format == Mesh::VertexFormat::packed
+                ? engine::ShaderFeatures::packedVertices
+                : engine::ShaderFeatures::none);
+    }
+
+    m_lightsBuffer = std::make_shared<UniformBuffer>(sizeof(engine::ForwardMeshLightsBlock));
+
+    m_cubeLinesShader = engine::ShaderLibrary::get(engine::ShaderLibrary::Program::cubeLines);
     m_cubeVertexArrayForLines = std::make_shared<VertexArray>();
     float cubeVerticesForLines[] = {
         0.0f, 0.0f, 1.0f,
@@ -197,14 +201,25 @@ void PreviewRenderer::drawPreviewToTexture(
     }
 
 
-    m_staticMeshShader->bind();
-    m_staticMeshShader->setUniform(camera.getProjectionMatrix(), "u_projectionMatrix");
-    m_staticMeshShader->setUniform(
+    // The sphere is always in the full vertex format
+    const Mesh::VertexFormat vertexFormat = mesh ? mesh->getVertexFormat() : Mesh::VertexFormat::full;
+    Shader &staticMeshShader = *m_staticMeshShaders[std::to_underlying(vertexFormat)];
+
+    // The program is shared with the ForwardRenderer, so every uniform it reads is set here and
+    // the lights are in the block of the preview
+    staticMeshShader.bind();
+    staticMeshShader.setUniform(camera.getProjectionMatrix(), "u_projectionMatrix");
+    staticMeshShader.setUniform(
         camera.getViewMatrix() * glm::translate(glm::scale(glm::mat4(1.0f), {scale, scale, scale}), -aabbCenter),
         "u_viewModelMatrix");
-    m_staticMeshShader->setUniform(
+    staticMeshShader.setUniform(
         0.05f,
         "u_parallaxScale");
+    if (vertexFormat == Mesh::VertexFormat::packed)
+    {
+        staticMeshShader.setUniform(mesh->getAABB().min, "u_positionOffset");
+        staticMeshShader.setUniform(mesh->getAABB().max - mesh->getAABB().min, "u_positionScale");
+    }
     GL::setDepthTest(true);
 
     int slot = 0;
@@ -213,10 +228,11 @@ void PreviewRenderer::drawPreviewToTexture(
         for (MaterialTextureType::Type i : {
             MaterialTextureType::diffuse,
             MaterialTextureType::specular,
-            MaterialTextureType::normal
+            MaterialTextureType::normal,
+            MaterialTextureType::height
         }) {
             // Set uniform telling the shader if a texture of the type was provided
-            m_staticMeshShader->setUniform(
+            staticMeshShader.setUniform(
                     material->getTextureIds(i).empty() ? 0 : 1,
                     "{}",
                     textureTypeToHasTextureUniformName(i));
@@ -227,7 +243,7 @@ void PreviewRenderer::drawPreviewToTexture(
                 if (texture)
                 {
                     texture->bind(slot);
-                    m_staticMeshShader->setUniform(slot, "{}{}", textureTypeToUniformName(i), indexOfTextureOfType);
+                    staticMeshShader.setUniform(slot, "{}{}", textureTypeToUniformName(i), indexOfTextureOfType);
                     slot++, indexOfTextureOfType++;
                 }
             }
@@ -239,26 +255,30 @@ void PreviewRenderer::drawPreviewToTexture(
         for (MaterialTextureType::Type i : {
             MaterialTextureType::diffuse,
             MaterialTextureType::specular,
-            MaterialTextureType::normal
+            MaterialTextureType::normal,
+            MaterialTextureType::height
         }) {
-            m_staticMeshShader->setUniform(0, "{}", textureTypeToHasTextureUniformName(i));
+            staticMeshShader.setUniform(0, "{}", textureTypeToHasTextureUniformName(i));
         }
     }
 
-    // Directional Light
+    // Directional Light, no point lights in the preview so the cluster grid is empty
+    engine::ForwardMeshLightsBlock lights {};
     glm::vec3 lightDirection = glm::normalize(glm::vec3(-2.0f, -1.0f, -0.5f));
-    m_staticMeshShader->setUniform(glm::mat3(camera.getViewMatrix()) * lightDirection, "u_directionalLights[0].directionInViewSpace");
-    m_staticMeshShader->setUniform(glm::vec3(1.0f), "u_directionalLights[0].color");
-    m_staticMeshShader->setUniform(0.5f, "u_directionalLights[0].intensity");
-    m_staticMeshShader->setUniform(1, "u_numOfDirectionalLights");
-
-    m_staticMeshShader->setUniform(0, "u_numOfPointLights");
+    lights.directionalLights[0].directionInViewSpace = glm::mat3(camera.getViewMatrix()) * lightDirection;
+    lights.directionalLights[0].color = glm::vec3(1.0f);
+    lights.directionalLights[0].intensity = 0.5f;
+    lights.numOfDirectionalLights = 1;
+    m_lightsBuffer->setData(&lights, sizeof(lights));
+    m_lightsBuffer->bind(engine::ForwardMeshLightsBlock::BINDING);
 
     if (mesh)
     {
+        // The preview always shows the full detail mesh
+        const Mesh::Lod &lod = mesh->getLods()[0];
         mesh->getVertexArray().bind();
         GL::viewport(framebuffer.getWidth(), framebuffer.getHeight());
-        GL::drawIndexed(mesh->getVertexArray());
+        GL::drawIndexed(mesh->getVertexArray(), lod.indexCount, lod.firstIndex);
     }
     else
     {
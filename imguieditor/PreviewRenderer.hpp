@@ -3,6 +3,10 @@
 #include <engine/AssetManager.hpp>
 #include <engine/assets/StaticMesh.hpp>
 #include <opengl/Shader.hpp>
+#include <opengl/UniformBuffer.hpp>
+
+#include <array>
+#include <utility>
 
 class PreviewRenderer {
 public:
@@ -14,8 +18,9 @@ public:
         const AssetManager &assetManager);
 
 private:
-    std::shared_ptr<Shader> m_staticMeshShader; // Get this from the ResourceManager
-                                                // so it isnt recreated with multiple renderers
+    // One variant for each Mesh::VertexFormat, from the ShaderLibrary
+    std::array<std::shared_ptr<Shader>, std::to_underlying(Mesh::VertexFormat::last)> m_staticMeshShaders;
+    std::shared_ptr<UniformBuffer> m_lightsBuffer; // Lights block of the programs
 
     std::shared_ptr<Shader> m_cubeLinesShader;
     std::shared_ptr<VertexArray> m_cubeVertexArrayForLines;
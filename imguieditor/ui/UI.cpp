@@ -8,8 +8,12 @@
 #include <engine/Components.hpp>
 #include <engine/PerspectiveCamera.hpp>
 #include <engine/AssetManager.hpp>
+#include <engine/Profiler.hpp>
+#include <engine/ShaderLibrary.hpp>
 #include <opengl/FrameBuffer.hpp>
+#include <opengl/ProgramCache.hpp>
 #include <opengl/gl.hpp>
+#include <utils/MemoryTracker.hpp>
 
 #include <glm/ext/quaternion_common.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -54,53 +58,318 @@ void UI::draw()
     drawCameraEntityViews();
 }
 
+namespace {
+
+float toMegabytes(uint64_t bytes)
+{
+    return bytes / (1024.0f * 1024.0f);
+}
+
+} // namespace
+
 void UI::drawStats()
 {
-    if (ImGui::Begin("Stats"))
+    constexpr float maxHistoryLength = 10.0f;
+    constexpr size_t maxSize = maxHistoryLength * 60.0f;
+
+    // The counters are of the previous frame, this is drawn before the scene views
+    PerformanceSample sample{
+        .time = m_time / 1000.0f, // from ms to seconds
+        .frameTime = m_timeDelta,
+        .glStats = GL::getStats(),
+        .rendererStats = m_renderer.getStats(),
+        .zones = engine::Profiler::getFrameZoneTotals(),
+    };
+    GL::resetStats();
+
+    if (m_performanceCapture.is_open())
+        writePerformanceCaptureRow(sample);
+
+    if (m_performanceHistory.size() < maxSize)
+    {
+        m_performanceHistory.push_back(std::move(sample));
+    }
+    else
     {
-        constexpr float maxHistoryLength = 10.0f;
-        constexpr size_t maxSize = maxHistoryLength * 60.0f;
+        m_performanceHistory[m_oldestPerformanceSample] = std::move(sample);
+        m_oldestPerformanceSample = (m_oldestPerformanceSample + 1) % maxSize;
+    }
+    const PerformanceSample &newest = m_performanceHistory[
+        (m_oldestPerformanceSample + m_performanceHistory.size() - 1) % m_performanceHistory.size()];
 
+    if (ImGui::Begin("Stats"))
+    {
         static float frametimeHistoryLength = 3.0f; // in seconds
-        static size_t newestFrametimeIndex = 0;
-        static std::vector<ImVec2> pastFrametimesPoints = []() {
-            std::vector<ImVec2> res;
-            res.reserve(maxSize);
-            return res;
-        }();
-
         ImGui::SliderFloat("Frametime history length", &frametimeHistoryLength, 0.1f,
                 maxHistoryLength);
 
+        // Samples from the oldest to the newest
+        const int sampleCount = m_performanceHistory.size();
+        auto at = [this](int index) -> const PerformanceSample & {
+            return m_performanceHistory[(m_oldestPerformanceSample + index) % m_performanceHistory.size()];
+        };
+        std::vector<float> times(sampleCount), values(sampleCount);
+        for (int i = 0; i < sampleCount; i++)
+            times[i] = at(i).time;
+        auto plotLine = [&](const char *label, auto getValue) {
+            for (int i = 0; i < sampleCount; i++)
+                values[i] = getValue(at(i));
+            ImPlot::PlotLine(label, times.data(), values.data(), sampleCount);
+        };
+        auto setupTimeAxis = [&]() {
+            ImPlot::SetupAxisLimits(ImAxis_X1, newest.time - frametimeHistoryLength, newest.time,
+                    ImGuiCond_Always);
+        };
 
-        float currentTime = m_time / 1000.0f; // from ms to seconds
+        ImGui::Text("%.2f ms (%.0f fps)", newest.frameTime, 1000.0f / std::max(newest.frameTime, 0.001f));
+        if (ImPlot::BeginPlot("##FrametimePlot", ImVec2(-1, 150)))
+        {
+            ImPlot::SetupAxes(nullptr, "Frametime (ms)", 0, 0);
+            setupTimeAxis();
+            ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0f, 40.0f);
+            plotLine("Frametime", [](const PerformanceSample &s) { return s.frameTime; });
+            ImPlot::EndPlot();
+        }
+        if (ImPlot::BeginPlot("##FrametimeHistogram", ImVec2(-1, 150)))
+        {
+            ImPlot::SetupAxes("Frametime (ms)", "Frames", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+            for (int i = 0; i < sampleCount; i++)
+                values[i] = at(i).frameTime;
+            ImPlot::PlotHistogram("Frametime", values.data(), sampleCount, ImPlotBin_Sqrt);
+            ImPlot::EndPlot();
+        }
 
-        if (pastFrametimesPoints.size() < maxSize)
+        if (ImGui::CollapsingHeader("Passes", ImGuiTreeNodeFlags_DefaultOpen))
         {
-            pastFrametimesPoints.emplace_back(currentTime, m_timeDelta);
+            if (ImGui::BeginTable("##Passes", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+            {
+                ImGui::TableSetupColumn("Zone");
+                ImGui::TableSetupColumn("CPU (ms)");
+                ImGui::TableSetupColumn("GPU (ms)");
+                ImGui::TableHeadersRow();
+                for (const engine::Profiler::ZoneTotal &zone : newest.zones)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(zone.name);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zone.cpuTime);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zone.gpuTime);
+                }
+                ImGui::EndTable();
+            }
+
+            if (ImPlot::BeginPlot("##PassesPlot", ImVec2(-1, 200)))
+            {
+                ImPlot::SetupAxes(nullptr, "Time (ms)", 0, ImPlotAxisFlags_AutoFit);
+                setupTimeAxis();
+                for (const engine::Profiler::ZoneTotal &zone : newest.zones)
+                {
+                    auto getZone = [&zone](const PerformanceSample &s) -> const engine::Profiler::ZoneTotal * {
+                        for (const engine::Profiler::ZoneTotal &sampleZone : s.zones)
+                            if (sampleZone.name == zone.name || std::strcmp(sampleZone.name, zone.name) == 0)
+                                return &sampleZone;
+                        return nullptr;
+                    };
+                    const std::string cpuLabel = std::format("{} (CPU)", zone.name);
+                    plotLine(cpuLabel.c_str(), [&](const PerformanceSample &s) {
+                        const engine::Profiler::ZoneTotal *sampleZone = getZone(s);
+                        return sampleZone ? sampleZone->cpuTime : 0.0f;
+                    });
+                    if (zone.gpuTime <= 0.0f)
+                        continue;
+                    const std::string gpuLabel = std::format("{} (GPU)", zone.name);
+                    plotLine(gpuLabel.c_str(), [&](const PerformanceSample &s) {
+                        const engine::Profiler::ZoneTotal *sampleZone = getZone(s);
+                        return sampleZone ? sampleZone->gpuTime : 0.0f;
+                    });
+                }
+                ImPlot::EndPlot();
+            }
         }
-        else
+
+        if (ImGui::CollapsingHeader("Draws", ImGuiTreeNodeFlags_DefaultOpen))
         {
-            pastFrametimesPoints[newestFrametimeIndex] = ImVec2(currentTime, m_timeDelta);
-            newestFrametimeIndex = (newestFrametimeIndex + 1) % maxSize;
+            ImGui::Text("Draw calls: %u  Triangles: %llu", newest.glStats.drawCalls,
+                    static_cast<unsigned long long>(newest.glStats.indices / 3));
+            ImGui::Text("Uniform uploads: %u  Texture binds: %u", newest.glStats.uniformUploads,
+                    newest.glStats.textureBinds);
+            const ProgramCache::Stats &programCacheStats = ProgramCache::getStats();
+            ImGui::Text("Program cache: %u loaded  %u compiled  %u rejected", programCacheStats.hits,
+                    programCacheStats.misses, programCacheStats.rejected);
+            const engine::ShaderLibrary::Stats shaderLibraryStats = engine::ShaderLibrary::getStats();
+            ImGui::Text("Shader variants: %u  Requests: %u", shaderLibraryStats.variants,
+                    shaderLibraryStats.requests);
+            if (ImPlot::BeginPlot("##DrawsPlot", ImVec2(-1, 150)))
+            {
+                ImPlot::SetupAxes(nullptr, "Count", 0, ImPlotAxisFlags_AutoFit);
+                ImPlot::SetupAxis(ImAxis_Y2, "Triangles", ImPlotAxisFlags_AuxDefault | ImPlotAxisFlags_AutoFit);
+                setupTimeAxis();
+                plotLine("Draw calls", [](const PerformanceSample &s) { return float(s.glStats.drawCalls); });
+                plotLine("Uniform uploads", [](const PerformanceSample &s) { return float(s.glStats.uniformUploads); });
+                plotLine("Texture binds", [](const PerformanceSample &s) { return float(s.glStats.textureBinds); });
+                ImPlot::SetAxes(ImAxis_X1, ImAxis_Y2);
+                plotLine("Triangles", [](const PerformanceSample &s) { return s.glStats.indices / 3.0f; });
+                ImPlot::EndPlot();
+            }
         }
 
+        if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const engine::ForwardRenderer::Stats &stats = newest.rendererStats;
+            ImGui::Text("Meshes: %u  In frustum: %u  Occluded: %u  Drawn: %u", stats.meshes,
+                    stats.inFrustum, stats.occluded, stats.inFrustum - stats.occluded);
+            if (ImPlot::BeginPlot("##CullingPlot", ImVec2(-1, 150)))
+            {
+                ImPlot::SetupAxes(nullptr, "Meshes", 0, ImPlotAxisFlags_AutoFit);
+                setupTimeAxis();
+                plotLine("Drawn", [](const PerformanceSample &s) {
+                    return float(s.rendererStats.inFrustum - s.rendererStats.occluded);
+                });
+                plotLine("Occluded", [](const PerformanceSample &s) { return float(s.rendererStats.occluded); });
+                plotLine("Outside of the frustum", [](const PerformanceSample &s) {
+                    return float(s.rendererStats.meshes - s.rendererStats.inFrustum);
+                });
+                ImPlot::EndPlot();
+            }
+        }
 
-        if (ImPlot::BeginPlot("##FrametimePlot", ImVec2(-1, 150)))
+        if (ImGui::CollapsingHeader("Asset memory"))
         {
-            ImPlot::SetupAxes(nullptr, "Frametime (ms)", 0, 0);
-            ImPlot::SetupAxisLimits(ImAxis_X1, currentTime - frametimeHistoryLength, currentTime,
-                    ImGuiCond_Always);
-            ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0f, 40.0f);
-            ImPlot::PlotLine("Frametime", &pastFrametimesPoints[0].x, &pastFrametimesPoints[0].y,
-                    pastFrametimesPoints.size(), ImPlotLineFlags_None, (int)newestFrametimeIndex,
-                    sizeof(ImVec2));
-            ImPlot::EndPlot();
+            const AssetManager::MemoryUsage memoryUsage = m_assetManager.getMemoryUsage();
+            const std::pair<const char *, uint64_t> rows[] = {
+                {"Static meshes", memoryUsage.staticMeshes},
+                {"Animated meshes", memoryUsage.animatedMeshes},
+                {"Textures", memoryUsage.textures},
+                {"Cubemaps", memoryUsage.cubemaps},
+                {"Animations", memoryUsage.animations},
+            };
+            uint64_t total = 0;
+            for (const auto &[name, bytes] : rows)
+            {
+                ImGui::Text("%-16s %8.2f MB", name, toMegabytes(bytes));
+                total += bytes;
+            }
+            ImGui::Text("%-16s %8.2f MB", "Total", toMegabytes(total));
+        }
+
+        if (ImGui::CollapsingHeader("Memory by subsystem"))
+        {
+            // The heap is only known when built with TRACK_HEAP_ALLOCATIONS
+            const bool trackingHeap = MemoryTracker::isTrackingHeap();
+            const MemoryTracker::Snapshot snapshot = MemoryTracker::takeSnapshot();
+            if (ImGui::BeginTable("##Memory", trackingHeap ? 4 : 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+            {
+                ImGui::TableSetupColumn("Tag");
+                if (trackingHeap)
+                {
+                    ImGui::TableSetupColumn("Heap (MB)");
+                    ImGui::TableSetupColumn("Allocations");
+                }
+                ImGui::TableSetupColumn("GPU (MB)");
+                ImGui::TableHeadersRow();
+                for (size_t i = 0; i < snapshot.tags.size(); i++)
+                {
+                    const MemoryTracker::TagUsage &usage = snapshot.tags[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(memoryTagNames[i].data());
+                    if (trackingHeap)
+                    {
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.2f", toMegabytes(usage.heapBytes));
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%lld", static_cast<long long>(usage.heapAllocations));
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", toMegabytes(usage.gpuBytes));
+                }
+                ImGui::EndTable();
+            }
+
+            if (ImGui::Button("Take snapshot"))
+                m_memorySnapshot = snapshot;
+            ImGui::SameLine();
+            if (ImGui::Button("Log report"))
+                INFO("Memory by subsystem:\n{}", MemoryTracker::formatReport(snapshot));
+            if (m_memorySnapshot)
+            {
+                ImGui::SameLine();
+                if (ImGui::Button("Clear snapshot"))
+                    m_memorySnapshot.reset();
+            }
+            if (m_memorySnapshot)
+            {
+                ImGui::TextUnformatted("Since the snapshot:");
+                ImGui::TextUnformatted(MemoryTracker::formatDiff(*m_memorySnapshot, snapshot).c_str());
+            }
+        }
+
+        static char capturePath[256] = "performance.csv";
+        ImGui::InputText("##CapturePath", capturePath, sizeof(capturePath));
+        ImGui::SameLine();
+        if (!m_performanceCapture.is_open())
+        {
+            if (ImGui::Button("Start capture"))
+                startPerformanceCapture(capturePath, newest);
+        }
+        else if (ImGui::Button("Stop capture"))
+        {
+            m_performanceCapture.close();
+            INFO("Saved performance capture to {}", capturePath);
         }
     }
     ImGui::End();
 }
 
+void UI::startPerformanceCapture(const char *path, const PerformanceSample &sample)
+{
+    m_performanceCapture.open(path);
+    if (!m_performanceCapture)
+    {
+        ERROR("Couldn't open {} to save the performance capture", path);
+        return;
+    }
+
+    // The zones are the ones of the frame when the capture starts
+    m_performanceCaptureZones.clear();
+    m_performanceCapture << "time_s,frame_ms,draw_calls,triangles,uniform_uploads,texture_binds,"
+        "meshes,in_frustum,occluded";
+    for (const engine::Profiler::ZoneTotal &zone : sample.zones)
+    {
+        m_performanceCaptureZones.push_back(zone.name);
+        m_performanceCapture << ",\"" << zone.name << " cpu_ms\",\"" << zone.name << " gpu_ms\"";
+    }
+    m_performanceCapture << '\n';
+}
+
+void UI::writePerformanceCaptureRow(const PerformanceSample &sample)
+{
+    m_performanceCapture << std::format("{:.4f},{:.4f},{},{},{},{},{},{},{}",
+        sample.time,
+        sample.frameTime,
+        sample.glStats.drawCalls,
+        sample.glStats.indices / 3,
+        sample.glStats.uniformUploads,
+        sample.glStats.textureBinds,
+        sample.rendererStats.meshes,
+        sample.rendererStats.inFrustum,
+        sample.rendererStats.occluded);
+    for (const char *zoneName : m_performanceCaptureZones)
+    {
+        const auto zone = std::find_if(sample.zones.begin(), sample.zones.end(),
+            [zoneName](const engine::Profiler::ZoneTotal &zone) {
+                return zone.name == zoneName || std::strcmp(zone.name, zoneName) == 0;
+            });
+        if (zone != sample.zones.end())
+            m_performanceCapture << std::format(",{:.4f},{:.4f}", zone->cpuTime, zone->gpuTime);
+        else
+            m_performanceCapture << ",0,0";
+    }
+    m_performanceCapture << '\n';
+}
+
 void UI::drawSceneTree()
 {
     if (ImGui::Begin("Scene editor"))
@@ -225,6 +494,28 @@ void UI::drawSceneView()
                 ImVec2(0, 1),
                 ImVec2(1, 0));
 
+            // Select the closest mesh under the cursor, unless the click is for the gizmo
+            if (ImGui::IsItemClicked(ImGuiMouseButton_Left)
+                && !(m_selectedEntity.is_valid() && ImGuizmo::IsOver()))
+            {
+                const ImVec2 imageMin = ImGui::GetItemRectMin();
+                const ImVec2 mouse = ImGui::GetMousePos();
+                const glm::vec2 ndc(
+                    2.0f * (mouse.x - imageMin.x) / size.x - 1.0f,
+                    1.0f - 2.0f * (mouse.y - imageMin.y) / size.y);
+                const glm::mat4 inverseProjectionView
+                    = glm::inverse(m_camera.getProjection() * m_cameraTransform.getView());
+                const glm::vec4 near = inverseProjectionView * glm::vec4(ndc, -1.0f, 1.0f);
+                const glm::vec4 far = inverseProjectionView * glm::vec4(ndc, 1.0f, 1.0f);
+                const glm::vec3 origin = glm::vec3(near) / near.w;
+                const glm::vec3 direction = glm::normalize(glm::vec3(far) / far.w - origin);
+
+                const std::optional<engine::SpatialIndex::RayHit> hit
+                    = m_renderer.getSpatialIndex().raycast(origin, direction);
+                if (hit)
+                    m_selectedEntity = m_world.entity(hit->id);
+            }
+
             if (m_selectedEntity.is_valid())
             {
                 ImGuizmo::SetOrthographic(false);
@@ -241,8 +532,14 @@ void UI::drawSceneView()
                 const glm::mat4 cameraView = m_cameraTransform.getView();
 
                 ASSERT(m_selectedEntity.has<engine::components::Transform>());
-                glm::mat4 selectedEntityTransform
-                    = m_selectedEntity.get<engine::components::Transform>()->getTransform();
+                // The gizmo works in world space and the Transform is relative to the parent
+                const flecs::entity parent = m_selectedEntity.parent();
+                const engine::components::WorldTransform *parentWorldTransform
+                    = parent.is_valid() ? parent.get<engine::components::WorldTransform>() : nullptr;
+                const glm::mat4 parentMatrix
+                    = parentWorldTransform ? parentWorldTransform->matrix : glm::mat4(1.0f);
+                glm::mat4 selectedEntityTransform = parentMatrix
+                    * m_selectedEntity.get<engine::components::Transform>()->getTransform();
 
                 static ImGuizmo::OPERATION operation = ImGuizmo::TRANSLATE;
                 if (ImGui::IsWindowHovered())
@@ -264,11 +561,14 @@ void UI::drawSceneView()
                     // Already ensured that the component exists above
                     engine::components::Transform &transform
                         = *m_selectedEntity.get_mut<engine::components::Transform>();
+                    const glm::mat4 localTransform
+                        = glm::inverse(parentMatrix) * selectedEntityTransform;
                     ImGuizmo::DecomposeMatrixToComponents(
-                        glm::value_ptr(selectedEntityTransform),
+                        glm::value_ptr(localTransform),
                         glm::value_ptr(transform.position),
                         glm::value_ptr(transform.rotation),
                         glm::value_ptr(transform.scale));
+                    m_selectedEntity.modified<engine::components::Transform>();
                 }
 
             }
@@ -685,10 +985,14 @@ void UI::drawMaterialBrowser()
     }
 }
 
+// The component can be edited so it is marked as modified for flecs change detection
 template<typename T>
 inline void visitIfExists(auto &&v, flecs::entity &e) {
     if (auto *component = e.get_mut<T>())
+    {
         v(*component);
+        e.modified<T>();
+    }
 };
 
 inline void visitComponents(auto &&v, flecs::entity &e) {
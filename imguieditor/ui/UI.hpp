@@ -3,11 +3,18 @@
 #include "../AssetMetadataManager.hpp"
 #include <engine/ForwardRenderer.hpp>
 #include <engine/Components.hpp>
+#include <engine/Profiler.hpp>
+#include <opengl/gl.hpp>
+#include <utils/MemoryTracker.hpp>
 
 #include <ResourceFileFormats.hpp>
 
 #include <flecs.h>
 
+#include <fstream>
+#include <optional>
+#include <vector>
+
 class PerspectiveCamera;
 class AssetManager;
 class FrameBuffer;
@@ -30,7 +37,19 @@ public:
     void update(float timeDelta) { m_time += timeDelta; m_timeDelta = timeDelta; }
 
 private:
+    // Counters of one frame
+    struct PerformanceSample
+    {
+        float time; // In seconds
+        float frameTime; // In miliseconds
+        GL::Stats glStats;
+        engine::ForwardRenderer::Stats rendererStats;
+        std::vector<engine::Profiler::ZoneTotal> zones;
+    };
+
     void drawStats();
+    void startPerformanceCapture(const char *path, const PerformanceSample &sample);
+    void writePerformanceCaptureRow(const PerformanceSample &sample);
     void drawSceneTree();
     void drawSceneView();
     void drawAssetManager();
@@ -71,6 +90,12 @@ private:
 
     std::vector<CameraEntityView> m_cameraViews;
 
+    std::vector<PerformanceSample> m_performanceHistory; // Ring buffer
+    size_t m_oldestPerformanceSample = 0;
+    std::ofstream m_performanceCapture; // Open while capturing, one row per frame
+    std::vector<const char *> m_performanceCaptureZones;
+    std::optional<MemoryTracker::Snapshot> m_memorySnapshot; // To compare the current usage with
+
     flecs::entity m_selectedEntity;
     float m_time;
     float m_timeDelta;
@@ -0,0 +1,142 @@
+#include "HeadlessContext.hpp"
+
+#include "utils/Assert.hpp"
+#include "utils/Log.hpp"
+
+#include <GL/glew.h>
+#include <EGL/eglext.h>
+
+#include <string_view>
+
+namespace {
+
+bool hasExtension(const char *extensions, std::string_view extension)
+{
+    if (!extensions)
+        return false;
+    for (std::string_view remaining(extensions); !remaining.empty();)
+    {
+        const size_t end = remaining.find(' ');
+        if (remaining.substr(0, end) == extension)
+            return true;
+        if (end == std::string_view::npos)
+            break;
+        remaining.remove_prefix(end + 1);
+    }
+    return false;
+}
+
+} // namespace
+
+HeadlessContext::HeadlessContext()
+{}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (m_display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_context != EGL_NO_CONTEXT)
+        eglDestroyContext(m_display, m_context);
+    if (m_surface != EGL_NO_SURFACE)
+        eglDestroySurface(m_display, m_surface);
+    eglTerminate(m_display);
+}
+
+void HeadlessContext::create()
+{
+    // Client extensions, queried without a display
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+    {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay)
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (m_display == EGL_NO_DISPLAY)
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor))
+    {
+        ERROR("Error initializing EGL: {:#x}", eglGetError());
+        ASSERT(false);
+    }
+    INFO("EGL {}.{} ({})", major, minor, eglQueryString(m_display, EGL_VENDOR));
+
+    const bool surfaceless
+        = hasExtension(eglQueryString(m_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(m_display, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        ERROR("No EGL config for OpenGL rendering: {:#x}", eglGetError());
+        ASSERT(false);
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        ERROR("Error binding the OpenGL API: {:#x}", eglGetError());
+        ASSERT(false);
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (m_context == EGL_NO_CONTEXT)
+    {
+        ERROR("Error creating GL context: {:#x}", eglGetError());
+        ASSERT(false);
+    }
+
+    // Everything is drawn to framebuffers so the surface is never used
+    if (!surfaceless)
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttributes);
+        if (m_surface == EGL_NO_SURFACE)
+        {
+            ERROR("Error creating pbuffer surface: {:#x}", eglGetError());
+            ASSERT(false);
+        }
+    }
+
+    if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+    {
+        ERROR("Error making the GL context current: {:#x}", eglGetError());
+        ASSERT(false);
+    }
+
+    // GLEW built for GLX fails looking for an X display after loading the functions, the
+    // context is usable anyway
+    const GLenum glewError = glewInit();
+    if (glewError != GLEW_OK && glewError != GLEW_ERROR_NO_GLX_DISPLAY)
+    {
+        ERROR("Error initializing glew: {}", reinterpret_cast<const char*>(glewGetErrorString(glewError)));
+        ASSERT(false);
+    }
+    INFO("{} ({})",
+        reinterpret_cast<const char*>(glGetString(GL_VERSION)),
+        reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+}
+
+void HeadlessContext::finish()
+{
+    glFinish();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <EGL/egl.h>
+
+// OpenGL context without a window, to render into framebuffers in benchmarks and tests. Uses a
+// surfaceless EGL display when the driver supports it (Mesa, including llvmpipe without a GPU)
+// and a small pbuffer surface otherwise
+class HeadlessContext {
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Creates the context, makes it current and loads the OpenGL functions
+    void create();
+
+    // Waits for the commands sent to the GPU to finish, to measure the time of a frame
+    void finish();
+
+    bool isSurfaceless() const { return m_surface == EGL_NO_SURFACE; }
+
+private:
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLSurface m_surface = EGL_NO_SURFACE;
+    EGLContext m_context = EGL_NO_CONTEXT;
+};
@@ -0,0 +1,356 @@
+// Renders a scene along a scripted camera path without a window and reports the frame times,
+// the draw counts and a checksum of the last frame. Uses a fixed time step so the animations
+// and the image are the same in every run. A HUD is drawn over every frame with Renderer2D, like
+// the one of a game, the text only if the asset pack has a font
+//
+// Usage: render-bench [assets.yaml] [scene.yaml] [frames] [width] [height]
+
+#include "HeadlessContext.hpp"
+
+#include <engine/AssetManager.hpp>
+#include <engine/Components.hpp>
+#include <engine/FlecsSerialization.hpp>
+#include <engine/ForwardRenderer.hpp>
+#include <engine/ShaderLibrary.hpp>
+#include <engine/FrameArena.hpp>
+#include <engine/Loader.hpp>
+#include <engine/OrthoCamera.hpp>
+#include <engine/Renderer2D.hpp>
+#include <engine/YamlSerialization.hpp>
+#include <opengl/FrameBuffer.hpp>
+#include <opengl/gl.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <flecs.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <numbers>
+#include <print>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr float FRAME_TIME = 1000.0f / 60.0f; // In miliseconds, like the deltaTime of renderWorld
+constexpr uint32_t WARMUP_FRAMES = 10;
+
+// Returns the first font of the pack, for the HUD
+FontId loadAssetPack(AssetManager &assetManager, const std::string &path)
+{
+    paca::fileformats::NewAssetPack assetPack;
+    {
+        engine::serializers::YamlUnserializer unserializer(path);
+        unserializer(assetPack);
+    }
+
+    for (auto &staticMeshRef : assetPack.staticMeshes)
+    {
+        auto staticMesh = engine::loaders::load<paca::fileformats::StaticMesh>(staticMeshRef.path.c_str());
+        if (!staticMesh)
+        {
+            ERROR("Couldn't load mesh: {}", staticMeshRef.path);
+            continue;
+        }
+        staticMesh->name = staticMeshRef.name;
+        staticMesh->id = staticMeshRef.id;
+        assetManager.add(*staticMesh);
+    }
+    for (auto &animatedMeshRef : assetPack.animatedMeshes)
+    {
+        auto animatedMesh = engine::loaders::load<paca::fileformats::AnimatedMesh>(animatedMeshRef.path.c_str());
+        if (!animatedMesh)
+        {
+            ERROR("Couldn't load mesh: {}", animatedMeshRef.path);
+            continue;
+        }
+        animatedMesh->name = animatedMeshRef.name;
+        animatedMesh->id = animatedMeshRef.id;
+        assetManager.add(*animatedMesh);
+    }
+    for (auto &animationRef : assetPack.animations)
+    {
+        auto animation = engine::loaders::load<paca::fileformats::Animation>(animationRef.path.c_str());
+        if (!animation)
+        {
+            ERROR("Couldn't load animation: {}", animationRef.path);
+            continue;
+        }
+        animation->name = animationRef.name;
+        animation->id = animationRef.id;
+        assetManager.add(*animation);
+    }
+    for (auto &textureRef : assetPack.textures)
+    {
+        auto texture = engine::loaders::load<paca::fileformats::Texture>(textureRef.path.c_str());
+        if (!texture)
+        {
+            ERROR("Couldn't load texture: {}", textureRef.path);
+            continue;
+        }
+        texture->name = textureRef.name;
+        texture->id = textureRef.id;
+        assetManager.add(*texture);
+    }
+    for (auto &cubeMapRef : assetPack.cubeMaps)
+    {
+        auto cubeMap = engine::loaders::load<paca::fileformats::CubeMap>(cubeMapRef.path.c_str());
+        if (!cubeMap)
+        {
+            ERROR("Couldn't load cubemap: {}", cubeMapRef.path);
+            continue;
+        }
+        cubeMap->name = cubeMapRef.name;
+        cubeMap->id = cubeMapRef.id;
+        assetManager.add(*cubeMap);
+    }
+    for (auto &material : assetPack.materials)
+        assetManager.add(material);
+    for (auto &font : assetPack.fonts)
+        assetManager.add(font);
+    return assetPack.fonts.empty() ? FontId::null : FontId(assetPack.fonts.front().id);
+}
+
+// Bounds of every mesh of the scene, from the spatial index of the renderer after a frame
+AxisAlignedBoundingBox getSceneBounds(const engine::SpatialIndex &spatialIndex)
+{
+    std::vector<uint64_t> ids;
+    spatialIndex.queryBox(
+        AxisAlignedBoundingBox{glm::vec3(-INFINITY), glm::vec3(INFINITY)},
+        ids);
+    if (ids.empty())
+        return AxisAlignedBoundingBox{glm::vec3(-1.0f), glm::vec3(1.0f)};
+
+    AxisAlignedBoundingBox bounds{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+    for (uint64_t id : ids)
+    {
+        const AxisAlignedBoundingBox &aabb = spatialIndex.getAABB(id);
+        bounds.min = glm::min(bounds.min, aabb.min);
+        bounds.max = glm::max(bounds.max, aabb.max);
+    }
+    return bounds;
+}
+
+// The path circles the scene twice, going down from above it to its height and back up
+engine::components::Transform getCameraTransform(
+    const AxisAlignedBoundingBox &sceneBounds,
+    uint32_t frame,
+    uint32_t frameCount)
+{
+    const glm::vec3 center = (sceneBounds.min + sceneBounds.max) * 0.5f;
+    const float radius = std::max(glm::length(sceneBounds.max - sceneBounds.min) * 0.5f, 1.0f);
+
+    const float t = static_cast<float>(frame) / frameCount;
+    const float angle = 4.0f * std::numbers::pi_v<float> * t;
+    const float height = radius * (0.1f + 0.4f * std::abs(std::cos(2.0f * std::numbers::pi_v<float> * t)));
+
+    engine::components::Transform transform;
+    transform.position = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+
+    // Inverse of Transform::getDirection()
+    const glm::vec3 direction = glm::normalize(center - transform.position);
+    transform.rotation = glm::vec3(
+        glm::degrees(std::asin(direction.y)),
+        glm::degrees(std::atan2(direction.z, direction.x)),
+        0.0f);
+    return transform;
+}
+
+// Only depends on the frame number so the image is the same in every run. The title has the same
+// layout in every frame and the counter a new one
+void drawHud(
+    const OrthoCamera &camera,
+    uint32_t width,
+    uint32_t frame,
+    uint32_t frameCount,
+    const Font *font,
+    const AssetManager &assetManager)
+{
+    GL::setDepthTest(false);
+    Renderer2D::beginScene(camera);
+    const glm::vec2 barSize(width - 16.0f, 8.0f);
+    Renderer2D::drawQuad({8.0f, 8.0f, 0.0f}, barSize, {0.0f, 0.0f, 0.0f, 0.5f});
+    Renderer2D::drawQuad(
+        {8.0f, 8.0f, 0.0f},
+        {barSize.x * (frame + 1) / frameCount, barSize.y},
+        {0.0f, 1.0f, 0.0f, 1.0f});
+    if (font)
+    {
+        const float lineHeight = font->getHeight();
+        Renderer2D::drawString(
+            {8.0f, 24.0f + lineHeight, 0.0f},
+            "render-bench",
+            *font,
+            assetManager,
+            {1.0f, 1.0f, 1.0f, 1.0f});
+        Renderer2D::drawString(
+            {8.0f, 24.0f, 0.0f},
+            std::format("frame {}/{}", frame + 1, frameCount),
+            *font,
+            assetManager,
+            {1.0f, 1.0f, 1.0f, 1.0f});
+    }
+    Renderer2D::endScene();
+}
+
+// FNV-1a
+uint64_t checksum(const std::vector<uint8_t> &data)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (uint8_t byte : data)
+    {
+        hash ^= byte;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+float percentile(std::vector<float> values, float fraction)
+{
+    std::sort(values.begin(), values.end());
+    return values[std::min<size_t>(values.size() * fraction, values.size() - 1)];
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    const std::string assetsPath = argc > 1 ? argv[1] : "assets.yaml";
+    const std::string scenePath = argc > 2 ? argv[2] : "flecs.yaml";
+    const uint32_t frameCount = argc > 3 ? std::atoi(argv[3]) : 600;
+    const uint32_t width = argc > 4 ? std::atoi(argv[4]) : 1280;
+    const uint32_t height = argc > 5 ? std::atoi(argv[5]) : 720;
+    ASSERT_MSG(frameCount > 0 && width > 0 && height > 0, "Invalid frame count or size");
+
+    HeadlessContext context;
+    context.create();
+    GL::init();
+
+    AssetManager assetManager;
+    assetManager.setMeshVertexFormat(Mesh::VertexFormat::packed);
+    const FontId hudFontId = loadAssetPack(assetManager, assetsPath);
+    const Font *hudFont = assetManager.get(hudFontId);
+
+    flecs::world world;
+    {
+        engine::serializers::FlecsUnserializer unserializer(scenePath);
+        unserializer(world);
+    }
+
+    engine::ForwardRenderer renderer(
+        engine::ForwardRenderer::Flags::enableShadowMapping |
+        engine::ForwardRenderer::Flags::enablePreSkinning |
+        engine::ForwardRenderer::Flags::enableOcclusionCulling);
+    // So the frames don't include waiting for the shaders
+    engine::ShaderLibrary::prewarm();
+    Renderer2D::init();
+    const OrthoCamera hudCamera(0.0f, width, 0.0f, height);
+
+    std::vector<Texture> colorTextures;
+    colorTextures.emplace_back(Texture::Specification{
+        .width = width,
+        .height = height,
+        .format = Texture::Format::RGBA8,
+        .linearMinification = false,
+        .linearMagnification = false,
+        .interpolateBetweenMipmapLevels = false,
+        .tile = false,
+    });
+    FrameBuffer renderTarget({
+        .width = width,
+        .height = height,
+        .depthTextureAttachment = Texture(Texture::Specification{
+            .width = width,
+            .height = height,
+            .format = Texture::Format::depth24,
+        }),
+        .colorTextureAttachments = std::move(colorTextures),
+    });
+
+    engine::components::Camera camera;
+    camera.aspect = static_cast<float>(width) / height;
+
+    auto renderFrame = [&](const engine::components::Transform &cameraTransform, uint32_t frame) {
+        renderTarget.bind();
+        GL::clear();
+        renderer.renderWorld(FRAME_TIME, cameraTransform, camera, world, assetManager, renderTarget);
+        renderTarget.bind();
+        drawHud(hudCamera, width, frame, frameCount, hudFont, assetManager);
+        engine::FrameArena::nextFrame();
+    };
+
+    // The first frames fill the spatial index, compile the shaders and fill the caches
+    const engine::components::Transform initialTransform;
+    for (uint32_t i = 0; i < WARMUP_FRAMES; i++)
+        renderFrame(initialTransform, 0);
+    context.finish();
+    Renderer2D::resetStats();
+
+    const AxisAlignedBoundingBox sceneBounds = getSceneBounds(renderer.getSpatialIndex());
+    camera.far = std::max(camera.far, 4.0f * glm::length(sceneBounds.max - sceneBounds.min));
+
+    // Submission is the cpu time of renderWorld, the frame also waits for the gpu to finish
+    std::vector<float> submissionTimes, frameTimes;
+    submissionTimes.reserve(frameCount);
+    frameTimes.reserve(frameCount);
+    uint64_t drawCalls = 0, indices = 0;
+    for (uint32_t frame = 0; frame < frameCount; frame++)
+    {
+        const engine::components::Transform cameraTransform
+            = getCameraTransform(sceneBounds, frame, frameCount);
+
+        GL::resetStats();
+        const auto start = std::chrono::steady_clock::now();
+        renderFrame(cameraTransform, frame);
+        const auto submitted = std::chrono::steady_clock::now();
+        context.finish();
+        const auto end = std::chrono::steady_clock::now();
+
+        submissionTimes.push_back(std::chrono::duration<float, std::milli>(submitted - start).count());
+        frameTimes.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+        drawCalls += GL::getStats().drawCalls;
+        indices += GL::getStats().indices;
+    }
+
+    const Renderer2D::Stats &hudStats = Renderer2D::getStats();
+
+    std::vector<uint8_t> pixels(width * height * 4);
+    renderTarget.getColorAttachments()[0].getData(pixels.data(), pixels.size());
+
+    float totalFrameTime = 0.0f;
+    for (float frameTime : frameTimes)
+        totalFrameTime += frameTime;
+
+    std::println("frames:            {} at {}x{}", frameCount, width, height);
+    std::println("submission (ms):   median {:.3f}  p95 {:.3f}  max {:.3f}",
+        percentile(submissionTimes, 0.5f),
+        percentile(submissionTimes, 0.95f),
+        percentile(submissionTimes, 1.0f));
+    std::println("frame (ms):        median {:.3f}  p95 {:.3f}  max {:.3f}  mean {:.3f}",
+        percentile(frameTimes, 0.5f),
+        percentile(frameTimes, 0.95f),
+        percentile(frameTimes, 1.0f),
+        totalFrameTime / frameCount);
+    std::println("draw calls/frame:  {:.1f}", static_cast<double>(drawCalls) / frameCount);
+    std::println("triangles/frame:   {:.1f}", static_cast<double>(indices) / 3.0 / frameCount);
+    std::println("hud quads/frame:   {:.1f}  batches/frame {:.1f}  ended by textures {}",
+        static_cast<double>(hudStats.quads) / frameCount,
+        static_cast<double>(hudStats.batches) / frameCount,
+        hudStats.batchesEndedByTextures);
+    std::println("hud text layouts:  {} reused  {} built",
+        hudStats.textLayoutsReused,
+        hudStats.textLayoutsBuilt);
+    if (const engine::OcclusionCuller *occlusionCuller = renderer.getOcclusionCuller())
+        std::println("occluded (last):   {} of {}",
+            occlusionCuller->getStats().culledObjects,
+            occlusionCuller->getStats().testedObjects);
+    std::println("checksum:          {:016x}", checksum(pixels));
+
+    Renderer2D::shutdown();
+    engine::ShaderLibrary::clear();
+    return 0;
+}
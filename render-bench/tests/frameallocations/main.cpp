@@ -0,0 +1,263 @@
+#include "HeadlessContext.hpp"
+
+#include <engine/AssetManager.hpp>
+#include <engine/Components.hpp>
+#include <engine/ForwardRenderer.hpp>
+#include <engine/FrameArena.hpp>
+#include <engine/ShaderLibrary.hpp>
+#include <opengl/FrameBuffer.hpp>
+#include <opengl/gl.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+#include <utils/MemoryTracker.hpp>
+
+#include <flecs.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SIZE = 256;
+constexpr float FRAME_TIME = 1000.0f / 60.0f; // In miliseconds
+constexpr uint32_t GRID_SIZE = 8; // Of static cubes in each side
+constexpr uint32_t ANIMATED_MESHES = 4;
+constexpr uint32_t BONE_COUNT = 16;
+// The camera goes once around the scene in this many frames
+constexpr uint32_t CAMERA_PATH_FRAMES = 60;
+
+// Cube of side 1 centered in the origin, each face with its own vertices
+template<typename Vertex>
+void makeCube(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        for (float side : {-1.0f, 1.0f})
+        {
+            glm::vec3 normal(0.0f), u(0.0f), v(0.0f);
+            normal[axis] = side;
+            u[(axis + 1) % 3] = 0.5f;
+            v[(axis + 2) % 3] = 0.5f;
+            // Counter-clockwise seen from outside
+            if (side < 0.0f)
+                std::swap(u, v);
+
+            const uint32_t first = vertices.size();
+            for (const glm::vec2 &corner : {glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1)})
+            {
+                vertices.push_back({
+                    .position = normal * 0.5f + u * corner.x + v * corner.y,
+                    .normal = normal,
+                    .tangent = glm::normalize(u),
+                    .texture = corner * 0.5f + 0.5f,
+                });
+            }
+            for (uint32_t index : {0, 1, 2, 0, 2, 3})
+                indices.push_back(first + index);
+        }
+    }
+}
+
+// The camera circles the grid looking at its center
+engine::components::Transform getCameraTransform(uint32_t frame)
+{
+    const float angle = 2.0f * std::numbers::pi_v<float> * (frame % CAMERA_PATH_FRAMES) / CAMERA_PATH_FRAMES;
+    const float radius = 2.0f * GRID_SIZE;
+
+    engine::components::Transform transform;
+    transform.position = glm::vec3(std::cos(angle) * radius, 0.5f * radius, std::sin(angle) * radius);
+
+    // Inverse of Transform::getDirection()
+    const glm::vec3 direction = glm::normalize(-transform.position);
+    transform.rotation = glm::vec3(
+        glm::degrees(std::asin(direction.y)),
+        glm::degrees(std::atan2(direction.z, direction.x)),
+        0.0f);
+    return transform;
+}
+
+} // namespace
+
+#ifdef TRACK_HEAP_ALLOCATIONS
+// The MemoryTracker already replaces the global operator new
+uint64_t getAllocationCount()
+{
+    const MemoryTracker::Snapshot snapshot = MemoryTracker::takeSnapshot();
+    uint64_t count = 0;
+    for (const MemoryTracker::TagUsage &usage : snapshot.tags)
+        count += usage.totalHeapAllocations;
+    return count;
+}
+#else
+std::atomic<uint64_t> allocationCount = 0;
+
+uint64_t getAllocationCount()
+{
+    return allocationCount.load();
+}
+
+// Counts every allocation of the program that goes through the global operator new
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+// Renders frames of a scene with static and animated meshes, point lights and a directional light
+// with a shadow map, and checks that once the caches and the arenas are filled the frames of the
+// ForwardRenderer don't allocate from the heap: their temporaries come from the FrameArena
+int main (int argc, char *argv[]) {
+    HeadlessContext context;
+    context.create();
+    GL::init();
+
+    AssetManager assetManager;
+    assetManager.setMeshVertexFormat(Mesh::VertexFormat::packed);
+
+    paca::fileformats::StaticMesh cube{.name = "cube", .id = 1};
+    makeCube(cube.vertices, cube.indices);
+    cube.aabb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+    assetManager.add(cube);
+
+    // A chain of bones and every vertex moved by the last one
+    paca::fileformats::AnimatedMesh animatedCube{.name = "animated cube", .id = 1};
+    makeCube(animatedCube.vertices, animatedCube.indices);
+    for (paca::fileformats::AnimatedMesh::Vertex &vertex : animatedCube.vertices)
+    {
+        vertex.boneIDs = {BONE_COUNT - 1, 0, 0, 0};
+        vertex.boneWeights = {1.0f, 0.0f, 0.0f, 0.0f};
+    }
+    animatedCube.aabb = {glm::vec3(-0.5f), glm::vec3(0.5f)};
+    paca::fileformats::Animation animation{.name = "sway", .id = 1, .duration = 10.0f, .ticksPerSecond = 1};
+    for (uint32_t i = 0; i < BONE_COUNT; i++)
+    {
+        animatedCube.skeleton.bones.push_back({
+            .parentID = i == 0 ? std::numeric_limits<uint32_t>::max() : i - 1,
+            .offsetMatrix = glm::mat4(1.0f),
+        });
+        animatedCube.skeleton.boneNames.push_back("bone");
+        animation.keyframes.push_back({
+            .positions = {{.time = 0.0f, .position = glm::vec3(0.0f)}},
+            .rotations = {
+                {.time = 0.0f, .quaternion = glm::quat(1.0f, 0.0f, 0.0f, 0.0f)},
+                {.time = 10.0f, .quaternion = glm::angleAxis(0.1f, glm::vec3(0.0f, 0.0f, 1.0f))},
+            },
+            .scalings = {{.time = 0.0f, .scale = glm::vec3(1.0f)}},
+        });
+    }
+    assetManager.add(animatedCube);
+    assetManager.add(animation);
+
+    flecs::world world;
+    world.component<engine::components::Transform>("Transform")
+        .add(flecs::With, world.component<engine::components::WorldTransform>("WorldTransform"));
+
+    // The floor hides what is below it from the occlusion culling
+    world.entity()
+        .set<engine::components::Transform>({{0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {2.0f * GRID_SIZE, 1.0f, 2.0f * GRID_SIZE}})
+        .set<engine::components::StaticMesh>({StaticMeshId(1)});
+    for (uint32_t x = 0; x < GRID_SIZE; x++)
+    {
+        for (uint32_t z = 0; z < GRID_SIZE; z++)
+        {
+            const glm::vec3 position(2.0f * x - GRID_SIZE, 0.0f, 2.0f * z - GRID_SIZE);
+            world.entity()
+                .set<engine::components::Transform>({position, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}})
+                .set<engine::components::StaticMesh>({StaticMeshId(1)});
+            world.entity()
+                .set<engine::components::Transform>({position + glm::vec3(1.0f, 0.0f, 1.0f), {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}})
+                .set<engine::components::PointLight>({{1.0f, 0.5f, 0.25f}, 1.0f, 1.0f});
+        }
+    }
+    for (uint32_t i = 0; i < ANIMATED_MESHES; i++)
+    {
+        world.entity()
+            .set<engine::components::Transform>({{2.0f * i, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}})
+            .set<engine::components::AnimatedMesh>({AnimatedMeshId(1)})
+            .set<engine::components::AnimationPlayer>({.id = AnimationId(1), .progress = 1.0f * i});
+    }
+    world.entity()
+        .set<engine::components::Transform>({{0.0f, 0.0f, 0.0f}, {-60.0f, 30.0f, 0.0f}, {1.0f, 1.0f, 1.0f}})
+        .set<engine::components::DirectionalLight>({{1.0f, 1.0f, 1.0f}, 1.0f})
+        .emplace<engine::components::DirectionalLightShadowMap>(256u, std::vector<float>{5.0f, 15.0f, 40.0f});
+
+    engine::ForwardRenderer renderer(
+        engine::ForwardRenderer::Flags::enableShadowMapping |
+        engine::ForwardRenderer::Flags::enablePreSkinning |
+        engine::ForwardRenderer::Flags::enableOcclusionCulling);
+    engine::ShaderLibrary::prewarm();
+
+    std::vector<Texture> colorTextures;
+    colorTextures.emplace_back(Texture::Specification{
+        .width = SIZE,
+        .height = SIZE,
+        .format = Texture::Format::RGBA8,
+    });
+    FrameBuffer renderTarget({
+        .width = SIZE,
+        .height = SIZE,
+        .depthTextureAttachment = Texture(Texture::Specification{
+            .width = SIZE,
+            .height = SIZE,
+            .format = Texture::Format::depth24,
+        }),
+        .colorTextureAttachments = std::move(colorTextures),
+    });
+    engine::components::Camera camera;
+
+    // The temporaries of the frame are in the arenas until nextFrame()
+    size_t maxArenaUsedSize = 0;
+    auto renderFrame = [&](uint32_t frame) {
+        renderTarget.bind();
+        GL::clear();
+        renderer.renderWorld(FRAME_TIME, getCameraTransform(frame), camera, world, assetManager, renderTarget);
+        maxArenaUsedSize = std::max(maxArenaUsedSize, engine::FrameArena::getUsedSize());
+        engine::FrameArena::nextFrame();
+    };
+
+    // The first round fills the spatial index, the caches and the vectors of the renderer and
+    // the blocks of both arenas of every thread
+    uint32_t frame = 0;
+    for (; frame < CAMERA_PATH_FRAMES; frame++)
+        renderFrame(frame);
+    context.finish();
+    ASSERT(renderer.getStats().meshes == GRID_SIZE * GRID_SIZE + 1 + ANIMATED_MESHES);
+    ASSERT(renderer.getStats().inFrustum > 0);
+    ASSERT(maxArenaUsedSize > 0);
+
+    // The second round sees the same things, nothing should grow
+    const uint64_t allocationsBeforeSteadyState = getAllocationCount();
+    for (; frame < 2 * CAMERA_PATH_FRAMES; frame++)
+        renderFrame(frame);
+    const uint64_t steadyStateAllocations = getAllocationCount() - allocationsBeforeSteadyState;
+    context.finish();
+
+    INFO("{} heap allocations in {} steady state frames of the ForwardRenderer, up to {} bytes in the frame arenas",
+        steadyStateAllocations, CAMERA_PATH_FRAMES, maxArenaUsedSize);
+    ASSERT(steadyStateAllocations == 0);
+
+    return 0;
+}
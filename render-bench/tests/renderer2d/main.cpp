@@ -0,0 +1,139 @@
+#include "HeadlessContext.hpp"
+
+#include <engine/AssetManager.hpp>
+#include <engine/OrthoCamera.hpp>
+#include <engine/Renderer2D.hpp>
+#include <opengl/FrameBuffer.hpp>
+#include <opengl/gl.hpp>
+#include <utils/Assert.hpp>
+#include <utils/Log.hpp>
+
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SIZE = 64;
+
+// Single channel, like the font atlases
+paca::fileformats::Texture makeTexture(uint32_t id)
+{
+    return {
+        .name = "texture",
+        .id = id,
+        .width = 8,
+        .height = 8,
+        .channels = 1,
+        .pixelData = std::vector<uint8_t>(8 * 8, 255),
+    };
+}
+
+} // namespace
+
+int main (int argc, char *argv[]) {
+    HeadlessContext context;
+    context.create();
+    GL::init();
+    Renderer2D::init();
+
+    AssetManager assetManager;
+    std::vector<const Texture*> textures;
+    for (uint32_t id = 1; id <= Renderer2D::MAX_TEXTURES_IN_BATCH + 1; id++)
+    {
+        paca::fileformats::Texture texture = makeTexture(id);
+        assetManager.add(texture);
+        textures.push_back(assetManager.get(TextureId(id)));
+        ASSERT(textures.back());
+    }
+
+    // Two glyphs in the atlas of the last texture
+    paca::fileformats::Font fontData{
+        .name = "font",
+        .id = 1,
+        .fontHeight = 8,
+        .distanceFieldSpread = 0,
+        .glyphs = {
+            {.characterCode = 'a', .textureCoords = {0, 0}, .size = {4, 4}, .advance = {4, 0}, .offset = {0, 4}},
+            {.characterCode = 'b', .textureCoords = {4, 0}, .size = {4, 4}, .advance = {4, 0}, .offset = {0, 4}},
+        },
+        .atlasTextureId = Renderer2D::MAX_TEXTURES_IN_BATCH + 1,
+    };
+    assetManager.add(fontData);
+    const Font *font = assetManager.get(FontId(1));
+    ASSERT(font);
+
+    std::vector<Texture> colorTextures;
+    colorTextures.emplace_back(Texture::Specification{
+        .width = SIZE,
+        .height = SIZE,
+        .format = Texture::Format::RGBA8,
+    });
+    FrameBuffer renderTarget({
+        .width = SIZE,
+        .height = SIZE,
+        .depthTextureAttachment = Texture(Texture::Specification{
+            .width = SIZE,
+            .height = SIZE,
+            .format = Texture::Format::depth24,
+        }),
+        .colorTextureAttachments = std::move(colorTextures),
+    });
+    renderTarget.bind();
+    GL::viewport(SIZE, SIZE);
+    const OrthoCamera camera(0.0f, SIZE, 0.0f, SIZE);
+
+    // Colored quads share the white texture
+    Renderer2D::resetStats();
+    Renderer2D::beginScene(camera);
+    for (uint32_t i = 0; i < 3; i++)
+        Renderer2D::drawQuad({i * 8.0f, 0.0f, 0.0f}, {8.0f, 8.0f}, {1.0f, 0.0f, 0.0f, 1.0f});
+    Renderer2D::endScene();
+    ASSERT(Renderer2D::getStats().quads == 3);
+    ASSERT(Renderer2D::getStats().batches == 1);
+    ASSERT(Renderer2D::getStats().batchesEndedByTextures == 0);
+
+    // One texture more than fit in a batch
+    Renderer2D::resetStats();
+    Renderer2D::beginScene(camera);
+    for (const Texture *texture : textures)
+        Renderer2D::drawQuad({0.0f, 0.0f, 0.0f}, {8.0f, 8.0f}, *texture);
+    Renderer2D::endScene();
+    ASSERT(Renderer2D::getStats().quads == Renderer2D::MAX_TEXTURES_IN_BATCH + 1);
+    ASSERT(Renderer2D::getStats().batches == 2);
+    ASSERT(Renderer2D::getStats().batchesEndedByTextures == 1);
+
+    // One quad more than fit in a batch
+    Renderer2D::resetStats();
+    Renderer2D::beginScene(camera);
+    for (uint32_t i = 0; i < Renderer2D::MAX_QUADS_IN_BATCH + 1; i++)
+        Renderer2D::drawQuad({0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f, 0.0f, 1.0f});
+    Renderer2D::endScene();
+    ASSERT(Renderer2D::getStats().quads == Renderer2D::MAX_QUADS_IN_BATCH + 1);
+    ASSERT(Renderer2D::getStats().batches == 2);
+    ASSERT(Renderer2D::getStats().batchesEndedByTextures == 0);
+
+    // The layout of a text drawn again is reused, the glyphs without quads are skipped
+    Renderer2D::resetStats();
+    for (uint32_t scene = 0; scene < 2; scene++)
+    {
+        Renderer2D::beginScene(camera);
+        Renderer2D::drawString({0.0f, 16.0f, 0.0f}, "abc", *font, assetManager, {1.0f, 1.0f, 1.0f, 1.0f});
+        Renderer2D::drawQuad({0.0f, 0.0f, 0.0f}, {8.0f, 8.0f}, {0.0f, 0.0f, 1.0f, 1.0f});
+        Renderer2D::endScene();
+    }
+    ASSERT(Renderer2D::getStats().quads == 6);
+    ASSERT(Renderer2D::getStats().batches == 2);
+    ASSERT(Renderer2D::getStats().textLayoutsBuilt == 1);
+    ASSERT(Renderer2D::getStats().textLayoutsReused == 1);
+
+    // The scenes leave blending as they found it
+    GL::setBlending(false);
+    Renderer2D::beginScene(camera);
+    Renderer2D::endScene();
+    ASSERT(!GL::isBlending());
+
+    context.finish();
+    INFO("Renderer2D batches: OK");
+
+    Renderer2D::shutdown();
+    return 0;
+}